@@ -1,8 +1,20 @@
 
 #include "command_handler.h"
+#include "config.h"
+#include "globals.h"
+#include "rvss_vm_pipelined.h"
+#include "lockstep_checker.h"
+#include "design_space.h"
+#include "utils.h"
+#include "assembler/assembler.h"
 
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
 #include <string>
 #include <sstream>
+#include <stdexcept>
 #include <vector>
 
 namespace command_handler {
@@ -44,6 +56,38 @@ Command ParseCommand(const std::string &input) {
     command_type = command_handler::CommandType::ADD_BREAKPOINT;
   } else if (command_str=="remove_breakpoint") {
     command_type = command_handler::CommandType::REMOVE_BREAKPOINT;
+  } else if (command_str=="add_watchpoint" || command_str=="watch") {
+    command_type = command_handler::CommandType::ADD_WATCHPOINT;
+  } else if (command_str=="remove_watchpoint" || command_str=="unwatch") {
+    command_type = command_handler::CommandType::REMOVE_WATCHPOINT;
+  } else if (command_str=="profile" || command_str=="prof") {
+    command_type = command_handler::CommandType::PROFILE;
+  } else if (command_str=="callgraph" || command_str=="cg") {
+    command_type = command_handler::CommandType::CALL_GRAPH;
+  } else if (command_str=="mix" || command_str=="imix") {
+    command_type = command_handler::CommandType::INSTRUCTION_MIX;
+  } else if (command_str=="stats") {
+    command_type = command_handler::CommandType::STATS;
+  } else if (command_str=="bbv") {
+    command_type = command_handler::CommandType::BBV;
+  } else if (command_str=="btrace") {
+    command_type = command_handler::CommandType::BRANCH_TRACE;
+  } else if (command_str=="ptrace") {
+    command_type = command_handler::CommandType::PIPELINE_TRACE;
+  } else if (command_str=="cpi") {
+    command_type = command_handler::CommandType::CPI_STACK;
+  } else if (command_str=="sample") {
+    command_type = command_handler::CommandType::SAMPLE;
+  } else if (command_str=="lockstep") {
+    command_type = command_handler::CommandType::LOCKSTEP;
+  } else if (command_str=="dse") {
+    command_type = command_handler::CommandType::DESIGN_SPACE;
+  } else if (command_str=="save_state") {
+    command_type = command_handler::CommandType::SAVE_STATE;
+  } else if (command_str=="load_state") {
+    command_type = command_handler::CommandType::LOAD_STATE;
+  } else if (command_str=="bpred") {
+    command_type = command_handler::CommandType::BRANCH_PREDICTOR;
   } else if (command_str=="vm_stdin" || command_str=="vmsin") {
     command_type = command_handler::CommandType::VM_STDIN;
   }
@@ -88,9 +132,526 @@ Command ParseCommand(const std::string &input) {
   return Command(command_type, args);
 }
 
-void ExecuteCommand(const Command &command, RVSSVM& vm) {
-  (void)vm;
-  (void)command;
+namespace {
+// Parses "r", "w" or "rw" (default) into a WatchKind mask.
+uint8_t ParseWatchKind(const std::string &kind) {
+  if (kind=="r" || kind=="read") {
+    return kWatchRead;
+  } else if (kind=="w" || kind=="write") {
+    return kWatchWrite;
+  } else if (kind=="rw" || kind=="access") {
+    return kWatchAccess;
+  }
+  throw std::invalid_argument("Invalid watchpoint kind: " + kind);
+}
+
+// profile on|off|clear|report [limit]|csv <file>
+void HandleProfile(const Command &command, RVSSVM &vm) {
+  if (command.args.empty()) {
+    throw std::invalid_argument("Usage: profile on|off|clear|report [limit]|csv <file>");
+  }
+  const std::string &action = command.args[0];
+  if (action=="on") {
+    vm.profiler_.SetEnabled(true);
+  } else if (action=="off") {
+    vm.profiler_.SetEnabled(false);
+  } else if (action=="clear") {
+    vm.profiler_.Clear();
+  } else if (action=="report") {
+    size_t limit = command.args.size() > 1 ? std::stoull(command.args[1]) : 20;
+    vm.profiler_.WriteReport(std::cout, vm.program_, limit);
+  } else if (action=="csv" && command.args.size()==2) {
+    vm.profiler_.WriteCsv(command.args[1], vm.program_);
+  } else {
+    throw std::invalid_argument("Usage: profile on|off|clear|report [limit]|csv <file>");
+  }
+}
+
+// callgraph on|off|clear|report|collapsed <file> [cycles|instructions|stalls]
+void HandleCallGraph(const Command &command, RVSSVM &vm) {
+  const char *usage = "Usage: callgraph on|off|clear|report|collapsed <file> [cycles|instructions|stalls]";
+  if (command.args.empty()) {
+    throw std::invalid_argument(usage);
+  }
+  const std::string &action = command.args[0];
+  if (action=="on") {
+    vm.call_graph_.SetEnabled(true);
+  } else if (action=="off") {
+    vm.call_graph_.SetEnabled(false);
+  } else if (action=="clear") {
+    vm.call_graph_.Clear();
+  } else if (action=="report") {
+    vm.call_graph_.WriteReport(std::cout);
+  } else if (action=="collapsed" && (command.args.size()==2 || command.args.size()==3)) {
+    CallGraphProfiler::Metric metric = CallGraphProfiler::Metric::kCycles;
+    if (command.args.size()==3) {
+      if (command.args[2]=="instructions") {
+        metric = CallGraphProfiler::Metric::kInstructions;
+      } else if (command.args[2]=="stalls") {
+        metric = CallGraphProfiler::Metric::kStallCycles;
+      } else if (command.args[2]!="cycles") {
+        throw std::invalid_argument(usage);
+      }
+    }
+    vm.call_graph_.WriteCollapsedStacks(std::filesystem::path(command.args[1]), metric);
+  } else {
+    throw std::invalid_argument(usage);
+  }
+}
+
+// mix [report|json|clear]
+void HandleInstructionMix(const Command &command, RVSSVM &vm) {
+  const std::string action = command.args.empty() ? "report" : command.args[0];
+  if (command.args.size() > 1) {
+    throw std::invalid_argument("Usage: mix [report|json|clear]");
+  }
+  if (action=="report") {
+    vm.instruction_mix_.WriteReport(std::cout);
+  } else if (action=="json") {
+    vm.instruction_mix_.WriteJson(std::cout);
+  } else if (action=="clear") {
+    vm.instruction_mix_.Clear();
+  } else {
+    throw std::invalid_argument("Usage: mix [report|json|clear]");
+  }
+}
+
+// stats [json|csv] [file] | stats interval <cycles> [file]
+void HandleStats(const Command &command, RVSSVM &vm) {
+  const char *usage = "Usage: stats [json|csv] [file] | stats interval <cycles> [file]";
+  const std::string format = command.args.empty() ? "json" : command.args[0];
+  if (format=="interval") {
+    if (command.args.size() < 2 || command.args.size() > 3) {
+      throw std::invalid_argument(usage);
+    }
+    uint64_t interval = std::stoull(command.args[1]);
+    std::filesystem::path file = command.args.size()==3 ? std::filesystem::path(command.args[2])
+                                                         : globals::stats_timeseries_file_path;
+    vm.stats_.StartTimeSeries(file, interval, vm.cycle_s_);
+  } else if ((format=="json" || format=="csv") && command.args.size() <= 2) {
+    std::ofstream file;
+    if (command.args.size()==2) {
+      file.open(command.args[1]);
+      if (!file.is_open()) {
+        throw std::runtime_error("Unable to open file: " + command.args[1]);
+      }
+    }
+    std::ostream &out = file.is_open() ? static_cast<std::ostream &>(file) : std::cout;
+    if (format=="csv") {
+      vm.stats_.WriteCsv(out);
+    } else {
+      vm.stats_.WriteJson(out);
+    }
+  } else {
+    throw std::invalid_argument(usage);
+  }
+}
+
+// bbv on <interval> [file] | off | blocks [file]
+void HandleBasicBlockVectors(const Command &command, RVSSVM &vm) {
+  const char *usage = "Usage: bbv on <interval> [file] | off | blocks [file]";
+  if (command.args.empty()) {
+    throw std::invalid_argument(usage);
+  }
+  const std::string &action = command.args[0];
+  if (action=="on" && (command.args.size()==2 || command.args.size()==3)) {
+    std::filesystem::path file = command.args.size()==3 ? std::filesystem::path(command.args[2])
+                                                         : globals::bbv_file_path;
+    vm.bbv_.Start(file, std::stoull(command.args[1]));
+  } else if (action=="off" && command.args.size()==1) {
+    vm.bbv_.Stop();
+  } else if (action=="blocks" && command.args.size()==1) {
+    vm.bbv_.WriteBlockMap(std::cout, vm.program_);
+  } else if (action=="blocks" && command.args.size()==2) {
+    std::ofstream file(command.args[1]);
+    if (!file.is_open()) {
+      throw std::runtime_error("Unable to open file: " + command.args[1]);
+    }
+    vm.bbv_.WriteBlockMap(file, vm.program_);
+  } else {
+    throw std::invalid_argument(usage);
+  }
+}
+
+// btrace on [file] | off
+void HandleBranchTrace(const Command &command, RVSSVM &vm) {
+  const char *usage = "Usage: btrace on [file] | off";
+  if (command.args.empty()) {
+    throw std::invalid_argument(usage);
+  }
+  const std::string &action = command.args[0];
+  if (action=="on" && command.args.size()<=2) {
+    std::filesystem::path file = command.args.size()==2 ? std::filesystem::path(command.args[1])
+                                                         : globals::branch_trace_file_path;
+    vm.branch_trace_.Start(file);
+  } else if (action=="off" && command.args.size()==1) {
+    std::cout << "Branch trace: " << vm.branch_trace_.Records() << " branches" << std::endl;
+    vm.branch_trace_.Stop();
+  } else {
+    throw std::invalid_argument(usage);
+  }
+}
+
+// ptrace on [file [first_cycle [last_cycle]]] | off
+void HandlePipelineTrace(const Command &command, RVSSVM &vm) {
+  const char *usage = "Usage: ptrace on [file [first_cycle [last_cycle]]] | off";
+  auto *pipelined = dynamic_cast<RVSSVMPipelined *>(&vm);
+  if (!pipelined) {
+    throw std::invalid_argument("Pipeline traces need the pipelined VM");
+  }
+  if (command.args.empty()) {
+    throw std::invalid_argument(usage);
+  }
+  const std::string &action = command.args[0];
+  if (action=="on" && command.args.size()<=4) {
+    std::filesystem::path file = command.args.size()>=2 ? std::filesystem::path(command.args[1])
+                                                         : globals::pipeline_trace_file_path;
+    uint64_t first_cycle = command.args.size()>=3 ? std::stoull(command.args[2]) : 0;
+    uint64_t last_cycle = command.args.size()==4 ? std::stoull(command.args[3]) : UINT64_MAX;
+    pipelined->pipeline_trace_.Start(file, vm.program_, first_cycle, last_cycle);
+  } else if (action=="off" && command.args.size()==1) {
+    std::cout << "Pipeline trace: " << pipelined->pipeline_trace_.Instructions() << " instructions" << std::endl;
+    pipelined->pipeline_trace_.Stop();
+  } else {
+    throw std::invalid_argument(usage);
+  }
+}
+
+// cpi [report [limit]] | clear
+void HandleCpiStack(const Command &command, RVSSVM &vm) {
+  const char *usage = "Usage: cpi [report [limit]] | clear";
+  auto *pipelined = dynamic_cast<RVSSVMPipelined *>(&vm);
+  if (!pipelined) {
+    throw std::invalid_argument("CPI stacks need the pipelined VM");
+  }
+  if (command.args.empty() || (command.args[0]=="report" && command.args.size()<=2)) {
+    size_t limit = command.args.size()==2 ? std::stoull(command.args[1]) : 5;
+    pipelined->WriteCpiStack(std::cout, limit);
+  } else if (command.args[0]=="clear" && command.args.size()==1) {
+    pipelined->cpi_stack_.Clear();
+  } else {
+    throw std::invalid_argument(usage);
+  }
+}
+
+// sample <fast_forward> <warmup> <window> <period> [max_windows]
+// sample simpoints <simpoints_file> <weights_file> <interval> [warmup]
+void HandleSample(const Command &command, RVSSVM &vm) {
+  const char *usage = "Usage: sample <fast_forward> <warmup> <window> <period> [max_windows] | "
+                      "sample simpoints <simpoints> <weights> <interval> [warmup]";
+  auto *pipelined = dynamic_cast<RVSSVMPipelined *>(&vm);
+  if (!pipelined) {
+    throw std::invalid_argument("Sampled runs need the pipelined VM");
+  }
+  SamplingPlan plan;
+  if (!command.args.empty() && command.args[0]=="simpoints") {
+    if (command.args.size() < 4 || command.args.size() > 5) {
+      throw std::invalid_argument(usage);
+    }
+    plan = SamplingPlan::FromSimPoints(command.args[1], command.args[2], std::stoull(command.args[3]));
+    if (command.args.size()==5) {
+      plan.warmup = std::stoull(command.args[4]);
+    }
+  } else if (command.args.size()==4 || command.args.size()==5) {
+    plan.fast_forward = std::stoull(command.args[0]);
+    plan.warmup = std::stoull(command.args[1]);
+    plan.window = std::stoull(command.args[2]);
+    plan.period = std::stoull(command.args[3]);
+    if (command.args.size()==5) {
+      plan.max_windows = std::stoull(command.args[4]);
+    }
+  } else {
+    throw std::invalid_argument(usage);
+  }
+
+  SampledRunResult result = pipelined->RunSampled(plan);
+  result.WriteReport(std::cout);
+  std::ofstream file(globals::sampled_run_report_file_path);
+  if (file.is_open()) {
+    result.WriteReport(file);
+  }
+}
+
+// lockstep [max_instructions]
+void HandleLockstep(const Command &command, RVSSVM &vm) {
+  auto *pipelined = dynamic_cast<RVSSVMPipelined *>(&vm);
+  if (!pipelined) {
+    throw std::invalid_argument("Lockstep checking needs the pipelined VM");
+  }
+  if (command.args.size() > 1) {
+    throw std::invalid_argument("Usage: lockstep [max_instructions]");
+  }
+  uint64_t max_instructions = command.args.empty() ? 0 : std::stoull(command.args[0]);
+
+  LockstepChecker checker(*pipelined, max_instructions);
+  pipelined->RunLockstep(checker);
+  checker.WriteReport(std::cout);
+  std::ofstream file(globals::lockstep_report_file_path);
+  if (file.is_open()) {
+    checker.WriteReport(file);
+  }
+}
+
+// dse <sweep_file> [csv_file [threads]]
+void HandleDesignSpace(const Command &command, RVSSVM &vm) {
+  if (command.args.empty() || command.args.size() > 3) {
+    throw std::invalid_argument("Usage: dse <sweep_file> [csv_file [threads]]");
+  }
+  if (vm.program_size_ == 0) {
+    throw std::invalid_argument("Load a program before exploring the design space");
+  }
+  DesignSpace space = DesignSpace::FromFile(command.args[0]);
+  std::filesystem::path csv = command.args.size() >= 2 ? std::filesystem::path(command.args[1])
+                                                        : globals::design_space_file_path;
+  size_t threads = command.args.size()==3 ? std::stoull(command.args[2]) : 0;
+  std::ofstream file(csv);
+  if (!file.is_open()) {
+    throw std::runtime_error("Unable to open file: " + csv.string());
+  }
+
+  std::vector<DesignPointResult> results = RunDesignSpace(space, vm.program_, vm_config::config, threads);
+  WriteDesignSpaceCsv(file, space, results);
+  size_t failed = std::count_if(results.begin(), results.end(),
+                                [](const DesignPointResult &result) { return result.status != "ok"; });
+  std::cout << "Design space: " << results.size() << " points (" << failed << " failed), results in "
+            << csv.string() << std::endl;
+}
+
+// bpred [<type> [table_size [history_length]]] | bpred btb <entries> <ways> | bpred dump [file]
+void HandleBranchPredictor(const Command &command, RVSSVM &vm) {
+  auto *pipelined = dynamic_cast<RVSSVMPipelined *>(&vm);
+  if (!pipelined) {
+    throw std::invalid_argument("Branch prediction needs the pipelined VM");
+  }
+  vm_config::VmConfig &config = vm_config::config;
+  if (command.args.empty()) {
+    std::cout << "Branch predictor: " << config.getBranchPredictorType()
+              << ", table size " << config.getBranchPredictorTableSize()
+              << ", history " << config.getBranchHistoryLength()
+              << ", BTB " << config.getBtbSize() << " entries " << config.getBtbAssociativity() << "-way\n";
+    std::cout << "Misprediction rate: " << vm.stats_.Value("bpred.misprediction_rate")
+              << ", BTB hit rate: " << vm.stats_.Value("btb.hit_rate")
+              << ", MPKI: " << vm.stats_.Value("bpred.mpki") << "\n";
+    std::cout << "Returns: " << vm.stats_.Value("ras.returns") << " (" << vm.stats_.Value("ras.mispredictions")
+              << " mispredicted), indirect jumps: " << vm.stats_.Value("indirect.jumps") << " ("
+              << vm.stats_.Value("indirect.mispredictions") << " mispredicted)" << std::endl;
+    return;
+  }
+
+  const std::string &action = command.args[0];
+  if (action=="dump" && command.args.size() <= 2) {
+    pipelined->DumpBranchPredictionTables(command.args.size()==2 ? std::filesystem::path(command.args[1])
+                                                                   : globals::branchPredectionPath);
+    return;
+  }
+
+  vm_config::VmConfig previous = config;
+  if (action=="btb" && command.args.size()==3) {
+    config.setBtbSize(std::stoull(command.args[1]));
+    config.setBtbAssociativity(std::stoull(command.args[2]));
+  } else if (action!="btb" && action!="dump" && command.args.size() <= 3) {
+    config.setBranchPredictorType(action);
+    if (command.args.size() > 1) {
+      config.setBranchPredictorTableSize(std::stoull(command.args[1]));
+    }
+    if (command.args.size() > 2) {
+      config.setBranchHistoryLength(std::stoull(command.args[2]));
+    }
+  } else {
+    throw std::invalid_argument("Usage: bpred [<bimodal|gshare|tournament|tage|perceptron> [table_size [history]]]"
+                                " | bpred btb <entries> <ways> | bpred dump [file]");
+  }
+  try {
+    pipelined->ConfigureBranchPredictor();
+  } catch (...) {
+    config = previous;
+    throw;
+  }
+}
+
+// load <file>: assembles the file and loads it into a freshly reset VM
+void HandleLoad(const Command &command, RVSSVM &vm) {
+  if (command.args.size() != 1) {
+    throw std::invalid_argument("Usage: load <file>");
+  }
+  Assembler assembler(vm.registers_);
+  AssembledProgram program = assembler.assemble(command.args[0]);
+  if (program.errorCount != 0) {
+    throw std::runtime_error(std::to_string(program.errorCount) + " assembler error(s) in " + command.args[0] +
+                             ", see " + globals::errors_dump_file_path.string());
+  }
+  vm.Reset();
+  vm.LoadProgram(program);
+}
+
+// Prints where a run or step left the VM, e.g. "VM_BREAKPOINT_HIT: pc 0x1c, 12 instructions, 19 cycles"
+void ReportStop(const RVSSVM &vm) {
+  std::string status = vm.output_status_;
+  if (status.empty()) {
+    status = vm.GetProgramCounter() >= vm.program_size_ ? "VM_PROGRAM_END" : "VM_STOPPED";
+  }
+  std::cout << status << ": pc 0x" << std::hex
+            << vm.GetProgramCounter() << std::dec << ", " << vm.instructions_retired_ << " instructions, "
+            << vm.cycle_s_ << " cycles" << std::endl;
+}
+
+// add_watchpoint <address> [size=4] [r|w|rw]
+void HandleWatchpoint(const Command &command, RVSSVM &vm, bool add) {
+  if (command.args.empty() || command.args.size() > 3) {
+    throw std::invalid_argument("Usage: <address> [size] [r|w|rw]");
+  }
+  uint64_t address = std::stoull(command.args[0], nullptr, 0);
+  uint64_t size = command.args.size() > 1 ? std::stoull(command.args[1], nullptr, 0) : 4;
+  uint8_t kind = command.args.size() > 2 ? ParseWatchKind(command.args[2]) : static_cast<uint8_t>(kWatchAccess);
+  if (add) {
+    vm.AddWatchpoint(address, size, kind);
+  } else {
+    vm.RemoveWatchpoint(address, size, kind);
+  }
+}
+} // namespace
+
+bool ExecuteCommand(const Command &command, RVSSVM& vm) {
+  try {
+    switch (command.type) {
+      case CommandType::LOAD:
+        HandleLoad(command, vm);
+        break;
+      case CommandType::RUN:
+      case CommandType::DEBUG_RUN:
+        if (vm.program_size_ == 0) {
+          throw std::invalid_argument("Load a program before running it");
+        }
+        vm.ClearStop();
+        vm.output_status_.clear();
+        if (command.type==CommandType::RUN) {
+          vm.Run();
+        } else {
+          vm.DebugRun();
+        }
+        ReportStop(vm);
+        break;
+      case CommandType::STEP:
+        vm.output_status_.clear();
+        vm.Step();
+        ReportStop(vm);
+        break;
+      case CommandType::UNDO:
+        vm.output_status_.clear();
+        vm.Undo();
+        ReportStop(vm);
+        break;
+      case CommandType::RESET:
+        vm.Reset();
+        break;
+      case CommandType::ADD_BREAKPOINT: {
+        // add_breakpoint <line> [condition], e.g. add_breakpoint 12 "a0 == 0 && hits >= 1000"
+        if (command.args.empty()) {
+          throw std::invalid_argument("Usage: <line> [condition]");
+        }
+        uint64_t line = std::stoull(command.args[0], nullptr, 0);
+        std::string condition;
+        for (size_t i = 1; i < command.args.size(); ++i) {
+          if (i > 1) {
+            condition += ' ';
+          }
+          condition += command.args[i];
+        }
+        vm.AddBreakpoint(line, true, condition);
+        break;
+      }
+      case CommandType::REMOVE_BREAKPOINT: {
+        if (command.args.size() != 1) {
+          throw std::invalid_argument("Usage: <line>");
+        }
+        vm.RemoveBreakpoint(std::stoull(command.args[0], nullptr, 0));
+        break;
+      }
+      case CommandType::ADD_WATCHPOINT:
+        HandleWatchpoint(command, vm, true);
+        break;
+      case CommandType::REMOVE_WATCHPOINT:
+        HandleWatchpoint(command, vm, false);
+        break;
+      case CommandType::PROFILE:
+        HandleProfile(command, vm);
+        break;
+      case CommandType::CALL_GRAPH:
+        HandleCallGraph(command, vm);
+        break;
+      case CommandType::INSTRUCTION_MIX:
+        HandleInstructionMix(command, vm);
+        break;
+      case CommandType::STATS:
+        HandleStats(command, vm);
+        break;
+      case CommandType::BBV:
+        HandleBasicBlockVectors(command, vm);
+        break;
+      case CommandType::BRANCH_TRACE:
+        HandleBranchTrace(command, vm);
+        break;
+      case CommandType::PIPELINE_TRACE:
+        HandlePipelineTrace(command, vm);
+        break;
+      case CommandType::CPI_STACK:
+        HandleCpiStack(command, vm);
+        break;
+      case CommandType::SAMPLE:
+        HandleSample(command, vm);
+        break;
+      case CommandType::LOCKSTEP:
+        HandleLockstep(command, vm);
+        break;
+      case CommandType::DESIGN_SPACE:
+        HandleDesignSpace(command, vm);
+        break;
+      case CommandType::BRANCH_PREDICTOR:
+        HandleBranchPredictor(command, vm);
+        break;
+      case CommandType::SAVE_STATE:
+      case CommandType::LOAD_STATE: {
+        if (command.args.size() != 1) {
+          throw std::invalid_argument("Usage: <file>");
+        }
+        if (command.type==CommandType::SAVE_STATE) {
+          vm.SaveState(command.args[0]);
+        } else {
+          vm.LoadState(command.args[0]);
+        }
+        break;
+      }
+      default:
+        throw std::invalid_argument("Command not available in the console");
+    }
+  } catch (const std::exception &e) {
+    std::cerr << "VM_COMMAND_ERROR: " << e.what() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+size_t RunConsole(std::istream &in, RVSSVM &vm) {
+  setupVmStateDirectory();
+  size_t failed = 0;
+  std::string line;
+  while (std::getline(in, line)) {
+    size_t first = line.find_first_not_of(" \t\r");
+    if (first == std::string::npos || line[first] == '#') {
+      continue;
+    }
+    Command command = ParseCommand(line);
+    if (command.type==CommandType::EXIT) {
+      break;
+    }
+    if (command.type==CommandType::INVALID) {
+      std::cerr << "VM_COMMAND_ERROR: Unknown command: " << line << std::endl;
+      ++failed;
+    } else if (!ExecuteCommand(command, vm)) {
+      ++failed;
+    }
+  }
+  return failed;
 }
 
 } // namespace command_handler
@@ -3,6 +3,7 @@
 
 #include "rvss_vm.h"
 
+#include <istream>
 #include <vector>
 
 namespace command_handler {
@@ -24,6 +25,22 @@ enum class CommandType {
   DUMP_CACHE,
   ADD_BREAKPOINT,
   REMOVE_BREAKPOINT,
+  ADD_WATCHPOINT,
+  REMOVE_WATCHPOINT,
+  PROFILE,
+  CALL_GRAPH,
+  INSTRUCTION_MIX,
+  STATS,
+  BBV,
+  BRANCH_TRACE,
+  PIPELINE_TRACE,
+  CPI_STACK,
+  SAMPLE,
+  LOCKSTEP,
+  DESIGN_SPACE,
+  SAVE_STATE,
+  LOAD_STATE,
+  BRANCH_PREDICTOR,
   VM_STDIN,
   EXIT
 };
@@ -47,7 +64,13 @@ struct Command {
 
 Command ParseCommand(const std::string &input);
 
-void ExecuteCommand(const Command& command, RVSSVM& vm);
+// Runs one command against vm. Errors are reported on stderr as VM_COMMAND_ERROR
+// lines; returns false if the command failed.
+bool ExecuteCommand(const Command& command, RVSSVM& vm);
+
+// Reads commands line by line from in until exit or end of input and returns the
+// number of commands that failed. Backs the `risc-simulator --cli` mode.
+size_t RunConsole(std::istream &in, RVSSVM &vm);
 
 } // namespace CommandParser
 
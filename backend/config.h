@@ -16,6 +16,17 @@ enum class VmTypes {
   MULTI_STAGE
 };
 
+struct FunctionalUnitConfig {
+  uint64_t latency;
+  uint64_t interval;
+  uint64_t count = 1; // identical copies of the unit
+};
+
+constexpr uint64_t kMaxFunctionalUnitCount = 4;
+constexpr uint64_t kMaxPipelineStageDepth = 4;
+constexpr uint64_t kMaxFetchTargets = 16;
+constexpr uint64_t kMaxInstructionBufferEntries = 32;
+
 struct VmConfig {
   VmTypes vm_type = VmTypes::SINGLE_STAGE;
   uint64_t run_step_delay = 300;
@@ -24,6 +35,48 @@ struct VmConfig {
   uint64_t data_section_start = 0x10000000; // Default start address for data section
   uint64_t text_section_start = 0x0; // Default start address for text section
   uint64_t bss_section_start = 0x11000000; // Default start address for BSS section
+  uint64_t pipeline_undo_depth = 10000; // Cycles of undo history kept by the pipelined VM
+  uint64_t pipeline_undo_snapshot_interval = 64; // Full latch snapshot every N undo records
+  std::string branch_predictor_type = "bimodal"; // bimodal, gshare, tournament, tage or perceptron
+  uint64_t branch_predictor_table_size = 1024; // Entries of the predictor's main table (power of two)
+  uint64_t branch_history_length = 0; // Global history bits; 0 uses the predictor's default
+  uint64_t btb_size = 256; // Branch target buffer entries
+  uint64_t btb_associativity = 4;
+  uint64_t ras_depth = 16; // Return address stack entries
+  uint64_t indirect_predictor_size = 256; // Indirect target predictor entries (power of two)
+  uint64_t indirect_history_length = 12; // Path history bits hashed into the indirect predictor index
+  // Functional unit timing of the pipelined VM as {latency, initiation interval, copies};
+  // an interval equal to the latency models an unpipelined unit
+  FunctionalUnitConfig int_alu_timing{1, 1, 2};
+  FunctionalUnitConfig int_mul_timing{3, 1};
+  FunctionalUnitConfig int_div_timing{20, 20};
+  FunctionalUnitConfig fp_add_timing{4, 1};
+  FunctionalUnitConfig fp_mul_timing{4, 1};
+  FunctionalUnitConfig fp_fma_timing{5, 1};
+  FunctionalUnitConfig fp_div_timing{15, 15};
+  FunctionalUnitConfig fp_sqrt_timing{20, 20};
+  FunctionalUnitConfig fp_misc_timing{2, 1};
+  // Pipelined VM: cycles spent in fetch, execute and memory (1 each is the classic five stages)
+  uint64_t fetch_stages = 1;
+  uint64_t execute_stages = 1;
+  uint64_t memory_stages = 1;
+  // Pipelined VM: with a decoupled frontend the branch predictor runs ahead into a fetch target
+  // queue, and fetch moves whole blocks of up to fetch_block_bytes into an instruction buffer
+  bool decoupled_frontend = false;
+  uint64_t fetch_target_queue_entries = 8;
+  uint64_t fetch_block_bytes = 32;
+  uint64_t instruction_buffer_entries = 16;
+  // Dual-issue VM: instructions issued per cycle and how many of a pair may be memory ops or branches
+  uint64_t issue_width = 2;
+  uint64_t memory_ops_per_cycle = 1;
+  uint64_t branches_per_cycle = 1;
+  // Out-of-order VM: window structure sizes and the fetch/dispatch/issue/commit width
+  uint64_t ooo_width = 4;
+  uint64_t rob_size = 64;
+  uint64_t fetch_queue_size = 16;
+  uint64_t int_queue_size = 24;
+  uint64_t fp_queue_size = 16;
+  uint64_t lsq_size = 24;
 
   void setVmType(const VmTypes &type) {
     vm_type = type;
@@ -39,6 +92,220 @@ struct VmConfig {
   uint64_t getRunStepDelay() const {
     return run_step_delay;
   }
+  void setPipelineUndoDepth(uint64_t depth) {
+    pipeline_undo_depth = depth;
+  }
+  uint64_t getPipelineUndoDepth() const {
+    return pipeline_undo_depth;
+  }
+  void setPipelineUndoSnapshotInterval(uint64_t interval) {
+    pipeline_undo_snapshot_interval = interval;
+  }
+  uint64_t getPipelineUndoSnapshotInterval() const {
+    return pipeline_undo_snapshot_interval;
+  }
+  void setBranchPredictorType(const std::string &type) {
+    branch_predictor_type = type;
+  }
+  const std::string &getBranchPredictorType() const {
+    return branch_predictor_type;
+  }
+  void setBranchPredictorTableSize(uint64_t size) {
+    branch_predictor_table_size = size;
+  }
+  uint64_t getBranchPredictorTableSize() const {
+    return branch_predictor_table_size;
+  }
+  void setBranchHistoryLength(uint64_t length) {
+    branch_history_length = length;
+  }
+  uint64_t getBranchHistoryLength() const {
+    return branch_history_length;
+  }
+  void setBtbSize(uint64_t size) {
+    btb_size = size;
+  }
+  uint64_t getBtbSize() const {
+    return btb_size;
+  }
+  void setBtbAssociativity(uint64_t ways) {
+    btb_associativity = ways;
+  }
+  uint64_t getBtbAssociativity() const {
+    return btb_associativity;
+  }
+  void setRasDepth(uint64_t depth) {
+    ras_depth = depth;
+  }
+  uint64_t getRasDepth() const {
+    return ras_depth;
+  }
+  void setIndirectPredictorSize(uint64_t size) {
+    indirect_predictor_size = size;
+  }
+  uint64_t getIndirectPredictorSize() const {
+    return indirect_predictor_size;
+  }
+  void setIndirectHistoryLength(uint64_t length) {
+    indirect_history_length = length;
+  }
+  uint64_t getIndirectHistoryLength() const {
+    return indirect_history_length;
+  }
+  // Returns the timing entry for a [FunctionalUnits] unit name, or nullptr if there is none
+  FunctionalUnitConfig *getFunctionalUnitConfig(const std::string &unit) {
+    if (unit == "int_alu") return &int_alu_timing;
+    if (unit == "int_mul") return &int_mul_timing;
+    if (unit == "int_div") return &int_div_timing;
+    if (unit == "fp_add") return &fp_add_timing;
+    if (unit == "fp_mul") return &fp_mul_timing;
+    if (unit == "fp_fma") return &fp_fma_timing;
+    if (unit == "fp_div") return &fp_div_timing;
+    if (unit == "fp_sqrt") return &fp_sqrt_timing;
+    if (unit == "fp_misc") return &fp_misc_timing;
+    return nullptr;
+  }
+  const FunctionalUnitConfig *getFunctionalUnitConfig(const std::string &unit) const {
+    return const_cast<VmConfig *>(this)->getFunctionalUnitConfig(unit);
+  }
+  void setFunctionalUnitTiming(const std::string &key, uint64_t cycles) {
+    size_t split = key.rfind('_');
+    FunctionalUnitConfig *unit = split == std::string::npos ? nullptr
+                                                            : getFunctionalUnitConfig(key.substr(0, split));
+    std::string field = split == std::string::npos ? "" : key.substr(split + 1);
+    if (!unit || (field != "latency" && field != "interval" && field != "count")) {
+      throw std::invalid_argument("Unknown key: " + key);
+    }
+    if (field == "count") {
+      if (cycles == 0 || cycles > kMaxFunctionalUnitCount) {
+        throw std::invalid_argument(key + " must be between 1 and " + std::to_string(kMaxFunctionalUnitCount));
+      }
+      unit->count = cycles;
+      return;
+    }
+    if (cycles == 0) {
+      throw std::invalid_argument(key + " must be at least 1 cycle");
+    }
+    (field == "latency" ? unit->latency : unit->interval) = cycles;
+  }
+  void setPipelineDepth(const std::string &key, uint64_t stages) {
+    uint64_t *depth = key == "fetch_stages" ? &fetch_stages
+                    : key == "execute_stages" ? &execute_stages
+                    : key == "memory_stages" ? &memory_stages
+                                              : nullptr;
+    if (!depth) {
+      throw std::invalid_argument("Unknown key: " + key);
+    }
+    if (stages == 0 || stages > kMaxPipelineStageDepth) {
+      throw std::invalid_argument(key + " must be between 1 and " + std::to_string(kMaxPipelineStageDepth));
+    }
+    *depth = stages;
+  }
+  uint64_t getFetchStages() const {
+    return fetch_stages;
+  }
+  uint64_t getExecuteStages() const {
+    return execute_stages;
+  }
+  uint64_t getMemoryStages() const {
+    return memory_stages;
+  }
+  void setFrontendParameter(const std::string &key, uint64_t value) {
+    if (key == "decoupled") {
+      if (value > 1) {
+        throw std::invalid_argument("decoupled must be 0 or 1");
+      }
+      decoupled_frontend = value != 0;
+      return;
+    }
+    if (key == "fetch_target_queue_entries") {
+      if (value == 0 || value > kMaxFetchTargets) {
+        throw std::invalid_argument(key + " must be between 1 and " + std::to_string(kMaxFetchTargets));
+      }
+      fetch_target_queue_entries = value;
+    } else if (key == "fetch_block_bytes") {
+      if (value < 4 || (value & (value - 1)) != 0) {
+        throw std::invalid_argument(key + " must be a power of two of at least 4");
+      }
+      fetch_block_bytes = value;
+    } else if (key == "instruction_buffer_entries") {
+      if (value == 0 || value > kMaxInstructionBufferEntries) {
+        throw std::invalid_argument(key + " must be between 1 and " + std::to_string(kMaxInstructionBufferEntries));
+      }
+      instruction_buffer_entries = value;
+    } else {
+      throw std::invalid_argument("Unknown key: " + key);
+    }
+  }
+  bool isDecoupledFrontend() const {
+    return decoupled_frontend;
+  }
+  uint64_t getFetchTargetQueueEntries() const {
+    return fetch_target_queue_entries;
+  }
+  uint64_t getFetchBlockBytes() const {
+    return fetch_block_bytes;
+  }
+  uint64_t getInstructionBufferEntries() const {
+    return instruction_buffer_entries;
+  }
+  void setDualIssueLimit(const std::string &key, uint64_t value) {
+    uint64_t *limit = key == "issue_width" ? &issue_width
+                    : key == "memory_ops_per_cycle" ? &memory_ops_per_cycle
+                    : key == "branches_per_cycle" ? &branches_per_cycle
+                                                   : nullptr;
+    if (!limit) {
+      throw std::invalid_argument("Unknown key: " + key);
+    }
+    if (value == 0 || value > 2) {
+      throw std::invalid_argument(key + " must be 1 or 2");
+    }
+    *limit = value;
+  }
+  void setOutOfOrderLimit(const std::string &key, uint64_t value) {
+    uint64_t *limit = key == "width" ? &ooo_width
+                    : key == "rob_size" ? &rob_size
+                    : key == "fetch_queue_size" ? &fetch_queue_size
+                    : key == "int_queue_size" ? &int_queue_size
+                    : key == "fp_queue_size" ? &fp_queue_size
+                    : key == "lsq_size" ? &lsq_size
+                                        : nullptr;
+    if (!limit) {
+      throw std::invalid_argument("Unknown key: " + key);
+    }
+    const uint64_t max = key == "width" ? 8 : 1024;
+    if (value == 0 || value > max) {
+      throw std::invalid_argument(key + " must be between 1 and " + std::to_string(max));
+    }
+    *limit = value;
+  }
+  uint64_t getOutOfOrderWidth() const {
+    return ooo_width;
+  }
+  uint64_t getRobSize() const {
+    return rob_size;
+  }
+  uint64_t getFetchQueueSize() const {
+    return fetch_queue_size;
+  }
+  uint64_t getIntQueueSize() const {
+    return int_queue_size;
+  }
+  uint64_t getFpQueueSize() const {
+    return fp_queue_size;
+  }
+  uint64_t getLsqSize() const {
+    return lsq_size;
+  }
+  uint64_t getIssueWidth() const {
+    return issue_width;
+  }
+  uint64_t getMemoryOpsPerCycle() const {
+    return memory_ops_per_cycle;
+  }
+  uint64_t getBranchesPerCycle() const {
+    return branches_per_cycle;
+  }
   void setMemorySize(uint64_t size) {
     memory_size = size;
   }
@@ -86,6 +353,10 @@ struct VmConfig {
         }
       } else if (key == "run_step_delay") {
         setRunStepDelay(std::stoull(value));
+      } else if (key == "pipeline_undo_depth") {
+        setPipelineUndoDepth(std::stoull(value));
+      } else if (key == "pipeline_undo_snapshot_interval") {
+        setPipelineUndoSnapshotInterval(std::stoull(value));
       } else {
         throw std::invalid_argument("Unknown key: " + key);
       }
@@ -107,7 +378,42 @@ struct VmConfig {
       else {
         throw std::invalid_argument("Unknown key: " + key);
       }
-    } 
+    } else if (section == "BranchPrediction") {
+      if (key == "branch_prediction_type") {
+        setBranchPredictorType(value);
+      } else if (key == "branch_prediction_table_size") {
+        setBranchPredictorTableSize(std::stoull(value));
+      } else if (key == "branch_history_length") {
+        setBranchHistoryLength(std::stoull(value));
+      } else if (key == "btb_size") {
+        setBtbSize(std::stoull(value));
+      } else if (key == "btb_associativity") {
+        setBtbAssociativity(std::stoull(value));
+      } else if (key == "ras_depth") {
+        setRasDepth(std::stoull(value));
+      } else if (key == "indirect_predictor_size") {
+        setIndirectPredictorSize(std::stoull(value));
+      } else if (key == "indirect_history_length") {
+        setIndirectHistoryLength(std::stoull(value));
+      } else {
+        throw std::invalid_argument("Unknown key: " + key);
+      }
+    }
+    else if (section == "FunctionalUnits") {
+      setFunctionalUnitTiming(key, std::stoull(value));
+    }
+    else if (section == "PipelineDepth") {
+      setPipelineDepth(key, std::stoull(value));
+    }
+    else if (section == "Frontend") {
+      setFrontendParameter(key, std::stoull(value));
+    }
+    else if (section == "DualIssue") {
+      setDualIssueLimit(key, std::stoull(value));
+    }
+    else if (section == "OutOfOrder") {
+      setOutOfOrderLimit(key, std::stoull(value));
+    }
     
     
     
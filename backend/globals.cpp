@@ -12,6 +12,18 @@ std::filesystem::path globals::memory_dump_file_path = (globals::invokation_path
 std::filesystem::path globals::cache_dump_file_path = (globals::invokation_path / "vm_state" / "cache_dump.json");
 std::filesystem::path globals::vm_state_dump_file_path = (globals::invokation_path / "vm_state" / "vm_state_dump.json");
 std::filesystem::path globals::branchPredectionPath = (globals::invokation_path / "vm_state" / "branchPrediction.txt");
+std::filesystem::path globals::profile_report_file_path = (globals::invokation_path / "vm_state" / "profile_report.txt");
+std::filesystem::path globals::call_graph_report_file_path = (globals::invokation_path / "vm_state" / "call_graph.txt");
+std::filesystem::path globals::call_graph_stacks_file_path = (globals::invokation_path / "vm_state" / "call_graph.folded");
+std::filesystem::path globals::stats_file_path = (globals::invokation_path / "vm_state" / "stats.json");
+std::filesystem::path globals::stats_timeseries_file_path = (globals::invokation_path / "vm_state" / "stats_timeseries.csv");
+std::filesystem::path globals::bbv_file_path = (globals::invokation_path / "vm_state" / "bbv.bb");
+std::filesystem::path globals::bbv_blocks_file_path = (globals::invokation_path / "vm_state" / "bbv_blocks.txt");
+std::filesystem::path globals::branch_trace_file_path = (globals::invokation_path / "vm_state" / "branch_trace.bin");
+std::filesystem::path globals::pipeline_trace_file_path = (globals::invokation_path / "vm_state" / "pipeline_trace.kanata");
+std::filesystem::path globals::sampled_run_report_file_path = (globals::invokation_path / "vm_state" / "sampled_run.txt");
+std::filesystem::path globals::lockstep_report_file_path = (globals::invokation_path / "vm_state" / "lockstep.txt");
+std::filesystem::path globals::design_space_file_path = (globals::invokation_path / "vm_state" / "design_space.csv");
 
 bool globals::verbose_errors_print = false;
 bool globals::verbose_warnings = false;
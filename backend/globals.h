@@ -19,6 +19,18 @@ extern std::filesystem::path memory_dump_file_path;
 extern std::filesystem::path cache_dump_file_path;
 extern std::filesystem::path vm_state_dump_file_path;
 extern std::filesystem::path branchPredectionPath;
+extern std::filesystem::path profile_report_file_path;
+extern std::filesystem::path call_graph_report_file_path;
+extern std::filesystem::path call_graph_stacks_file_path;
+extern std::filesystem::path stats_file_path;
+extern std::filesystem::path stats_timeseries_file_path;
+extern std::filesystem::path bbv_file_path;
+extern std::filesystem::path bbv_blocks_file_path;
+extern std::filesystem::path branch_trace_file_path;
+extern std::filesystem::path pipeline_trace_file_path;
+extern std::filesystem::path sampled_run_report_file_path;
+extern std::filesystem::path lockstep_report_file_path;
+extern std::filesystem::path design_space_file_path;
 //extern std::string output_file;
 
 extern bool verbose_errors_print;
@@ -0,0 +1,359 @@
+/**
+ * @file command_handler_tests.cpp
+ * @brief Drives each console feature through ParseCommand/ExecuteCommand.
+ *
+ * Usage: command_handler_tests <feature>. ctest runs one feature per test; each
+ * loads a small program with `load` and checks the VM state and output files.
+ */
+
+#include "command_handler.h"
+#include "config.h"
+#include "globals.h"
+#include "rvss_vm_dual_issue.h"
+#include "utils.h"
+
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+// Sums arr[0..9] (55) through a call per element and stores the running sum back.
+// Line 13 is the store, line 14 the induction increment.
+constexpr char kProgram[] =
+    ".data\n"
+    "arr: .dword 5, 3, 9, 1, 7, 2, 8, 6, 4, 10\n"
+    ".text\n"
+    "    la x10, arr\n"
+    "    li x11, 10\n"
+    "    li x12, 0\n"
+    "    li x13, 0\n"
+    "loop:\n"
+    "    slli x14, x13, 3\n"
+    "    add x15, x10, x14\n"
+    "    ld x16, 0(x15)\n"
+    "    jal x1, accumulate\n"
+    "    sd x12, 0(x15)\n"
+    "    addi x13, x13, 1\n"
+    "    blt x13, x11, loop\n"
+    "    jal x0, end\n"
+    "accumulate:\n"
+    "    add x12, x12, x16\n"
+    "    ret\n"
+    "end:\n"
+    "    addi x31, x0, 1\n";
+
+std::filesystem::path test_dir;
+
+void Check(bool condition, const std::string &message) {
+  if (!condition) {
+    throw std::runtime_error(message);
+  }
+}
+
+std::string ReadFile(const std::filesystem::path &path) {
+  std::ifstream file(path);
+  Check(file.is_open(), "missing output file " + path.string());
+  std::ostringstream contents;
+  contents << file.rdbuf();
+  return contents.str();
+}
+
+bool Contains(const std::string &text, const std::string &part) {
+  return text.find(part) != std::string::npos;
+}
+
+// Runs one console line, fails the test if the command reports an error and
+// returns what it printed on stdout.
+std::string Run(RVSSVM &vm, const std::string &line) {
+  std::ostringstream captured;
+  std::streambuf *previous = std::cout.rdbuf(captured.rdbuf());
+  bool ok = command_handler::ExecuteCommand(command_handler::ParseCommand(line), vm);
+  std::cout.rdbuf(previous);
+  Check(ok, "command failed: " + line);
+  return captured.str();
+}
+
+// Expects the command to be rejected with a VM_COMMAND_ERROR.
+void RunRejected(RVSSVM &vm, const std::string &line) {
+  std::ostringstream captured;
+  std::streambuf *previous = std::cerr.rdbuf(captured.rdbuf());
+  bool ok = command_handler::ExecuteCommand(command_handler::ParseCommand(line), vm);
+  std::cerr.rdbuf(previous);
+  Check(!ok && Contains(captured.str(), "VM_COMMAND_ERROR"), "command not rejected: " + line);
+}
+
+std::string Path(const std::string &name) {
+  return (test_dir / name).string();
+}
+
+struct Machine {
+  RegisterFile registers;
+  std::unique_ptr<RVSSVM> vm;
+
+  explicit Machine(const std::string &kind) {
+    if (kind == "single_cycle") {
+      vm = std::make_unique<RVSSVM>(&registers);
+    } else if (kind == "dual_issue") {
+      vm = std::make_unique<RVSSVMDualIssue>(&registers);
+    } else {
+      vm = std::make_unique<RVSSVMPipelined>(&registers);
+    }
+    if (kind != "single_cycle") {
+      vm->SetPipelineConfig(true, true, true, true);
+    }
+    Run(*vm, "load " + Path("program.s"));
+  }
+};
+
+void CheckFinished(Machine &machine) {
+  Check(machine.registers.ReadGpr(12) == 55, "wrong sum: " + std::to_string(machine.registers.ReadGpr(12)));
+  Check(machine.registers.ReadGpr(31) == 1, "program did not reach its end");
+}
+
+void TestConsole() {
+  Machine machine("pipelined");
+  std::istringstream script("# comment\n"
+                            "load " + Path("program.s") + "\n"
+                            "step\n"
+                            "undo\n"
+                            "bogus\n"
+                            "run\n"
+                            "exit\n"
+                            "reset\n");
+  std::ostringstream out;
+  std::ostringstream err;
+  std::streambuf *previous_out = std::cout.rdbuf(out.rdbuf());
+  std::streambuf *previous_err = std::cerr.rdbuf(err.rdbuf());
+  size_t failed = command_handler::RunConsole(script, *machine.vm);
+  std::cout.rdbuf(previous_out);
+  std::cerr.rdbuf(previous_err);
+
+  Check(failed == 1, "expected only the unknown command to fail, got " + std::to_string(failed));
+  Check(Contains(err.str(), "Unknown command: bogus"), "unknown command not reported");
+  Check(Contains(out.str(), "VM_PROGRAM_END"), "run did not report the end of the program");
+  CheckFinished(machine);
+
+  RunRejected(*machine.vm, "load " + Path("missing.s"));
+  RunRejected(*machine.vm, "redo");
+}
+
+void TestBreakpoints() {
+  for (const char *kind : {"single_cycle", "pipelined", "dual_issue"}) {
+    Machine machine(kind);
+    Run(*machine.vm, "add_breakpoint 14 \"x13 == 3\"");
+    std::string out = Run(*machine.vm, "run");
+    Check(Contains(out, "VM_BREAKPOINT_HIT"), std::string(kind) + ": conditional breakpoint not hit");
+    Check(machine.registers.ReadGpr(13) == 3, std::string(kind) + ": stopped with x13 = "
+                                                    + std::to_string(machine.registers.ReadGpr(13)));
+    Check(machine.registers.ReadGpr(12) == 5 + 3 + 9 + 1, std::string(kind) + ": stopped after the wrong store");
+    Run(*machine.vm, "remove_breakpoint 14");
+    Run(*machine.vm, "run");
+    CheckFinished(machine);
+    RunRejected(*machine.vm, "add_breakpoint");
+  }
+}
+
+void TestWatchpoints() {
+  for (const char *kind : {"single_cycle", "pipelined", "dual_issue"}) {
+    Machine machine(kind);
+    uint64_t arr = vm_config::config.getDataSectionStart() + machine.vm->program_.symbol_table.at("arr").address;
+    Run(*machine.vm, "watch " + std::to_string(arr + 16) + " 8 w");
+    std::string out = Run(*machine.vm, "run");
+    Check(Contains(out, "VM_WATCHPOINT_HIT"), std::string(kind) + ": store to arr[2] not caught");
+    Check(machine.registers.ReadGpr(12) == 5 + 3 + 9, std::string(kind) + ": stopped at the wrong store");
+    Run(*machine.vm, "unwatch " + std::to_string(arr + 16) + " 8 w");
+    Run(*machine.vm, "run");
+    CheckFinished(machine);
+    RunRejected(*machine.vm, "watch 0x0 4 x");
+  }
+}
+
+void TestProfile() {
+  Machine machine("pipelined");
+  Run(*machine.vm, "profile on");
+  Run(*machine.vm, "run");
+  Check(!Run(*machine.vm, "profile report 5").empty(), "empty profile report");
+  Run(*machine.vm, "profile csv " + Path("profile.csv"));
+  Check(!ReadFile(Path("profile.csv")).empty(), "empty profile csv");
+  Run(*machine.vm, "profile off");
+  RunRejected(*machine.vm, "profile");
+}
+
+void TestCallGraph() {
+  Machine machine("pipelined");
+  Run(*machine.vm, "callgraph on");
+  Run(*machine.vm, "run");
+  Check(Contains(Run(*machine.vm, "callgraph report"), "accumulate"), "call graph misses accumulate");
+  Run(*machine.vm, "callgraph collapsed " + Path("stacks.folded") + " instructions");
+  Check(Contains(ReadFile(Path("stacks.folded")), "accumulate"), "collapsed stacks miss accumulate");
+  RunRejected(*machine.vm, "callgraph collapsed " + Path("stacks.folded") + " bogus");
+}
+
+void TestInstructionMix() {
+  Machine machine("pipelined");
+  Run(*machine.vm, "run");
+  Check(Contains(Run(*machine.vm, "mix json"), "\"ld\": 10"), "mix does not count the ten loads");
+  Run(*machine.vm, "mix clear");
+  Check(!Contains(Run(*machine.vm, "mix json"), "\"ld\""), "mix clear kept counts");
+}
+
+void TestStats() {
+  Machine machine("pipelined");
+  Run(*machine.vm, "stats interval 10 " + Path("series.csv"));
+  Run(*machine.vm, "run");
+  Run(*machine.vm, "stats json " + Path("stats.json"));
+  std::string json = ReadFile(Path("stats.json"));
+  Check(Contains(json, "\"cycles\": " + std::to_string(machine.vm->cycle_s_)), "stats json misses cycles");
+  Check(Contains(Run(*machine.vm, "stats csv"), "cycles"), "stats csv misses cycles");
+  RunRejected(*machine.vm, "stats xml");
+}
+
+void TestBasicBlockVectors() {
+  Machine machine("single_cycle");
+  Run(*machine.vm, "bbv on 10 " + Path("program.bb"));
+  Run(*machine.vm, "run");
+  Run(*machine.vm, "bbv off");
+  Check(Contains(ReadFile(Path("program.bb")), "T:"), "no basic block vectors written");
+  Check(!Run(*machine.vm, "bbv blocks").empty(), "empty block map");
+}
+
+void TestBranchTrace() {
+  Machine machine("pipelined");
+  Run(*machine.vm, "btrace on " + Path("branches.trace"));
+  Run(*machine.vm, "run");
+  std::string out = Run(*machine.vm, "btrace off");
+  Check(Contains(out, "Branch trace: ") && !Contains(out, "Branch trace: 0 "), "no branches traced: " + out);
+  Check(std::filesystem::file_size(Path("branches.trace")) > 0, "empty branch trace");
+}
+
+void TestPipelineTrace() {
+  Machine machine("pipelined");
+  Run(*machine.vm, "ptrace on " + Path("pipeline.kanata"));
+  Run(*machine.vm, "run");
+  Run(*machine.vm, "ptrace off");
+  Check(ReadFile(Path("pipeline.kanata")).rfind("Kanata\t0004\n", 0) == 0, "not a Kanata trace");
+
+  Machine single("single_cycle");
+  RunRejected(*single.vm, "ptrace on " + Path("single.kanata"));
+}
+
+void TestCpiStack() {
+  Machine machine("dual_issue");
+  Run(*machine.vm, "run");
+  Check(Contains(Run(*machine.vm, "cpi report 3"), "CPI stack: " + std::to_string(machine.vm->instructions_retired_)),
+        "CPI stack does not cover the run");
+  Run(*machine.vm, "cpi clear");
+  Check(Contains(Run(*machine.vm, "cpi"), ", 0 issue slots"), "cpi clear kept slots");
+}
+
+void TestSample() {
+  Machine machine("pipelined");
+  std::string out = Run(*machine.vm, "sample 10 5 10 30");
+  Check(Contains(out, "Sampled run: ") && !Contains(out, "Sampled run: 0 windows"), "no windows sampled: " + out);
+  CheckFinished(machine);
+  RunRejected(*machine.vm, "sample 1 2");
+}
+
+void TestLockstep() {
+  for (const char *kind : {"pipelined", "dual_issue"}) {
+    Machine machine(kind);
+    std::string out = Run(*machine.vm, "lockstep");
+    Check(Contains(out, "Result: both ran to the end of the program"), std::string(kind) + ": " + out);
+    CheckFinished(machine);
+  }
+}
+
+void TestDesignSpace() {
+  Machine machine("pipelined");
+  std::ofstream(Path("sweep.ini")) << "[Run]\nvm = pipelined, dual_issue\nforwarding = 1, 0\n";
+  std::string out = Run(*machine.vm, "dse " + Path("sweep.ini") + " " + Path("sweep.csv") + " 2");
+  Check(Contains(out, "4 points (0 failed)"), "design space run failed: " + out);
+  std::istringstream csv(ReadFile(Path("sweep.csv")));
+  size_t lines = 0;
+  for (std::string line; std::getline(csv, line);) {
+    ++lines;
+  }
+  Check(lines == 5, "expected a header and four points, got " + std::to_string(lines) + " lines");
+  RunRejected(*machine.vm, "dse " + Path("missing.ini"));
+}
+
+void TestBranchPredictor() {
+  Machine machine("pipelined");
+  vm_config::VmConfig previous = vm_config::config;
+  Run(*machine.vm, "bpred gshare 256 6");
+  Check(vm_config::config.getBranchPredictorType() == "gshare", "predictor type not applied");
+  Run(*machine.vm, "bpred btb 64 2");
+  Run(*machine.vm, "run");
+  CheckFinished(machine);
+  Check(Contains(Run(*machine.vm, "bpred"), "Branch predictor: gshare"), "bpred does not report the predictor");
+  Run(*machine.vm, "bpred dump " + Path("tables.txt"));
+  Check(std::filesystem::exists(Path("tables.txt")), "no predictor tables dumped");
+  RunRejected(*machine.vm, "bpred btb 64");
+  vm_config::config = previous;
+}
+
+void TestSaveState() {
+  Machine machine("pipelined");
+  Run(*machine.vm, "add_breakpoint 14 \"x13 == 4\"");
+  Run(*machine.vm, "run");
+  Run(*machine.vm, "save_state " + Path("state.bin"));
+  uint64_t pc = machine.vm->GetProgramCounter();
+  uint64_t cycles = machine.vm->cycle_s_;
+  Run(*machine.vm, "remove_breakpoint 14");
+  Run(*machine.vm, "run");
+  CheckFinished(machine);
+
+  Run(*machine.vm, "load_state " + Path("state.bin"));
+  Check(machine.vm->GetProgramCounter() == pc && machine.vm->cycle_s_ == cycles, "state not restored");
+  Check(machine.registers.ReadGpr(13) == 4 && machine.registers.ReadGpr(31) == 0, "registers not restored");
+  Run(*machine.vm, "run");
+  CheckFinished(machine);
+  RunRejected(*machine.vm, "load_state " + Path("missing.bin"));
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  const std::map<std::string, std::function<void()>> tests = {
+      {"console", TestConsole},
+      {"breakpoint", TestBreakpoints},
+      {"watchpoint", TestWatchpoints},
+      {"profile", TestProfile},
+      {"callgraph", TestCallGraph},
+      {"mix", TestInstructionMix},
+      {"stats", TestStats},
+      {"bbv", TestBasicBlockVectors},
+      {"btrace", TestBranchTrace},
+      {"ptrace", TestPipelineTrace},
+      {"cpi", TestCpiStack},
+      {"sample", TestSample},
+      {"lockstep", TestLockstep},
+      {"dse", TestDesignSpace},
+      {"bpred", TestBranchPredictor},
+      {"state", TestSaveState},
+  };
+  if (argc != 2 || tests.count(argv[1]) == 0) {
+    std::cerr << "Usage: command_handler_tests <feature>" << std::endl;
+    return 2;
+  }
+
+  setupVmStateDirectory();
+  test_dir = std::filesystem::temp_directory_path() / ("command_handler_tests_" + std::string(argv[1]));
+  std::filesystem::create_directories(test_dir);
+  std::ofstream(test_dir / "program.s") << kProgram;
+  try {
+    tests.at(argv[1])();
+  } catch (const std::exception &e) {
+    std::cerr << "FAIL " << argv[1] << ": " << e.what() << std::endl;
+    return 1;
+  }
+  std::cout << "PASS " << argv[1] << std::endl;
+  return 0;
+}
@@ -0,0 +1,172 @@
+/**
+ * @file branch_trace_eval.cpp
+ * @brief Replays a branch trace recorded with `btrace on` through many predictor configurations in parallel.
+ *
+ * Usage: branch_trace_eval <trace> [-j threads] [type:table_size[:history] ...]
+ *
+ * Without configurations every predictor type is swept over table sizes
+ * 256..16384. Each worker streams the trace on its own, so memory use does not
+ * grow with the trace length, and the results are printed in the order the
+ * configurations were given.
+ */
+#include "branch_predictor.h"
+#include "branch_trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct EvalConfig {
+  std::string type;
+  uint64_t table_size = 0;
+  uint64_t history_length = 0;
+};
+
+struct EvalResult {
+  std::string name;
+  uint64_t instructions = 0;
+  uint64_t conditional_branches = 0;
+  uint64_t mispredictions = 0;
+  size_t storage_bits = 0;
+  std::string error;
+};
+
+EvalConfig ParseConfig(const std::string &text) {
+  EvalConfig config;
+  size_t first = text.find(':');
+  if (first == std::string::npos) {
+    throw std::invalid_argument("Expected type:table_size[:history], got " + text);
+  }
+  config.type = text.substr(0, first);
+  size_t second = text.find(':', first + 1);
+  config.table_size = std::stoull(text.substr(first + 1, second - first - 1));
+  if (second != std::string::npos) {
+    config.history_length = std::stoull(text.substr(second + 1));
+  }
+  return config;
+}
+
+std::vector<EvalConfig> DefaultSweep() {
+  std::vector<EvalConfig> configs;
+  for (const char *type : {"bimodal", "gshare", "tournament", "tage", "perceptron"}) {
+    for (uint64_t size : {256, 1024, 4096, 16384}) {
+      configs.push_back({type, size, 0});
+    }
+  }
+  return configs;
+}
+
+// Direction predictors only see conditional branches, exactly like the pipeline's TrainBranchPredictor
+EvalResult Evaluate(const std::string &trace, const EvalConfig &config) {
+  EvalResult result;
+  result.name = config.type + ":" + std::to_string(config.table_size);
+  if (config.history_length != 0) {
+    result.name += ":" + std::to_string(config.history_length);
+  }
+  try {
+    std::unique_ptr<BranchPredictor> predictor = MakeBranchPredictor(config.type, config.table_size,
+                                                                     config.history_length);
+    result.storage_bits = predictor->StorageBits();
+    BranchTraceReader reader(trace);
+    BranchRecord record;
+    while (reader.Next(record)) {
+      if (record.kind != BranchKind::kConditional) {
+        continue;
+      }
+      ++result.conditional_branches;
+      result.mispredictions += predictor->Predict(record.pc) != record.taken;
+      predictor->Update(record.pc, record.taken);
+    }
+    result.instructions = reader.Instructions();
+  } catch (const std::exception &e) {
+    result.error = e.what();
+  }
+  return result;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::string trace;
+  unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<EvalConfig> configs;
+  try {
+    for (int i = 1; i < argc; ++i) {
+      std::string arg = argv[i];
+      if (arg == "-j" && i + 1 < argc) {
+        threads = std::max(1, std::stoi(argv[++i]));
+      } else if (trace.empty()) {
+        trace = arg;
+      } else {
+        configs.push_back(ParseConfig(arg));
+      }
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 2;
+  }
+  if (trace.empty()) {
+    std::cerr << "Usage: " << argv[0] << " <trace> [-j threads] [type:table_size[:history] ...]" << std::endl;
+    return 2;
+  }
+  if (configs.empty()) {
+    configs = DefaultSweep();
+  }
+
+  // Fail early on a bad trace rather than once per configuration
+  try {
+    BranchTraceReader check(trace);
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  std::vector<EvalResult> results(configs.size());
+  std::atomic<size_t> next{0};
+  std::vector<std::thread> workers;
+  for (unsigned t = 0; t < std::min<size_t>(threads, configs.size()); ++t) {
+    workers.emplace_back([&] {
+      for (size_t i = next++; i < configs.size(); i = next++) {
+        results[i] = Evaluate(trace, configs[i]);
+      }
+    });
+  }
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+
+  std::cout << std::left << std::setw(40) << "predictor" << std::right << std::setw(12) << "storage(B)"
+            << std::setw(14) << "branches" << std::setw(12) << "mispredicts" << std::setw(10) << "accuracy"
+            << std::setw(10) << "MPKI" << "\n";
+  bool failed = false;
+  for (const EvalResult &r : results) {
+    std::cout << std::left << std::setw(40) << r.name << std::right;
+    if (!r.error.empty()) {
+      std::cout << "  error: " << r.error << "\n";
+      failed = true;
+      continue;
+    }
+    double accuracy = r.conditional_branches ? 100.0*(r.conditional_branches - r.mispredictions)/r.conditional_branches
+                                             : 0.0;
+    double mpki = r.instructions ? 1000.0*r.mispredictions/r.instructions : 0.0;
+    std::cout << std::setw(12) << (r.storage_bits + 7)/8 << std::setw(14) << r.conditional_branches
+              << std::setw(12) << r.mispredictions << std::fixed << std::setprecision(2) << std::setw(9)
+              << accuracy << "%" << std::setprecision(3) << std::setw(10) << mpki << "\n";
+  }
+  uint64_t instructions = 0;
+  for (const EvalResult &r : results) {
+    instructions = std::max(instructions, r.instructions);
+  }
+  std::cout << "instructions: " << instructions << std::endl;
+  return failed ? 1 : 0;
+}
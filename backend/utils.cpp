@@ -394,7 +394,9 @@ void SetupConfigFile() {
   config_file << "processor_type=single_stage\n";
   config_file << "hazard_detection=false\n";
   config_file << "forwarding=false\n";
-  config_file << "branch_prediction=none\n\n";
+  config_file << "branch_prediction=none\n";
+  config_file << "pipeline_undo_depth=10000\n";
+  config_file << "pipeline_undo_snapshot_interval=64\n\n";
 
   config_file << "[Memory]\n";
   config_file << "memory_size=0xffffffffffffffff\n";
@@ -411,8 +413,58 @@ void SetupConfigFile() {
   config_file << "cache_write_miss_policy=write_allocate\n\n";
 
   config_file << "[BranchPrediction]\n";
-  config_file << "branch_prediction_type=always_not_taken\n";
-  config_file << "branch_prediction_table_size=0\n";
-  config_file << "branch_prediction_table_associativity=0\n";
+  config_file << "branch_prediction_type=bimodal   ; bimodal, gshare, tournament, tage, perceptron\n";
+  config_file << "branch_prediction_table_size=1024\n";
+  config_file << "branch_history_length=0   ; 0 = predictor default\n";
+  config_file << "btb_size=256\n";
+  config_file << "btb_associativity=4\n";
+  config_file << "ras_depth=16\n";
+  config_file << "indirect_predictor_size=256\n";
+  config_file << "indirect_history_length=12\n\n";
+
+  config_file << "[FunctionalUnits]   ; pipelined VM: cycles in EX, cycles before the unit takes the next op, copies\n";
+  config_file << "int_alu_latency=1\n";
+  config_file << "int_alu_interval=1\n";
+  config_file << "int_alu_count=2\n";
+  config_file << "int_mul_latency=3\n";
+  config_file << "int_mul_interval=1\n";
+  config_file << "int_div_latency=20\n";
+  config_file << "int_div_interval=20\n";
+  config_file << "fp_add_latency=4\n";
+  config_file << "fp_add_interval=1\n";
+  config_file << "fp_mul_latency=4\n";
+  config_file << "fp_mul_interval=1\n";
+  config_file << "fp_fma_latency=5\n";
+  config_file << "fp_fma_interval=1\n";
+  config_file << "fp_div_latency=15\n";
+  config_file << "fp_div_interval=15\n";
+  config_file << "fp_sqrt_latency=20\n";
+  config_file << "fp_sqrt_interval=20\n";
+  config_file << "fp_misc_latency=2\n";
+  config_file << "fp_misc_interval=1\n\n";
+
+  config_file << "[PipelineDepth]   ; pipelined VM: cycles per stage group, 1 to 4 each\n";
+  config_file << "fetch_stages=1\n";
+  config_file << "execute_stages=1\n";
+  config_file << "memory_stages=1\n\n";
+
+  config_file << "[Frontend]   ; pipelined VM: predictor runs ahead of fetch when decoupled=1; queue up to 16, buffer up to 32\n";
+  config_file << "decoupled=0\n";
+  config_file << "fetch_target_queue_entries=8\n";
+  config_file << "fetch_block_bytes=32\n";
+  config_file << "instruction_buffer_entries=16\n\n";
+
+  config_file << "[DualIssue]   ; dual-issue VM: at most 2 of each\n";
+  config_file << "issue_width=2\n";
+  config_file << "memory_ops_per_cycle=1\n";
+  config_file << "branches_per_cycle=1\n\n";
+
+  config_file << "[OutOfOrder]   ; out-of-order VM: width up to 8, structure sizes up to 1024\n";
+  config_file << "width=4\n";
+  config_file << "rob_size=64\n";
+  config_file << "fetch_queue_size=16\n";
+  config_file << "int_queue_size=24\n";
+  config_file << "fp_queue_size=16\n";
+  config_file << "lsq_size=24\n";
   config_file.close();
 }
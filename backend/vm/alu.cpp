@@ -213,7 +213,7 @@ namespace alu {
                                                           uint64_t inc,
                                                           uint8_t rm) {
 
-    qDebug() << QString::fromStdString(to_string(op));
+    // qDebug() << QString::fromStdString(to_string(op));
 
   float a, b, c;
   std::memcpy(&a, &ina, sizeof(float));
@@ -0,0 +1,127 @@
+/**
+ * @file basic_block_profiler.cpp
+ * @brief Contains the implementation of the basic block vector generator.
+ */
+#include "basic_block_profiler.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+int64_t BranchOffset(uint32_t instruction) {
+  uint32_t imm = ((instruction >> 31) & 0x1) << 12
+               | ((instruction >> 7) & 0x1) << 11
+               | ((instruction >> 25) & 0x3F) << 5
+               | ((instruction >> 8) & 0xF) << 1;
+  return static_cast<int64_t>(static_cast<int32_t>(imm << 19) >> 19);
+}
+
+int64_t JalOffset(uint32_t instruction) {
+  uint32_t imm = ((instruction >> 31) & 0x1) << 20
+               | ((instruction >> 12) & 0xFF) << 12
+               | ((instruction >> 20) & 0x1) << 11
+               | ((instruction >> 21) & 0x3FF) << 1;
+  return static_cast<int64_t>(static_cast<int32_t>(imm << 11) >> 11);
+}
+} // namespace
+
+void BasicBlockProfiler::Load(const AssembledProgram &program) {
+  const std::vector<uint32_t> &text = program.text_buffer;
+  text_start_ = 0;
+
+  std::vector<bool> leader(text.size(), false);
+  if (!text.empty()) {
+    leader[0] = true;
+  }
+  auto mark = [&leader](int64_t slot) {
+    if (slot >= 0 && static_cast<size_t>(slot) < leader.size()) {
+      leader[static_cast<size_t>(slot)] = true;
+    }
+  };
+  for (size_t slot = 0; slot < text.size(); ++slot) {
+    uint32_t opcode = text[slot] & 0x7F;
+    int64_t here = static_cast<int64_t>(slot);
+    if (opcode == 0b1100011) {  // branches
+      mark(here + BranchOffset(text[slot])/4);
+    } else if (opcode == 0b1101111) {  // jal
+      mark(here + JalOffset(text[slot])/4);
+    } else if (opcode != 0b1100111) {  // jalr targets are only known at run time
+      continue;
+    }
+    mark(here + 1);
+  }
+
+  blocks_.clear();
+  block_of_.assign(text.size(), 0);
+  for (size_t slot = 0; slot < text.size(); ++slot) {
+    if (leader[slot]) {
+      blocks_.push_back({text_start_ + slot*4, 0});
+    }
+    block_of_[slot] = static_cast<uint32_t>(blocks_.size() - 1);
+    ++blocks_.back().size;
+  }
+  counts_.assign(blocks_.size(), 0);
+  interval_instructions_ = 0;
+}
+
+void BasicBlockProfiler::Start(const std::filesystem::path &filename, uint64_t interval) {
+  if (interval == 0) {
+    throw std::invalid_argument("BBV interval must be greater than zero");
+  }
+  std::ofstream file(filename);
+  if (!file.is_open()) {
+    throw std::runtime_error("Unable to open file: " + filename.string());
+  }
+  out_ = std::move(file);
+  path_ = filename;
+  interval_ = interval;
+  interval_instructions_ = 0;
+  intervals_written_ = 0;
+  std::fill(counts_.begin(), counts_.end(), 0);
+}
+
+void BasicBlockProfiler::Stop() {
+  Flush();
+  if (out_.is_open()) {
+    out_.close();
+  }
+  interval_ = 0;
+}
+
+void BasicBlockProfiler::Restart() {
+  if (IsEnabled()) {
+    std::filesystem::path path = path_;
+    Start(path, interval_);
+  }
+}
+
+void BasicBlockProfiler::Flush() {
+  if (IsEnabled() && interval_instructions_ != 0) {
+    WriteInterval();
+  }
+  if (out_.is_open()) {
+    out_.flush();
+  }
+}
+
+void BasicBlockProfiler::WriteInterval() {
+  out_ << 'T';
+  for (size_t block = 0; block < counts_.size(); ++block) {
+    if (counts_[block] != 0) {
+      out_ << ':' << block + 1 << ':' << counts_[block] << ' ';
+      counts_[block] = 0;
+    }
+  }
+  out_ << '\n';
+  interval_instructions_ = 0;
+  ++intervals_written_;
+}
+
+void BasicBlockProfiler::WriteBlockMap(std::ostream &out, const AssembledProgram &program) const {
+  for (size_t block = 0; block < blocks_.size(); ++block) {
+    uint64_t instruction_number = (blocks_[block].start - text_start_)/4;
+    auto line = program.instruction_number_line_number_mapping.find(static_cast<unsigned int>(instruction_number));
+    out << block + 1 << " 0x" << std::hex << blocks_[block].start << std::dec << ' ' << blocks_[block].size << ' '
+        << (line == program.instruction_number_line_number_mapping.end() ? 0 : line->second) << '\n';
+  }
+}
@@ -0,0 +1,92 @@
+/**
+ * @file basic_block_profiler.h
+ * @brief Contains the basic block vector (BBV) generator used for SimPoint-style phase analysis.
+ */
+#ifndef BASIC_BLOCK_PROFILER_H
+#define BASIC_BLOCK_PROFILER_H
+
+#include "../vm_asm_mw.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <ostream>
+#include <vector>
+
+/**
+ * @brief Writes one basic block vector per interval of retired instructions.
+ *
+ * Basic blocks are found statically from the text segment: a block starts at
+ * the program entry, at every branch/jal target and after every control
+ * transfer (branch, jal, jalr). Each retired instruction adds one to its
+ * block's count, so a block's entry in a vector is its execution count
+ * weighted by its size, as SimPoint expects.
+ *
+ * Vectors use the Valgrind exp-bbv text format, one line per interval:
+ * `T:<block>:<instructions> :<block>:<instructions> ...` with 1-based block ids.
+ */
+class BasicBlockProfiler {
+ public:
+  struct Block {
+    uint64_t start;
+    uint32_t size;  // instructions
+  };
+
+  /**
+   * @brief Splits the program text into basic blocks and clears all counts.
+   */
+  void Load(const AssembledProgram &program);
+
+  /**
+   * @brief Starts writing vectors to `filename`, one every `interval` instructions.
+   */
+  void Start(const std::filesystem::path &filename, uint64_t interval);
+  void Stop();
+  bool IsEnabled() const { return interval_ != 0; }
+  uint64_t Interval() const { return interval_; }
+  uint64_t IntervalsWritten() const { return intervals_written_; }
+
+  /**
+   * @brief Reports one retired instruction.
+   */
+  void Retire(uint64_t pc) {
+    uint64_t slot = (pc - text_start_) >> 2;
+    if (slot < block_of_.size()) {
+      ++counts_[block_of_[slot]];
+    }
+    if (++interval_instructions_ == interval_) {
+      WriteInterval();
+    }
+  }
+
+  /**
+   * @brief Writes the trailing partial interval, if any (end of a run).
+   */
+  void Flush();
+  /**
+   * @brief Truncates the output and starts again from the first interval (VM reset).
+   */
+  void Restart();
+
+  const std::vector<Block> &Blocks() const { return blocks_; }
+  /**
+   * @brief Writes "id start_pc size first_line" for every block, to map SimPoint picks back to code.
+   */
+  void WriteBlockMap(std::ostream &out, const AssembledProgram &program) const;
+
+ private:
+  void WriteInterval();
+
+  uint64_t text_start_ = 0;
+  std::vector<Block> blocks_;
+  std::vector<uint32_t> block_of_;  // text slot -> block index
+  std::vector<uint64_t> counts_;    // per block, current interval
+
+  std::filesystem::path path_;
+  std::ofstream out_;
+  uint64_t interval_ = 0;
+  uint64_t interval_instructions_ = 0;
+  uint64_t intervals_written_ = 0;
+};
+
+#endif // BASIC_BLOCK_PROFILER_H
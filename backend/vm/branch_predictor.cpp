@@ -0,0 +1,940 @@
+/**
+ * @file branch_predictor.cpp
+ * @brief Contains the implementation of the direction and target predictors.
+ */
+#include "branch_predictor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+bool IsPowerOfTwo(uint64_t value) {
+  return value != 0 && (value & (value - 1)) == 0;
+}
+
+unsigned Log2(uint64_t value) {
+  unsigned bits = 0;
+  while (value > 1) {
+    value >>= 1;
+    ++bits;
+  }
+  return bits;
+}
+
+// Saturating counter in [0, max]
+void Train(uint8_t &counter, bool taken, uint8_t max) {
+  if (taken) {
+    if (counter < max) {
+      ++counter;
+    }
+  } else if (counter > 0) {
+    --counter;
+  }
+}
+
+void Train(int8_t &counter, bool taken, int8_t min, int8_t max) {
+  if (taken) {
+    if (counter < max) {
+      ++counter;
+    }
+  } else if (counter > min) {
+    --counter;
+  }
+}
+
+const char *TwoBitState(uint8_t counter) {
+  static const char *kStates[] = {"STRONG NOT TAKEN", "WEAK NOT TAKEN", "WEAK TAKEN", "STRONG TAKEN"};
+  return kStates[counter & 3];
+}
+
+std::string Hex(uint64_t value) {
+  std::ostringstream out;
+  out << "0x" << std::hex << std::setfill('0') << std::setw(8) << value;
+  return out.str();
+}
+
+std::string Bits(uint64_t value, unsigned length) {
+  std::string bits;
+  for (unsigned i = length; i-- > 0;) {
+    bits += ((value >> i) & 1) ? '1' : '0';
+  }
+  return bits.empty() ? "-" : bits;
+}
+
+template <typename T>
+void PutVector(VmSnapshot::Writer &writer, const std::vector<T> &values) {
+  writer.PutBytes(values.data(), values.size()*sizeof(T));
+}
+
+template <typename T>
+void GetVector(VmSnapshot::Reader &reader, std::vector<T> &values) {
+  reader.GetBytes(values.data(), values.size()*sizeof(T));
+}
+} // namespace
+
+void BranchPredictor::Save(VmSnapshot::Writer &writer) const {
+  std::string name = Name();
+  writer.Put(static_cast<uint32_t>(name.size()));
+  writer.PutBytes(name.data(), name.size());
+  std::vector<uint64_t> geometry = Geometry();
+  writer.Put(static_cast<uint32_t>(geometry.size()));
+  PutVector(writer, geometry);
+  SaveTables(writer);
+}
+
+bool BranchPredictor::Restore(VmSnapshot::Reader &reader) {
+  auto name_length = reader.Get<uint32_t>();
+  const auto *name = reinterpret_cast<const char *>(reader.Take(name_length));
+  std::vector<uint64_t> geometry(reader.Get<uint32_t>());
+  GetVector(reader, geometry);
+  if (std::string(name, name_length) != Name() || geometry != Geometry()) {
+    return false;
+  }
+  RestoreTables(reader);
+  return true;
+}
+
+std::unique_ptr<BranchPredictor> MakeBranchPredictor(const std::string &type, uint64_t table_size,
+                                                     uint64_t history_length) {
+  if (!IsPowerOfTwo(table_size)) {
+    throw std::invalid_argument("Branch predictor table size must be a power of two: " + std::to_string(table_size));
+  }
+  auto check_history = [&](uint64_t fallback, uint64_t max) {
+    if (history_length == 0) {
+      return static_cast<unsigned>(fallback);
+    }
+    if (history_length > max) {
+      throw std::invalid_argument(type + " supports at most " + std::to_string(max) + " history bits");
+    }
+    return static_cast<unsigned>(history_length);
+  };
+
+  if (type == "bimodal") {
+    return std::make_unique<BimodalPredictor>(table_size);
+  }
+  if (type == "gshare") {
+    return std::make_unique<GsharePredictor>(table_size, check_history(std::max(1u, Log2(table_size)), 63));
+  }
+  if (type == "tournament") {
+    return std::make_unique<TournamentPredictor>(table_size, check_history(12, 20));
+  }
+  if (type == "tage") {
+    return std::make_unique<TagePredictor>(table_size, check_history(64, TagePredictor::kMaxHistoryLength));
+  }
+  if (type == "perceptron") {
+    return std::make_unique<PerceptronPredictor>(table_size,
+                                                 check_history(24, PerceptronPredictor::kMaxHistoryLength));
+  }
+  throw std::invalid_argument("Unknown branch predictor: " + type);
+}
+
+// ---------------------------------------------------------------------------
+// Bimodal
+
+BimodalPredictor::BimodalPredictor(size_t entries) : counters_(entries, 1) {}
+
+void BimodalPredictor::Update(uint64_t pc, bool taken) {
+  Train(counters_[Index(pc)], taken, 3);
+}
+
+void BimodalPredictor::Reset() {
+  std::fill(counters_.begin(), counters_.end(), 1);
+}
+
+void BimodalPredictor::DumpTables(std::ostream &out) const {
+  out << "2-bit counters (" << counters_.size() << " entries, showing trained entries)\n";
+  out << std::left << std::setw(8) << "Index" << std::setw(12) << "PC slot" << std::setw(10) << "Counter"
+      << "State\n";
+  for (size_t i = 0; i < counters_.size(); ++i) {
+    if (counters_[i] != 1) {
+      out << std::setw(8) << i << std::setw(12) << Hex(i << 2) << std::setw(10) << int(counters_[i])
+          << TwoBitState(counters_[i]) << "\n";
+    }
+  }
+  out << std::right;
+}
+
+void BimodalPredictor::WriteStats(std::ostream &out) const {
+  size_t taken = std::count_if(counters_.begin(), counters_.end(), [](uint8_t c) { return c >= 2; });
+  out << "  Counters predicting taken: " << taken << " / " << counters_.size() << "\n";
+}
+
+void BimodalPredictor::SaveTables(VmSnapshot::Writer &writer) const {
+  PutVector(writer, counters_);
+}
+
+void BimodalPredictor::RestoreTables(VmSnapshot::Reader &reader) {
+  GetVector(reader, counters_);
+}
+
+// ---------------------------------------------------------------------------
+// Gshare
+
+GsharePredictor::GsharePredictor(size_t entries, unsigned history_length)
+    : counters_(entries, 1), history_length_(history_length) {}
+
+size_t GsharePredictor::Index(uint64_t pc) const {
+  // Histories longer than the index are folded onto it
+  unsigned index_bits = std::max(1u, Log2(counters_.size()));
+  uint64_t history = history_length_ >= 64 ? history_ : history_ & ((uint64_t{1} << history_length_) - 1);
+  uint64_t folded = 0;
+  for (; history != 0; history >>= index_bits) {
+    folded ^= history;
+  }
+  return ((pc >> 2) ^ folded) & (counters_.size() - 1);
+}
+
+void GsharePredictor::Update(uint64_t pc, bool taken) {
+  Train(counters_[Index(pc)], taken, 3);
+  history_ = (history_ << 1) | static_cast<uint64_t>(taken);
+}
+
+void GsharePredictor::Reset() {
+  std::fill(counters_.begin(), counters_.end(), 1);
+  history_ = 0;
+}
+
+void GsharePredictor::DumpTables(std::ostream &out) const {
+  out << "Global history (" << history_length_ << " bits, newest last): " << Bits(history_, history_length_) << "\n";
+  out << "2-bit counters (" << counters_.size() << " entries, showing trained entries)\n";
+  out << std::left << std::setw(8) << "Index" << std::setw(10) << "Counter" << "State\n";
+  for (size_t i = 0; i < counters_.size(); ++i) {
+    if (counters_[i] != 1) {
+      out << std::setw(8) << i << std::setw(10) << int(counters_[i]) << TwoBitState(counters_[i]) << "\n";
+    }
+  }
+  out << std::right;
+}
+
+void GsharePredictor::WriteStats(std::ostream &out) const {
+  size_t trained = std::count_if(counters_.begin(), counters_.end(), [](uint8_t c) { return c != 1; });
+  out << "  Trained counters: " << trained << " / " << counters_.size() << "\n";
+}
+
+void GsharePredictor::SaveTables(VmSnapshot::Writer &writer) const {
+  PutVector(writer, counters_);
+  writer.Put(history_);
+}
+
+void GsharePredictor::RestoreTables(VmSnapshot::Reader &reader) {
+  GetVector(reader, counters_);
+  history_ = reader.Get<uint64_t>();
+}
+
+// ---------------------------------------------------------------------------
+// Tournament
+
+TournamentPredictor::TournamentPredictor(size_t local_entries, unsigned history_length)
+    : local_histories_(local_entries, 0),
+      local_counters_(size_t{1} << kLocalHistoryLength, 3),
+      global_counters_(size_t{1} << history_length, 1),
+      chooser_(size_t{1} << history_length, 1),
+      history_length_(history_length) {}
+
+bool TournamentPredictor::Predict(uint64_t pc) const {
+  return chooser_[GlobalIndex()] >= 2 ? GlobalPrediction() : LocalPrediction(pc);
+}
+
+void TournamentPredictor::Update(uint64_t pc, bool taken) {
+  size_t global_index = GlobalIndex();
+  bool local = LocalPrediction(pc);
+  bool global = GlobalPrediction();
+  if (chooser_[global_index] >= 2) {
+    ++global_chosen_;
+  } else {
+    ++local_chosen_;
+  }
+  if (local != global) {
+    ++components_disagreed_;
+    Train(chooser_[global_index], global == taken, 3);
+  }
+
+  Train(global_counters_[global_index], taken, 3);
+  uint16_t &local_history = local_histories_[LocalSlot(pc)];
+  Train(local_counters_[local_history], taken, 7);
+  local_history = ((local_history << 1) | static_cast<uint16_t>(taken)) & ((1u << kLocalHistoryLength) - 1);
+  history_ = (history_ << 1) | static_cast<uint64_t>(taken);
+}
+
+void TournamentPredictor::Reset() {
+  std::fill(local_histories_.begin(), local_histories_.end(), 0);
+  std::fill(local_counters_.begin(), local_counters_.end(), 3);
+  std::fill(global_counters_.begin(), global_counters_.end(), 1);
+  std::fill(chooser_.begin(), chooser_.end(), 1);
+  history_ = 0;
+  global_chosen_ = 0;
+  local_chosen_ = 0;
+  components_disagreed_ = 0;
+}
+
+size_t TournamentPredictor::StorageBits() const {
+  return local_histories_.size()*kLocalHistoryLength + local_counters_.size()*3 +
+         global_counters_.size()*2 + chooser_.size()*2 + history_length_;
+}
+
+void TournamentPredictor::DumpTables(std::ostream &out) const {
+  out << "Global history (" << history_length_ << " bits, newest last): " << Bits(history_, history_length_) << "\n\n";
+
+  out << "Local histories (" << local_histories_.size() << " entries, showing non-zero entries)\n";
+  out << std::left << std::setw(8) << "Index" << std::setw(12) << "PC slot" << "History\n";
+  for (size_t i = 0; i < local_histories_.size(); ++i) {
+    if (local_histories_[i] != 0) {
+      out << std::setw(8) << i << std::setw(12) << Hex(i << 2) << Bits(local_histories_[i], kLocalHistoryLength)
+          << "\n";
+    }
+  }
+
+  out << "\nLocal 3-bit counters (showing trained entries)\n";
+  out << std::setw(14) << "History" << "Counter\n";
+  for (size_t i = 0; i < local_counters_.size(); ++i) {
+    if (local_counters_[i] != 3) {
+      out << std::setw(14) << Bits(i, kLocalHistoryLength) << int(local_counters_[i]) << "\n";
+    }
+  }
+
+  out << "\nGlobal counters and chooser (showing trained entries)\n";
+  out << std::setw(24) << "Global history" << std::setw(20) << "Global counter" << "Chooser\n";
+  for (size_t i = 0; i < global_counters_.size(); ++i) {
+    if (global_counters_[i] != 1 || chooser_[i] != 1) {
+      out << std::setw(24) << Bits(i, history_length_) << std::setw(20) << TwoBitState(global_counters_[i])
+          << (chooser_[i] >= 2 ? "GLOBAL" : "LOCAL") << " (" << int(chooser_[i]) << ")\n";
+    }
+  }
+  out << std::right;
+}
+
+void TournamentPredictor::WriteStats(std::ostream &out) const {
+  out << "  Global predictor chosen: " << global_chosen_ << "\n";
+  out << "  Local predictor chosen: " << local_chosen_ << "\n";
+  out << "  Components disagreed: " << components_disagreed_ << "\n";
+}
+
+void TournamentPredictor::SaveTables(VmSnapshot::Writer &writer) const {
+  PutVector(writer, local_histories_);
+  PutVector(writer, local_counters_);
+  PutVector(writer, global_counters_);
+  PutVector(writer, chooser_);
+  writer.Put(history_);
+}
+
+void TournamentPredictor::RestoreTables(VmSnapshot::Reader &reader) {
+  GetVector(reader, local_histories_);
+  GetVector(reader, local_counters_);
+  GetVector(reader, global_counters_);
+  GetVector(reader, chooser_);
+  history_ = reader.Get<uint64_t>();
+}
+
+// ---------------------------------------------------------------------------
+// TAGE
+
+TagePredictor::TagePredictor(size_t base_entries, unsigned max_history_length)
+    : base_(base_entries, 1), index_width_(std::max(1u, Log2(base_entries) - (base_entries > 1 ? 1 : 0))) {
+  // Geometric series from 4 to the longest history
+  double longest = std::max(8u, max_history_length);
+  for (size_t i = 0; i < kTaggedTables; ++i) {
+    double ratio = static_cast<double>(i)/static_cast<double>(kTaggedTables - 1);
+    history_lengths_[i] = static_cast<unsigned>(std::lround(4.0*std::pow(longest/4.0, ratio)));
+    tag_widths_[i] = 8 + static_cast<unsigned>(i);
+    tables_[i].assign(size_t{1} << index_width_, Entry());
+    index_history_[i] = {0, history_lengths_[i], index_width_};
+    tag_history_[i][0] = {0, history_lengths_[i], tag_widths_[i]};
+    tag_history_[i][1] = {0, history_lengths_[i], tag_widths_[i] - 1};
+  }
+}
+
+TagePredictor::LookupResult TagePredictor::Lookup(uint64_t pc) const {
+  LookupResult result;
+  uint64_t slot = pc >> 2;
+  for (size_t i = 0; i < kTaggedTables; ++i) {
+    result.index[i] = (slot ^ (slot >> index_width_) ^ index_history_[i].value) & (tables_[i].size() - 1);
+    result.tag[i] = static_cast<uint16_t>(
+        (slot ^ tag_history_[i][0].value ^ (tag_history_[i][1].value << 1)) & ((1u << tag_widths_[i]) - 1));
+  }
+  for (int i = static_cast<int>(kTaggedTables) - 1; i >= 0; --i) {
+    if (tables_[i][result.index[i]].tag == result.tag[i]) {
+      if (result.provider < 0) {
+        result.provider = i;
+      } else {
+        result.alternate = i;
+        break;
+      }
+    }
+  }
+
+  bool base_prediction = base_[BaseIndex(pc)] >= 2;
+  result.alternate_prediction = result.alternate >= 0
+                                    ? tables_[result.alternate][result.index[result.alternate]].counter >= 0
+                                    : base_prediction;
+  if (result.provider < 0) {
+    result.provider_prediction = base_prediction;
+    result.prediction = base_prediction;
+    return result;
+  }
+  const Entry &entry = tables_[result.provider][result.index[result.provider]];
+  result.provider_prediction = entry.counter >= 0;
+  bool newly_allocated = (entry.counter == 0 || entry.counter == -1) && entry.useful == 0;
+  result.prediction = newly_allocated && use_alternate_ >= 8 ? result.alternate_prediction
+                                                             : result.provider_prediction;
+  return result;
+}
+
+void TagePredictor::Update(uint64_t pc, bool taken) {
+  LookupResult result = Lookup(pc);
+  ++provider_hits_[result.provider + 1];
+
+  if (result.provider >= 0) {
+    Entry &entry = tables_[result.provider][result.index[result.provider]];
+    bool newly_allocated = (entry.counter == 0 || entry.counter == -1) && entry.useful == 0;
+    if (newly_allocated && result.provider_prediction != result.alternate_prediction) {
+      Train(use_alternate_, result.alternate_prediction == taken, 0, 15);
+    }
+  }
+
+  // Allocate in a longer table when the final prediction was wrong
+  if (result.prediction != taken && result.provider < static_cast<int>(kTaggedTables) - 1) {
+    size_t first = static_cast<size_t>(result.provider + 1);
+    // Occasionally skip the nearest table so allocations spread over the longer ones
+    random_ ^= random_ << 13;
+    random_ ^= random_ >> 17;
+    random_ ^= random_ << 5;
+    if (first + 1 < kTaggedTables && (random_ & 3) == 0) {
+      ++first;
+    }
+    bool allocated = false;
+    for (size_t i = first; i < kTaggedTables && !allocated; ++i) {
+      Entry &candidate = tables_[i][result.index[i]];
+      if (candidate.useful == 0) {
+        candidate.tag = result.tag[i];
+        candidate.counter = taken ? 0 : -1;
+        allocated = true;
+      }
+    }
+    if (allocated) {
+      ++allocations_;
+    } else {
+      ++allocation_failures_;
+      for (size_t i = first; i < kTaggedTables; ++i) {
+        Entry &candidate = tables_[i][result.index[i]];
+        if (candidate.useful > 0) {
+          --candidate.useful;
+        }
+      }
+    }
+  }
+
+  if (result.provider >= 0) {
+    Entry &entry = tables_[result.provider][result.index[result.provider]];
+    // A provider that has not proven useful yet also trains its alternate
+    if (entry.useful == 0) {
+      if (result.alternate >= 0) {
+        Train(tables_[result.alternate][result.index[result.alternate]].counter, taken, -4, 3);
+      } else {
+        Train(base_[BaseIndex(pc)], taken, 3);
+      }
+    }
+    Train(entry.counter, taken, -4, 3);
+    if (result.provider_prediction != result.alternate_prediction) {
+      Train(entry.useful, result.provider_prediction == taken, 3);
+    }
+  } else {
+    Train(base_[BaseIndex(pc)], taken, 3);
+  }
+
+  if (++updates_ % kUsefulResetPeriod == 0) {
+    for (auto &table : tables_) {
+      for (Entry &entry : table) {
+        entry.useful >>= 1;
+      }
+    }
+  }
+  PushHistory(taken);
+}
+
+void TagePredictor::PushHistory(bool taken) {
+  head_ = (head_ + kHistoryBuffer - 1) % kHistoryBuffer;
+  history_[head_] = taken;
+  for (size_t i = 0; i < kTaggedTables; ++i) {
+    // The outcome that just left a table's history window is now history_lengths_[i] old
+    bool oldest = HistoryBit(history_lengths_[i]);
+    index_history_[i].Push(taken, oldest);
+    tag_history_[i][0].Push(taken, oldest);
+    tag_history_[i][1].Push(taken, oldest);
+  }
+}
+
+void TagePredictor::Reset() {
+  std::fill(base_.begin(), base_.end(), 1);
+  for (auto &table : tables_) {
+    std::fill(table.begin(), table.end(), Entry());
+  }
+  std::fill(std::begin(history_), std::end(history_), 0);
+  head_ = 0;
+  for (size_t i = 0; i < kTaggedTables; ++i) {
+    index_history_[i].value = 0;
+    tag_history_[i][0].value = 0;
+    tag_history_[i][1].value = 0;
+  }
+  use_alternate_ = 8;
+  updates_ = 0;
+  std::fill(std::begin(provider_hits_), std::end(provider_hits_), 0);
+  allocations_ = 0;
+  allocation_failures_ = 0;
+}
+
+size_t TagePredictor::StorageBits() const {
+  size_t bits = base_.size()*2 + history_lengths_[kTaggedTables - 1] + 4;
+  for (size_t i = 0; i < kTaggedTables; ++i) {
+    bits += tables_[i].size()*(tag_widths_[i] + 3 + 2);
+  }
+  return bits;
+}
+
+std::vector<uint64_t> TagePredictor::Geometry() const {
+  return {base_.size(), tables_[0].size(), history_lengths_[kTaggedTables - 1]};
+}
+
+void TagePredictor::DumpTables(std::ostream &out) const {
+  out << "Tagged tables:";
+  for (size_t i = 0; i < kTaggedTables; ++i) {
+    out << " T" << i + 1 << "(" << tables_[i].size() << " entries, history " << history_lengths_[i]
+        << ", tag " << tag_widths_[i] << " bits)";
+  }
+  out << "\nUse-alternate counter: " << int(use_alternate_) << "\n\n";
+
+  out << "Base 2-bit counters (" << base_.size() << " entries, showing trained entries)\n";
+  out << std::left << std::setw(8) << "Index" << std::setw(12) << "PC slot" << "State\n";
+  for (size_t i = 0; i < base_.size(); ++i) {
+    if (base_[i] != 1) {
+      out << std::setw(8) << i << std::setw(12) << Hex(i << 2) << TwoBitState(base_[i]) << "\n";
+    }
+  }
+
+  out << "\nTagged entries (showing allocated entries)\n";
+  out << std::setw(8) << "Table" << std::setw(8) << "Index" << std::setw(8) << "Tag" << std::setw(10) << "Counter"
+      << "Useful\n";
+  for (size_t i = 0; i < kTaggedTables; ++i) {
+    for (size_t j = 0; j < tables_[i].size(); ++j) {
+      const Entry &entry = tables_[i][j];
+      if (entry.tag != 0 || entry.counter != 0 || entry.useful != 0) {
+        out << std::setw(8) << ("T" + std::to_string(i + 1)) << std::setw(8) << j << std::setw(8) << entry.tag
+            << std::setw(10) << int(entry.counter) << int(entry.useful) << "\n";
+      }
+    }
+  }
+  out << std::right;
+}
+
+void TagePredictor::WriteStats(std::ostream &out) const {
+  out << "  Provided by base table: " << provider_hits_[0] << "\n";
+  for (size_t i = 0; i < kTaggedTables; ++i) {
+    out << "  Provided by T" << i + 1 << ": " << provider_hits_[i + 1] << "\n";
+  }
+  out << "  Allocations: " << allocations_ << " (failed: " << allocation_failures_ << ")\n";
+}
+
+void TagePredictor::SaveTables(VmSnapshot::Writer &writer) const {
+  PutVector(writer, base_);
+  for (const auto &table : tables_) {
+    PutVector(writer, table);
+  }
+  writer.PutBytes(history_, sizeof(history_));
+  writer.Put(head_);
+  for (size_t i = 0; i < kTaggedTables; ++i) {
+    writer.Put(index_history_[i].value);
+    writer.Put(tag_history_[i][0].value);
+    writer.Put(tag_history_[i][1].value);
+  }
+  writer.Put(use_alternate_);
+  writer.Put(updates_);
+}
+
+void TagePredictor::RestoreTables(VmSnapshot::Reader &reader) {
+  GetVector(reader, base_);
+  for (auto &table : tables_) {
+    GetVector(reader, table);
+  }
+  reader.GetBytes(history_, sizeof(history_));
+  head_ = reader.Get<unsigned>() % kHistoryBuffer;
+  for (size_t i = 0; i < kTaggedTables; ++i) {
+    index_history_[i].value = reader.Get<uint32_t>();
+    tag_history_[i][0].value = reader.Get<uint32_t>();
+    tag_history_[i][1].value = reader.Get<uint32_t>();
+  }
+  use_alternate_ = reader.Get<int8_t>();
+  updates_ = reader.Get<uint64_t>();
+}
+
+// ---------------------------------------------------------------------------
+// Perceptron
+
+PerceptronPredictor::PerceptronPredictor(size_t perceptrons, unsigned history_length)
+    : perceptrons_(perceptrons),
+      history_length_(history_length),
+      threshold_(static_cast<int>(1.93*history_length + 14)),
+      weights_(perceptrons*(history_length + 1), 0) {}
+
+int PerceptronPredictor::Output(uint64_t pc) const {
+  const int8_t *weights = &weights_[Row(pc)];
+  int output = weights[0];
+  for (unsigned i = 0; i < history_length_; ++i) {
+    output += ((history_ >> i) & 1) ? weights[i + 1] : -weights[i + 1];
+  }
+  return output;
+}
+
+void PerceptronPredictor::Update(uint64_t pc, bool taken) {
+  int output = Output(pc);
+  if ((output >= 0) != taken || std::abs(output) <= threshold_) {
+    ++trainings_;
+    int8_t *weights = &weights_[Row(pc)];
+    Train(weights[0], taken, -127, 127);
+    for (unsigned i = 0; i < history_length_; ++i) {
+      Train(weights[i + 1], (((history_ >> i) & 1) != 0) == taken, -127, 127);
+    }
+  }
+  history_ = (history_ << 1) | static_cast<uint64_t>(taken);
+}
+
+void PerceptronPredictor::Reset() {
+  std::fill(weights_.begin(), weights_.end(), 0);
+  history_ = 0;
+  trainings_ = 0;
+}
+
+void PerceptronPredictor::DumpTables(std::ostream &out) const {
+  out << "Global history (" << history_length_ << " bits, newest last): " << Bits(history_, history_length_) << "\n";
+  out << "Training threshold: " << threshold_ << "\n";
+  out << "Weights (" << perceptrons_ << " perceptrons, showing trained rows; bias first, then newest history bit"
+      << " onwards)\n";
+  for (size_t row = 0; row < perceptrons_; ++row) {
+    const int8_t *weights = &weights_[row*(history_length_ + 1)];
+    if (std::all_of(weights, weights + history_length_ + 1, [](int8_t w) { return w == 0; })) {
+      continue;
+    }
+    out << std::left << std::setw(8) << row << std::setw(12) << Hex(row << 2) << std::right;
+    for (unsigned i = 0; i <= history_length_; ++i) {
+      out << std::setw(5) << int(weights[i]);
+    }
+    out << "\n";
+  }
+}
+
+void PerceptronPredictor::WriteStats(std::ostream &out) const {
+  out << "  Weight updates: " << trainings_ << "\n";
+}
+
+void PerceptronPredictor::SaveTables(VmSnapshot::Writer &writer) const {
+  PutVector(writer, weights_);
+  writer.Put(history_);
+}
+
+void PerceptronPredictor::RestoreTables(VmSnapshot::Reader &reader) {
+  GetVector(reader, weights_);
+  history_ = reader.Get<uint64_t>();
+}
+
+// ---------------------------------------------------------------------------
+// Branch target buffer
+
+const char *BranchKindName(BranchTargetBuffer::Kind kind) {
+  switch (kind) {
+    case BranchTargetBuffer::Kind::kConditional: return "BRANCH";
+    case BranchTargetBuffer::Kind::kJump: return "JAL";
+    case BranchTargetBuffer::Kind::kIndirect: return "JALR";
+  }
+  return "?";
+}
+
+BranchTargetBuffer::BranchTargetBuffer(size_t entries, size_t ways) : ways_(ways), sets_(0) {
+  if (ways == 0 || entries % ways != 0 || !IsPowerOfTwo(entries/ways)) {
+    throw std::invalid_argument("BTB entries/ways must be a power of two: " + std::to_string(entries) + "/" +
+                                std::to_string(ways));
+  }
+  sets_ = entries/ways;
+  entries_.assign(entries, Entry());
+}
+
+const BranchTargetBuffer::Entry *BranchTargetBuffer::Lookup(uint64_t pc) {
+  Entry *set = &entries_[Set(pc)*ways_];
+  uint64_t tag = Tag(pc);
+  for (size_t way = 0; way < ways_; ++way) {
+    if (set[way].valid && set[way].tag == tag) {
+      set[way].last_used = ++tick_;
+      return &set[way];
+    }
+  }
+  return nullptr;
+}
+
+void BranchTargetBuffer::Update(uint64_t pc, uint64_t target, Kind kind) {
+  Entry *set = &entries_[Set(pc)*ways_];
+  uint64_t tag = Tag(pc);
+  Entry *victim = &set[0];
+  for (size_t way = 0; way < ways_; ++way) {
+    if (set[way].valid && set[way].tag == tag) {
+      victim = &set[way];
+      break;
+    }
+    if (!set[way].valid) {
+      if (victim->valid) {
+        victim = &set[way];
+      }
+    } else if (victim->valid && set[way].last_used < victim->last_used) {
+      victim = &set[way];
+    }
+  }
+  victim->valid = true;
+  victim->kind = kind;
+  victim->tag = tag;
+  victim->target = target;
+  victim->last_used = ++tick_;
+}
+
+void BranchTargetBuffer::Clear() {
+  std::fill(entries_.begin(), entries_.end(), Entry());
+  tick_ = 0;
+}
+
+size_t BranchTargetBuffer::ValidEntries() const {
+  return std::count_if(entries_.begin(), entries_.end(), [](const Entry &entry) { return entry.valid; });
+}
+
+size_t BranchTargetBuffer::StorageBits() const {
+  // valid + kind + tag + target + LRU rank, for 32-bit text addresses
+  size_t tag_bits = 30 - std::min<size_t>(30, Log2(sets_));
+  return entries_.size()*(1 + 2 + tag_bits + 30 + Log2(std::max<size_t>(ways_, 2)));
+}
+
+void BranchTargetBuffer::Dump(std::ostream &out) const {
+  out << "BTB: " << entries_.size() << " entries, " << ways_ << "-way, " << sets_ << " sets, " << ValidEntries()
+      << " valid\n";
+  out << std::left << std::setw(6) << "Set" << std::setw(5) << "Way" << std::setw(12) << "PC" << std::setw(12)
+      << "Target" << std::setw(7) << "Kind" << std::setw(10) << "Offset" << "Direction\n";
+  for (size_t set = 0; set < sets_; ++set) {
+    for (size_t way = 0; way < ways_; ++way) {
+      const Entry &entry = entries_[set*ways_ + way];
+      if (!entry.valid) {
+        continue;
+      }
+      uint64_t pc = EntryPc(set, entry);
+      int64_t offset = static_cast<int64_t>(entry.target - pc);
+      out << std::setw(6) << set << std::setw(5) << way << std::setw(12) << Hex(pc) << std::setw(12)
+          << Hex(entry.target) << std::setw(7) << BranchKindName(entry.kind) << std::setw(10)
+          << ((offset > 0 ? "+" : "") + std::to_string(offset))
+          << (offset < 0 ? "BACKWARD (Loop)" : offset > 0 ? "FORWARD" : "SELF") << "\n";
+    }
+  }
+  out << std::right;
+}
+
+void BranchTargetBuffer::Save(VmSnapshot::Writer &writer) const {
+  writer.Put(static_cast<uint64_t>(entries_.size()));
+  writer.Put(static_cast<uint64_t>(ways_));
+  writer.Put(tick_);
+  for (const Entry &entry : entries_) {
+    writer.Put(entry.valid);
+    writer.Put(entry.kind);
+    writer.Put(entry.tag);
+    writer.Put(entry.target);
+    writer.Put(entry.last_used);
+  }
+}
+
+bool BranchTargetBuffer::Restore(VmSnapshot::Reader &reader) {
+  constexpr size_t kEntryBytes = sizeof(bool) + sizeof(Kind) + 3*sizeof(uint64_t);
+  auto entries = reader.Get<uint64_t>();
+  auto ways = reader.Get<uint64_t>();
+  auto tick = reader.Get<uint64_t>();
+  if (entries != entries_.size() || ways != ways_) {
+    reader.Take(entries*kEntryBytes);
+    return false;
+  }
+  tick_ = tick;
+  for (Entry &entry : entries_) {
+    entry.valid = reader.Get<bool>();
+    entry.kind = reader.Get<Kind>();
+    entry.tag = reader.Get<uint64_t>();
+    entry.target = reader.Get<uint64_t>();
+    entry.last_used = reader.Get<uint64_t>();
+  }
+  return true;
+}
+
+// ---------------------------------------------------------------------------
+// Return address stack
+
+ReturnAddressStack::Action ReturnAddressStack::ActionFor(uint32_t instruction) {
+  uint32_t opcode = instruction & 0x7F;
+  uint32_t rd = (instruction >> 7) & 0x1F;
+  uint32_t rs1 = (instruction >> 15) & 0x1F;
+  auto is_link = [](uint32_t reg) { return reg == 1 || reg == 5; };
+  Action action;
+  if (opcode == 0b1101111) {
+    action.push = is_link(rd);
+  } else if (opcode == 0b1100111) {
+    action.push = is_link(rd);
+    action.pop = is_link(rs1) && (!is_link(rd) || rd != rs1);
+  }
+  return action;
+}
+
+ReturnAddressStack::ReturnAddressStack(size_t depth) : entries_(std::max<size_t>(depth, 1), 0) {}
+
+void ReturnAddressStack::Push(uint64_t return_address) {
+  top_ = static_cast<uint32_t>((top_ + 1) % entries_.size());
+  entries_[top_] = return_address;
+  if (size_ < entries_.size()) {
+    ++size_;
+  } else {
+    ++overflows_;
+  }
+}
+
+uint64_t ReturnAddressStack::Pop() {
+  uint64_t value = entries_[top_];
+  if (size_ > 0) {
+    --size_;
+    top_ = static_cast<uint32_t>((top_ + entries_.size() - 1) % entries_.size());
+  }
+  return value;
+}
+
+void ReturnAddressStack::Restore(const Checkpoint &checkpoint) {
+  top_ = checkpoint.top % entries_.size();
+  size_ = std::min<uint32_t>(checkpoint.size, static_cast<uint32_t>(entries_.size()));
+  entries_[top_] = checkpoint.top_value;
+}
+
+void ReturnAddressStack::Clear() {
+  std::fill(entries_.begin(), entries_.end(), 0);
+  top_ = 0;
+  size_ = 0;
+  overflows_ = 0;
+}
+
+void ReturnAddressStack::Dump(std::ostream &out) const {
+  out << "RAS: depth " << entries_.size() << ", " << size_ << " entries in use, " << overflows_ << " overflows\n";
+  for (uint32_t i = 0; i < size_; ++i) {
+    size_t slot = (top_ + entries_.size() - i) % entries_.size();
+    out << (i == 0 ? "  top " : "      ") << Hex(entries_[slot]) << "\n";
+  }
+}
+
+void ReturnAddressStack::Save(VmSnapshot::Writer &writer) const {
+  writer.Put(static_cast<uint64_t>(entries_.size()));
+  PutVector(writer, entries_);
+  writer.Put(top_);
+  writer.Put(size_);
+  writer.Put(overflows_);
+}
+
+bool ReturnAddressStack::Restore(VmSnapshot::Reader &reader) {
+  auto depth = reader.Get<uint64_t>();
+  if (depth != entries_.size()) {
+    reader.Take(depth*sizeof(uint64_t) + 2*sizeof(uint32_t) + sizeof(uint64_t));
+    return false;
+  }
+  GetVector(reader, entries_);
+  top_ = reader.Get<uint32_t>() % entries_.size();
+  size_ = std::min<uint32_t>(reader.Get<uint32_t>(), static_cast<uint32_t>(entries_.size()));
+  overflows_ = reader.Get<uint64_t>();
+  return true;
+}
+
+// ---------------------------------------------------------------------------
+// Indirect target predictor
+
+IndirectTargetPredictor::IndirectTargetPredictor(size_t entries, unsigned history_length)
+    : entries_(entries), history_length_(history_length) {
+  if (!IsPowerOfTwo(entries) || history_length > 63) {
+    throw std::invalid_argument("Indirect predictor needs a power-of-two size and at most 63 history bits");
+  }
+}
+
+size_t IndirectTargetPredictor::Index(uint64_t pc) const {
+  unsigned index_bits = std::max(1u, Log2(entries_.size()));
+  uint64_t folded = 0;
+  for (uint64_t path = path_; path != 0; path >>= index_bits) {
+    folded ^= path;
+  }
+  return ((pc >> 2) ^ folded) & (entries_.size() - 1);
+}
+
+bool IndirectTargetPredictor::Predict(uint64_t pc, uint64_t &target) const {
+  const Entry &entry = entries_[Index(pc)];
+  if (!entry.valid || entry.tag != Tag(pc)) {
+    return false;
+  }
+  target = entry.target;
+  return true;
+}
+
+void IndirectTargetPredictor::Update(uint64_t pc, uint64_t target) {
+  Entry &entry = entries_[Index(pc)];
+  if (!entry.valid || entry.tag != Tag(pc)) {
+    entry = {true, 1, Tag(pc), target};
+  } else if (entry.target == target) {
+    Train(entry.confidence, true, 3);
+  } else if (entry.confidence > 0) {
+    --entry.confidence;
+  } else {
+    entry.target = target;
+    entry.confidence = 1;
+  }
+}
+
+void IndirectTargetPredictor::Clear() {
+  std::fill(entries_.begin(), entries_.end(), Entry());
+  path_ = 0;
+}
+
+void IndirectTargetPredictor::Dump(std::ostream &out) const {
+  size_t valid = std::count_if(entries_.begin(), entries_.end(), [](const Entry &entry) { return entry.valid; });
+  out << "Indirect target predictor: " << entries_.size() << " entries (" << valid << " valid), path history "
+      << history_length_ << " bits: " << Bits(path_, history_length_) << "\n";
+  out << std::left << std::setw(8) << "Index" << std::setw(8) << "Tag" << std::setw(12) << "Target" << "Confidence\n";
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    const Entry &entry = entries_[i];
+    if (entry.valid) {
+      out << std::setw(8) << i << std::setw(8) << entry.tag << std::setw(12) << Hex(entry.target)
+          << int(entry.confidence) << "\n";
+    }
+  }
+  out << std::right;
+}
+
+void IndirectTargetPredictor::Save(VmSnapshot::Writer &writer) const {
+  writer.Put(static_cast<uint64_t>(entries_.size()));
+  writer.Put(static_cast<uint64_t>(history_length_));
+  writer.Put(path_);
+  for (const Entry &entry : entries_) {
+    writer.Put(entry.valid);
+    writer.Put(entry.confidence);
+    writer.Put(entry.tag);
+    writer.Put(entry.target);
+  }
+}
+
+bool IndirectTargetPredictor::Restore(VmSnapshot::Reader &reader) {
+  constexpr size_t kEntryBytes = sizeof(bool) + sizeof(uint8_t) + sizeof(uint16_t) + sizeof(uint64_t);
+  auto entries = reader.Get<uint64_t>();
+  auto history_length = reader.Get<uint64_t>();
+  auto path = reader.Get<uint64_t>();
+  if (entries != entries_.size() || history_length != history_length_) {
+    reader.Take(entries*kEntryBytes);
+    return false;
+  }
+  path_ = path;
+  for (Entry &entry : entries_) {
+    entry.valid = reader.Get<bool>();
+    entry.confidence = reader.Get<uint8_t>();
+    entry.tag = reader.Get<uint16_t>();
+    entry.target = reader.Get<uint64_t>();
+  }
+  return true;
+}
@@ -0,0 +1,474 @@
+/**
+ * @file branch_predictor.h
+ * @brief Contains the direction predictors, branch target buffer and return/indirect target predictors used by
+ * the pipelined VM.
+ */
+#ifndef BRANCH_PREDICTOR_H
+#define BRANCH_PREDICTOR_H
+
+#include "vm_snapshot.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Predicts the direction of conditional branches.
+ *
+ * The pipeline calls Predict() at fetch and Update() when the branch resolves
+ * in EX. Global histories are updated at resolve time rather than
+ * speculatively at fetch, so Update() recomputes the indices Predict() used
+ * from the same history; in a five-stage in-order pipeline the two only
+ * differ when an older branch resolves in between.
+ *
+ * Lookup and misprediction counts are kept by the pipeline, which sees both
+ * the prediction and the outcome; predictors count what only they know
+ * (which component provided the prediction, how often weights were trained)
+ * and print it from WriteStats().
+ */
+class BranchPredictor {
+ public:
+  virtual ~BranchPredictor() = default;
+
+  virtual std::string Name() const = 0;
+  virtual bool Predict(uint64_t pc) const = 0;
+  virtual void Update(uint64_t pc, bool taken) = 0;
+  /**
+   * @brief Clears the tables, histories and predictor-specific counters.
+   */
+  virtual void Reset() = 0;
+  virtual size_t StorageBits() const = 0;
+
+  /**
+   * @brief Writes the predictor's tables, skipping entries still in their initial state.
+   */
+  virtual void DumpTables(std::ostream &out) const = 0;
+  virtual void WriteStats(std::ostream &out) const = 0;
+
+  /**
+   * @brief Writes the tables to a snapshot section, prefixed by the predictor's name and geometry.
+   */
+  void Save(VmSnapshot::Writer &writer) const;
+  /**
+   * @brief Restores tables saved by a predictor with the same name and geometry.
+   * @return false (leaving the tables alone) if the snapshot was taken with a different predictor.
+   */
+  bool Restore(VmSnapshot::Reader &reader);
+
+ protected:
+  // Parameters that determine the table layout; a snapshot only fits an identical layout
+  virtual std::vector<uint64_t> Geometry() const = 0;
+  virtual void SaveTables(VmSnapshot::Writer &writer) const = 0;
+  virtual void RestoreTables(VmSnapshot::Reader &reader) = 0;
+};
+
+/**
+ * @brief Builds a predictor by name: "bimodal", "gshare", "tournament", "tage" or "perceptron".
+ * @param table_size Entries of the main table (counters, local histories or perceptrons); a power of two.
+ * @param history_length Global history bits; 0 picks the predictor's default.
+ * @throws std::invalid_argument for an unknown name or a size that is not a power of two.
+ */
+std::unique_ptr<BranchPredictor> MakeBranchPredictor(const std::string &type, uint64_t table_size,
+                                                     uint64_t history_length);
+
+/**
+ * @brief Table of 2-bit saturating counters indexed by PC.
+ */
+class BimodalPredictor : public BranchPredictor {
+ public:
+  explicit BimodalPredictor(size_t entries);
+
+  std::string Name() const override { return "bimodal"; }
+  bool Predict(uint64_t pc) const override { return counters_[Index(pc)] >= 2; }
+  void Update(uint64_t pc, bool taken) override;
+  void Reset() override;
+  size_t StorageBits() const override { return counters_.size()*2; }
+  void DumpTables(std::ostream &out) const override;
+  void WriteStats(std::ostream &out) const override;
+
+ protected:
+  std::vector<uint64_t> Geometry() const override { return {counters_.size()}; }
+  void SaveTables(VmSnapshot::Writer &writer) const override;
+  void RestoreTables(VmSnapshot::Reader &reader) override;
+
+ private:
+  size_t Index(uint64_t pc) const { return (pc >> 2) & (counters_.size() - 1); }
+
+  std::vector<uint8_t> counters_;
+};
+
+/**
+ * @brief 2-bit counters indexed by PC xor global history (McFarling).
+ */
+class GsharePredictor : public BranchPredictor {
+ public:
+  GsharePredictor(size_t entries, unsigned history_length);
+
+  std::string Name() const override { return "gshare"; }
+  bool Predict(uint64_t pc) const override { return counters_[Index(pc)] >= 2; }
+  void Update(uint64_t pc, bool taken) override;
+  void Reset() override;
+  size_t StorageBits() const override { return counters_.size()*2 + history_length_; }
+  void DumpTables(std::ostream &out) const override;
+  void WriteStats(std::ostream &out) const override;
+
+ protected:
+  std::vector<uint64_t> Geometry() const override { return {counters_.size(), history_length_}; }
+  void SaveTables(VmSnapshot::Writer &writer) const override;
+  void RestoreTables(VmSnapshot::Reader &reader) override;
+
+ private:
+  size_t Index(uint64_t pc) const;
+
+  std::vector<uint8_t> counters_;
+  unsigned history_length_;
+  uint64_t history_ = 0;
+};
+
+/**
+ * @brief Alpha 21264-style tournament predictor.
+ *
+ * A local predictor (per-branch history selecting a 3-bit counter) and a
+ * global predictor (2-bit counters indexed by global history) compete; a
+ * chooser indexed by global history picks the one that has been right more
+ * often in that context.
+ */
+class TournamentPredictor : public BranchPredictor {
+ public:
+  TournamentPredictor(size_t local_entries, unsigned history_length);
+
+  std::string Name() const override { return "tournament"; }
+  bool Predict(uint64_t pc) const override;
+  void Update(uint64_t pc, bool taken) override;
+  void Reset() override;
+  size_t StorageBits() const override;
+  void DumpTables(std::ostream &out) const override;
+  void WriteStats(std::ostream &out) const override;
+
+ protected:
+  std::vector<uint64_t> Geometry() const override { return {local_histories_.size(), history_length_}; }
+  void SaveTables(VmSnapshot::Writer &writer) const override;
+  void RestoreTables(VmSnapshot::Reader &reader) override;
+
+ private:
+  static constexpr unsigned kLocalHistoryLength = 10;
+
+  size_t LocalSlot(uint64_t pc) const { return (pc >> 2) & (local_histories_.size() - 1); }
+  size_t GlobalIndex() const { return history_ & ((uint64_t{1} << history_length_) - 1); }
+  bool LocalPrediction(uint64_t pc) const { return local_counters_[local_histories_[LocalSlot(pc)]] >= 4; }
+  bool GlobalPrediction() const { return global_counters_[GlobalIndex()] >= 2; }
+
+  std::vector<uint16_t> local_histories_;
+  std::vector<uint8_t> local_counters_;   // 3-bit, indexed by local history
+  std::vector<uint8_t> global_counters_;  // 2-bit, indexed by global history
+  std::vector<uint8_t> chooser_;          // 2-bit, >= 2 selects the global predictor
+  unsigned history_length_;
+  uint64_t history_ = 0;
+
+  uint64_t global_chosen_ = 0;
+  uint64_t local_chosen_ = 0;
+  uint64_t components_disagreed_ = 0;
+};
+
+/**
+ * @brief TAGE predictor (Seznec & Michaud): a bimodal base table plus tagged
+ * tables indexed by geometrically increasing global history lengths.
+ *
+ * The longest matching history provides the prediction; a newly allocated,
+ * still-weak provider defers to the alternate prediction while the
+ * use-alt-on-new-allocation counter says that pays off. On a misprediction an
+ * entry is allocated in one longer table whose usefulness counter is zero.
+ * Histories are folded incrementally into index and tag widths.
+ */
+class TagePredictor : public BranchPredictor {
+ public:
+  static constexpr size_t kTaggedTables = 4;
+  static constexpr unsigned kMaxHistoryLength = 256;
+
+  TagePredictor(size_t base_entries, unsigned max_history_length);
+
+  std::string Name() const override { return "tage"; }
+  bool Predict(uint64_t pc) const override { return Lookup(pc).prediction; }
+  void Update(uint64_t pc, bool taken) override;
+  void Reset() override;
+  size_t StorageBits() const override;
+  void DumpTables(std::ostream &out) const override;
+  void WriteStats(std::ostream &out) const override;
+
+ protected:
+  std::vector<uint64_t> Geometry() const override;
+  void SaveTables(VmSnapshot::Writer &writer) const override;
+  void RestoreTables(VmSnapshot::Reader &reader) override;
+
+ private:
+  struct Entry {
+    uint16_t tag = 0;
+    int8_t counter = 0;  // 3-bit signed, >= 0 predicts taken
+    uint8_t useful = 0;  // 2-bit
+  };
+
+  // Global history compressed to `width` bits by xor-ing `length`-bit chunks
+  struct FoldedHistory {
+    uint32_t value = 0;
+    unsigned length = 0;
+    unsigned width = 0;
+
+    void Push(bool newest, bool oldest) {
+      value = (value << 1) | static_cast<uint32_t>(newest);
+      value ^= static_cast<uint32_t>(oldest) << (length % width);
+      value ^= value >> width;
+      value &= (uint32_t{1} << width) - 1;
+    }
+  };
+
+  struct LookupResult {
+    int provider = -1;  // tagged table, or -1 for the base table
+    int alternate = -1;
+    size_t index[kTaggedTables];
+    uint16_t tag[kTaggedTables];
+    bool provider_prediction;
+    bool alternate_prediction;
+    bool prediction;
+  };
+
+  LookupResult Lookup(uint64_t pc) const;
+  size_t BaseIndex(uint64_t pc) const { return (pc >> 2) & (base_.size() - 1); }
+  bool HistoryBit(unsigned age) const { return history_[(head_ + age) % kHistoryBuffer] != 0; }
+  void PushHistory(bool taken);
+
+  std::vector<uint8_t> base_;  // 2-bit counters
+  std::vector<Entry> tables_[kTaggedTables];
+  unsigned history_lengths_[kTaggedTables];
+  unsigned tag_widths_[kTaggedTables];
+  unsigned index_width_;
+
+  // Circular, history_[head_] is the newest outcome; one slot longer than the longest history so the
+  // outcome leaving it can still be read
+  static constexpr unsigned kHistoryBuffer = kMaxHistoryLength + 1;
+  uint8_t history_[kHistoryBuffer] = {};
+  unsigned head_ = 0;
+  FoldedHistory index_history_[kTaggedTables];
+  FoldedHistory tag_history_[kTaggedTables][2];
+
+  int8_t use_alternate_ = 8;  // 4-bit, >= 8 trusts the alternate over a new provider
+  uint64_t updates_ = 0;      // usefulness counters age every kUsefulResetPeriod updates
+  uint32_t random_ = 0x2545f491;
+  static constexpr uint64_t kUsefulResetPeriod = 1 << 18;
+
+  uint64_t provider_hits_[kTaggedTables + 1] = {};  // [0] is the base table
+  uint64_t allocations_ = 0;
+  uint64_t allocation_failures_ = 0;
+};
+
+/**
+ * @brief Perceptron predictor (Jiménez & Lin): one weight vector per PC slot,
+ * dotted with the global history; trained on mispredictions and whenever the
+ * output is below the threshold.
+ */
+class PerceptronPredictor : public BranchPredictor {
+ public:
+  static constexpr unsigned kMaxHistoryLength = 62;
+
+  PerceptronPredictor(size_t perceptrons, unsigned history_length);
+
+  std::string Name() const override { return "perceptron"; }
+  bool Predict(uint64_t pc) const override { return Output(pc) >= 0; }
+  void Update(uint64_t pc, bool taken) override;
+  void Reset() override;
+  size_t StorageBits() const override { return weights_.size()*8 + history_length_; }
+  void DumpTables(std::ostream &out) const override;
+  void WriteStats(std::ostream &out) const override;
+
+ protected:
+  std::vector<uint64_t> Geometry() const override { return {perceptrons_, history_length_}; }
+  void SaveTables(VmSnapshot::Writer &writer) const override;
+  void RestoreTables(VmSnapshot::Reader &reader) override;
+
+ private:
+  size_t Row(uint64_t pc) const { return ((pc >> 2) & (perceptrons_ - 1))*(history_length_ + 1); }
+  int Output(uint64_t pc) const;
+
+  size_t perceptrons_;
+  unsigned history_length_;
+  int threshold_;
+  std::vector<int8_t> weights_;  // per perceptron: bias, then one weight per history bit
+  uint64_t history_ = 0;
+
+  uint64_t trainings_ = 0;
+};
+
+/**
+ * @brief Set-associative, tagged branch target buffer with LRU replacement.
+ *
+ * Entries are allocated when a control transfer is taken; the kind tells
+ * fetch whether the direction predictor needs to be consulted.
+ */
+class BranchTargetBuffer {
+ public:
+  enum class Kind : uint8_t {
+    kConditional,
+    kJump,      // jal
+    kIndirect,  // jalr
+  };
+
+  struct Entry {
+    bool valid = false;
+    Kind kind = Kind::kConditional;
+    uint64_t tag = 0;
+    uint64_t target = 0;
+    uint64_t last_used = 0;
+  };
+
+  BranchTargetBuffer() : BranchTargetBuffer(256, 4) {}
+  /**
+   * @throws std::invalid_argument unless entries is a multiple of ways and the set count is a power of two.
+   */
+  BranchTargetBuffer(size_t entries, size_t ways);
+
+  /**
+   * @brief Returns the entry for `pc`, or nullptr on a miss; a hit refreshes the entry's LRU age.
+   */
+  const Entry *Lookup(uint64_t pc);
+  void Update(uint64_t pc, uint64_t target, Kind kind);
+  void Clear();
+
+  size_t Entries() const { return entries_.size(); }
+  size_t Ways() const { return ways_; }
+  size_t ValidEntries() const;
+  size_t StorageBits() const;
+
+  void Dump(std::ostream &out) const;
+  void Save(VmSnapshot::Writer &writer) const;
+  bool Restore(VmSnapshot::Reader &reader);
+
+ private:
+  size_t Set(uint64_t pc) const { return (pc >> 2) & (sets_ - 1); }
+  uint64_t Tag(uint64_t pc) const { return (pc >> 2)/sets_; }
+  uint64_t EntryPc(size_t set, const Entry &entry) const { return (entry.tag*sets_ + set) << 2; }
+
+  size_t ways_;
+  size_t sets_;
+  std::vector<Entry> entries_;  // set-major
+  uint64_t tick_ = 0;
+};
+
+const char *BranchKindName(BranchTargetBuffer::Kind kind);
+
+/**
+ * @brief Circular return address stack.
+ *
+ * Fetch predecodes jal/jalr and pushes or pops following the RISC-V hint
+ * convention (x1/x5 as link registers), so updates are speculative. Each
+ * fetched instruction carries a checkpoint of the top of stack; when EX
+ * redirects fetch, the stack is restored from the mispredicted instruction's
+ * checkpoint, which undoes the wrong-path pushes and pops. On overflow the
+ * oldest entry is overwritten.
+ */
+class ReturnAddressStack {
+ public:
+  struct Action {
+    bool pop = false;
+    bool push = false;
+  };
+
+  struct Checkpoint {
+    uint32_t top = 0;
+    uint32_t size = 0;
+    uint64_t top_value = 0;
+  };
+
+  /**
+   * @brief Returns the stack operation implied by a jal/jalr's rd and rs1 (RISC-V unprivileged spec, Table 3).
+   */
+  static Action ActionFor(uint32_t instruction);
+
+  explicit ReturnAddressStack(size_t depth = 16);
+
+  void Push(uint64_t return_address);
+  uint64_t Pop();
+  bool Empty() const { return size_ == 0; }
+  uint64_t Top() const { return entries_[top_]; }
+  // Pops then pushes, as a jalr that both returns and calls (coroutine swap) does
+  void Apply(const Action &action, uint64_t return_address) {
+    if (action.pop) {
+      Pop();
+    }
+    if (action.push) {
+      Push(return_address);
+    }
+  }
+
+  Checkpoint Save() const { return {top_, size_, entries_[top_]}; }
+  void Restore(const Checkpoint &checkpoint);
+  void Clear();
+
+  size_t Depth() const { return entries_.size(); }
+  size_t Size() const { return size_; }
+  uint64_t Overflows() const { return overflows_; }
+  size_t StorageBits() const { return entries_.size()*30; }
+
+  void Dump(std::ostream &out) const;
+  void Save(VmSnapshot::Writer &writer) const;
+  bool Restore(VmSnapshot::Reader &reader);
+
+ private:
+  std::vector<uint64_t> entries_;
+  uint32_t top_ = 0;
+  uint32_t size_ = 0;
+  uint64_t overflows_ = 0;
+};
+
+/**
+ * @brief Target cache for indirect jumps, indexed by PC hashed with the path history.
+ *
+ * The path history shifts in bits of the target of every taken control
+ * transfer, so one jalr that dispatches to different targets in different
+ * contexts (switch tables, virtual calls) gets one entry per context. Each
+ * entry keeps a partial PC tag and a 2-bit confidence; a wrong target only
+ * replaces the stored one once confidence has dropped to zero.
+ */
+class IndirectTargetPredictor {
+ public:
+  IndirectTargetPredictor() : IndirectTargetPredictor(256, 12) {}
+  /**
+   * @throws std::invalid_argument if entries is not a power of two or history_length exceeds 63.
+   */
+  IndirectTargetPredictor(size_t entries, unsigned history_length);
+
+  bool Predict(uint64_t pc, uint64_t &target) const;
+  void Update(uint64_t pc, uint64_t target);
+  void RecordPath(uint64_t target) {
+    path_ = ((path_ << kPathShift) ^ (target >> 2)) & ((uint64_t{1} << history_length_) - 1);
+  }
+  void Clear();
+
+  size_t Entries() const { return entries_.size(); }
+  unsigned HistoryLength() const { return history_length_; }
+  size_t StorageBits() const { return entries_.size()*(1 + 16 + 30 + 2) + history_length_; }
+
+  void Dump(std::ostream &out) const;
+  void Save(VmSnapshot::Writer &writer) const;
+  bool Restore(VmSnapshot::Reader &reader);
+
+ private:
+  static constexpr unsigned kPathShift = 2;
+
+  struct Entry {
+    bool valid = false;
+    uint8_t confidence = 0;
+    uint16_t tag = 0;
+    uint64_t target = 0;
+  };
+
+  size_t Index(uint64_t pc) const;
+  static uint16_t Tag(uint64_t pc) { return static_cast<uint16_t>((pc >> 2) ^ (pc >> 18)); }
+
+  std::vector<Entry> entries_;
+  unsigned history_length_;
+  uint64_t path_ = 0;
+};
+
+#endif // BRANCH_PREDICTOR_H
@@ -0,0 +1,195 @@
+/**
+ * @file branch_trace.cpp
+ * @brief Contains the implementation of the branch trace writer and reader.
+ */
+#include "branch_trace.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+constexpr char kMagic[8] = {'R', 'V', 'B', 'T', 'R', 'A', 'C', 'E'};
+constexpr uint32_t kVersion = 1;
+constexpr uint8_t kEndMarker = 0xFF;
+constexpr size_t kFlushThreshold = 64*1024;
+
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+};
+
+uint64_t ZigZag(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t UnZigZag(uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+bool IsLink(uint32_t reg) {
+  return reg == 1 || reg == 5;
+}
+
+int64_t BranchOffset(uint32_t instruction) {
+  int64_t offset = ((instruction >> 31) & 0x1) << 12 | ((instruction >> 7) & 0x1) << 11 |
+                   ((instruction >> 25) & 0x3F) << 5 | ((instruction >> 8) & 0xF) << 1;
+  return (offset ^ 0x1000) - 0x1000;  // sign-extend 13 bits
+}
+} // namespace
+
+const char *BranchKindName(BranchKind kind) {
+  switch (kind) {
+    case BranchKind::kConditional: return "conditional";
+    case BranchKind::kJump: return "jump";
+    case BranchKind::kCall: return "call";
+    case BranchKind::kReturn: return "return";
+    case BranchKind::kIndirect: return "indirect";
+    case BranchKind::kCount: break;
+  }
+  return "?";
+}
+
+void BranchTraceWriter::Start(const std::filesystem::path &filename) {
+  Stop();
+  out_.open(filename, std::ios::binary | std::ios::trunc);
+  if (!out_.is_open()) {
+    throw std::runtime_error("Unable to open file: " + filename.string());
+  }
+  path_ = filename;
+  FileHeader header{};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  out_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  buffer_.clear();
+  enabled_ = true;
+  gap_ = 0;
+  expected_pc_ = 0;
+  records_ = 0;
+}
+
+void BranchTraceWriter::Stop() {
+  if (!enabled_) {
+    return;
+  }
+  buffer_.push_back(kEndMarker);
+  PutVarint(gap_);
+  Flush();
+  out_.close();
+  enabled_ = false;
+}
+
+void BranchTraceWriter::Flush() {
+  if (out_.is_open() && !buffer_.empty()) {
+    out_.write(reinterpret_cast<const char *>(buffer_.data()), static_cast<std::streamsize>(buffer_.size()));
+    out_.flush();
+  }
+  buffer_.clear();
+}
+
+void BranchTraceWriter::Restart() {
+  if (enabled_) {
+    enabled_ = false;
+    out_.close();
+    Start(path_);
+  }
+}
+
+void BranchTraceWriter::PutVarint(uint64_t value) {
+  while (value >= 0x80) {
+    buffer_.push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  buffer_.push_back(static_cast<uint8_t>(value));
+}
+
+void BranchTraceWriter::Write(uint64_t pc, uint32_t instruction, uint64_t next_pc) {
+  uint32_t opcode = instruction & 0x7F;
+  uint32_t rd = (instruction >> 7) & 0x1F;
+  uint32_t rs1 = (instruction >> 15) & 0x1F;
+  BranchKind kind;
+  uint64_t target = next_pc;
+  bool taken = true;
+  if (opcode == 0b1100011) {
+    kind = BranchKind::kConditional;
+    target = pc + BranchOffset(instruction);
+    taken = next_pc != pc + 4;
+  } else if (IsLink(rd)) {
+    kind = BranchKind::kCall;
+  } else if (opcode == 0b1100111) {
+    kind = IsLink(rs1) ? BranchKind::kReturn : BranchKind::kIndirect;
+  } else {
+    kind = BranchKind::kJump;
+  }
+
+  buffer_.push_back(static_cast<uint8_t>(static_cast<uint8_t>(kind) | (taken ? 0x8 : 0)));
+  PutVarint(gap_);
+  PutVarint(ZigZag(static_cast<int64_t>(pc - (expected_pc_ + 4*(gap_ - 1)))));
+  PutVarint(ZigZag(static_cast<int64_t>(target - pc)));
+  gap_ = 0;
+  expected_pc_ = next_pc;
+  ++records_;
+  if (buffer_.size() >= kFlushThreshold) {
+    Flush();
+  }
+}
+
+BranchTraceReader::BranchTraceReader(const std::filesystem::path &filename)
+    : in_(filename, std::ios::binary) {
+  if (!in_.is_open()) {
+    throw std::runtime_error("Unable to open file: " + filename.string());
+  }
+  FileHeader header{};
+  in_.read(reinterpret_cast<char *>(&header), sizeof(header));
+  if (!in_ || std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+    throw std::runtime_error("Not a branch trace: " + filename.string());
+  }
+  if (header.version != kVersion) {
+    throw std::runtime_error("Unsupported branch trace version " + std::to_string(header.version));
+  }
+}
+
+bool BranchTraceReader::GetVarint(uint64_t &value) {
+  value = 0;
+  for (unsigned shift = 0; shift < 64; shift += 7) {
+    int byte = in_.get();
+    if (byte == std::char_traits<char>::eof()) {
+      return false;
+    }
+    value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool BranchTraceReader::Next(BranchRecord &record) {
+  if (done_) {
+    return false;
+  }
+  int flags = in_.get();
+  uint64_t gap = 0;
+  if (flags == std::char_traits<char>::eof() || flags == kEndMarker) {
+    if (flags == kEndMarker && GetVarint(gap)) {
+      instructions_ += gap;
+    }
+    done_ = true;
+    return false;
+  }
+  uint64_t pc_delta = 0;
+  uint64_t target_delta = 0;
+  if ((flags & 0x7) >= static_cast<int>(BranchKind::kCount) || !GetVarint(gap) || gap == 0 ||
+      !GetVarint(pc_delta) || !GetVarint(target_delta)) {
+    done_ = true;  // truncated or corrupt record
+    return false;
+  }
+  instructions_ += gap;
+  record.pc = expected_pc_ + 4*(gap - 1) + UnZigZag(pc_delta);
+  record.target = record.pc + UnZigZag(target_delta);
+  record.instructions = instructions_;
+  record.kind = static_cast<BranchKind>(flags & 0x7);
+  record.taken = (flags & 0x8) != 0;
+  expected_pc_ = record.taken ? record.target : record.pc + 4;
+  return true;
+}
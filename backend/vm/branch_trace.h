@@ -0,0 +1,122 @@
+/**
+ * @file branch_trace.h
+ * @brief Contains the compact binary branch trace written by the VMs and read by the offline predictor evaluator.
+ */
+#ifndef BRANCH_TRACE_H
+#define BRANCH_TRACE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+enum class BranchKind : uint8_t {
+  kConditional,
+  kJump,          // jal without link
+  kCall,          // jal/jalr linking x1/x5
+  kReturn,        // jalr through x1/x5
+  kIndirect,      // other jalr
+  kCount
+};
+
+const char *BranchKindName(BranchKind kind);
+
+/**
+ * @brief One retired control transfer.
+ */
+struct BranchRecord {
+  uint64_t pc = 0;
+  uint64_t target = 0;        // taken target; for conditional branches also when not taken
+  uint64_t instructions = 0;  // instructions retired up to and including this one
+  BranchKind kind = BranchKind::kConditional;
+  bool taken = false;
+};
+
+/**
+ * @brief Streams retired branches to a trace file.
+ *
+ * Format: a 16-byte header ("RVBTRACE", version, reserved), then one
+ * variable-length record per branch:
+ *  - flags byte: kind in bits 0-2, taken in bit 3 (0xFF ends the trace);
+ *  - LEB128 number of instructions since the previous record, this one included;
+ *  - zigzag LEB128 of the PC minus the PC straight-line execution would have reached;
+ *  - zigzag LEB128 of target minus PC.
+ * Straight-line code between branches encodes its PC delta as 0, so most
+ * records take 3-5 bytes. The end marker is followed by the number of
+ * instructions retired after the last branch.
+ */
+class BranchTraceWriter {
+ public:
+  ~BranchTraceWriter() { Stop(); }
+
+  /**
+   * @brief Starts a new trace; throws if the file cannot be opened.
+   */
+  void Start(const std::filesystem::path &filename);
+  /**
+   * @brief Writes the end marker and closes the file.
+   */
+  void Stop();
+  bool IsEnabled() const { return enabled_; }
+  uint64_t Records() const { return records_; }
+
+  /**
+   * @brief Reports one retired instruction; only control transfers are written.
+   */
+  void Retire(uint64_t pc, uint32_t instruction, uint64_t next_pc) {
+    ++gap_;
+    uint32_t opcode = instruction & 0x7F;
+    if (opcode == 0b1100011 || opcode == 0b1101111 || opcode == 0b1100111) {
+      Write(pc, instruction, next_pc);
+    }
+  }
+
+  /**
+   * @brief Writes buffered records to the file (end of a run).
+   */
+  void Flush();
+  /**
+   * @brief Truncates the trace and starts again (VM reset).
+   */
+  void Restart();
+
+ private:
+  void Write(uint64_t pc, uint32_t instruction, uint64_t next_pc);
+  void PutVarint(uint64_t value);
+
+  std::filesystem::path path_;
+  std::ofstream out_;
+  std::vector<uint8_t> buffer_;
+  bool enabled_ = false;
+  uint64_t gap_ = 0;
+  uint64_t expected_pc_ = 0;  // fall-through PC after the previous record
+  uint64_t records_ = 0;
+};
+
+/**
+ * @brief Reads a trace written by BranchTraceWriter; a trace cut short (no end marker) reads up to the last record.
+ */
+class BranchTraceReader {
+ public:
+  /**
+   * @throws std::runtime_error if the file cannot be opened or is not a branch trace.
+   */
+  explicit BranchTraceReader(const std::filesystem::path &filename);
+
+  bool Next(BranchRecord &record);
+  /**
+   * @brief Instructions retired so far; after Next() returned false, the length of the whole trace.
+   */
+  uint64_t Instructions() const { return instructions_; }
+
+ private:
+  bool GetVarint(uint64_t &value);
+
+  std::ifstream in_;
+  uint64_t instructions_ = 0;
+  uint64_t expected_pc_ = 0;
+  bool done_ = false;
+};
+
+#endif // BRANCH_TRACE_H
@@ -0,0 +1,259 @@
+/**
+ * @file breakpoint_condition.cpp
+ * @brief Contains the parser and evaluator for breakpoint conditions.
+ */
+#include "breakpoint_condition.h"
+
+#include "registers.h"
+#include "memory_controller.h"
+
+#include <array>
+#include <cctype>
+#include <stdexcept>
+
+/**
+ * @brief Recursive-descent parser emitting postfix bytecode.
+ */
+class BreakpointCondition::Parser {
+ public:
+  Parser(const std::string &source, std::vector<Instruction> &code)
+      : source_(source), code_(code) {}
+
+  void Parse() {
+    ParseBinary(0);
+    SkipSpace();
+    if (pos_ != source_.size()) {
+      Fail("unexpected '" + source_.substr(pos_, 1) + "'");
+    }
+  }
+
+ private:
+  struct BinaryOperator {
+    const char *text;
+    int precedence;
+    Op op;
+  };
+
+  // Longer spellings first so that "<=" is not read as "<"
+  static constexpr std::array<BinaryOperator, 18> kBinaryOperators{{
+      {"||", 0, Op::kOr}, {"&&", 1, Op::kAnd},
+      {"==", 5, Op::kEq}, {"!=", 5, Op::kNe},
+      {"<=", 6, Op::kLe}, {">=", 6, Op::kGe}, {"<<", 7, Op::kShl}, {">>", 7, Op::kShr},
+      {"|", 2, Op::kBitOr}, {"^", 3, Op::kBitXor}, {"&", 4, Op::kBitAnd},
+      {"<", 6, Op::kLt}, {">", 6, Op::kGt},
+      {"+", 8, Op::kAdd}, {"-", 8, Op::kSub},
+      {"*", 9, Op::kMul}, {"/", 9, Op::kDiv}, {"%", 9, Op::kRem},
+  }};
+
+  [[noreturn]] void Fail(const std::string &message) const {
+    throw std::invalid_argument("Invalid breakpoint condition at column " + std::to_string(pos_ + 1)
+                                + ": " + message);
+  }
+
+  void SkipSpace() {
+    while (pos_ < source_.size() && std::isspace(static_cast<unsigned char>(source_[pos_]))) {
+      ++pos_;
+    }
+  }
+
+  bool Accept(const char *text) {
+    SkipSpace();
+    size_t length = std::char_traits<char>::length(text);
+    if (source_.compare(pos_, length, text) == 0) {
+      pos_ += length;
+      return true;
+    }
+    return false;
+  }
+
+  void Expect(const char *text) {
+    if (!Accept(text)) {
+      Fail(std::string("expected '") + text + "'");
+    }
+  }
+
+  void Emit(Op op, uint64_t operand, int stack_effect) {
+    code_.push_back({op, operand});
+    depth_ += stack_effect;
+    if (static_cast<size_t>(depth_) > kMaxStackDepth) {
+      Fail("expression too deeply nested");
+    }
+  }
+
+  const BinaryOperator *PeekBinaryOperator() {
+    SkipSpace();
+    for (const auto &candidate : kBinaryOperators) {
+      size_t length = std::char_traits<char>::length(candidate.text);
+      if (source_.compare(pos_, length, candidate.text) == 0) {
+        return &candidate;
+      }
+    }
+    return nullptr;
+  }
+
+  // Precedence climbing; all binary operators are left associative
+  void ParseBinary(int min_precedence) {
+    ParseUnary();
+    while (true) {
+      const BinaryOperator *op = PeekBinaryOperator();
+      if (!op || op->precedence < min_precedence) {
+        return;
+      }
+      pos_ += std::char_traits<char>::length(op->text);
+      ParseBinary(op->precedence + 1);
+      Emit(op->op, 0, -1);
+    }
+  }
+
+  void ParseUnary() {
+    SkipSpace();
+    if (pos_ < source_.size()) {
+      char c = source_[pos_];
+      if (c == '-' || c == '~' || (c == '!' && source_.compare(pos_, 2, "!=") != 0)) {
+        ++pos_;
+        ParseUnary();
+        Emit(c == '-' ? Op::kNeg : (c == '~' ? Op::kBitNot : Op::kNot), 0, 0);
+        return;
+      }
+    }
+    ParsePrimary();
+  }
+
+  void ParsePrimary() {
+    SkipSpace();
+    if (pos_ >= source_.size()) {
+      Fail("unexpected end of expression");
+    }
+    if (Accept("(")) {
+      ParseBinary(0);
+      Expect(")");
+      return;
+    }
+    char c = source_[pos_];
+    if (std::isdigit(static_cast<unsigned char>(c))) {
+      size_t consumed = 0;
+      uint64_t value = 0;
+      try {
+        value = std::stoull(source_.substr(pos_), &consumed, 0);
+      } catch (const std::exception &) {
+        Fail("invalid number");
+      }
+      pos_ += consumed;
+      Emit(Op::kPushImm, value, 1);
+      return;
+    }
+    if (!std::isalpha(static_cast<unsigned char>(c)) && c != '_') {
+      Fail("unexpected '" + std::string(1, c) + "'");
+    }
+
+    size_t start = pos_;
+    while (pos_ < source_.size()
+        && (std::isalnum(static_cast<unsigned char>(source_[pos_])) || source_[pos_] == '_')) {
+      ++pos_;
+    }
+    std::string name = source_.substr(start, pos_ - start);
+
+    if (name == "hits") {
+      Emit(Op::kPushHits, 0, 1);
+      return;
+    }
+    if (name == "mem8" || name == "mem16" || name == "mem32" || name == "mem64") {
+      Expect("[");
+      ParseBinary(0);
+      Expect("]");
+      Op load = name == "mem8" ? Op::kLoad8
+              : name == "mem16" ? Op::kLoad16
+              : name == "mem32" ? Op::kLoad32 : Op::kLoad64;
+      Emit(load, 0, 0);
+      return;
+    }
+
+    auto alias = reg_alias_to_name.find(name);
+    if (alias == reg_alias_to_name.end()) {
+      pos_ = start;
+      Fail("unknown identifier '" + name + "'");
+    }
+    const std::string &canonical = alias->second;
+    if (IsValidGeneralPurposeRegister(canonical)) {
+      Emit(Op::kPushGpr, std::stoull(canonical.substr(1)), 1);
+    } else if (IsValidFloatingPointRegister(canonical)) {
+      Emit(Op::kPushFpr, std::stoull(canonical.substr(1)), 1);
+    } else {
+      Emit(Op::kPushCsr, static_cast<uint64_t>(csr_to_address.at(canonical)), 1);
+    }
+  }
+
+  const std::string &source_;
+  std::vector<Instruction> &code_;
+  size_t pos_ = 0;
+  int depth_ = 0;
+};
+
+BreakpointCondition BreakpointCondition::Compile(const std::string &source) {
+  BreakpointCondition condition;
+  condition.source_ = source;
+  Parser(condition.source_, condition.code_).Parse();
+  return condition;
+}
+
+bool BreakpointCondition::Evaluate(const RegisterFile &registers, MemoryController &memory,
+                                   uint64_t hits) const {
+  std::array<int64_t, kMaxStackDepth> stack;
+  size_t top = 0;  // number of live entries
+
+  for (const Instruction &instruction : code_) {
+    // Ops are ordered push, unary, binary in the enum
+    if (instruction.op <= Op::kPushHits) {
+      switch (instruction.op) {
+        case Op::kPushImm: stack[top] = static_cast<int64_t>(instruction.operand); break;
+        case Op::kPushGpr: stack[top] = static_cast<int64_t>(registers.ReadGpr(instruction.operand)); break;
+        case Op::kPushFpr: stack[top] = static_cast<int64_t>(registers.ReadFpr(instruction.operand)); break;
+        case Op::kPushCsr: stack[top] = static_cast<int64_t>(registers.ReadCsr(instruction.operand)); break;
+        default: stack[top] = static_cast<int64_t>(hits); break;
+      }
+      ++top;
+      continue;
+    }
+
+    int64_t &a = stack[top - 1];
+    if (instruction.op <= Op::kBitNot) {
+      uint64_t address = static_cast<uint64_t>(a);
+      switch (instruction.op) {
+        case Op::kLoad8: a = memory.ReadByte_d(address); break;
+        case Op::kLoad16: a = memory.ReadHalfWord_d(address); break;
+        case Op::kLoad32: a = memory.ReadWord_d(address); break;
+        case Op::kLoad64: a = static_cast<int64_t>(memory.ReadDoubleWord_d(address)); break;
+        case Op::kNeg: a = static_cast<int64_t>(0 - address); break;
+        case Op::kNot: a = !a; break;
+        default: a = ~a; break;
+      }
+      continue;
+    }
+
+    int64_t b = stack[--top];
+    int64_t &lhs = stack[top - 1];
+    uint64_t ua = static_cast<uint64_t>(lhs);
+    uint64_t ub = static_cast<uint64_t>(b);
+    switch (instruction.op) {
+      case Op::kMul: lhs = static_cast<int64_t>(ua*ub); break;
+      case Op::kDiv: lhs = (b == 0 || (lhs == INT64_MIN && b == -1)) ? 0 : lhs/b; break;
+      case Op::kRem: lhs = (b == 0 || (lhs == INT64_MIN && b == -1)) ? 0 : lhs%b; break;
+      case Op::kAdd: lhs = static_cast<int64_t>(ua + ub); break;
+      case Op::kSub: lhs = static_cast<int64_t>(ua - ub); break;
+      case Op::kShl: lhs = static_cast<int64_t>(ua << (ub & 63)); break;
+      case Op::kShr: lhs = lhs >> (ub & 63); break;
+      case Op::kLt: lhs = lhs < b; break;
+      case Op::kLe: lhs = lhs <= b; break;
+      case Op::kGt: lhs = lhs > b; break;
+      case Op::kGe: lhs = lhs >= b; break;
+      case Op::kEq: lhs = lhs == b; break;
+      case Op::kNe: lhs = lhs != b; break;
+      case Op::kBitAnd: lhs = lhs & b; break;
+      case Op::kBitXor: lhs = lhs ^ b; break;
+      case Op::kBitOr: lhs = lhs | b; break;
+      case Op::kAnd: lhs = lhs && b; break;
+      default: lhs = lhs || b; break;
+    }
+  }
+  return top > 0 && stack[top - 1] != 0;
+}
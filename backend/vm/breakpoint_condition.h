@@ -0,0 +1,73 @@
+/**
+ * @file breakpoint_condition.h
+ * @brief Contains the compiled condition expressions attached to breakpoints.
+ */
+#ifndef BREAKPOINT_CONDITION_H
+#define BREAKPOINT_CONDITION_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class RegisterFile;
+class MemoryController;
+
+/**
+ * @brief A breakpoint condition compiled once into stack bytecode.
+ *
+ * The expression language is C-like integer arithmetic over 64-bit signed
+ * values:
+ *  - operands: decimal/hex literals, register names (`a0`, `x10`, `f1`, `fcsr`),
+ *    `hits` (times execution has reached this breakpoint, including the current one;
+ *    instructions fetched down a mispredicted path do not count),
+ *    and memory loads `mem8[expr]`, `mem16[expr]`, `mem32[expr]`, `mem64[expr]`;
+ *  - operators, by increasing precedence: `||`, `&&`, `|`, `^`, `&`, `== !=`,
+ *    `< <= > >=`, `<< >>`, `+ -`, `* / %`, unary `- ! ~`.
+ *
+ * Memory loads bypass the cache and watchpoints. Division by zero yields 0.
+ */
+class BreakpointCondition {
+ public:
+  static constexpr size_t kMaxStackDepth = 32;
+
+  BreakpointCondition() = default;
+
+  /**
+   * @brief Parses and compiles a condition.
+   * @throws std::invalid_argument on syntax errors or unknown registers.
+   */
+  static BreakpointCondition Compile(const std::string &source);
+
+  /**
+   * @brief Evaluates the condition against the current architectural state, which the caller
+   * must have brought up to date with every instruction older than the breakpoint.
+   * @param hits The hit count of the breakpoint, including this hit.
+   * @return True if the condition holds (non-zero).
+   */
+  bool Evaluate(const RegisterFile &registers, MemoryController &memory, uint64_t hits) const;
+
+  const std::string &Source() const { return source_; }
+  bool Empty() const { return code_.empty(); }
+
+ private:
+  enum class Op : uint8_t {
+    kPushImm, kPushGpr, kPushFpr, kPushCsr, kPushHits,
+    kLoad8, kLoad16, kLoad32, kLoad64,
+    kNeg, kNot, kBitNot,
+    kMul, kDiv, kRem, kAdd, kSub, kShl, kShr,
+    kLt, kLe, kGt, kGe, kEq, kNe,
+    kBitAnd, kBitXor, kBitOr, kAnd, kOr
+  };
+
+  struct Instruction {
+    Op op;
+    uint64_t operand;
+  };
+
+  class Parser;
+
+  std::string source_;
+  std::vector<Instruction> code_;
+};
+
+#endif // BREAKPOINT_CONDITION_H
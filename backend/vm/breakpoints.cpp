@@ -0,0 +1,53 @@
+/**
+ * @file breakpoints.cpp
+ * @brief Contains the implementation of the BreakpointTable.
+ */
+#include "breakpoints.h"
+
+#include <algorithm>
+
+bool BreakpointTable::Add(uint64_t address) {
+  auto &page = pages_[address >> kPageShift];
+  InvalidateCache();
+  unsigned int slot = Slot(address);
+  if (page.test(slot)) {
+    return false;
+  }
+  page.set(slot);
+  ++count_;
+  return true;
+}
+
+bool BreakpointTable::Remove(uint64_t address) {
+  auto it = pages_.find(address >> kPageShift);
+  if (it == pages_.end() || !it->second.test(Slot(address))) {
+    return false;
+  }
+  it->second.reset(Slot(address));
+  if (it->second.none()) {
+    pages_.erase(it);
+  }
+  InvalidateCache();
+  --count_;
+  return true;
+}
+
+void BreakpointTable::Clear() {
+  pages_.clear();
+  count_ = 0;
+  InvalidateCache();
+}
+
+std::vector<uint64_t> BreakpointTable::Addresses() const {
+  std::vector<uint64_t> addresses;
+  addresses.reserve(count_);
+  for (const auto &[page, bits] : pages_) {
+    for (unsigned int slot = 0; slot < kSlotsPerPage; ++slot) {
+      if (bits.test(slot)) {
+        addresses.push_back((page << kPageShift) | (static_cast<uint64_t>(slot) << 2));
+      }
+    }
+  }
+  std::sort(addresses.begin(), addresses.end());
+  return addresses;
+}
@@ -0,0 +1,80 @@
+/**
+ * @file breakpoints.h
+ * @brief Contains the BreakpointTable used by the VMs for constant-time breakpoint checks.
+ */
+#ifndef BREAKPOINTS_H
+#define BREAKPOINTS_H
+
+#include <bitset>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Instruction breakpoints stored as one bitmap per 4 KB page of code.
+ *
+ * A check is a page lookup (served from a one-entry cache for straight-line
+ * code) followed by a bit test. Engines that translate or predecode whole
+ * pages can call PageHasBreakpoints() once per page instead of per instruction.
+ */
+class BreakpointTable {
+ public:
+  static constexpr unsigned int kPageShift = 12;
+  static constexpr unsigned int kSlotsPerPage = (1u << kPageShift) / 4;
+
+  BreakpointTable() = default;
+
+  /**
+   * @brief Adds a breakpoint at the given instruction address.
+   * @return False if one already existed.
+   */
+  bool Add(uint64_t address);
+
+  /**
+   * @brief Removes the breakpoint at the given instruction address.
+   * @return False if there was none.
+   */
+  bool Remove(uint64_t address);
+
+  void Clear();
+
+  bool Contains(uint64_t address) const {
+    uint64_t page = address >> kPageShift;
+    if (page != cached_page_index_) {
+      auto it = pages_.find(page);
+      cached_page_index_ = page;
+      cached_page_ = (it == pages_.end()) ? nullptr : &it->second;
+    }
+    return cached_page_ && cached_page_->test(Slot(address));
+  }
+
+  bool PageHasBreakpoints(uint64_t page) const {
+    return pages_.find(page) != pages_.end();
+  }
+
+  size_t Size() const { return count_; }
+  bool Empty() const { return count_ == 0; }
+
+  /**
+   * @brief Returns all breakpoint addresses in ascending order.
+   */
+  std::vector<uint64_t> Addresses() const;
+
+ private:
+  static unsigned int Slot(uint64_t address) {
+    return static_cast<unsigned int>((address & ((1u << kPageShift) - 1)) >> 2);
+  }
+
+  void InvalidateCache() const {
+    cached_page_index_ = ~0ULL;
+    cached_page_ = nullptr;
+  }
+
+  std::unordered_map<uint64_t, std::bitset<kSlotsPerPage>> pages_;
+  size_t count_ = 0;
+
+  mutable uint64_t cached_page_index_ = ~0ULL;
+  mutable const std::bitset<kSlotsPerPage> *cached_page_ = nullptr;
+};
+
+#endif // BREAKPOINTS_H
@@ -57,9 +57,9 @@ struct CacheLine {
 };
 
 struct CacheStats {
-  unsigned long accesses; ///< Total number of accesses to the cache
-  unsigned long hits;     ///< Total number of hits in the cache
-  unsigned long misses;   ///< Total number of misses in the cache
+  uint64_t accesses = 0; ///< Total number of accesses to the cache
+  uint64_t hits = 0;     ///< Total number of hits in the cache
+  uint64_t misses = 0;   ///< Total number of misses in the cache
 
 
 };
@@ -0,0 +1,255 @@
+/**
+ * @file call_graph_profiler.cpp
+ * @brief Contains the implementation of the call graph profiler.
+ */
+#include "call_graph_profiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+bool IsLinkRegister(uint32_t reg) {
+  return reg == 1 || reg == 5;
+}
+} // namespace
+
+CallGraphProfiler::CallGraphProfiler() {
+  Clear();
+}
+
+void CallGraphProfiler::Load(const AssembledProgram &program) {
+  labels_.clear();
+  // symbol_table is ordered by name, so the alphabetically first label wins for aliases
+  for (const auto &[name, symbol] : program.symbol_table) {
+    if (!symbol.isData) {
+      labels_.emplace(symbol.address, name);
+    }
+  }
+  Clear();
+}
+
+void CallGraphProfiler::Clear() {
+  function_names_.clear();
+  function_ids_.clear();
+  nodes_.clear();
+  children_.clear();
+  stack_.clear();
+  pending_ = Pending::kNone;
+
+  uint32_t entry = FunctionFor(0);
+  nodes_.push_back({entry, 0});
+  nodes_[0].calls = 1;
+  current_node_ = 0;
+}
+
+uint32_t CallGraphProfiler::FunctionFor(uint64_t entry_pc) {
+  auto it = function_ids_.find(entry_pc);
+  if (it != function_ids_.end()) {
+    return it->second;
+  }
+  std::string name;
+  auto label = labels_.find(entry_pc);
+  if (label != labels_.end()) {
+    name = label->second;
+  } else if (entry_pc == 0) {
+    name = "_start";
+  } else {
+    std::ostringstream hex;
+    hex << "0x" << std::hex << entry_pc;
+    name = hex.str();
+  }
+  uint32_t id = static_cast<uint32_t>(function_names_.size());
+  function_names_.push_back(std::move(name));
+  function_ids_.emplace(entry_pc, id);
+  return id;
+}
+
+uint32_t CallGraphProfiler::ChildOf(uint32_t parent, uint32_t function) {
+  uint64_t key = (static_cast<uint64_t>(parent) << 32) | function;
+  auto it = children_.find(key);
+  if (it != children_.end()) {
+    return it->second;
+  }
+  uint32_t node = static_cast<uint32_t>(nodes_.size());
+  nodes_.push_back({function, parent});
+  children_.emplace(key, node);
+  return node;
+}
+
+void CallGraphProfiler::ClassifyJump(uint64_t pc, uint32_t instruction) {
+  uint32_t opcode = instruction & 0x7F;
+  uint32_t rd = (instruction >> 7) & 0x1F;
+  bool rd_link = IsLinkRegister(rd);
+
+  if (opcode == 0x6F) {  // jal
+    if (rd_link) {
+      pending_ = Pending::kCall;
+      pending_return_address_ = pc + 4;
+    }
+    return;
+  }
+
+  uint32_t rs1 = (instruction >> 15) & 0x1F;
+  bool rs1_link = IsLinkRegister(rs1);
+  if (rd_link && rs1_link && rd != rs1) {
+    pending_ = Pending::kReturnThenCall;
+  } else if (rd_link) {
+    pending_ = Pending::kCall;
+  } else if (rs1_link) {
+    pending_ = Pending::kReturn;
+  } else {
+    return;  // plain indirect jump
+  }
+  pending_return_address_ = pc + 4;
+}
+
+void CallGraphProfiler::ResolvePending(uint64_t target) {
+  Pending pending = pending_;
+  pending_ = Pending::kNone;
+  switch (pending) {
+    case Pending::kCall:
+      PushCall(target);
+      break;
+    case Pending::kReturn:
+      PopReturn(target);
+      break;
+    case Pending::kReturnThenCall:
+      if (!stack_.empty()) {
+        stack_.pop_back();
+        current_node_ = stack_.empty() ? 0 : stack_.back().node;
+      }
+      PushCall(target);
+      break;
+    case Pending::kNone:
+      break;
+  }
+}
+
+void CallGraphProfiler::PushCall(uint64_t target) {
+  uint32_t node = current_node_;
+  if (stack_.size() < kMaxTreeDepth) {
+    node = ChildOf(current_node_, FunctionFor(target));
+  }
+  ++nodes_[node].calls;
+  stack_.push_back({node, pending_return_address_});
+  current_node_ = node;
+}
+
+void CallGraphProfiler::PopReturn(uint64_t target) {
+  if (stack_.empty()) {
+    return;  // return from the entry function
+  }
+  // Unwind to the frame that expected this return address; frames skipped this way
+  // belong to functions that left through a tail call or a non-local jump
+  auto match = std::find_if(stack_.rbegin(), stack_.rend(), [target](const Frame &frame) {
+    return frame.return_address == target;
+  });
+  if (match != stack_.rend()) {
+    stack_.erase(std::prev(match.base()), stack_.end());
+  } else {
+    stack_.pop_back();
+  }
+  current_node_ = stack_.empty() ? 0 : stack_.back().node;
+}
+
+std::vector<CallGraphProfiler::FunctionStats> CallGraphProfiler::Functions() const {
+  // Subtree totals; children are always created after their parent
+  std::vector<uint64_t> subtree_instructions(nodes_.size());
+  std::vector<uint64_t> subtree_cycles(nodes_.size());
+  for (size_t i = nodes_.size(); i-- > 0;) {
+    subtree_instructions[i] += nodes_[i].instructions;
+    subtree_cycles[i] += nodes_[i].cycles;
+    if (i != 0) {
+      subtree_instructions[nodes_[i].parent] += subtree_instructions[i];
+      subtree_cycles[nodes_[i].parent] += subtree_cycles[i];
+    }
+  }
+
+  std::vector<FunctionStats> functions(function_names_.size());
+  for (size_t i = 0; i < function_names_.size(); ++i) {
+    functions[i].name = function_names_[i];
+  }
+  for (size_t i = 0; i < nodes_.size(); ++i) {
+    const Node &node = nodes_[i];
+    FunctionStats &stats = functions[node.function];
+    stats.calls += node.calls;
+    stats.exclusive_instructions += node.instructions;
+    stats.exclusive_cycles += node.cycles;
+    stats.exclusive_stall_cycles += node.stall_cycles;
+    stats.exclusive_mispredictions += node.mispredictions;
+
+    bool recursive = false;
+    for (size_t ancestor = i; ancestor != 0 && !recursive;) {
+      ancestor = nodes_[ancestor].parent;
+      recursive = nodes_[ancestor].function == node.function;
+    }
+    if (!recursive) {
+      stats.inclusive_instructions += subtree_instructions[i];
+      stats.inclusive_cycles += subtree_cycles[i];
+    }
+  }
+
+  functions.erase(std::remove_if(functions.begin(), functions.end(), [](const FunctionStats &stats) {
+    return stats.calls == 0;
+  }), functions.end());
+  std::sort(functions.begin(), functions.end(), [](const FunctionStats &a, const FunctionStats &b) {
+    return a.inclusive_cycles != b.inclusive_cycles ? a.inclusive_cycles > b.inclusive_cycles : a.name < b.name;
+  });
+  return functions;
+}
+
+void CallGraphProfiler::WriteReport(std::ostream &out) const {
+  out << std::left << std::setw(24) << "Function"
+      << std::right << std::setw(10) << "Calls"
+      << std::setw(14) << "Incl.Instr" << std::setw(14) << "Excl.Instr"
+      << std::setw(14) << "Incl.Cycles" << std::setw(14) << "Excl.Cycles"
+      << std::setw(12) << "Stalls" << std::setw(12) << "Mispred" << "\n";
+  for (const auto &stats : Functions()) {
+    out << std::left << std::setw(24) << stats.name
+        << std::right << std::setw(10) << stats.calls
+        << std::setw(14) << stats.inclusive_instructions << std::setw(14) << stats.exclusive_instructions
+        << std::setw(14) << stats.inclusive_cycles << std::setw(14) << stats.exclusive_cycles
+        << std::setw(12) << stats.exclusive_stall_cycles << std::setw(12) << stats.exclusive_mispredictions << "\n";
+  }
+}
+
+std::string CallGraphProfiler::PathOf(uint32_t node) const {
+  std::vector<uint32_t> chain;
+  for (uint32_t n = node;; n = nodes_[n].parent) {
+    chain.push_back(n);
+    if (n == 0) {
+      break;
+    }
+  }
+  std::string path;
+  for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+    if (!path.empty()) {
+      path += ';';
+    }
+    path += function_names_[nodes_[*it].function];
+  }
+  return path;
+}
+
+void CallGraphProfiler::WriteCollapsedStacks(std::ostream &out, Metric metric) const {
+  for (uint32_t i = 0; i < nodes_.size(); ++i) {
+    const Node &node = nodes_[i];
+    uint64_t value = metric == Metric::kCycles ? node.cycles
+                   : metric == Metric::kInstructions ? node.instructions
+                                                     : node.stall_cycles;
+    if (value != 0) {
+      out << PathOf(i) << ' ' << value << '\n';
+    }
+  }
+}
+
+void CallGraphProfiler::WriteCollapsedStacks(const std::filesystem::path &filename, Metric metric) const {
+  std::ofstream file(filename);
+  if (!file.is_open()) {
+    throw std::runtime_error("Unable to open file: " + filename.string());
+  }
+  WriteCollapsedStacks(file, metric);
+}
@@ -0,0 +1,145 @@
+/**
+ * @file call_graph_profiler.h
+ * @brief Contains the shadow-stack call graph profiler.
+ */
+#ifndef CALL_GRAPH_PROFILER_H
+#define CALL_GRAPH_PROFILER_H
+
+#include "../vm_asm_mw.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Attributes retired instructions and cycles to functions using a shadow call stack.
+ *
+ * Calls and returns are recognised from the standard link-register conventions
+ * (x1/x5, see the RAS hints in the RISC-V unprivileged spec, table 2.1):
+ *  - `jal`/`jalr` with rd = link register push a frame;
+ *  - `jalr` with rs1 = link register and rd != link register pops one;
+ *  - `jalr` with both set and rd != rs1 pops and then pushes (co-routine swap).
+ *
+ * The callee is identified by the PC of the next retired instruction, so the
+ * VMs only need to report retirements in program order. Function names come
+ * from the code labels in the symbol table.
+ */
+class CallGraphProfiler {
+ public:
+  struct FunctionStats {
+    std::string name;
+    uint64_t calls = 0;
+    uint64_t inclusive_instructions = 0;
+    uint64_t exclusive_instructions = 0;
+    uint64_t inclusive_cycles = 0;
+    uint64_t exclusive_cycles = 0;
+    uint64_t exclusive_stall_cycles = 0;
+    uint64_t exclusive_mispredictions = 0;
+  };
+
+  enum class Metric { kCycles, kInstructions, kStallCycles };
+
+  CallGraphProfiler();
+
+  /**
+   * @brief Builds the function name table from the program and clears all counts.
+   */
+  void Load(const AssembledProgram &program);
+
+  /**
+   * @brief Clears all counts and the shadow stack, keeping the name table.
+   */
+  void Clear();
+
+  void SetEnabled(bool enabled) { enabled_ = enabled; }
+  bool IsEnabled() const { return enabled_; }
+
+  /**
+   * @brief Reports one instruction retiring, in program order.
+   */
+  void Retire(uint64_t pc, uint32_t instruction) {
+    if (pending_ != Pending::kNone) {
+      ResolvePending(pc);
+    }
+    ++nodes_[current_node_].instructions;
+
+    uint32_t opcode = instruction & 0x7F;
+    if (opcode == 0x6F || opcode == 0x67) {
+      ClassifyJump(pc, instruction);
+    }
+  }
+
+  /**
+   * @brief Charges cycles (and the stalls/mispredictions among them) to the current function.
+   */
+  void AddCycles(uint64_t cycles, uint64_t stall_cycles = 0, uint64_t mispredictions = 0) {
+    Node &node = nodes_[current_node_];
+    node.cycles += cycles;
+    node.stall_cycles += stall_cycles;
+    node.mispredictions += mispredictions;
+  }
+
+  size_t Depth() const { return stack_.size(); }
+
+  /**
+   * @brief Aggregates the call tree per function, sorted by inclusive cycles.
+   *
+   * Recursive calls are counted once in inclusive totals.
+   */
+  std::vector<FunctionStats> Functions() const;
+
+  void WriteReport(std::ostream &out) const;
+
+  /**
+   * @brief Writes "caller;callee;... count" lines as consumed by flamegraph.pl and speedscope.
+   */
+  void WriteCollapsedStacks(std::ostream &out, Metric metric = Metric::kCycles) const;
+  void WriteCollapsedStacks(const std::filesystem::path &filename, Metric metric = Metric::kCycles) const;
+
+ private:
+  static constexpr size_t kMaxTreeDepth = 512;  // deeper recursion folds into the deepest node
+
+  enum class Pending : uint8_t { kNone, kCall, kReturn, kReturnThenCall };
+
+  struct Node {
+    uint32_t function;
+    uint32_t parent;
+    uint64_t instructions = 0;
+    uint64_t cycles = 0;
+    uint64_t stall_cycles = 0;
+    uint64_t mispredictions = 0;
+    uint64_t calls = 0;
+  };
+
+  struct Frame {
+    uint32_t node;
+    uint64_t return_address;
+  };
+
+  void ClassifyJump(uint64_t pc, uint32_t instruction);
+  void ResolvePending(uint64_t target);
+  void PushCall(uint64_t target);
+  void PopReturn(uint64_t target);
+  uint32_t FunctionFor(uint64_t entry_pc);
+  uint32_t ChildOf(uint32_t parent, uint32_t function);
+  std::string PathOf(uint32_t node) const;
+
+  bool enabled_ = false;
+
+  std::unordered_map<uint64_t, std::string> labels_;  // code label addresses
+  std::vector<std::string> function_names_;
+  std::unordered_map<uint64_t, uint32_t> function_ids_;
+
+  std::vector<Node> nodes_;  // nodes_[0] is the root (program entry)
+  std::unordered_map<uint64_t, uint32_t> children_;  // (parent << 32 | function) -> node
+  std::vector<Frame> stack_;
+  uint32_t current_node_ = 0;
+
+  Pending pending_ = Pending::kNone;
+  uint64_t pending_return_address_ = 0;
+};
+
+#endif // CALL_GRAPH_PROFILER_H
@@ -0,0 +1,107 @@
+/**
+ * @file cpi_stack.cpp
+ * @brief Contains the implementation of the CPI stack report.
+ */
+#include "cpi_stack.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <numeric>
+#include <sstream>
+
+const char *StallCauseName(StallCause cause) {
+  switch (cause) {
+    case StallCause::kLoadUse: return "load_use";
+    case StallCause::kRawNoForwarding: return "raw_no_forwarding";
+    case StallCause::kExecuteLatency: return "execute_latency";
+    case StallCause::kStructural: return "structural";
+    case StallCause::kControl: return "control";
+    case StallCause::kSerialize: return "serialize";
+    case StallCause::kCacheMiss: return "cache_miss";
+    case StallCause::kFillDrain: return "fill_drain";
+    case StallCause::kCount: break;
+  }
+  return "?";
+}
+
+void CpiStack::Resize(uint64_t text_start, uint64_t text_size) {
+  text_start_ = text_start;
+  per_pc_.assign(text_size / 4, {});
+  Clear();
+}
+
+void CpiStack::Clear() {
+  issued_ = 0;
+  lost_.fill(0);
+  std::fill(per_pc_.begin(), per_pc_.end(), std::array<uint64_t, kStallCauseCount>{});
+}
+
+void CpiStack::Retract(const std::vector<Change> &changes) {
+  for (auto it = changes.rbegin(); it != changes.rend(); ++it) {
+    issued_ -= it->issued;
+    if (it->cause == StallCause::kCount) {
+      continue;
+    }
+    --lost_[static_cast<size_t>(it->cause)];
+    uint64_t slot = (it->pc - text_start_) >> 2;
+    if (slot < per_pc_.size()) {
+      --per_pc_[slot][static_cast<size_t>(it->cause)];
+    }
+  }
+}
+
+void CpiStack::WriteReport(std::ostream &out, const AssembledProgram &program, uint64_t instructions,
+                           uint64_t width, size_t limit) const {
+  uint64_t lost = std::accumulate(lost_.begin(), lost_.end(), uint64_t{0});
+  double slots_per_instruction = static_cast<double>(std::max<uint64_t>(instructions, 1)*std::max<uint64_t>(width, 1));
+  auto cpi = [slots_per_instruction](uint64_t slots) {
+    return static_cast<double>(slots)/slots_per_instruction;
+  };
+
+  out << "CPI stack: " << instructions << " instructions, " << (issued_ + lost) << " issue slots ("
+      << width << " per cycle)\n";
+  out << std::left << std::setw(20) << "Component" << std::right << std::setw(14) << "Slots"
+      << std::setw(10) << "CPI" << "\n";
+  out << std::fixed << std::setprecision(3);
+  out << std::left << std::setw(20) << "base" << std::right << std::setw(14) << issued_
+      << std::setw(10) << cpi(issued_) << "\n";
+  for (size_t cause = 0; cause < kStallCauseCount; ++cause) {
+    out << std::left << std::setw(20) << StallCauseName(static_cast<StallCause>(cause)) << std::right
+        << std::setw(14) << lost_[cause] << std::setw(10) << cpi(lost_[cause]) << "\n";
+  }
+  out << std::left << std::setw(20) << "total" << std::right << std::setw(14) << (issued_ + lost)
+      << std::setw(10) << cpi(issued_ + lost) << "\n";
+
+  for (size_t cause = 0; cause < kStallCauseCount; ++cause) {
+    if (lost_[cause] == 0) {
+      continue;
+    }
+    std::vector<size_t> slots;
+    for (size_t slot = 0; slot < per_pc_.size(); ++slot) {
+      if (per_pc_[slot][cause] != 0) {
+        slots.push_back(slot);
+      }
+    }
+    if (slots.empty()) {
+      continue;
+    }
+    std::sort(slots.begin(), slots.end(), [&](size_t a, size_t b) {
+      return per_pc_[a][cause] != per_pc_[b][cause] ? per_pc_[a][cause] > per_pc_[b][cause] : a < b;
+    });
+    if (limit != 0 && slots.size() > limit) {
+      slots.resize(limit);
+    }
+    out << "\n" << StallCauseName(static_cast<StallCause>(cause)) << " by responsible instruction:\n";
+    for (size_t slot : slots) {
+      auto line = program.instruction_number_line_number_mapping.find(static_cast<unsigned int>(slot));
+      std::ostringstream pc;
+      pc << "0x" << std::hex << std::setw(8) << std::setfill('0') << (text_start_ + slot*4);
+      out << "  " << std::left << std::setw(12) << pc.str() << "line " << std::setw(6)
+          << (line == program.instruction_number_line_number_mapping.end() ? 0 : line->second)
+          << std::right << std::setw(12) << per_pc_[slot][cause]
+          << std::setw(8) << std::setprecision(1) << 100.0*static_cast<double>(per_pc_[slot][cause])/static_cast<double>(lost_[cause])
+          << "%\n" << std::setprecision(3);
+    }
+  }
+  out << std::defaultfloat;
+}
@@ -0,0 +1,119 @@
+/**
+ * @file cpi_stack.h
+ * @brief Contains the issue-slot accounting behind the pipelined VMs' CPI stack.
+ */
+#ifndef CPI_STACK_H
+#define CPI_STACK_H
+
+#include "../vm_asm_mw.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+/**
+ * @brief Why an issue slot went unused.
+ */
+enum class StallCause : uint8_t {
+  kLoadUse,          // waiting for a load's data with forwarding on
+  kRawNoForwarding,  // waiting for a result to reach the register file (forwarding off, or within a pair)
+  kExecuteLatency,   // waiting behind a multi-cycle operation (RAW or in-order WAW)
+  kStructural,       // functional unit busy, or a per-cycle issue limit
+  kControl,          // squashed or not fetched behind a redirect
+  kSerialize,        // SYSTEM, FENCE and AMO instructions issue alone
+  kCacheMiss,        // not modelled yet: MEM always takes memory_stages cycles
+  kFillDrain,        // nothing fetched: pipeline start, program end, sampled-run drain
+  kCount
+};
+
+constexpr size_t kStallCauseCount = static_cast<size_t>(StallCause::kCount);
+
+const char *StallCauseName(StallCause cause);
+
+/**
+ * @brief Counts issued and lost issue slots, with each lost slot charged to a cause and
+ * to the PC of the instruction responsible (the producer, branch, unit holder or
+ * serialising instruction).
+ *
+ * With `width` slots per cycle, cycles * width = issued + sum of lost slots, so
+ * CPI splits into a base of issued / (instructions * width) plus
+ * lost / (instructions * width) per cause.
+ */
+class CpiStack {
+ public:
+  /**
+   * @brief Sizes the per-PC counters for a text section and zeroes everything.
+   */
+  void Resize(uint64_t text_start, uint64_t text_size);
+  void Clear();
+
+  // PC for slots no instruction is responsible for; they only appear in the totals
+  static constexpr uint64_t kNoPc = UINT64_MAX;
+
+  // One counter update, for undo: `issued` slots issued, and a slot lost to `cause` at `pc`
+  // unless `cause` is kCount
+  struct Change {
+    uint64_t pc;
+    StallCause cause;
+    int8_t issued;
+  };
+
+  void Issue() {
+    ++issued_;
+    if (journal_) {
+      journal_->push_back({kNoPc, StallCause::kCount, 1});
+    }
+  }
+  // Takes back an issued slot whose instruction was squashed and charges it instead
+  void Squash(StallCause cause, uint64_t pc) {
+    --issued_;
+    if (journal_) {
+      journal_->push_back({kNoPc, StallCause::kCount, -1});
+    }
+    Charge(cause, pc);
+  }
+  void Charge(StallCause cause, uint64_t pc) {
+    ++lost_[static_cast<size_t>(cause)];
+    uint64_t slot = (pc - text_start_) >> 2;
+    if (slot < per_pc_.size()) {
+      ++per_pc_[slot][static_cast<size_t>(cause)];
+    }
+    if (journal_) {
+      journal_->push_back({pc, cause, 0});
+    }
+  }
+
+  /**
+   * @brief Appends every later update to `journal` until it is set back to null.
+   */
+  void SetJournal(std::vector<Change> *journal) { journal_ = journal; }
+  /**
+   * @brief Takes back the updates a journal recorded, newest first.
+   */
+  void Retract(const std::vector<Change> &changes);
+
+  uint64_t Issued() const { return issued_; }
+  uint64_t Lost(StallCause cause) const { return lost_[static_cast<size_t>(cause)]; }
+  // Stable addresses for the stats registry
+  const uint64_t *IssuedCounter() const { return &issued_; }
+  const uint64_t *LostCounter(StallCause cause) const { return &lost_[static_cast<size_t>(cause)]; }
+
+  /**
+   * @brief Writes the CPI stack and, per cause, the PCs that lost the most slots.
+   * @param width Issue slots per cycle.
+   * @param limit PCs listed per cause, 0 for all.
+   */
+  void WriteReport(std::ostream &out, const AssembledProgram &program, uint64_t instructions, uint64_t width,
+                   size_t limit = 5) const;
+
+ private:
+  uint64_t text_start_ = 0;
+  uint64_t issued_ = 0;
+  std::array<uint64_t, kStallCauseCount> lost_{};
+  std::vector<std::array<uint64_t, kStallCauseCount>> per_pc_;
+  std::vector<Change> *journal_ = nullptr;
+};
+
+#endif // CPI_STACK_H
@@ -0,0 +1,313 @@
+/**
+ * @file design_space.cpp
+ * @brief Contains the implementation of the design-space exploration runner.
+ */
+#include "design_space.h"
+
+#include "rvss_vm_dual_issue.h"
+#include "rvss_vm_ooo.h"
+#include "rvss_vm_pipelined.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+// Bounds the full grid; larger spaces have to be sampled
+constexpr uint64_t kMaxGridPoints = 100000;
+
+enum class VmKind { kPipelined, kDualIssue, kOutOfOrder };
+
+struct PointSetup {
+  vm_config::VmConfig config;
+  VmKind vm = VmKind::kPipelined;
+  bool hazard_detection = true;
+  bool forwarding = true;
+  bool branch_prediction = true;
+  bool dynamic_prediction = true;
+  bool fusion = false;
+};
+
+// VMs read vm_config::config while they are built and load a program; each point's
+// configuration is swapped in for just that long, one point at a time
+std::mutex config_mutex;
+
+std::string Trim(const std::string &text) {
+  size_t first = text.find_first_not_of(" \t\r");
+  if (first == std::string::npos) {
+    return "";
+  }
+  return text.substr(first, text.find_last_not_of(" \t\r") - first + 1);
+}
+
+bool ParseSwitch(const std::string &key, const std::string &value) {
+  if (value == "1" || value == "on" || value == "true") {
+    return true;
+  }
+  if (value == "0" || value == "off" || value == "false") {
+    return false;
+  }
+  throw std::invalid_argument(key + " must be 0 or 1, not " + value);
+}
+
+void ApplyRunSwitch(PointSetup &setup, const std::string &key, const std::string &value) {
+  if (key == "vm") {
+    if (value == "pipelined") {
+      setup.vm = VmKind::kPipelined;
+    } else if (value == "dual_issue") {
+      setup.vm = VmKind::kDualIssue;
+    } else if (value == "out_of_order") {
+      setup.vm = VmKind::kOutOfOrder;
+    } else {
+      throw std::invalid_argument("Unknown VM: " + value + " (pipelined, dual_issue or out_of_order)");
+    }
+  } else if (key == "hazard_detection") {
+    setup.hazard_detection = ParseSwitch(key, value);
+  } else if (key == "forwarding") {
+    setup.forwarding = ParseSwitch(key, value);
+  } else if (key == "branch_prediction") {
+    setup.branch_prediction = ParseSwitch(key, value);
+  } else if (key == "dynamic_prediction") {
+    setup.dynamic_prediction = ParseSwitch(key, value);
+  } else if (key == "fusion") {
+    setup.fusion = ParseSwitch(key, value);
+  } else {
+    throw std::invalid_argument("Unknown key: Run." + key);
+  }
+}
+
+PointSetup SetUp(const DesignSpace &space, const std::vector<size_t> &point, const vm_config::VmConfig &base) {
+  PointSetup setup;
+  setup.config = base;
+  for (size_t a = 0; a < space.axes.size(); ++a) {
+    const DesignAxis &axis = space.axes[a];
+    const std::string &value = axis.values[point[a]];
+    if (axis.section == "Run") {
+      ApplyRunSwitch(setup, axis.key, value);
+    } else {
+      setup.config.modifyConfig(axis.section, axis.key, value);
+    }
+  }
+  return setup;
+}
+
+std::unique_ptr<RVSSVM> Build(const PointSetup &setup, RegisterFile *registers, const AssembledProgram &program) {
+  std::lock_guard<std::mutex> lock(config_mutex);
+  vm_config::VmConfig previous = vm_config::config;
+  vm_config::config = setup.config;
+  try {
+    std::unique_ptr<RVSSVM> vm;
+    switch (setup.vm) {
+      case VmKind::kPipelined: vm = std::make_unique<RVSSVMPipelined>(registers); break;
+      case VmKind::kDualIssue: vm = std::make_unique<RVSSVMDualIssue>(registers); break;
+      case VmKind::kOutOfOrder: vm = std::make_unique<RVSSVMOutOfOrder>(registers); break;
+    }
+    vm->headless_ = true;
+    vm->SetPipelineConfig(setup.hazard_detection, setup.forwarding, setup.branch_prediction,
+                          setup.dynamic_prediction, setup.fusion);
+    vm->LoadProgram(program);
+    vm_config::config = previous;
+    return vm;
+  } catch (...) {
+    vm_config::config = previous;
+    throw;
+  }
+}
+
+DesignPointResult RunPoint(const PointSetup &setup, const AssembledProgram &program) {
+  DesignPointResult result;
+  try {
+    RegisterFile registers;
+    std::unique_ptr<RVSSVM> vm = Build(setup, &registers, program);
+    vm->Run();
+    result.instructions = vm->instructions_retired_;
+    result.cycles = vm->cycle_s_;
+    result.stall_cycles = vm->stall_cycles_;
+    result.branch_mispredictions = vm->branch_mispredictions_;
+  } catch (const std::exception &e) {
+    result.status = std::string("error: ") + e.what();
+  }
+  return result;
+}
+
+// Quoted when it holds a comma or a quote, with quotes doubled
+std::string CsvField(const std::string &text) {
+  if (text.find_first_of(",\"\n") == std::string::npos) {
+    return text;
+  }
+  std::string quoted = "\"";
+  for (char c : text) {
+    quoted += c;
+    if (c == '"') {
+      quoted += '"';
+    }
+  }
+  return quoted + "\"";
+}
+} // namespace
+
+DesignSpace DesignSpace::FromFile(const std::filesystem::path &filename) {
+  std::ifstream file(filename);
+  if (!file.is_open()) {
+    throw std::runtime_error("Unable to open file: " + filename.string());
+  }
+  DesignSpace space;
+  std::string section;
+  std::string line;
+  for (size_t number = 1; std::getline(file, line); ++number) {
+    line = Trim(line.substr(0, line.find_first_of(";#")));
+    if (line.empty()) {
+      continue;
+    }
+    if (line.front() == '[' && line.back() == ']') {
+      section = Trim(line.substr(1, line.size() - 2));
+      continue;
+    }
+    size_t equals = line.find('=');
+    if (equals == std::string::npos || section.empty()) {
+      throw std::invalid_argument(filename.string() + ":" + std::to_string(number) + ": expected key = values under a [section]");
+    }
+    std::string key = Trim(line.substr(0, equals));
+    std::string values = Trim(line.substr(equals + 1));
+
+    if (section == "Explore") {
+      if (key == "samples") {
+        space.samples = std::stoull(values);
+      } else if (key == "seed") {
+        space.seed = std::stoull(values);
+      } else {
+        throw std::invalid_argument("Unknown key: Explore." + key);
+      }
+      continue;
+    }
+
+    DesignAxis axis{section, key, {}};
+    std::istringstream list(values);
+    for (std::string value; std::getline(list, value, ',');) {
+      value = Trim(value);
+      if (!value.empty()) {
+        axis.values.push_back(value);
+      }
+    }
+    if (axis.values.empty()) {
+      throw std::invalid_argument(filename.string() + ":" + std::to_string(number) + ": " + axis.Name() + " has no values");
+    }
+    for (const DesignAxis &other : space.axes) {
+      if (other.section == axis.section && other.key == axis.key) {
+        throw std::invalid_argument(axis.Name() + " is swept twice");
+      }
+    }
+    space.axes.push_back(std::move(axis));
+  }
+  return space;
+}
+
+uint64_t DesignSpace::GridSize() const {
+  uint64_t size = 1;
+  for (const DesignAxis &axis : axes) {
+    if (size > std::numeric_limits<uint64_t>::max() / axis.values.size()) {
+      return std::numeric_limits<uint64_t>::max();
+    }
+    size *= axis.values.size();
+  }
+  return size;
+}
+
+std::vector<std::vector<size_t>> DesignSpace::Points() const {
+  std::vector<std::vector<size_t>> points;
+  const uint64_t grid = GridSize();
+  if (samples == 0 || samples >= grid) {
+    if (grid > kMaxGridPoints) {
+      throw std::invalid_argument("The grid has more than " + std::to_string(kMaxGridPoints)
+                                  + " points; set [Explore] samples to run a random subset");
+    }
+    for (uint64_t index = 0; index < grid; ++index) {
+      // Mixed radix, last axis fastest
+      std::vector<size_t> point(axes.size());
+      uint64_t rest = index;
+      for (size_t a = axes.size(); a-- > 0;) {
+        point[a] = rest % axes[a].values.size();
+        rest /= axes[a].values.size();
+      }
+      points.push_back(std::move(point));
+    }
+    return points;
+  }
+
+  // Distinct points drawn uniformly; samples < grid, so this ends
+  std::mt19937_64 random(seed);
+  std::set<std::vector<size_t>> drawn;
+  while (points.size() < samples) {
+    std::vector<size_t> point(axes.size());
+    for (size_t a = 0; a < axes.size(); ++a) {
+      point[a] = std::uniform_int_distribution<size_t>(0, axes[a].values.size() - 1)(random);
+    }
+    if (drawn.insert(point).second) {
+      points.push_back(std::move(point));
+    }
+  }
+  return points;
+}
+
+std::vector<DesignPointResult> RunDesignSpace(const DesignSpace &space, const AssembledProgram &program,
+                                              const vm_config::VmConfig &base, size_t threads) {
+  // `base` is usually vm_config::config itself, which Build swaps while other points set up
+  const vm_config::VmConfig start = base;
+  std::vector<std::vector<size_t>> points = space.Points();
+  for (const std::vector<size_t> &point : points) {
+    SetUp(space, point, start);
+  }
+
+  std::vector<DesignPointResult> results(points.size());
+  std::atomic<size_t> next{0};
+  auto worker = [&] {
+    for (size_t i = next.fetch_add(1); i < points.size(); i = next.fetch_add(1)) {
+      results[i] = RunPoint(SetUp(space, points[i], start), program);
+      results[i].point = points[i];
+    }
+  };
+
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  threads = std::min(threads, points.size());
+  std::vector<std::thread> pool;
+  for (size_t t = 1; t < threads; ++t) {
+    pool.emplace_back(worker);
+  }
+  worker();
+  for (std::thread &thread : pool) {
+    thread.join();
+  }
+  return results;
+}
+
+void WriteDesignSpaceCsv(std::ostream &out, const DesignSpace &space, const std::vector<DesignPointResult> &results) {
+  out << "point";
+  for (const DesignAxis &axis : space.axes) {
+    out << "," << axis.Name();
+  }
+  out << ",instructions,cycles,cpi,stall_cycles,branch_mispredictions,mpki,status\n";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const DesignPointResult &result = results[i];
+    out << i;
+    for (size_t a = 0; a < space.axes.size(); ++a) {
+      out << "," << space.axes[a].values[result.point[a]];
+    }
+    double mpki = result.instructions == 0 ? 0.0
+                                           : 1000.0*static_cast<double>(result.branch_mispredictions)
+                                                 / static_cast<double>(result.instructions);
+    out << "," << result.instructions << "," << result.cycles << "," << result.Cpi() << ","
+        << result.stall_cycles << "," << result.branch_mispredictions << "," << mpki << ","
+        << CsvField(result.status) << "\n";
+  }
+}
@@ -0,0 +1,88 @@
+/**
+ * @file design_space.h
+ * @brief Contains the design-space exploration runner for the pipelined VMs.
+ */
+#ifndef DESIGN_SPACE_H
+#define DESIGN_SPACE_H
+
+#include "../config.h"
+#include "../vm_asm_mw.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief One swept parameter: a vm_config key, or one of the [Run] switches, and its values.
+ */
+struct DesignAxis {
+  std::string section;
+  std::string key;
+  std::vector<std::string> values;
+
+  std::string Name() const { return section + "." + key; }
+};
+
+/**
+ * @brief The parameters to sweep and which of their combinations to run.
+ *
+ * Read from an ini-style file whose keys take comma-separated value lists:
+ *
+ *     [Run]                ; vm = pipelined|dual_issue|out_of_order, and the SetPipelineConfig switches
+ *     vm = pipelined, dual_issue
+ *     forwarding = 0, 1
+ *     [BranchPrediction]   ; any vm_config section and key
+ *     branch_prediction_type = bimodal, gshare, tage
+ *     [Explore]
+ *     samples = 20         ; 0 (default) runs the full grid
+ *     seed = 1
+ *
+ * Every other setting comes from the configuration in effect when the sweep starts.
+ */
+struct DesignSpace {
+  std::vector<DesignAxis> axes;
+  uint64_t samples = 0;
+  uint64_t seed = 1;
+
+  static DesignSpace FromFile(const std::filesystem::path &filename);
+
+  // Number of grid points, saturating at UINT64_MAX
+  uint64_t GridSize() const;
+  // The value index of every axis for each point to run, in grid order or in draw order
+  std::vector<std::vector<size_t>> Points() const;
+};
+
+/**
+ * @brief Measurements of one design point; `status` is "ok" or why the point has no numbers.
+ */
+struct DesignPointResult {
+  std::vector<size_t> point;
+  std::string status = "ok";
+  uint64_t instructions = 0;
+  uint64_t cycles = 0;
+  uint64_t stall_cycles = 0;
+  uint64_t branch_mispredictions = 0;
+
+  double Cpi() const {
+    return instructions == 0 ? 0.0 : static_cast<double>(cycles)/static_cast<double>(instructions);
+  }
+};
+
+/**
+ * @brief Runs `program` to the end at every point of `space` on up to `threads` threads (0: one per core).
+ *
+ * Each point gets its own VM, register file and copy of the program image, configured from
+ * `base` with the point's values applied. The values of every point are checked before
+ * anything runs, so a bad sweep file fails without running a point. Programs that read
+ * stdin can't be swept.
+ */
+std::vector<DesignPointResult> RunDesignSpace(const DesignSpace &space, const AssembledProgram &program,
+                                              const vm_config::VmConfig &base, size_t threads);
+
+// One row per point: the axis values, then instructions, cycles, CPI, stalls and mispredictions
+void WriteDesignSpaceCsv(std::ostream &out, const DesignSpace &space, const std::vector<DesignPointResult> &results);
+
+#endif // DESIGN_SPACE_H
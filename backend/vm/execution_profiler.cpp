@@ -0,0 +1,132 @@
+/**
+ * @file execution_profiler.cpp
+ * @brief Contains the implementation of the per-PC execution profiler.
+ */
+#include "execution_profiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+unsigned int LineFor(const AssembledProgram &program, uint64_t instruction_number) {
+  auto it = program.instruction_number_line_number_mapping.find(static_cast<unsigned int>(instruction_number));
+  return it == program.instruction_number_line_number_mapping.end() ? 0 : it->second;
+}
+} // namespace
+
+void ExecutionProfiler::Resize(uint64_t text_start, uint64_t text_size) {
+  text_start_ = text_start;
+  executions_.assign(text_size / 4, 0);
+  cycles_.assign(text_size / 4, 0);
+}
+
+void ExecutionProfiler::Clear() {
+  std::fill(executions_.begin(), executions_.end(), 0);
+  std::fill(cycles_.begin(), cycles_.end(), 0);
+}
+
+uint64_t ExecutionProfiler::TotalExecutions() const {
+  return std::accumulate(executions_.begin(), executions_.end(), uint64_t{0});
+}
+
+uint64_t ExecutionProfiler::TotalCycles() const {
+  return std::accumulate(cycles_.begin(), cycles_.end(), uint64_t{0});
+}
+
+std::vector<ExecutionProfiler::HotSpot> ExecutionProfiler::HotSpots(const AssembledProgram &program,
+                                                                    size_t limit) const {
+  std::vector<HotSpot> hot_spots;
+  for (size_t slot = 0; slot < executions_.size(); ++slot) {
+    if (executions_[slot] == 0 && cycles_[slot] == 0) {
+      continue;
+    }
+    uint64_t pc = text_start_ + slot*4;
+    hot_spots.push_back({pc, LineFor(program, slot), executions_[slot], cycles_[slot]});
+  }
+  std::sort(hot_spots.begin(), hot_spots.end(), [](const HotSpot &a, const HotSpot &b) {
+    if (a.cycles != b.cycles) {
+      return a.cycles > b.cycles;
+    }
+    if (a.executions != b.executions) {
+      return a.executions > b.executions;
+    }
+    return a.pc < b.pc;
+  });
+  if (limit != 0 && hot_spots.size() > limit) {
+    hot_spots.resize(limit);
+  }
+  return hot_spots;
+}
+
+void ExecutionProfiler::WriteReport(std::ostream &out, const AssembledProgram &program, size_t limit) const {
+  std::vector<HotSpot> hot_spots = HotSpots(program);
+  uint64_t total_cycles = TotalCycles();
+  uint64_t total_executions = TotalExecutions();
+
+  auto percent = [total_cycles](uint64_t cycles) {
+    return total_cycles == 0 ? 0.0 : 100.0*static_cast<double>(cycles)/static_cast<double>(total_cycles);
+  };
+
+  out << "Profile: " << total_executions << " instructions, " << total_cycles << " cycles\n\n";
+  out << "Hot instructions:\n";
+  out << std::left << std::setw(12) << "PC" << std::setw(8) << "Line"
+      << std::right << std::setw(14) << "Executions" << std::setw(14) << "Cycles"
+      << std::setw(9) << "%Cycles" << std::setw(8) << "CPI" << "\n";
+  size_t shown = 0;
+  for (const auto &hot_spot : hot_spots) {
+    if (limit != 0 && shown++ == limit) {
+      break;
+    }
+    std::ostringstream pc;
+    pc << "0x" << std::hex << std::setw(8) << std::setfill('0') << hot_spot.pc;
+    double cpi = hot_spot.executions == 0 ? 0.0
+                                          : static_cast<double>(hot_spot.cycles)/static_cast<double>(hot_spot.executions);
+    out << std::left << std::setw(12) << pc.str() << std::setw(8) << hot_spot.line
+        << std::right << std::setw(14) << hot_spot.executions << std::setw(14) << hot_spot.cycles
+        << std::setw(8) << std::fixed << std::setprecision(2) << percent(hot_spot.cycles) << "%"
+        << std::setw(8) << cpi << "\n";
+  }
+
+  // Pseudo-instructions expand to several instructions on the same line
+  std::map<unsigned int, std::pair<uint64_t, uint64_t>> per_line;
+  for (const auto &hot_spot : hot_spots) {
+    auto &totals = per_line[hot_spot.line];
+    totals.first += hot_spot.executions;
+    totals.second += hot_spot.cycles;
+  }
+  std::vector<std::pair<unsigned int, std::pair<uint64_t, uint64_t>>> lines(per_line.begin(), per_line.end());
+  std::sort(lines.begin(), lines.end(), [](const auto &a, const auto &b) {
+    return a.second.second != b.second.second ? a.second.second > b.second.second : a.first < b.first;
+  });
+
+  out << "\nHot source lines:\n";
+  out << std::left << std::setw(8) << "Line"
+      << std::right << std::setw(14) << "Executions" << std::setw(14) << "Cycles" << std::setw(9) << "%Cycles" << "\n";
+  shown = 0;
+  for (const auto &[line, totals] : lines) {
+    if (limit != 0 && shown++ == limit) {
+      break;
+    }
+    out << std::left << std::setw(8) << line
+        << std::right << std::setw(14) << totals.first << std::setw(14) << totals.second
+        << std::setw(8) << std::fixed << std::setprecision(2) << percent(totals.second) << "%\n";
+  }
+  out << std::defaultfloat;
+}
+
+void ExecutionProfiler::WriteCsv(const std::filesystem::path &filename, const AssembledProgram &program) const {
+  std::ofstream file(filename);
+  if (!file.is_open()) {
+    throw std::runtime_error("Unable to open file: " + filename.string());
+  }
+  file << "pc,line,executions,cycles\n";
+  for (const auto &hot_spot : HotSpots(program)) {
+    file << "0x" << std::hex << hot_spot.pc << std::dec << ","
+         << hot_spot.line << "," << hot_spot.executions << "," << hot_spot.cycles << "\n";
+  }
+}
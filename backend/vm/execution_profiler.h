@@ -0,0 +1,85 @@
+/**
+ * @file execution_profiler.h
+ * @brief Contains the per-PC execution profiler.
+ */
+#ifndef EXECUTION_PROFILER_H
+#define EXECUTION_PROFILER_H
+
+#include "../vm_asm_mw.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <vector>
+
+/**
+ * @brief Counts executions and cycles for every instruction of the text section.
+ *
+ * Counters live in flat arrays indexed by (pc - text_start) / 4, so recording
+ * is an index computation, a bounds check and two increments.
+ */
+class ExecutionProfiler {
+ public:
+  struct HotSpot {
+    uint64_t pc;
+    unsigned int line;
+    uint64_t executions;
+    uint64_t cycles;
+  };
+
+  ExecutionProfiler() = default;
+
+  /**
+   * @brief Sizes the counter arrays for a text section and zeroes them.
+   */
+  void Resize(uint64_t text_start, uint64_t text_size);
+
+  /**
+   * @brief Zeroes all counters, keeping the current text section.
+   */
+  void Clear();
+
+  void SetEnabled(bool enabled) { enabled_ = enabled; }
+  bool IsEnabled() const { return enabled_; }
+
+  void RecordExecution(uint64_t pc) {
+    uint64_t slot = (pc - text_start_) >> 2;
+    if (slot < executions_.size()) {
+      ++executions_[slot];
+    }
+  }
+
+  void RecordCycles(uint64_t pc, uint64_t cycles) {
+    uint64_t slot = (pc - text_start_) >> 2;
+    if (slot < cycles_.size()) {
+      cycles_[slot] += cycles;
+    }
+  }
+
+  uint64_t TotalExecutions() const;
+  uint64_t TotalCycles() const;
+
+  /**
+   * @brief Returns executed instructions sorted by cycles, then executions, descending.
+   * @param limit Maximum number of entries, 0 for all.
+   */
+  std::vector<HotSpot> HotSpots(const AssembledProgram &program, size_t limit = 0) const;
+
+  /**
+   * @brief Writes a human-readable hot spot table, including per-source-line totals.
+   */
+  void WriteReport(std::ostream &out, const AssembledProgram &program, size_t limit = 20) const;
+
+  /**
+   * @brief Writes one CSV row per executed instruction, hottest first.
+   */
+  void WriteCsv(const std::filesystem::path &filename, const AssembledProgram &program) const;
+
+ private:
+  bool enabled_ = false;
+  uint64_t text_start_ = 0;
+  std::vector<uint64_t> executions_;
+  std::vector<uint64_t> cycles_;
+};
+
+#endif // EXECUTION_PROFILER_H
@@ -0,0 +1,103 @@
+/**
+ * @file fetch_frontend.h
+ * @brief Contains the queues of the pipelined VM's decoupled fetch frontend.
+ */
+#ifndef FETCH_FRONTEND_H
+#define FETCH_FRONTEND_H
+
+#include "branch_predictor.h"
+#include "cpi_stack.h"
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Fixed-capacity FIFO kept inline, so the frontend stays trivially copyable for the
+ * undo log and snapshots. Callers check Size() against their configured limit before Push.
+ */
+template <typename T, size_t N>
+class FixedRing {
+ public:
+  static constexpr size_t kCapacity = N;
+
+  size_t Size() const { return size_; }
+  bool Empty() const { return size_ == 0; }
+  const T &Front() const { return slots_[head_]; }
+  const T &At(size_t i) const { return slots_[(head_ + i) % N]; }
+
+  void Push(const T &value) {
+    slots_[(head_ + size_) % N] = value;
+    ++size_;
+  }
+  void Pop() {
+    head_ = static_cast<uint32_t>((head_ + 1) % N);
+    --size_;
+  }
+  void Clear() {
+    head_ = 0;
+    size_ = 0;
+  }
+
+ private:
+  T slots_[N]{};
+  uint32_t head_ = 0;
+  uint32_t size_ = 0;
+};
+
+/**
+ * @brief One prediction of the branch prediction unit: a run of sequential instructions
+ * ending at a fetch block boundary, a predicted-taken transfer or a return stack push/pop.
+ *
+ * Since only the last instruction can touch the return stack, the stack from before the
+ * block is the right repair point for every instruction in it.
+ */
+struct FetchTarget {
+  uint64_t start_pc = 0;
+  uint64_t next_pc = 0;  // predicted successor of the last instruction
+  uint32_t count = 0;
+  bool taken = false;    // the last instruction is a predicted-taken transfer
+  ReturnAddressStack::Checkpoint ras_checkpoint;
+};
+
+/**
+ * @brief An instruction fetched into the instruction buffer, waiting for decode.
+ */
+struct BufferedInstruction {
+  uint64_t pc = 0;
+  uint64_t predicted_pc = 0;
+  uint32_t instruction = 0;
+  bool predicted_taken = false;
+  ReturnAddressStack::Checkpoint ras_checkpoint;
+};
+
+constexpr size_t kMaxFetchTargetQueue = 16;
+constexpr size_t kMaxInstructionBuffer = 32;
+
+/**
+ * @brief State of the decoupled frontend: the predictor writes fetch targets at
+ * `predict_pc`, fetch turns the oldest target into buffered instructions, and IF hands
+ * those to decode in order.
+ */
+struct DecoupledFrontend {
+  FixedRing<FetchTarget, kMaxFetchTargetQueue> ftq;
+  FixedRing<BufferedInstruction, kMaxInstructionBuffer> buffer;
+  uint64_t predict_pc = 0;
+  // Charged for the bubbles IF sends while the buffer refills
+  StallCause empty_cause = StallCause::kFillDrain;
+  uint64_t empty_pc = CpiStack::kNoPc;
+
+  // The PC IF hands to decode next if nothing redirects it
+  uint64_t NextPc() const {
+    return !buffer.Empty() ? buffer.Front().pc : !ftq.Empty() ? ftq.Front().start_pc : predict_pc;
+  }
+  // Return stack from before the oldest instruction not yet handed to decode
+  bool OldestCheckpoint(ReturnAddressStack::Checkpoint &checkpoint) const {
+    if (buffer.Empty() && ftq.Empty()) {
+      return false;
+    }
+    checkpoint = !buffer.Empty() ? buffer.Front().ras_checkpoint : ftq.Front().ras_checkpoint;
+    return true;
+  }
+};
+
+#endif // FETCH_FRONTEND_H
@@ -138,3 +138,14 @@ ForwardingUnit::ForwardingSource ForwardingUnit::GetRs2Source(
     return ForwardingSource::FROM_REG_FILE;
 }
 
+uint64_t ForwardingUnit::ResultReadyCycle(uint64_t ex_cycle, uint64_t latency, bool mem_read,
+                                          bool forwarding_enabled, uint64_t execute_stages,
+                                          uint64_t memory_stages) const
+{
+    uint64_t cycle = ex_cycle + latency + (execute_stages - 1);
+    if (mem_read)
+        cycle += memory_stages; // forwarded from the end of MEM
+    if (!forwarding_enabled)
+        cycle = ex_cycle + latency + (execute_stages - 1) + memory_stages + 1; // through MEM and WB, then read in ID
+    return cycle;
+}
@@ -59,6 +59,14 @@ public:
         bool ex_is_float = false,
         bool mem_is_float = false
         ) const;
+
+    // First cycle a dependent instruction can be in EX when the producer entered EX at ex_cycle
+    // and spends `latency` cycles in its functional unit. Results leave after the last of
+    // `execute_stages` EX stages, and loads after the last of `memory_stages` MEM stages; without
+    // forwarding the value is only read from the register file once the producer has written back.
+    uint64_t ResultReadyCycle(uint64_t ex_cycle, uint64_t latency, bool mem_read,
+                              bool forwarding_enabled, uint64_t execute_stages = 1,
+                              uint64_t memory_stages = 1) const;
 };
 
 #endif // FORWARDING_UNIT_H
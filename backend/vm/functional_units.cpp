@@ -0,0 +1,172 @@
+/**
+ * @file functional_units.cpp
+ * @brief Contains the operation-to-unit mapping and the scoreboard bookkeeping.
+ */
+#include "functional_units.h"
+
+#include <algorithm>
+
+const char *FunctionalUnitName(FunctionalUnit unit) {
+  switch (unit) {
+    case FunctionalUnit::kIntAlu: return "int_alu";
+    case FunctionalUnit::kIntMul: return "int_mul";
+    case FunctionalUnit::kIntDiv: return "int_div";
+    case FunctionalUnit::kFpAdd: return "fp_add";
+    case FunctionalUnit::kFpMul: return "fp_mul";
+    case FunctionalUnit::kFpFma: return "fp_fma";
+    case FunctionalUnit::kFpDiv: return "fp_div";
+    case FunctionalUnit::kFpSqrt: return "fp_sqrt";
+    case FunctionalUnit::kFpMisc: return "fp_misc";
+    case FunctionalUnit::kCount: break;
+  }
+  return "?";
+}
+
+FunctionalUnit FunctionalUnitFor(alu::AluOp op) {
+  using alu::AluOp;
+  switch (op) {
+    case AluOp::kMul:
+    case AluOp::kMulh:
+    case AluOp::kMulhsu:
+    case AluOp::kMulhu:
+    case AluOp::kMulw:
+      return FunctionalUnit::kIntMul;
+    case AluOp::kDiv:
+    case AluOp::kDivw:
+    case AluOp::kDivu:
+    case AluOp::kDivuw:
+    case AluOp::kRem:
+    case AluOp::kRemw:
+    case AluOp::kRemu:
+    case AluOp::kRemuw:
+      return FunctionalUnit::kIntDiv;
+    case AluOp::FADD_S:
+    case AluOp::FSUB_S:
+    case AluOp::FADD_D:
+    case AluOp::FSUB_D:
+      return FunctionalUnit::kFpAdd;
+    case AluOp::FMUL_S:
+    case AluOp::FMUL_D:
+      return FunctionalUnit::kFpMul;
+    case AluOp::kFmadd_s:
+    case AluOp::kFmsub_s:
+    case AluOp::kFnmadd_s:
+    case AluOp::kFnmsub_s:
+    case AluOp::FMADD_D:
+    case AluOp::FMSUB_D:
+    case AluOp::FNMADD_D:
+    case AluOp::FNMSUB_D:
+      return FunctionalUnit::kFpFma;
+    case AluOp::FDIV_S:
+    case AluOp::FDIV_D:
+      return FunctionalUnit::kFpDiv;
+    case AluOp::FSQRT_S:
+    case AluOp::FSQRT_D:
+      return FunctionalUnit::kFpSqrt;
+    default:
+      break;
+  }
+  // The remaining floating-point ops are declared after the R4 group
+  return static_cast<int>(op) >= static_cast<int>(AluOp::kFmadd_s) ? FunctionalUnit::kFpMisc
+                                                                     : FunctionalUnit::kIntAlu;
+}
+
+RegisterUsage DecodeRegisterUsage(uint32_t instruction) {
+  RegisterUsage usage;
+  uint32_t opcode = instruction & 0x7F;
+  uint32_t funct3 = (instruction >> 12) & 0x7;
+  uint32_t funct7 = (instruction >> 25) & 0x7F;
+  switch (opcode) {
+    case 0b0100111: // FP store
+      usage.rs2_is_float = true;
+      [[fallthrough]];
+    case 0b0110011: // OP
+    case 0b0111011: // OP-32
+    case 0b0100011: // store
+    case 0b1100011: // branch
+    case 0b0101111: // AMO
+      usage.reads_rs1 = usage.reads_rs2 = true;
+      break;
+    case 0b1100111: // jalr
+    case 0b0000011: // load
+    case 0b0010011: // OP-IMM
+    case 0b0011011: // OP-IMM-32
+      usage.reads_rs1 = true;
+      break;
+    case 0b0000111: // FP load
+      usage.reads_rs1 = true;
+      usage.rd_is_float = true;
+      break;
+    case 0b1110011: // SYSTEM: only csrrw/csrrs/csrrc read rs1
+      usage.reads_rs1 = funct3 >= 1 && funct3 <= 3;
+      break;
+    case 0b1000011: // fmadd
+    case 0b1000111: // fmsub
+    case 0b1001011: // fnmsub
+    case 0b1001111: // fnmadd
+      usage.reads_rs1 = usage.reads_rs2 = usage.reads_rs3 = true;
+      usage.rs1_is_float = usage.rs2_is_float = usage.rd_is_float = true;
+      break;
+    case 0b1010011: // OP-FP
+      usage.reads_rs1 = true;
+      usage.rs1_is_float = funct7 != 0b1101000 && funct7 != 0b1101001 &&  // fcvt from integer
+                           funct7 != 0b1111000 && funct7 != 0b1111001;    // fmv to FPR
+      usage.rs2_is_float = true;
+      switch (funct7) {
+        case 0b0101100: case 0b0101101: // fsqrt
+        case 0b0100000: case 0b0100001: // fcvt.s.d / fcvt.d.s
+        case 0b1100000: case 0b1100001: // fcvt to integer
+        case 0b1101000: case 0b1101001: // fcvt from integer
+        case 0b1110000: case 0b1110001: // fmv.x / fclass
+        case 0b1111000: case 0b1111001: // fmv to FPR
+          break;
+        default:
+          usage.reads_rs2 = true;
+          break;
+      }
+      switch (funct7) {
+        case 0b1100000: case 0b1100001:
+        case 0b1110000: case 0b1110001:
+        case 0b1010000: case 0b1010001: // compares
+          break;
+        default:
+          usage.rd_is_float = true;
+          break;
+      }
+      break;
+    default: // lui, auipc, jal, fence
+      break;
+  }
+  return usage;
+}
+
+uint64_t Scoreboard::UnitFreeCycle(FunctionalUnit unit, size_t copies) const {
+  const uint64_t *free = unit_free_cycle[static_cast<size_t>(unit)];
+  return *std::min_element(free, free + std::clamp<size_t>(copies, 1, kMaxUnitCopies));
+}
+
+uint64_t Scoreboard::UnitOwner(FunctionalUnit unit, size_t copies) const {
+  const uint64_t *free = unit_free_cycle[static_cast<size_t>(unit)];
+  size_t copy = std::min_element(free, free + std::clamp<size_t>(copies, 1, kMaxUnitCopies)) - free;
+  return unit_pc[static_cast<size_t>(unit)][copy];
+}
+
+void Scoreboard::Issue(FunctionalUnit unit, const FunctionalUnitTiming &timing, uint64_t ex_cycle, bool reg_write,
+                       uint8_t rd, bool rd_is_float, uint64_t result_cycle, uint64_t pc, bool is_load) {
+  uint64_t *free = unit_free_cycle[static_cast<size_t>(unit)];
+  size_t copy = std::min_element(free, free + std::clamp<size_t>(timing.count, 1, kMaxUnitCopies)) - free;
+  free[copy] = ex_cycle + timing.interval;
+  unit_pc[static_cast<size_t>(unit)][copy] = pc;
+  if (reg_write) {
+    Book(rd, rd_is_float, result_cycle, pc, is_load);
+  }
+}
+
+void Scoreboard::Book(uint8_t rd, bool rd_is_float, uint64_t result_cycle, uint64_t pc, bool is_load) {
+  if (rd == 0 && !rd_is_float) {
+    return;
+  }
+  ready_cycle[rd_is_float][rd & 0x1F] = result_cycle;
+  producer_pc[rd_is_float][rd & 0x1F] = pc;
+  producer_is_load[rd_is_float][rd & 0x1F] = is_load;
+}
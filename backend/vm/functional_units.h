@@ -0,0 +1,95 @@
+/**
+ * @file functional_units.h
+ * @brief Contains the functional-unit classes, their timing and the register scoreboard of the pipelined VM.
+ */
+#ifndef FUNCTIONAL_UNITS_H
+#define FUNCTIONAL_UNITS_H
+
+#include "alu.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Execution resources an operation can occupy in EX.
+ *
+ * Names match the `<unit>_latency` / `<unit>_interval` / `<unit>_count` keys
+ * of the [FunctionalUnits] config section.
+ */
+enum class FunctionalUnit : uint8_t {
+  kIntAlu,  // integer ALU, address generation, branches
+  kIntMul,
+  kIntDiv,  // div/rem
+  kFpAdd,   // fadd/fsub
+  kFpMul,
+  kFpFma,   // fmadd/fmsub/fnmadd/fnmsub
+  kFpDiv,
+  kFpSqrt,
+  kFpMisc,  // sign injection, min/max, compares, classify, conversions, moves
+  kCount
+};
+
+constexpr size_t kFunctionalUnitCount = static_cast<size_t>(FunctionalUnit::kCount);
+constexpr size_t kMaxUnitCopies = 4;  // matches vm_config::kMaxFunctionalUnitCount
+
+const char *FunctionalUnitName(FunctionalUnit unit);
+FunctionalUnit FunctionalUnitFor(alu::AluOp op);
+
+struct FunctionalUnitTiming {
+  uint64_t latency = 1;   // cycles from entering EX until the result can be forwarded
+  uint64_t interval = 1;  // cycles before the unit accepts the next operation (latency = unpipelined)
+  size_t count = 1;       // identical copies; each takes one operation per interval
+};
+
+using FunctionalUnitTimings = std::array<FunctionalUnitTiming, kFunctionalUnitCount>;
+
+/**
+ * @brief Register operands an instruction actually uses, from its encoding.
+ *
+ * ID's rs1/rs2 fields are extracted for every format; this tells which of
+ * them (and rs3 of the fused multiply-adds) are real sources, so immediates
+ * don't create false dependences on long-latency results.
+ */
+struct RegisterUsage {
+  bool reads_rs1 = false;
+  bool reads_rs2 = false;
+  bool reads_rs3 = false;
+  bool rs1_is_float = false;
+  bool rs2_is_float = false;  // rs3 is always an FPR
+  bool rd_is_float = false;
+};
+
+RegisterUsage DecodeRegisterUsage(uint32_t instruction);
+
+/**
+ * @brief Per-register result times and per-unit busy times, in cycles.
+ *
+ * Trivially copyable so the pipeline undo log and snapshots can store it
+ * like a latch.
+ */
+struct Scoreboard {
+  // First cycle a dependent instruction can be in EX, per register file (0 = GPR, 1 = FPR)
+  uint64_t ready_cycle[2][32] = {};
+  // First cycle each copy of each unit accepts another operation
+  uint64_t unit_free_cycle[kFunctionalUnitCount][kMaxUnitCopies] = {};
+  // PC of the last instruction to book each register and unit copy, so stalls can be charged to it
+  uint64_t producer_pc[2][32] = {};
+  bool producer_is_load[2][32] = {};
+  uint64_t unit_pc[kFunctionalUnitCount][kMaxUnitCopies] = {};
+
+  uint64_t ReadyCycle(uint8_t reg, bool is_float) const { return ready_cycle[is_float][reg & 0x1F]; }
+  // First cycle any of the first `copies` copies of `unit` is free
+  uint64_t UnitFreeCycle(FunctionalUnit unit, size_t copies) const;
+  // PC of the operation holding the copy of `unit` that frees first
+  uint64_t UnitOwner(FunctionalUnit unit, size_t copies) const;
+  // Books the earliest free copy of `unit` for an operation entering EX at `ex_cycle`; the result is
+  // usable from `result_cycle`
+  void Issue(FunctionalUnit unit, const FunctionalUnitTiming &timing, uint64_t ex_cycle, bool reg_write,
+             uint8_t rd, bool rd_is_float, uint64_t result_cycle, uint64_t pc = 0, bool is_load = false);
+  // Marks `rd` as written at `result_cycle` without booking a unit (a fused pair's second destination)
+  void Book(uint8_t rd, bool rd_is_float, uint64_t result_cycle, uint64_t pc = 0, bool is_load = false);
+  void Clear() { *this = Scoreboard(); }
+};
+
+#endif // FUNCTIONAL_UNITS_H
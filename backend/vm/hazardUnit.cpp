@@ -88,6 +88,32 @@ bool HazardDetectionUnit::DetectMEMHazard(uint8_t mem_rd, bool mem_reg_write, ui
     return (mem_rd == id_rs1) || (mem_rd == id_rs2);
 }
 
+HazardDetectionUnit::ScoreboardHazard HazardDetectionUnit::DetectScoreboardHazard(
+    const Scoreboard &scoreboard, uint64_t ex_cycle, const RegisterUsage &usage,
+    uint8_t rs1, bool rs1_is_float, uint8_t rs2, bool rs2_is_float, uint8_t rs3,
+    bool reg_write, uint8_t rd, FunctionalUnit unit, size_t unit_copies, uint64_t result_cycle) const
+{
+    // GPR x0 never waits; f0 is a normal register
+    auto pending = [&](uint8_t reg, bool is_float) {
+        return (reg != 0 || is_float) && scoreboard.ReadyCycle(reg, is_float) > ex_cycle;
+    };
+
+    if ((usage.reads_rs1 && pending(rs1, rs1_is_float)) ||
+        (usage.reads_rs2 && pending(rs2, rs2_is_float)) ||
+        (usage.reads_rs3 && pending(rs3, true)))
+        return ScoreboardHazard::RAW;
+
+    if (scoreboard.UnitFreeCycle(unit, unit_copies) > ex_cycle)
+        return ScoreboardHazard::STRUCTURAL;
+
+    // Results are written in order, so a shorter operation waits behind a longer one to the same rd
+    if (reg_write && (rd != 0 || usage.rd_is_float) &&
+        scoreboard.ReadyCycle(rd, usage.rd_is_float) > result_cycle)
+        return ScoreboardHazard::WAW;
+
+    return ScoreboardHazard::NONE;
+}
+
 
 // bool HazardDetectionUnit::DetectEXHazard(uint8_t ex_rd, bool ex_reg_write, uint8_t id_rs1, uint8_t id_rs2) const
 // {
@@ -1,6 +1,8 @@
 #ifndef HAZARD_UNIT_H
 #define HAZARD_UNIT_H
 
+#include "functional_units.h"
+
 #include <cstdint>
 
 class HazardDetectionUnit
@@ -23,6 +25,24 @@ public:
     // Detect MEM hazard: MEM stage result needed by ID stage
     bool DetectMEMHazard(uint8_t mem_rd, bool mem_reg_write,
                          uint8_t id_rs1, uint8_t id_rs2) const;
+
+    enum class ScoreboardHazard
+    {
+        NONE,
+        RAW,        // a source is still being produced by a multi-cycle unit
+        WAW,        // an older, slower write to rd would land after this one
+        STRUCTURAL  // every copy of the functional unit is still in its initiation interval
+    };
+
+    // Checks the ID-stage instruction against the scoreboard, assuming it enters EX
+    // at ex_cycle and its result is usable from result_cycle
+    ScoreboardHazard DetectScoreboardHazard(const Scoreboard &scoreboard, uint64_t ex_cycle,
+                                            const RegisterUsage &usage,
+                                            uint8_t rs1, bool rs1_is_float,
+                                            uint8_t rs2, bool rs2_is_float, uint8_t rs3,
+                                            bool reg_write, uint8_t rd,
+                                            FunctionalUnit unit, size_t unit_copies,
+                                            uint64_t result_cycle) const;
 };
 
 #endif // HAZARD_UNIT_H
@@ -0,0 +1,205 @@
+/**
+ * @file instruction_mix.cpp
+ * @brief Contains the lookup tables and reporting for the instruction-mix counters.
+ */
+#include "instruction_mix.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <numeric>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using instruction_set::Instruction;
+
+static_assert(InstructionMix::kInstructionCount < 0xFF, "Instruction index must fit below the rs2 marker");
+
+namespace {
+struct DecodeTables {
+  std::array<uint8_t, (1u << 17)> table;
+  std::unordered_map<uint32_t, uint8_t> by_rs2;  // key | rs2 << 17
+};
+
+std::vector<int> Candidates(int value, int limit) {
+  std::vector<int> values;
+  if (value >= 0) {
+    values.push_back(value);
+  } else {
+    for (int i = 0; i < limit; ++i) {
+      values.push_back(i);
+    }
+  }
+  return values;
+}
+
+const DecodeTables &Tables() {
+  static const DecodeTables tables = [] {
+    DecodeTables built;
+    built.table.fill(static_cast<uint8_t>(Instruction::INVALID));
+
+    // Wildcard entries first so that fully specified encodings take precedence
+    for (int pass = 0; pass < 2; ++pass) {
+      for (const auto &[instruction, encoding] : instruction_set::instruction_encoding_map) {
+        // ebreak differs from ecall only in imm[0], which is not part of the key
+        if (instruction == Instruction::kebreak) {
+          continue;
+        }
+        int funct7 = encoding.funct7;
+        if (encoding.funct2 >= 0 || instruction == Instruction::kecall) {
+          funct7 = -1;
+        }
+        bool specific = funct7 >= 0 && encoding.funct3 >= 0;
+        if (specific != (pass == 1)) {
+          continue;
+        }
+
+        std::vector<int> funct7_values = Candidates(funct7, 128);
+        if (encoding.funct2 >= 0) {
+          // R4-type: funct2 sits in the low bits of the funct7 field, rs3 above it
+          funct7_values.clear();
+          for (int value = encoding.funct2; value < 128; value += 4) {
+            funct7_values.push_back(value);
+          }
+        }
+        if (instruction == Instruction::kslli || instruction == Instruction::ksrli
+            || instruction == Instruction::ksrai) {
+          funct7_values.push_back(funct7 | 1);  // shamt[5] on RV64
+        }
+
+        uint8_t index = static_cast<uint8_t>(instruction);
+        for (int funct3 : Candidates(encoding.funct3, 8)) {
+          for (int f7 : funct7_values) {
+            size_t key = static_cast<size_t>(encoding.opcode) | (static_cast<size_t>(funct3) << 7)
+                       | (static_cast<size_t>(f7) << 10);
+            if (encoding.funct5 >= 0) {
+              built.table[key] = 0xFF;
+              built.by_rs2[static_cast<uint32_t>(key | (static_cast<size_t>(encoding.funct5) << 17))] = index;
+            } else {
+              built.table[key] = index;
+            }
+          }
+        }
+      }
+    }
+    return built;
+  }();
+  return tables;
+}
+} // namespace
+
+const char *InstructionClassName(InstructionClass instruction_class) {
+  switch (instruction_class) {
+    case InstructionClass::kAlu: return "alu";
+    case InstructionClass::kLoad: return "load";
+    case InstructionClass::kStore: return "store";
+    case InstructionClass::kBranchTaken: return "branch_taken";
+    case InstructionClass::kBranchNotTaken: return "branch_not_taken";
+    case InstructionClass::kJump: return "jump";
+    case InstructionClass::kFpSingle: return "fp_single";
+    case InstructionClass::kFpDouble: return "fp_double";
+    case InstructionClass::kCsr: return "csr";
+    case InstructionClass::kSyscall: return "syscall";
+    case InstructionClass::kOther: return "other";
+    default: return "unknown";
+  }
+}
+
+InstructionMix::InstructionMix() : decode_table_(Tables().table) {
+  auto set = [this](uint32_t opcode, InstructionClass base, uint8_t shift = 0, uint8_t mask = 0) {
+    opcode_info_[opcode] = {static_cast<uint8_t>(base), shift, mask};
+  };
+  for (uint32_t opcode : {0b0110011u, 0b0111011u, 0b0010011u, 0b0011011u, 0b0110111u, 0b0010111u}) {
+    set(opcode, InstructionClass::kAlu);
+  }
+  set(0b0000011, InstructionClass::kLoad);
+  set(0b0000111, InstructionClass::kLoad);
+  set(0b0100011, InstructionClass::kStore);
+  set(0b0100111, InstructionClass::kStore);
+  set(0b1100011, InstructionClass::kBranchTaken, 1, 1);
+  set(0b1101111, InstructionClass::kJump);
+  set(0b1100111, InstructionClass::kJump);
+  for (uint32_t opcode : {0b1010011u, 0b1000011u, 0b1000111u, 0b1001011u, 0b1001111u}) {
+    set(opcode, InstructionClass::kFpSingle, 0, 1);
+  }
+  set(0b1110011, InstructionClass::kCsr, 2, 1);
+}
+
+size_t InstructionMix::DecodeByRs2(uint32_t instruction) const {
+  const auto &by_rs2 = Tables().by_rs2;
+  auto it = by_rs2.find(static_cast<uint32_t>(DecodeKey(instruction) | (((instruction >> 20) & 0x1F) << 17)));
+  return it == by_rs2.end() ? static_cast<size_t>(Instruction::INVALID) : it->second;
+}
+
+void InstructionMix::Clear() {
+  class_counts_.fill(0);
+  instruction_counts_.fill(0);
+}
+
+uint64_t InstructionMix::Total() const {
+  return std::accumulate(class_counts_.begin(), class_counts_.end(), uint64_t{0});
+}
+
+namespace {
+std::vector<std::string> InstructionNames() {
+  std::vector<std::string> names(InstructionMix::kInstructionCount);
+  for (const auto &[name, instruction] : instruction_set::instruction_string_map) {
+    std::string &slot = names[static_cast<size_t>(instruction)];
+    if (slot.empty() || name < slot) {
+      slot = name;
+    }
+  }
+  names[static_cast<size_t>(Instruction::INVALID)] = "invalid";
+  return names;
+}
+} // namespace
+
+void InstructionMix::WriteReport(std::ostream &out) const {
+  uint64_t total = Total();
+  auto percent = [total](uint64_t count) {
+    return total == 0 ? 0.0 : 100.0*static_cast<double>(count)/static_cast<double>(total);
+  };
+
+  out << "Instruction mix (" << total << " retired):\n";
+  for (size_t i = 0; i < kClassCount; ++i) {
+    out << "  " << std::left << std::setw(18) << InstructionClassName(static_cast<InstructionClass>(i))
+        << std::right << std::setw(14) << class_counts_[i]
+        << std::setw(9) << std::fixed << std::setprecision(2) << percent(class_counts_[i]) << "%\n";
+  }
+
+  std::vector<std::string> names = InstructionNames();
+  std::vector<size_t> order(kInstructionCount);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+    return instruction_counts_[a] > instruction_counts_[b];
+  });
+  out << "Opcode histogram:\n";
+  for (size_t index : order) {
+    if (instruction_counts_[index] == 0) {
+      break;
+    }
+    out << "  " << std::left << std::setw(18) << names[index]
+        << std::right << std::setw(14) << instruction_counts_[index]
+        << std::setw(9) << percent(instruction_counts_[index]) << "%\n";
+  }
+  out << std::defaultfloat;
+}
+
+void InstructionMix::WriteJson(std::ostream &out) const {
+  out << "{\n  \"classes\": {";
+  for (size_t i = 0; i < kClassCount; ++i) {
+    out << (i ? ", " : "") << "\"" << InstructionClassName(static_cast<InstructionClass>(i)) << "\": "
+        << class_counts_[i];
+  }
+  out << "},\n  \"instructions\": {";
+  std::vector<std::string> names = InstructionNames();
+  bool first = true;
+  for (size_t i = 0; i < kInstructionCount; ++i) {
+    if (instruction_counts_[i] == 0) {
+      continue;
+    }
+    out << (first ? "" : ", ") << "\"" << names[i] << "\": " << instruction_counts_[i];
+    first = false;
+  }
+  out << "}\n}\n";
+}
@@ -0,0 +1,125 @@
+/**
+ * @file instruction_mix.h
+ * @brief Contains the dynamic instruction-mix counters.
+ */
+#ifndef INSTRUCTION_MIX_H
+#define INSTRUCTION_MIX_H
+
+#include "../common/instructions.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+/**
+ * @brief Classes used for the instruction-mix breakdown.
+ *
+ * kBranchTaken/kBranchNotTaken, kFpSingle/kFpDouble and kCsr/kSyscall are kept
+ * adjacent so the second member of each pair is selected by adding one bit.
+ */
+enum class InstructionClass : uint8_t {
+  kAlu,
+  kLoad,
+  kStore,
+  kBranchTaken,
+  kBranchNotTaken,
+  kJump,
+  kFpSingle,
+  kFpDouble,
+  kCsr,
+  kSyscall,
+  kOther,
+  kCount
+};
+
+const char *InstructionClassName(InstructionClass instruction_class);
+
+/**
+ * @brief Counts retired instructions per class and per instruction_set::Instruction.
+ *
+ * Both counters are plain array increments indexed through lookup tables that
+ * are built once, so Record() has no data-dependent branches.
+ */
+class InstructionMix {
+ public:
+  static constexpr size_t kClassCount = static_cast<size_t>(InstructionClass::kCount);
+  static constexpr size_t kInstructionCount = static_cast<size_t>(instruction_set::Instruction::COUNT);
+
+  InstructionMix();
+
+  /**
+   * @brief Records one retired instruction.
+   * @param taken Whether control left the sequential path (only used for branches).
+   */
+  void Record(uint32_t instruction, bool taken) { Add(instruction, taken, 1); }
+
+  /**
+   * @brief Takes back a Record() with the same arguments (used by undo).
+   */
+  void Retract(uint32_t instruction, bool taken) { Add(instruction, taken, ~uint64_t{0}); }
+
+  void Clear();
+
+  uint64_t Total() const;
+  uint64_t Count(InstructionClass instruction_class) const {
+    return class_counts_[static_cast<size_t>(instruction_class)];
+  }
+  const uint64_t *Counter(InstructionClass instruction_class) const {
+    return &class_counts_[static_cast<size_t>(instruction_class)];
+  }
+  uint64_t Count(instruction_set::Instruction instruction) const {
+    return instruction_counts_[static_cast<size_t>(instruction)];
+  }
+
+  /**
+   * @brief Writes the class breakdown followed by the non-zero per-instruction counts.
+   */
+  void WriteReport(std::ostream &out) const;
+
+  /**
+   * @brief Writes the counters as a JSON object.
+   */
+  void WriteJson(std::ostream &out) const;
+
+ private:
+  struct OpcodeInfo {
+    uint8_t base = static_cast<uint8_t>(InstructionClass::kOther);
+    uint8_t shift = 0;
+    uint8_t mask = 0;
+  };
+
+  void Add(uint32_t instruction, bool taken, uint64_t delta) {
+    uint32_t opcode = instruction & 0x7F;
+    const OpcodeInfo &info = opcode_info_[opcode];
+    // bit 0: fmt (double), bit 1: not taken, bit 2: funct3 == 0 (ecall/ebreak)
+    uint32_t selectors = ((instruction >> 25) & 1)
+                       | (static_cast<uint32_t>(!taken) << 1)
+                       | (static_cast<uint32_t>(((instruction >> 12) & 0x7) == 0) << 2);
+    class_counts_[info.base + ((selectors >> info.shift) & info.mask)] += delta;
+    instruction_counts_[DecodeIndex(instruction)] += delta;
+  }
+
+  // opcode | funct3 << 7 | funct7 << 10
+  static constexpr size_t kDecodeKeyBits = 17;
+  static constexpr uint8_t kNeedsRs2 = 0xFF;
+
+  static size_t DecodeKey(uint32_t instruction) {
+    return (instruction & 0x7F) | (((instruction >> 12) & 0x7) << 7) | (((instruction >> 25) & 0x7F) << 10);
+  }
+
+  size_t DecodeIndex(uint32_t instruction) const {
+    uint8_t index = decode_table_[DecodeKey(instruction)];
+    // Only the FP conversions/sqrt are told apart by rs2
+    return index != kNeedsRs2 ? index : DecodeByRs2(instruction);
+  }
+  size_t DecodeByRs2(uint32_t instruction) const;
+
+  std::array<OpcodeInfo, 128> opcode_info_{};
+  const std::array<uint8_t, (1u << kDecodeKeyBits)> &decode_table_;
+
+  std::array<uint64_t, kClassCount> class_counts_{};
+  std::array<uint64_t, kInstructionCount> instruction_counts_{};
+};
+
+#endif // INSTRUCTION_MIX_H
@@ -0,0 +1,306 @@
+/**
+ * @file lockstep_checker.cpp
+ * @brief Contains the implementation of the lockstep co-simulation checker.
+ */
+#include "lockstep_checker.h"
+
+#include "functional_units.h"
+#include "rvss_vm.h"
+#include "vm_snapshot.h"
+
+#include <algorithm>
+#include <exception>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+constexpr uint32_t kStoreOpcode = 0b0100011;
+constexpr uint32_t kFpStoreOpcode = 0b0100111;
+
+std::string Hex(uint64_t value, int width = 16) {
+  std::ostringstream text;
+  text << "0x" << std::hex << std::setw(width) << std::setfill('0') << value;
+  return text.str();
+}
+
+std::string PcText(const RetireRecord &record) {
+  return Hex(record.pc, 8);
+}
+
+std::string InstructionText(const RetireRecord &record) {
+  return Hex(record.instruction, 8);
+}
+
+std::string DestinationText(const RetireRecord &record) {
+  if (record.destination == RetireDestination::kNone) {
+    return "-";
+  }
+  return (record.destination == RetireDestination::kFpr ? "f" : "x") + std::to_string(record.rd) + " = "
+         + Hex(record.rd_value);
+}
+
+std::string StoreText(const RetireRecord &record) {
+  if (record.store_size == 0) {
+    return "-";
+  }
+  return "[" + Hex(record.store_address, 8) + "] " + std::to_string(record.store_size) + "B = "
+         + Hex(record.store_value, 2*record.store_size);
+}
+
+std::string SourceLine(const AssembledProgram &program, uint64_t pc) {
+  auto line = program.instruction_number_line_number_mapping.find(static_cast<unsigned int>(pc / 4));
+  return line == program.instruction_number_line_number_mapping.end() ? "-" : "line " + std::to_string(line->second);
+}
+} // namespace
+
+bool RetireRecord::operator==(const RetireRecord &other) const {
+  if (pc != other.pc || instruction != other.instruction || destination != other.destination
+      || store_size != other.store_size) {
+    return false;
+  }
+  if (destination != RetireDestination::kNone && (rd != other.rd || rd_value != other.rd_value)) {
+    return false;
+  }
+  return store_size == 0 || (store_address == other.store_address && store_value == other.store_value);
+}
+
+RetireRecord DescribeRetirement(uint64_t pc, uint32_t instruction, const RegisterFile &registers,
+                                uint64_t store_address, uint64_t store_data) {
+  RetireRecord record;
+  record.pc = pc;
+  record.instruction = instruction;
+  uint32_t opcode = instruction & 0x7F;
+  uint32_t funct3 = (instruction >> 12) & 0x7;
+  switch (opcode) {
+    case kStoreOpcode:
+      record.store_size = static_cast<uint8_t>(1u << (funct3 & 0x3));
+      break;
+    case kFpStoreOpcode:
+      record.store_size = funct3 == 0b011 ? 8 : 4;
+      break;
+    case 0b1100011: // branch
+    case 0b0001111: // fence
+      break;
+    case 0b1110011: // SYSTEM: ecall/ebreak write nothing, the CSR instructions write the old CSR to rd
+      record.destination = funct3 == 0 ? RetireDestination::kNone : RetireDestination::kGpr;
+      break;
+    default:
+      record.destination = DecodeRegisterUsage(instruction).rd_is_float ? RetireDestination::kFpr
+                                                                          : RetireDestination::kGpr;
+      break;
+  }
+
+  record.rd = static_cast<uint8_t>((instruction >> 7) & 0x1F);
+  if (record.destination == RetireDestination::kGpr && record.rd == 0) {
+    record.destination = RetireDestination::kNone;
+  }
+  if (record.destination == RetireDestination::kGpr) {
+    record.rd_value = registers.ReadGpr(record.rd);
+  } else if (record.destination == RetireDestination::kFpr) {
+    record.rd_value = registers.ReadFpr(record.rd);
+  } else {
+    record.rd = 0;
+  }
+
+  if (record.store_size != 0) {
+    record.store_address = store_address;
+    record.store_value = record.store_size == 8 ? store_data : store_data & ((uint64_t{1} << (8*record.store_size)) - 1);
+  }
+  return record;
+}
+
+LockstepChecker::LockstepChecker(VmBase &dut, uint64_t max_instructions, size_t queue_capacity)
+    : dut_(dut),
+      reference_(std::make_unique<RVSSVM>(&reference_registers_)),
+      queue_(queue_capacity),
+      max_instructions_(max_instructions) {
+  // Only the architectural part of the state: the reference has no pipeline to restore
+  VmSnapshot state;
+  dut.VmBase::SaveSnapshot(state);
+  reference_->program_ = dut.program_;
+  reference_->VmBase::RestoreSnapshot(state);
+  reference_->SetIsa(reference_registers_.GetIsa());  // the snapshot carries the DUT's ISA
+  reference_->instruction_pc_ = reference_->program_counter_;
+}
+
+LockstepChecker::~LockstepChecker() {
+  stop_reference_.store(true, std::memory_order_relaxed);
+  if (reference_thread_.joinable()) {
+    reference_thread_.join();
+  }
+}
+
+void LockstepChecker::Start() {
+  reference_thread_ = std::thread([this] {
+    try {
+      RunReference();
+    } catch (const std::exception &e) {
+      reference_end_ = ReferenceEnd::kError;
+      reference_error_ = e.what();
+    }
+    reference_done_.store(true, std::memory_order_release);
+  });
+}
+
+void LockstepChecker::RunReference() {
+  RVSSVM &vm = *reference_;
+  uint64_t retired = 0;
+  while (true) {
+    if (vm.stop_requested_) {
+      reference_end_ = ReferenceEnd::kExit;
+      return;
+    }
+    if (vm.program_counter_ >= vm.program_size_) {
+      reference_end_ = ReferenceEnd::kProgramEnd;
+      return;
+    }
+    if (max_instructions_ != 0 && retired == max_instructions_) {
+      reference_end_ = ReferenceEnd::kLimit;
+      return;
+    }
+
+    uint64_t pc = vm.program_counter_;
+    vm.ProcessInstruction();
+    vm.instructions_retired_++;
+    ++retired;
+
+    uint32_t instruction = vm.current_instruction_;
+    uint8_t rs2 = (instruction >> 20) & 0x1F;
+    uint64_t store_data = (instruction & 0x7F) == kFpStoreOpcode ? vm.registers_->ReadFpr(rs2)
+                                                                   : vm.registers_->ReadGpr(rs2);
+    RetireRecord record = DescribeRetirement(pc, instruction, *vm.registers_,
+                                             static_cast<uint64_t>(vm.execution_result_), store_data);
+    while (!queue_.TryPush(record)) {
+      if (stop_reference_.load(std::memory_order_relaxed)) {
+        reference_end_ = ReferenceEnd::kStopped;
+        return;
+      }
+      std::this_thread::yield();
+    }
+  }
+}
+
+bool LockstepChecker::NextExpected(RetireRecord &record) {
+  while (!queue_.TryPop(record)) {
+    if (reference_done_.load(std::memory_order_acquire)) {
+      // Anything pushed before the flag was set is visible now
+      return queue_.TryPop(record);
+    }
+    std::this_thread::yield();
+  }
+  return true;
+}
+
+bool LockstepChecker::Retire(const RetireRecord &record) {
+  if (outcome_ != Outcome::kRunning) {
+    return false;
+  }
+  RetireRecord expected;
+  if (!NextExpected(expected)) {
+    Diverge(nullptr, &record);
+    return false;
+  }
+  if (expected != record) {
+    Diverge(&expected, &record);
+    return false;
+  }
+  history_[matched_ % kHistory] = record;
+  ++matched_;
+  if (max_instructions_ != 0 && matched_ >= max_instructions_) {
+    outcome_ = Outcome::kLimit;
+    return false;
+  }
+  return true;
+}
+
+void LockstepChecker::Finish(bool dut_finished) {
+  if (outcome_ == Outcome::kRunning) {
+    RetireRecord extra;
+    if (!dut_finished) {
+      outcome_ = Outcome::kStopped;
+    } else if (NextExpected(extra)) {
+      Diverge(&extra, nullptr);
+    } else {
+      outcome_ = Outcome::kMatched;
+    }
+  }
+  stop_reference_.store(true, std::memory_order_relaxed);
+  if (reference_thread_.joinable()) {
+    reference_thread_.join();
+  }
+}
+
+void LockstepChecker::Diverge(const RetireRecord *expected, const RetireRecord *actual) {
+  outcome_ = Outcome::kDiverged;
+  divergence_cycle_ = dut_.cycle_s_;
+  has_expected_ = expected != nullptr;
+  has_actual_ = actual != nullptr;
+  if (expected) {
+    expected_ = *expected;
+  }
+  if (actual) {
+    actual_ = *actual;
+  }
+}
+
+void LockstepChecker::WriteReport(std::ostream &out) const {
+  const AssembledProgram &program = dut_.program_;
+  out << "Lockstep check against the single-cycle reference: " << matched_ << " retirements matched\n";
+  switch (outcome_) {
+    case Outcome::kRunning:
+      out << "Result: still running\n";
+      return;
+    case Outcome::kMatched:
+      out << "Result: both ran to the end of the program\n";
+      return;
+    case Outcome::kLimit:
+      out << "Result: instruction limit reached\n";
+      return;
+    case Outcome::kStopped:
+      out << "Result: the run stopped before the end of the program (breakpoint, watchpoint, fault or stop)\n";
+      return;
+    case Outcome::kDiverged:
+      break;
+  }
+
+  out << "Result: DIVERGED at retirement " << matched_ + 1 << ", cycle " << divergence_cycle_ << "\n";
+  if (!has_expected_) {
+    out << "The reference retired nothing more (";
+    switch (reference_end_) {
+      case ReferenceEnd::kProgramEnd: out << "end of program"; break;
+      case ReferenceEnd::kExit: out << "exit syscall"; break;
+      case ReferenceEnd::kError: out << "error: " << reference_error_; break;
+      default: out << "stopped"; break;
+    }
+    out << ")\n";
+  }
+  if (!has_actual_) {
+    out << "The VM under test ended the program; the reference still retires\n";
+  }
+
+  auto row = [&out](const char *field, const std::string &expected, const std::string &actual, bool mark = true) {
+    out << "  " << std::left << std::setw(13) << field << std::setw(42) << expected << std::setw(42) << actual
+        << (mark && expected != actual ? "<<" : "") << "\n";
+  };
+  auto side = [](bool present, const RetireRecord &record, std::string (*text)(const RetireRecord &)) {
+    return present ? text(record) : std::string("(none)");
+  };
+  row("", "reference", "under test", false);
+  row("pc", side(has_expected_, expected_, PcText), side(has_actual_, actual_, PcText));
+  row("source", has_expected_ ? SourceLine(program, expected_.pc) : "(none)",
+      has_actual_ ? SourceLine(program, actual_.pc) : "(none)");
+  row("instruction", side(has_expected_, expected_, InstructionText), side(has_actual_, actual_, InstructionText));
+  row("register", side(has_expected_, expected_, DestinationText), side(has_actual_, actual_, DestinationText));
+  row("store", side(has_expected_, expected_, StoreText), side(has_actual_, actual_, StoreText));
+
+  uint64_t shown = std::min<uint64_t>(matched_, kHistory);
+  if (shown != 0) {
+    out << "Last " << shown << " matching retirements:\n";
+    for (uint64_t i = matched_ - shown; i < matched_; ++i) {
+      const RetireRecord &record = history_[i % kHistory];
+      out << "  " << std::right << std::setw(10) << i + 1 << "  " << PcText(record) << "  "
+          << InstructionText(record) << "  " << std::left << std::setw(10) << SourceLine(program, record.pc)
+          << std::setw(26) << DestinationText(record) << StoreText(record) << "\n";
+    }
+  }
+}
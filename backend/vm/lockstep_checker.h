@@ -0,0 +1,132 @@
+/**
+ * @file lockstep_checker.h
+ * @brief Contains the lockstep co-simulation that checks a timing VM against the single-cycle VM.
+ */
+#ifndef LOCKSTEP_CHECKER_H
+#define LOCKSTEP_CHECKER_H
+
+#include "registers.h"
+#include "spsc_queue.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <thread>
+
+class RVSSVM;
+class VmBase;
+
+enum class RetireDestination : uint8_t { kNone, kGpr, kFpr };
+
+/**
+ * @brief Architectural effect of one retired instruction, as both VMs report it.
+ *
+ * CSR writes and the memory side of AMOs are not recorded.
+ */
+struct RetireRecord {
+  uint64_t pc = 0;
+  uint32_t instruction = 0;
+  RetireDestination destination = RetireDestination::kNone;
+  uint8_t rd = 0;
+  uint8_t store_size = 0;  // bytes written, 0 if the instruction does not store
+  uint64_t rd_value = 0;   // register contents after the write
+  uint64_t store_address = 0;
+  uint64_t store_value = 0;  // the bytes written, zero-extended
+
+  bool operator==(const RetireRecord &other) const;
+  bool operator!=(const RetireRecord &other) const { return !(*this == other); }
+};
+
+/**
+ * @brief Builds the record of an instruction that has just written back.
+ * @param registers Register file after the instruction's write.
+ * @param store_address,store_data Address and source register value of a store; ignored otherwise.
+ */
+RetireRecord DescribeRetirement(uint64_t pc, uint32_t instruction, const RegisterFile &registers,
+                                uint64_t store_address, uint64_t store_data);
+
+/**
+ * @brief Runs a private single-cycle reference on a second thread and compares every
+ * instruction the VM under test retires against it.
+ *
+ * The reference starts from a copy of the VM's architectural state (registers and
+ * memory), so the VM's pipeline must be empty. It runs ahead, publishing its
+ * retirements through a lock-free SPSC queue and waiting whenever the queue is
+ * full; the VM under test pops one record per retirement, in program order, and
+ * stops at the first mismatch with both sides and the retirements leading up
+ * to it kept for the report.
+ */
+class LockstepChecker {
+ public:
+  /**
+   * @param dut VM under test; only read here, it must outlive the checker.
+   * @param max_instructions Stop after this many matching retirements, 0 for no limit.
+   */
+  LockstepChecker(VmBase &dut, uint64_t max_instructions = 0, size_t queue_capacity = 4096);
+  ~LockstepChecker();
+
+  LockstepChecker(const LockstepChecker &) = delete;
+  LockstepChecker &operator=(const LockstepChecker &) = delete;
+
+  /**
+   * @brief Starts the reference thread.
+   */
+  void Start();
+  /**
+   * @brief Checks the next retirement of the VM under test (its thread only).
+   * @return false once the run should stop: divergence or instruction limit.
+   */
+  bool Retire(const RetireRecord &record);
+  /**
+   * @brief Ends the check and joins the reference thread.
+   * @param dut_finished The VM under test ran to the end of the program, so the
+   * reference must not have anything left to retire.
+   */
+  void Finish(bool dut_finished);
+
+  bool Diverged() const { return outcome_ == Outcome::kDiverged; }
+  uint64_t Matched() const { return matched_; }
+
+  /**
+   * @brief Writes the outcome and, after a divergence, both sides of the first
+   * mismatching retirement and the ones that matched before it.
+   */
+  void WriteReport(std::ostream &out) const;
+
+ private:
+  enum class Outcome { kRunning, kMatched, kLimit, kDiverged, kStopped };
+  enum class ReferenceEnd { kRunning, kProgramEnd, kExit, kLimit, kStopped, kError };
+  static constexpr size_t kHistory = 8;
+
+  // Reference thread: executes and publishes until the program ends or the checker stops it
+  void RunReference();
+  // Waits for the reference's next record; false if it has finished and has none
+  bool NextExpected(RetireRecord &record);
+  void Diverge(const RetireRecord *expected, const RetireRecord *actual);
+
+  VmBase &dut_;
+  RegisterFile reference_registers_;
+  std::unique_ptr<RVSSVM> reference_;
+  std::thread reference_thread_;
+  SpscQueue<RetireRecord> queue_;
+  std::atomic<bool> reference_done_{false};
+  std::atomic<bool> stop_reference_{false};
+  uint64_t max_instructions_ = 0;
+  // Written by the reference thread before it sets reference_done_
+  ReferenceEnd reference_end_ = ReferenceEnd::kRunning;
+  std::string reference_error_;
+
+  // Checker state, owned by the thread of the VM under test
+  Outcome outcome_ = Outcome::kRunning;
+  uint64_t matched_ = 0;
+  uint64_t divergence_cycle_ = 0;
+  bool has_expected_ = false, has_actual_ = false;
+  RetireRecord expected_, actual_;
+  std::array<RetireRecord, kHistory> history_{};  // last matching retirements, a ring indexed by matched_
+};
+
+#endif // LOCKSTEP_CHECKER_H
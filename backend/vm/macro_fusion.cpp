@@ -0,0 +1,86 @@
+/**
+ * @file macro_fusion.cpp
+ * @brief Contains the detection of fusible instruction pairs.
+ */
+#include "macro_fusion.h"
+
+namespace {
+constexpr uint32_t kLoadOpcode = 0b0000011;
+constexpr uint32_t kOpImmOpcode = 0b0010011;
+constexpr uint32_t kAuipcOpcode = 0b0010111;
+constexpr uint32_t kOpImm32Opcode = 0b0011011;
+constexpr uint32_t kOpOpcode = 0b0110011;
+constexpr uint32_t kLuiOpcode = 0b0110111;
+constexpr uint32_t kJalrOpcode = 0b1100111;
+
+uint32_t Opcode(uint32_t instruction) { return instruction & 0x7F; }
+uint8_t Rd(uint32_t instruction) { return (instruction >> 7) & 0x1F; }
+uint8_t Funct3(uint32_t instruction) { return (instruction >> 12) & 0x7; }
+uint8_t Rs1(uint32_t instruction) { return (instruction >> 15) & 0x1F; }
+int64_t ImmI(uint32_t instruction) { return static_cast<int32_t>(instruction) >> 20; }
+
+bool IsIntegerLoad(uint32_t instruction) {
+  return Opcode(instruction) == kLoadOpcode && Funct3(instruction) != 0b111;
+}
+
+// slli/srli with funct6 = 0 (srai sets bit 30)
+bool IsShift(uint32_t instruction, uint8_t funct3) {
+  return Opcode(instruction) == kOpImmOpcode && Funct3(instruction) == funct3 && (instruction >> 26) == 0;
+}
+} // namespace
+
+const char *FusionKindName(FusionKind kind) {
+  switch (kind) {
+    case FusionKind::kNone: return "none";
+    case FusionKind::kLuiAddi: return "lui_addi";
+    case FusionKind::kAuipcJalr: return "auipc_jalr";
+    case FusionKind::kShiftPair: return "shift_pair";
+    case FusionKind::kIndexedLoad: return "indexed_load";
+    case FusionKind::kLoadPair: return "load_pair";
+    case FusionKind::kCount: break;
+  }
+  return "?";
+}
+
+FusionKind DetectFusion(uint32_t head, uint32_t tail) {
+  uint8_t rd = Rd(head);
+  if (rd == 0) {
+    return FusionKind::kNone;
+  }
+  // The dependent pairs pass the head's result through the tail's rs1
+  bool chained = Rs1(tail) == rd;
+  bool overwrites = chained && Rd(tail) == rd;
+
+  switch (Opcode(head)) {
+    case kLuiOpcode:
+      if (overwrites && (Opcode(tail) == kOpImmOpcode || Opcode(tail) == kOpImm32Opcode) && Funct3(tail) == 0) {
+        return FusionKind::kLuiAddi;
+      }
+      break;
+    case kAuipcOpcode:
+      if (chained && Opcode(tail) == kJalrOpcode) {
+        return FusionKind::kAuipcJalr;
+      }
+      break;
+    case kOpImmOpcode:
+      if (overwrites && IsShift(head, 0b001) && IsShift(tail, 0b101)) {
+        return FusionKind::kShiftPair;
+      }
+      break;
+    case kOpOpcode:
+      if (overwrites && Funct3(head) == 0 && (head >> 25) == 0 && IsIntegerLoad(tail)) {
+        return FusionKind::kIndexedLoad;
+      }
+      break;
+    case kLoadOpcode:
+      if (IsIntegerLoad(head) && IsIntegerLoad(tail) && Funct3(head) == Funct3(tail) && Rs1(head) == Rs1(tail)
+          && rd != Rs1(head) && Rd(tail) != 0 && Rd(tail) != rd
+          && ImmI(tail) == ImmI(head) + (int64_t{1} << (Funct3(head) & 0x3))) {
+        return FusionKind::kLoadPair;
+      }
+      break;
+    default:
+      break;
+  }
+  return FusionKind::kNone;
+}
@@ -0,0 +1,41 @@
+/**
+ * @file macro_fusion.h
+ * @brief Contains the instruction pairs the pipelined VM can fuse into one macro-op.
+ */
+#ifndef MACRO_FUSION_H
+#define MACRO_FUSION_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Adjacent instruction pairs that issue as one pipeline entry.
+ *
+ * In every pair but kLoadPair the second instruction (the tail) reads the first
+ * one's (the head's) destination as its rs1, so the head's result only has to be
+ * computed ahead of the tail in EX. All of them are integer-only.
+ */
+enum class FusionKind : uint8_t {
+  kNone,
+  kLuiAddi,      // lui rd, hi; addi(w) rd, rd, lo: 32-bit constant
+  kAuipcJalr,    // auipc rt, hi; jalr rd, lo(rt): call/tail to a far target
+  kShiftPair,    // slli rd, rs, a; srli rd, rd, b: zero-extension and bit-field extract
+  kIndexedLoad,  // add rd, rs1, rs2; l* rd, imm(rd)
+  kLoadPair,     // l* rd1, imm(rs); l* rd2, imm+size(rs) of the same width
+  kCount
+};
+
+constexpr size_t kFusionKindCount = static_cast<size_t>(FusionKind::kCount);
+
+const char *FusionKindName(FusionKind kind);
+
+/**
+ * @brief Which pair `head` followed by `tail` forms, or kNone.
+ *
+ * The three pairs whose intermediate result is dead (lui+addi, the shift pair and the
+ * indexed load) only fuse when the tail overwrites the head's destination; a load
+ * pair needs two different destinations, neither of them the base.
+ */
+FusionKind DetectFusion(uint32_t head, uint32_t tail);
+
+#endif // MACRO_FUSION_H
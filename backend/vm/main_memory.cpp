@@ -16,24 +16,154 @@ uint8_t Memory::Read(uint64_t address) {
   if (address >= memory_size_) {
     throw std::out_of_range("Memory address out of range: " + std::to_string(address));
   }
-  uint64_t block_index = GetBlockIndex(address);
-  uint64_t offset = GetBlockOffset(address);
-  // std::cout << "block index : " << block_index << " offset: " << offset << " value :" << blocks_[block_index].data[offset]<<std::endl;
-  if (!IsBlockPresent(block_index)) {
+  auto it = blocks_.find(GetBlockIndex(address));
+  if (it == blocks_.end()) {
+    if (!watchpoints_.empty()) {
+      CheckWatchpoints(address, kWatchRead);
+    }
     return 0;
   }
-  return blocks_[block_index].data[offset];
+  if (it->second.watch_flags & kWatchRead) {
+    CheckWatchpoints(address, kWatchRead);
+  }
+  return it->second.data[GetBlockOffset(address)];
 }
 
 void Memory::Write(uint64_t address, uint8_t value) {
   if (address >= memory_size_) {
     throw std::out_of_range(std::string("Memory address out of range: ") + std::to_string(address));
   }
-  uint64_t block_index = GetBlockIndex(address);
-  uint64_t offset = GetBlockOffset(address);
+  uint64_t index = GetBlockIndex(address);
+  auto [it, inserted] = blocks_.try_emplace(index);
+  MemoryBlock &block = it->second;
+  if (inserted && !watchpoints_.empty()) {
+    block.watch_flags = WatchFlagsFor(index);
+  }
+  if (block.watch_flags & kWatchWrite) {
+    CheckWatchpoints(address, kWatchWrite);
+  }
+  block.data[GetBlockOffset(address)] = value;
+}
+
+uint8_t Memory::Peek(uint64_t address) const {
+  auto it = blocks_.find(GetBlockIndex(address));
+  if (it == blocks_.end()) {
+    return 0;
+  }
+  return it->second.data[GetBlockOffset(address)];
+}
+
+void Memory::Reset() {
+  blocks_.clear();
+  watch_hit_pending_ = false;
+}
+
+std::vector<uint64_t> Memory::GetBlockIndices() const {
+  std::vector<uint64_t> indices;
+  indices.reserve(blocks_.size());
+  for (const auto &[index, block] : blocks_) {
+    indices.push_back(index);
+  }
+  std::sort(indices.begin(), indices.end());
+  return indices;
+}
+
+const uint8_t *Memory::GetBlockData(uint64_t block_index) const {
+  auto it = blocks_.find(block_index);
+  return it == blocks_.end() ? nullptr : it->second.data.data();
+}
+
+void Memory::RestoreBlock(uint64_t block_index, const uint8_t *data) {
   EnsureBlockExists(block_index);
-  blocks_[block_index].data[offset] = value;
-  // std::cout << blocks_[block_index].data[offset] << " " << value << std::endl;
+  std::memcpy(blocks_[block_index].data.data(), data, block_size_);
+}
+
+uint8_t Memory::WatchFlagsFor(uint64_t block_index) const {
+  uint64_t block_start = block_index*block_size_;
+  uint64_t block_end = block_start + block_size_;
+  uint8_t flags = 0;
+  for (const auto &watchpoint : watchpoints_) {
+    if (watchpoint.start < block_end && watchpoint.end > block_start) {
+      flags |= watchpoint.kind;
+    }
+  }
+  return flags;
+}
+
+void Memory::RefreshWatchFlags(uint64_t start, uint64_t end) {
+  if (end <= start) {
+    return;
+  }
+  uint64_t first = GetBlockIndex(start);
+  uint64_t last = GetBlockIndex(end - 1);
+  // Only allocated blocks carry flags; walk whichever of the range and the block map is smaller
+  if (last - first >= blocks_.size()) {
+    for (auto &[index, block] : blocks_) {
+      if (index >= first && index <= last) {
+        block.watch_flags = WatchFlagsFor(index);
+      }
+    }
+    return;
+  }
+  for (uint64_t index = first; index <= last; ++index) {
+    auto it = blocks_.find(index);
+    if (it != blocks_.end()) {
+      it->second.watch_flags = WatchFlagsFor(index);
+    }
+  }
+}
+
+void Memory::CheckWatchpoints(uint64_t address, uint8_t kind) {
+  if (watch_hit_pending_) {
+    return;
+  }
+  for (const auto &watchpoint : watchpoints_) {
+    if ((watchpoint.kind & kind) && address >= watchpoint.start && address < watchpoint.end) {
+      watch_hit_pending_ = true;
+      watch_hit_.address = address;
+      watch_hit_.kind = kind;
+      watch_hit_.watchpoint = watchpoint;
+      return;
+    }
+  }
+}
+
+bool Memory::AddWatchpoint(uint64_t address, uint64_t size, uint8_t kind) {
+  if (size == 0 || (kind & kWatchAccess) == 0 || address >= memory_size_) {
+    throw std::invalid_argument("Invalid watchpoint: address " + std::to_string(address)
+                                + ", size " + std::to_string(size));
+  }
+  uint64_t end = (size > memory_size_ - address) ? memory_size_ : address + size;
+  for (const auto &watchpoint : watchpoints_) {
+    if (watchpoint.start == address && watchpoint.end == end && watchpoint.kind == kind) {
+      return false;
+    }
+  }
+  watchpoints_.push_back({address, end, static_cast<uint8_t>(kind & kWatchAccess)});
+  RefreshWatchFlags(address, end);
+  return true;
+}
+
+bool Memory::RemoveWatchpoint(uint64_t address, uint64_t size, uint8_t kind) {
+  uint64_t end = (size > memory_size_ - address) ? memory_size_ : address + size;
+  auto it = std::find_if(watchpoints_.begin(), watchpoints_.end(), [&](const Watchpoint &watchpoint) {
+    return watchpoint.start == address && watchpoint.end == end && watchpoint.kind == kind;
+  });
+  if (it == watchpoints_.end()) {
+    return false;
+  }
+  watchpoints_.erase(it);
+  RefreshWatchFlags(address, end);
+  return true;
+}
+
+bool Memory::TakeWatchHit(WatchHit &hit) {
+  if (!watch_hit_pending_) {
+    return false;
+  }
+  hit = watch_hit_;
+  watch_hit_pending_ = false;
+  return true;
 }
 
 uint64_t Memory::GetBlockIndex(uint64_t address) const {
@@ -50,7 +180,8 @@ bool Memory::IsBlockPresent(uint64_t block_index) const {
 
 void Memory::EnsureBlockExists(uint64_t block_index) {
   if (blocks_.find(block_index)==blocks_.end()) {
-    blocks_.emplace(block_index, MemoryBlock());
+    MemoryBlock &block = blocks_.emplace(block_index, MemoryBlock()).first->second;
+    block.watch_flags = WatchFlagsFor(block_index);
   }
 }
 
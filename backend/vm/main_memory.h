@@ -11,12 +11,40 @@
 #include <string>
 // #include <stdexcept>
 
+/**
+ * @brief Kinds of memory watchpoints, usable as a bit mask.
+ */
+enum WatchKind : uint8_t {
+  kWatchRead = 1,   ///< Trigger on loads.
+  kWatchWrite = 2,  ///< Trigger on stores.
+  kWatchAccess = 3  ///< Trigger on loads and stores.
+};
+
+/**
+ * @brief A watched address range [start, end).
+ */
+struct Watchpoint {
+  uint64_t start; ///< First watched byte.
+  uint64_t end; ///< One past the last watched byte.
+  uint8_t kind; ///< WatchKind mask.
+};
+
+/**
+ * @brief Describes the first watchpoint triggered since the last TakeWatchHit().
+ */
+struct WatchHit {
+  uint64_t address = 0; ///< Byte address that triggered the watchpoint.
+  uint8_t kind = 0; ///< kWatchRead or kWatchWrite.
+  Watchpoint watchpoint{}; ///< The watchpoint that matched.
+};
+
 /**
  * @brief Represents a memory block containing 1 KB of memory.
  */
 struct MemoryBlock {
   std::vector<uint8_t> data; ///< A vector representing the memory block data.
   unsigned int block_size = vm_config::config.getMemoryBlockSize(); ///< The size of the memory block in bytes.
+  uint8_t watch_flags = 0; ///< Union of the WatchKind masks of watchpoints overlapping this block.
 
   /**
    * @brief Constructs a MemoryBlock with a size of 1 KB initialized to 0.
@@ -35,6 +63,10 @@ class Memory {
   unsigned int block_size_; ///< The size of each memory block in bytes.
   uint64_t memory_size_ = vm_config::config.getMemorySize(); ///< The total memory size in bytes.
 
+  std::vector<Watchpoint> watchpoints_; ///< Active watchpoints; allocated blocks they cover carry watch_flags.
+  bool watch_hit_pending_ = false; ///< Set when an access hits a watchpoint.
+  WatchHit watch_hit_; ///< Details of the pending hit.
+
   /**
    * @brief Gets the block index for a given memory address.
    * @param address The memory address.
@@ -62,6 +94,25 @@ class Memory {
    */
   void EnsureBlockExists(uint64_t block_index);
 
+  /**
+   * @brief Union of the kinds of the watchpoints overlapping a block, allocated or not.
+   */
+  uint8_t WatchFlagsFor(uint64_t block_index) const;
+
+  /**
+   * @brief Recomputes the watch flags of the allocated blocks covering [start, end). Blocks are
+   * never allocated to hold a flag; new ones take their flags when they are created.
+   */
+  void RefreshWatchFlags(uint64_t start, uint64_t end);
+
+  /**
+   * @brief Slow path taken for accesses to blocks that carry watch flags, and for reads of
+   * unallocated memory while any watchpoint is set.
+   * @param address The byte address being accessed.
+   * @param kind kWatchRead or kWatchWrite.
+   */
+  void CheckWatchpoints(uint64_t address, uint8_t kind);
+
   /**
    * @brief Generic function to read data of type T from the memory.
    * @tparam T The type of data to read.
@@ -92,9 +143,10 @@ class Memory {
    */
   ~Memory() = default;
 
-  void Reset() {
-    blocks_.clear();
-  }
+  /**
+   * @brief Clears all memory. Watchpoints are kept and apply to blocks as they are allocated again.
+   */
+  void Reset();
 
   /**
    * @brief Reads a single byte from the given memory address.
@@ -174,6 +226,63 @@ class Memory {
 
   void WriteDouble(uint64_t address, double value);
 
+  /**
+   * @brief Reads a byte without triggering watchpoints (debugger and GUI access).
+   * @param address The memory address to read from.
+   * @return The byte value at the given address.
+   */
+  uint8_t Peek(uint64_t address) const;
+
+  unsigned int GetBlockSize() const {
+    return block_size_;
+  }
+
+  /**
+   * @brief Returns the indices of all allocated blocks in ascending order.
+   */
+  std::vector<uint64_t> GetBlockIndices() const;
+
+  /**
+   * @brief Returns the contents of an allocated block, or nullptr if it is not present.
+   */
+  const uint8_t *GetBlockData(uint64_t block_index) const;
+
+  /**
+   * @brief Allocates a block if needed and overwrites its contents with block-size bytes from data.
+   */
+  void RestoreBlock(uint64_t block_index, const uint8_t *data);
+
+  /**
+   * @brief Adds a watchpoint over [address, address + size).
+   * @return False if an identical watchpoint already exists.
+   */
+  bool AddWatchpoint(uint64_t address, uint64_t size, uint8_t kind);
+
+  /**
+   * @brief Removes the watchpoint over [address, address + size) with the given kind.
+   * @return False if no such watchpoint exists.
+   */
+  bool RemoveWatchpoint(uint64_t address, uint64_t size, uint8_t kind);
+
+  const std::vector<Watchpoint> &GetWatchpoints() const {
+    return watchpoints_;
+  }
+
+  bool HasWatchHit() const {
+    return watch_hit_pending_;
+  }
+
+  /**
+   * @brief Returns and clears the pending watchpoint hit.
+   * @param hit Receives the hit details.
+   * @return False if no watchpoint was hit.
+   */
+  bool TakeWatchHit(WatchHit &hit);
+
+  void ClearWatchHit() {
+    watch_hit_pending_ = false;
+  }
+
   void PrintMemory(uint64_t address, unsigned int rows);
 
   void DumpMemory(std::vector<std::string> args);
@@ -21,6 +21,14 @@
 class MemoryController {
 private:
     Memory memory_; ///< The main memory object.
+
+    uint64_t ReadGeneric_d(uint64_t address, unsigned int bytes) const {
+        uint64_t value = 0;
+        for (unsigned int i = 0; i < bytes; ++i) {
+            value |= static_cast<uint64_t>(memory_.Peek(address + i)) << (8*i);
+        }
+        return value;
+    }
 public:
     MemoryController() = default;
 
@@ -63,22 +71,62 @@ public:
         return memory_.ReadDoubleWord(address);
     }
 
-    // Functions to read memory directly with cache bypass
+    // Functions to read memory directly with cache bypass; these never trigger watchpoints
 
     [[nodiscard]] uint8_t ReadByte_d(uint64_t address) {
-        return memory_.ReadByte(address);
+        return memory_.Peek(address);
     }
 
     [[nodiscard]] uint16_t ReadHalfWord_d(uint64_t address) {
-        return memory_.ReadHalfWord(address);
+        return static_cast<uint16_t>(ReadGeneric_d(address, 2));
     }
 
     [[nodiscard]] uint32_t ReadWord_d(uint64_t address) {
-        return memory_.ReadWord(address);
+        return static_cast<uint32_t>(ReadGeneric_d(address, 4));
     }
 
     [[nodiscard]] uint64_t ReadDoubleWord_d(uint64_t address) {
-        return memory_.ReadDoubleWord(address);
+        return ReadGeneric_d(address, 8);
+    }
+
+    bool AddWatchpoint(uint64_t address, uint64_t size, uint8_t kind) {
+        return memory_.AddWatchpoint(address, size, kind);
+    }
+
+    bool RemoveWatchpoint(uint64_t address, uint64_t size, uint8_t kind) {
+        return memory_.RemoveWatchpoint(address, size, kind);
+    }
+
+    const std::vector<Watchpoint> &GetWatchpoints() const {
+        return memory_.GetWatchpoints();
+    }
+
+    unsigned int GetBlockSize() const {
+        return memory_.GetBlockSize();
+    }
+
+    std::vector<uint64_t> GetBlockIndices() const {
+        return memory_.GetBlockIndices();
+    }
+
+    const uint8_t *GetBlockData(uint64_t block_index) const {
+        return memory_.GetBlockData(block_index);
+    }
+
+    void RestoreBlock(uint64_t block_index, const uint8_t *data) {
+        memory_.RestoreBlock(block_index, data);
+    }
+
+    bool HasWatchHit() const {
+        return memory_.HasWatchHit();
+    }
+
+    bool TakeWatchHit(WatchHit &hit) {
+        return memory_.TakeWatchHit(hit);
+    }
+
+    void ClearWatchHit() {
+        memory_.ClearWatchHit();
     }
 
     void PrintMemory(const uint64_t address, unsigned int rows) {
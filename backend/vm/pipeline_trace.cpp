@@ -0,0 +1,163 @@
+/**
+ * @file pipeline_trace.cpp
+ * @brief Contains the implementation of the Kanata pipeline trace writer.
+ */
+#include "pipeline_trace.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+constexpr char kHeader[] = "Kanata\t0004\n";
+constexpr size_t kFlushThreshold = 64*1024;
+constexpr int kRetired = 0;
+constexpr int kFlushed = 1;
+} // namespace
+
+void PipelineTraceWriter::Start(const std::filesystem::path &filename, const AssembledProgram &program,
+                                uint64_t first_cycle, uint64_t last_cycle) {
+  if (first_cycle > last_cycle) {
+    throw std::invalid_argument("Trace window ends before it starts");
+  }
+  Stop();
+  out_.open(filename, std::ios::trunc);
+  if (!out_.is_open()) {
+    throw std::runtime_error("Unable to open file: " + filename.string());
+  }
+  path_ = filename;
+  program_ = &program;
+  first_cycle_ = first_cycle;
+  last_cycle_ = last_cycle;
+  buffer_ = kHeader;
+  enabled_ = true;
+  in_window_ = false;
+  started_ = false;
+  written_cycle_ = 0;
+  next_id_ = 0;
+  next_retire_id_ = 0;
+  in_flight_.clear();
+}
+
+void PipelineTraceWriter::Stop() {
+  if (!enabled_) {
+    return;
+  }
+  // Whatever was in the final stage retires as that cycle ends; the rest is left open and
+  // Konata draws it up to the last cycle
+  if (in_window_) {
+    BeginCycle(written_cycle_ + 1);
+    for (auto &[seq, entry] : in_flight_) {
+      entry.seen = !entry.final;
+    }
+    EndCycle();
+  }
+  Flush();
+  out_.close();
+  enabled_ = false;
+  in_flight_.clear();
+}
+
+void PipelineTraceWriter::BeginCycle(uint64_t cycle) {
+  in_window_ = enabled_ && cycle >= first_cycle_ && cycle <= last_cycle_ && (!started_ || cycle > written_cycle_);
+  if (!in_window_) {
+    return;
+  }
+  char line[64];
+  if (started_) {
+    std::snprintf(line, sizeof(line), "C\t%" PRIu64 "\n", cycle - written_cycle_);
+  } else {
+    std::snprintf(line, sizeof(line), "C=\t%" PRIu64 "\n", cycle);
+    started_ = true;
+  }
+  buffer_ += line;
+  written_cycle_ = cycle;
+}
+
+void PipelineTraceWriter::Stage(uint64_t seq, uint32_t lane, const char *stage, uint64_t pc,
+                                uint32_t instruction, bool stalled, bool final) {
+  if (!in_window_) {
+    return;
+  }
+  char line[128];
+  auto [it, inserted] = in_flight_.try_emplace(seq);
+  InFlight &entry = it->second;
+  if (inserted) {
+    entry.id = next_id_++;
+    auto source = program_->instruction_number_line_number_mapping.find(static_cast<unsigned int>(pc / 4));
+    unsigned int source_line = source == program_->instruction_number_line_number_mapping.end() ? 0 : source->second;
+    std::snprintf(line, sizeof(line), "I\t%" PRIu64 "\t%" PRIu64 "\t0\nL\t%" PRIu64 "\t0\t%08" PRIx64 ": %08" PRIx32,
+                  entry.id, seq, entry.id, pc, instruction);
+    buffer_ += line;
+    if (source_line != 0) {
+      std::snprintf(line, sizeof(line), " (line %u)", source_line);
+      buffer_ += line;
+    }
+    buffer_ += '\n';
+  } else if (entry.lane != lane || std::strcmp(entry.stage, stage) != 0) {
+    EndStage(entry);
+  } else {
+    stage = nullptr;  // still in the same stage
+  }
+  if (stage) {
+    entry.lane = lane;
+    entry.stage = stage;
+    entry.stalled = 0;
+    std::snprintf(line, sizeof(line), "S\t%" PRIu64 "\t%" PRIu32 "\t%s\n", entry.id, lane, stage);
+    buffer_ += line;
+  }
+  entry.seen = true;
+  entry.final = final;
+  entry.stalled += stalled;
+}
+
+void PipelineTraceWriter::EndCycle() {
+  if (!in_window_) {
+    return;
+  }
+  char line[64];
+  for (auto it = in_flight_.begin(); it != in_flight_.end();) {
+    InFlight &entry = it->second;
+    if (entry.seen) {
+      entry.seen = false;
+      ++it;
+      continue;
+    }
+    EndStage(entry);
+    std::snprintf(line, sizeof(line), "R\t%" PRIu64 "\t%" PRIu64 "\t%d\n", entry.id,
+                  entry.final ? next_retire_id_++ : 0, entry.final ? kRetired : kFlushed);
+    buffer_ += line;
+    it = in_flight_.erase(it);
+  }
+  if (buffer_.size() >= kFlushThreshold) {
+    Flush();
+  }
+}
+
+void PipelineTraceWriter::EndStage(const InFlight &entry) {
+  char line[128];
+  if (entry.stalled != 0) {
+    std::snprintf(line, sizeof(line), "L\t%" PRIu64 "\t1\t%s stalled %" PRIu64 " cycles; \n", entry.id,
+                  entry.stage, entry.stalled);
+    buffer_ += line;
+  }
+  std::snprintf(line, sizeof(line), "E\t%" PRIu64 "\t%" PRIu32 "\t%s\n", entry.id, entry.lane, entry.stage);
+  buffer_ += line;
+}
+
+void PipelineTraceWriter::Flush() {
+  if (out_.is_open() && !buffer_.empty()) {
+    out_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    out_.flush();
+  }
+  buffer_.clear();
+}
+
+void PipelineTraceWriter::Restart() {
+  if (enabled_) {
+    enabled_ = false;
+    out_.close();
+    Start(path_, *program_, first_cycle_, last_cycle_);
+  }
+}
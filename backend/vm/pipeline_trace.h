@@ -0,0 +1,101 @@
+/**
+ * @file pipeline_trace.h
+ * @brief Contains the Kanata pipeline trace written by the pipelined VMs for the Konata viewer.
+ */
+#ifndef PIPELINE_TRACE_H
+#define PIPELINE_TRACE_H
+
+#include "../vm_asm_mw.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+
+/**
+ * @brief Streams per-instruction stage occupancy in the Kanata 0004 log format.
+ *
+ * The VM reports, once per cycle, every instruction it holds and the stage it
+ * is in; the writer turns changes into Kanata records:
+ *  - `I`/`L` when an instruction is first seen (label: PC, encoding, source line);
+ *  - `S`/`E` when it moves from one stage to the next;
+ *  - `R ... 0` when it leaves the final stage, `R ... 1` when it disappears from
+ *    any other stage (flushed);
+ *  - a mouse-over `L` with the number of cycles it was held in a stalled stage.
+ *
+ * Only cycles inside [first_cycle, last_cycle] are written. Cycles that are not
+ * past the last one written (after Undo) are skipped.
+ */
+class PipelineTraceWriter {
+ public:
+  ~PipelineTraceWriter() { Stop(); }
+
+  /**
+   * @brief Starts a new trace; throws if the file cannot be opened.
+   * @param program Source of the line numbers in the instruction labels; must outlive the trace.
+   */
+  void Start(const std::filesystem::path &filename, const AssembledProgram &program,
+             uint64_t first_cycle = 0, uint64_t last_cycle = UINT64_MAX);
+  /**
+   * @brief Retires or flushes whatever is still in flight, then closes the file.
+   */
+  void Stop();
+  bool IsEnabled() const { return enabled_; }
+  uint64_t Instructions() const { return next_id_; }
+
+  /**
+   * @brief Opens cycle `cycle`; the Stage() calls that follow describe it.
+   */
+  void BeginCycle(uint64_t cycle);
+  /**
+   * @brief Reports that instruction `seq` occupies `stage` of `lane` this cycle.
+   * @param stage Must stay valid for the whole trace (the VMs pass string literals).
+   * @param stalled The stage is holding the instruction back this cycle.
+   * @param final The instruction leaves the pipeline (retires) after this stage.
+   */
+  void Stage(uint64_t seq, uint32_t lane, const char *stage, uint64_t pc, uint32_t instruction,
+             bool stalled = false, bool final = false);
+  /**
+   * @brief Closes the cycle: instructions that were not reported have retired or been flushed.
+   */
+  void EndCycle();
+
+  /**
+   * @brief Writes buffered records to the file (end of a run).
+   */
+  void Flush();
+  /**
+   * @brief Truncates the trace and starts again (VM reset).
+   */
+  void Restart();
+
+ private:
+  struct InFlight {
+    uint64_t id = 0;       // Kanata id, numbered in the order instructions were first seen
+    uint32_t lane = 0;
+    const char *stage = nullptr;
+    bool final = false;
+    bool seen = false;     // reported in the current cycle
+    uint64_t stalled = 0;  // cycles held in the current stage
+  };
+
+  void EndStage(const InFlight &entry);
+
+  std::filesystem::path path_;
+  std::ofstream out_;
+  std::string buffer_;
+  const AssembledProgram *program_ = nullptr;
+  bool enabled_ = false;
+  bool in_window_ = false;   // the current cycle is being written
+  bool started_ = false;     // the absolute cycle (C=) has been written
+  uint64_t first_cycle_ = 0;
+  uint64_t last_cycle_ = UINT64_MAX;
+  uint64_t written_cycle_ = 0;
+  uint64_t next_id_ = 0;
+  uint64_t next_retire_id_ = 0;
+  std::unordered_map<uint64_t, InFlight> in_flight_;  // keyed by the VM's fetch sequence number
+};
+
+#endif // PIPELINE_TRACE_H
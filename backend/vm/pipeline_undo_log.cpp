@@ -0,0 +1,178 @@
+#include "pipeline_undo_log.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+void PipelineUndoLog::SetLatches(const std::vector<LatchView> &latches)
+{
+    latches_ = latches;
+    total_size_ = 0;
+    for (const auto &latch : latches_)
+        total_size_ += latch.size;
+
+    if (total_size_ > 0xFFFF)
+        throw std::invalid_argument("Pipeline latches too large for undo encoding");
+
+    before_.assign(total_size_, 0);
+    after_.assign(total_size_, 0);
+    Clear();
+}
+
+void PipelineUndoLog::AddLatches(const std::vector<LatchView> &latches)
+{
+    std::vector<LatchView> all = latches_;
+    all.insert(all.end(), latches.begin(), latches.end());
+    SetLatches(all);
+}
+
+void PipelineUndoLog::Configure(size_t depth, size_t snapshot_interval)
+{
+    if (depth == 0)
+        depth = 1;
+    ring_.clear();
+    ring_.resize(depth);
+    snapshot_interval_ = snapshot_interval;
+    head_ = 0;
+    count_ = 0;
+    since_snapshot_ = 0;
+}
+
+void PipelineUndoLog::Clear()
+{
+    head_ = 0;
+    count_ = 0;
+    since_snapshot_ = 0;
+}
+
+void PipelineUndoLog::CopyLatchesTo(std::vector<uint8_t> &out) const
+{
+    size_t offset = 0;
+    for (const auto &latch : latches_)
+    {
+        std::memcpy(out.data() + offset, latch.data, latch.size);
+        offset += latch.size;
+    }
+}
+
+void PipelineUndoLog::WriteLatchBytes(size_t offset, const uint8_t *src, size_t length)
+{
+    size_t base = 0;
+    for (const auto &latch : latches_)
+    {
+        if (length == 0)
+            return;
+        size_t end = base + latch.size;
+        if (offset < end)
+        {
+            size_t chunk = std::min(length, end - offset);
+            std::memcpy(static_cast<uint8_t *>(latch.data) + (offset - base), src, chunk);
+            offset += chunk;
+            src += chunk;
+            length -= chunk;
+        }
+        base = end;
+    }
+}
+
+void PipelineUndoLog::BeginCycle()
+{
+    CopyLatchesTo(before_);
+}
+
+PipelineUndoRecord &PipelineUndoLog::CommitCycle()
+{
+    if (ring_.empty())
+        Configure(1, snapshot_interval_);
+
+    PipelineUndoRecord &record = ring_[head_];
+    head_ = (head_ + 1) % ring_.size();
+    count_ = std::min(count_ + 1, ring_.size());
+
+    record.register_changes.clear();
+    record.memory_changes.clear();
+    record.latch_data.clear();
+
+    bool snapshot_due = snapshot_interval_ != 0 && since_snapshot_ + 1 >= snapshot_interval_;
+    if (!snapshot_due)
+    {
+        CopyLatchesTo(after_);
+
+        size_t i = 0;
+        while (i < total_size_)
+        {
+            if (before_[i] == after_[i])
+            {
+                ++i;
+                continue;
+            }
+            size_t start = i;
+            while (i < total_size_ && i - start < 0xFF && before_[i] != after_[i])
+                ++i;
+            size_t length = i - start;
+            record.latch_data.push_back(static_cast<uint8_t>(start & 0xFF));
+            record.latch_data.push_back(static_cast<uint8_t>(start >> 8));
+            record.latch_data.push_back(static_cast<uint8_t>(length));
+            record.latch_data.insert(record.latch_data.end(),
+                                     before_.begin() + start, before_.begin() + i);
+        }
+
+        // A diff that is not smaller than a snapshot is not worth keeping
+        if (record.latch_data.size() >= total_size_)
+            snapshot_due = true;
+    }
+
+    if (snapshot_due)
+    {
+        record.latch_data.assign(before_.begin(), before_.end());
+        record.is_snapshot = true;
+        since_snapshot_ = 0;
+    }
+    else
+    {
+        record.is_snapshot = false;
+        ++since_snapshot_;
+    }
+
+    return record;
+}
+
+const PipelineUndoRecord &PipelineUndoLog::PopCycle()
+{
+    if (count_ == 0)
+        throw std::out_of_range("Pipeline undo log is empty");
+
+    head_ = (head_ + ring_.size() - 1) % ring_.size();
+    --count_;
+    if (since_snapshot_ > 0)
+        --since_snapshot_;
+
+    const PipelineUndoRecord &record = ring_[head_];
+    if (record.is_snapshot)
+    {
+        WriteLatchBytes(0, record.latch_data.data(), record.latch_data.size());
+        return record;
+    }
+
+    size_t pos = 0;
+    while (pos + 3 <= record.latch_data.size())
+    {
+        size_t offset = record.latch_data[pos] | (static_cast<size_t>(record.latch_data[pos + 1]) << 8);
+        size_t length = record.latch_data[pos + 2];
+        pos += 3;
+        WriteLatchBytes(offset, record.latch_data.data() + pos, length);
+        pos += length;
+    }
+    return record;
+}
+
+size_t PipelineUndoLog::LatchBytesStored() const
+{
+    size_t total = 0;
+    for (size_t i = 0; i < count_; ++i)
+    {
+        size_t slot = (head_ + ring_.size() - 1 - i) % ring_.size();
+        total += ring_[slot].latch_data.size();
+    }
+    return total;
+}
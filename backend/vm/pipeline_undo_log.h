@@ -0,0 +1,100 @@
+#ifndef PIPELINE_UNDO_LOG_H
+#define PIPELINE_UNDO_LOG_H
+
+#include "rvss_vm.h"
+#include "cpi_stack.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Undo information for a single pipelined cycle.
+ *
+ * The pipeline latches are stored either as a full snapshot or as a list of
+ * byte runs that changed during the cycle (only the old bytes are kept).
+ */
+struct PipelineUndoRecord
+{
+    uint64_t old_pc = 0;
+    uint64_t old_pc_update_value = 0;
+    uint64_t old_cycle = 0;
+    uint64_t old_instructions_retired = 0;
+    uint64_t old_stall_cycles = 0;
+    uint64_t old_branch_mispredictions = 0;
+    uint64_t old_stall_burst = 0;
+    uint64_t old_stall_burst_samples = 0;
+    bool old_stall = false;
+    bool old_pc_update_pending = false;
+
+    bool is_snapshot = false;
+    std::vector<uint8_t> latch_data; // snapshot bytes, or [offset:2][length:1][old bytes] runs
+
+    std::vector<RegisterChange> register_changes;
+    std::vector<MemoryChange> memory_changes;
+    std::vector<CpiStack::Change> cpi_changes;
+};
+
+/**
+ * @brief Fixed-depth ring buffer of differential pipeline undo records.
+ *
+ * The caller describes its latches once as a list of raw byte views. Before a
+ * cycle BeginCycle() copies them into a scratch area; after the cycle
+ * CommitCycle() stores only the runs that differ (or a full snapshot every
+ * snapshot_interval cycles, or when the diff would be larger than a snapshot).
+ * Record storage is reused when the ring wraps, so steady-state recording does
+ * not allocate for latches.
+ */
+class PipelineUndoLog
+{
+public:
+    struct LatchView
+    {
+        void *data;
+        size_t size;
+    };
+
+    PipelineUndoLog() = default;
+
+    void SetLatches(const std::vector<LatchView> &latches);
+    // Appends to the latches already set, e.g. a derived pipeline's extra lanes
+    void AddLatches(const std::vector<LatchView> &latches);
+    void Configure(size_t depth, size_t snapshot_interval);
+    void Clear();
+
+    bool Empty() const { return count_ == 0; }
+    size_t Size() const { return count_; }
+    size_t Depth() const { return ring_.size(); }
+
+    // Copies the current latch contents; must precede CommitCycle().
+    void BeginCycle();
+
+    // Encodes the latch changes since BeginCycle() into the next ring slot and
+    // returns it so the caller can fill in the remaining fields.
+    PipelineUndoRecord &CommitCycle();
+
+    // Restores the latches from the newest record and returns it. The returned
+    // reference is valid until the next CommitCycle().
+    const PipelineUndoRecord &PopCycle();
+
+    // Bytes held by latch encodings, useful for comparing with full copies.
+    size_t LatchBytesStored() const;
+
+private:
+    void CopyLatchesTo(std::vector<uint8_t> &out) const;
+    void WriteLatchBytes(size_t offset, const uint8_t *src, size_t length);
+
+    std::vector<LatchView> latches_;
+    size_t total_size_ = 0;
+
+    std::vector<PipelineUndoRecord> ring_;
+    size_t head_ = 0;  // next slot to write
+    size_t count_ = 0;
+    size_t snapshot_interval_ = 64;
+    size_t since_snapshot_ = 0;
+
+    std::vector<uint8_t> before_;
+    std::vector<uint8_t> after_;
+};
+
+#endif // PIPELINE_UNDO_LOG_H
@@ -16,13 +16,43 @@ RVSSVM::RVSSVM(RegisterFile *sharedRegisters, QObject *parent)
     : QObject(parent), VmBase()
 {
     registers_ = sharedRegisters;
+    BindIsa();
 }
 RVSSVM::~RVSSVM() = default;
 
+void RVSSVM::BindIsa()
+{
+    process_instruction_ = registers_->GetIsa() == ISA::RV64 ? &RVSSVM::ProcessInstruction<ISA::RV64>
+                                                             : &RVSSVM::ProcessInstruction<ISA::RV32>;
+}
+
+void RVSSVM::SetIsa(ISA isa)
+{
+    registers_->SetIsa(isa);
+    BindIsa();
+}
+
+void RVSSVM::LoadProgram(const AssembledProgram &program)
+{
+    VmBase::LoadProgram(program);
+    BindIsa();
+}
+
+template <ISA kIsa>
+void RVSSVM::ProcessInstruction()
+{
+    Fetch();
+    Decode();
+    Execute<kIsa>();
+    WriteMemory<kIsa>();
+    WriteBack<kIsa>();
+}
+
 void RVSSVM::Fetch()
 {
     instruction_pc_ = program_counter_;
-    current_instruction_ = memory_controller_.ReadWord(program_counter_);
+    // Instruction fetch is not a data access, so it never triggers watchpoints
+    current_instruction_ = memory_controller_.ReadWord_d(program_counter_);
     UpdateProgramCounter(4);
 }
 
@@ -31,6 +61,7 @@ void RVSSVM::Decode()
     control_unit_.SetControlSignals(current_instruction_);
 }
 
+template <ISA kIsa>
 void RVSSVM::Execute()
 {
     uint8_t opcode = current_instruction_ & 0b1111111;
@@ -56,7 +87,7 @@ void RVSSVM::Execute()
     else if (instruction_set::isDInstruction(current_instruction_))
     {
         qDebug() << ">>> DOUBLE INSTRUCTION DETECTED <<<";
-        if (registers_->GetIsa() == ISA::RV64)
+        if constexpr (kIsa == ISA::RV64)
             ExecuteDouble();
         else
             emit vmError("Double-precision not supported in RV32");
@@ -235,6 +266,7 @@ void RVSSVM::HandleSyscall()
     }
 }
 
+template <ISA kIsa>
 void RVSSVM::WriteMemory()
 {
     uint8_t opcode = current_instruction_ & 0b1111111;
@@ -255,7 +287,7 @@ void RVSSVM::WriteMemory()
     else if (instruction_set::isDInstruction(current_instruction_))
     {
         qDebug() << ">>> Calling WriteMemoryDouble()";
-        if (registers_->GetIsa() == ISA::RV64)
+        if constexpr (kIsa == ISA::RV64)
             WriteMemoryDouble();
         else
             emit vmError("Double-precision stores not supported in RV32");
@@ -282,7 +314,7 @@ void RVSSVM::WriteMemory()
             qDebug() << "LW - Value:" << QString::number(memory_result_, 16) << "(" << (int32_t)memory_result_ << ")";
             break;
         case 0b011: // LD - Load Doubleword
-            if (registers_->GetIsa() == ISA::RV64)
+            if constexpr (kIsa == ISA::RV64)
             {
                 memory_result_ = memory_controller_.ReadDoubleWord(execution_result_);
                 qDebug() << "LD - Value:" << QString::number(memory_result_, 16) << "(" << (int64_t)memory_result_ << ")";
@@ -322,12 +354,12 @@ void RVSSVM::WriteMemory()
             switch (funct3)
             {
             case 0b000: // SB
-                mem_change.old_bytes_vec.push_back(memory_controller_.ReadByte(execution_result_));
+                mem_change.old_bytes_vec.push_back(memory_controller_.ReadByte_d(execution_result_));
                 mem_change.new_bytes_vec.push_back(registers_->ReadGpr(rs2) & 0xFF);
                 break;
             case 0b001: // SH
             {
-                uint16_t old_val = memory_controller_.ReadHalfWord(execution_result_);
+                uint16_t old_val = memory_controller_.ReadHalfWord_d(execution_result_);
                 mem_change.old_bytes_vec.push_back(old_val & 0xFF);
                 mem_change.old_bytes_vec.push_back((old_val >> 8) & 0xFF);
                 uint16_t new_val = registers_->ReadGpr(rs2) & 0xFFFF;
@@ -337,7 +369,7 @@ void RVSSVM::WriteMemory()
             }
             case 0b010: // SW
             {
-                uint32_t old_val = memory_controller_.ReadWord(execution_result_);
+                uint32_t old_val = memory_controller_.ReadWord_d(execution_result_);
                 for (int i = 0; i < 4; ++i)
                     mem_change.old_bytes_vec.push_back((old_val >> (i * 8)) & 0xFF);
                 uint32_t new_val = registers_->ReadGpr(rs2) & 0xFFFFFFFF;
@@ -346,9 +378,9 @@ void RVSSVM::WriteMemory()
                 break;
             }
             case 0b011: // SD
-                if (registers_->GetIsa() == ISA::RV64)
+                if constexpr (kIsa == ISA::RV64)
                 {
-                    uint64_t old_val = memory_controller_.ReadDoubleWord(execution_result_);
+                    uint64_t old_val = memory_controller_.ReadDoubleWord_d(execution_result_);
                     for (int i = 0; i < 8; ++i)
                         mem_change.old_bytes_vec.push_back((old_val >> (i * 8)) & 0xFF);
                     uint64_t new_val = registers_->ReadGpr(rs2);
@@ -380,7 +412,7 @@ void RVSSVM::WriteMemory()
             qDebug() << "SW - Wrote word:" << QString::number(registers_->ReadGpr(rs2) & 0xFFFFFFFF, 16);
             break;
         case 0b011: // SD
-            if (registers_->GetIsa() == ISA::RV64)
+            if constexpr (kIsa == ISA::RV64)
             {
                 memory_controller_.WriteDoubleWord(execution_result_, registers_->ReadGpr(rs2));
                 qDebug() << "SD - Wrote doubleword:" << QString::number(registers_->ReadGpr(rs2), 16);
@@ -395,6 +427,7 @@ void RVSSVM::WriteMemory()
     }
 }
 
+template <ISA kIsa>
 void RVSSVM::WriteBack()
 {
     uint8_t opcode = current_instruction_ & 0b1111111;
@@ -415,7 +448,7 @@ void RVSSVM::WriteBack()
     else if (instruction_set::isDInstruction(current_instruction_))
     {
         qDebug() << ">>> Calling WriteBackDouble()";
-        if (registers_->GetIsa() == ISA::RV64)
+        if constexpr (kIsa == ISA::RV64)
             WriteBackDouble();
         else
             emit vmError("Double-precision writeback not supported in RV32");
@@ -614,14 +647,9 @@ void RVSSVM::ExecuteFloat()
     qDebug() << "====================================\n";
 }
 
+// Only the RV64 instantiations get here
 void RVSSVM::ExecuteDouble()
 {
-    if (registers_->GetIsa() != ISA::RV64)
-    {
-        emit vmError("Double-precision not supported in RV32");
-        return;
-    }
-
     uint8_t opcode = current_instruction_ & 0b1111111;
     uint8_t funct3 = (current_instruction_ >> 12) & 0b111;
     uint8_t funct7 = (current_instruction_ >> 25) & 0b1111111;
@@ -786,7 +814,7 @@ void RVSSVM::WriteMemoryFloat()
         {
             MemoryChange mem_change;
             mem_change.address = execution_result_;
-            uint32_t old_val = memory_controller_.ReadWord(execution_result_);
+            uint32_t old_val = memory_controller_.ReadWord_d(execution_result_);
             qDebug() << "Old memory value:" << QString::number(old_val, 16);
 
             float old_f;
@@ -806,14 +834,9 @@ void RVSSVM::WriteMemoryFloat()
     qDebug() << "========================================\n";
 }
 
+// Only the RV64 instantiations get here
 void RVSSVM::WriteMemoryDouble()
 {
-    if (registers_->GetIsa() != ISA::RV64)
-    {
-        emit vmError("Double-precision store/read not supported in RV32");
-        return;
-    }
-
     uint8_t rs2 = (current_instruction_ >> 20) & 0b11111;
 
     qDebug() << "\n========== WriteMemoryDouble() ==========";
@@ -844,7 +867,7 @@ void RVSSVM::WriteMemoryDouble()
         {
             MemoryChange mem_change;
             mem_change.address = execution_result_;
-            uint64_t old_val = memory_controller_.ReadDoubleWord(execution_result_);
+            uint64_t old_val = memory_controller_.ReadDoubleWord_d(execution_result_);
             qDebug() << "Old memory value:" << QString::number(old_val, 16);
 
             double old_d;
@@ -987,13 +1010,9 @@ void RVSSVM::WriteBackFloat()
     qDebug() << "======================================\n";
 }
 
+// Only the RV64 instantiations get here
 void RVSSVM::WriteBackDouble()
 {
-    if (registers_->GetIsa() != ISA::RV64)
-    {
-        return;
-    }
-
     uint8_t opcode = current_instruction_ & 0b1111111;
     uint8_t funct7 = (current_instruction_ >> 25) & 0b1111111;
     uint8_t rd = (current_instruction_ >> 7) & 0b11111;
@@ -1243,20 +1262,54 @@ void RVSSVM::Run()
 {
     qDebug() << "\n***** RUN MODE STARTED *****\n";
     ClearStop();
+    memory_controller_.ClearWatchHit();
+    bool resuming = true;  // don't stop again on the breakpoint we are resuming from
+    const bool profiling = profiler_.IsEnabled();
+    const bool call_graph = call_graph_.IsEnabled();
+    const bool bbv = bbv_.IsEnabled();
+    const bool branch_trace = branch_trace_.IsEnabled();
     while (!stop_requested_ && program_counter_ < program_size_)
     {
-        Fetch();
-        Decode();
-        Execute();
-        WriteMemory();
-        WriteBack();
+        if (!resuming && ShouldBreakAt(program_counter_))
+        {
+            output_status_ = "VM_BREAKPOINT_HIT";
+            emit statusChanged("VM_BREAKPOINT_HIT");
+            break;
+        }
+        resuming = false;
+        uint64_t instruction_pc = program_counter_;
+        ProcessInstruction();
         instructions_retired_++;
         cycle_s_++;
+        stats_.Sample(cycle_s_);
+        instruction_mix_.Record(current_instruction_, program_counter_ != instruction_pc + 4);
+        if (profiling)
+        {
+            profiler_.RecordExecution(instruction_pc);
+            profiler_.RecordCycles(instruction_pc, 1);
+        }
+        if (call_graph)
+        {
+            call_graph_.Retire(instruction_pc, current_instruction_);
+            call_graph_.AddCycles(1);
+        }
+        if (bbv)
+            bbv_.Retire(instruction_pc);
+        if (branch_trace)
+            branch_trace_.Retire(instruction_pc, current_instruction_, program_counter_);
+        if (CheckWatchpointHit())
+        {
+            emit statusChanged("VM_WATCHPOINT_HIT");
+            break;
+        }
     }
     if (program_counter_ >= program_size_)
         emit statusChanged("VM_PROGRAM_END");
 
-    DumpRegisters(globals::registers_dump_file_path, *registers_);
+    if (!headless_)
+        DumpRegisters(globals::registers_dump_file_path, *registers_);
+    WriteProfileReport();
+    WriteStats();
     qDebug() << "\n***** RUN MODE ENDED *****";
     qDebug() << "Instructions:" << instructions_retired_ << "Cycles:" << cycle_s_ << "\n";
 }
@@ -1265,23 +1318,51 @@ void RVSSVM::DebugRun()
 {
     qDebug() << "\n***** DEBUG RUN MODE STARTED *****\n";
     ClearStop();
+    memory_controller_.ClearWatchHit();
+    bool resuming = true;
     while (!stop_requested_ && program_counter_ < program_size_)
     {
+        if (!resuming && ShouldBreakAt(program_counter_))
+        {
+            output_status_ = "VM_BREAKPOINT_HIT";
+            emit statusChanged("VM_BREAKPOINT_HIT");
+            break;
+        }
+        resuming = false;
         current_delta_.old_pc = program_counter_;
-        Fetch();
-        Decode();
-        Execute();
-        WriteMemory();
-        WriteBack();
+        ProcessInstruction();
         instructions_retired_++;
         cycle_s_++;
+        stats_.Sample(cycle_s_);
         current_delta_.new_pc = program_counter_;
+        instruction_mix_.Record(current_instruction_, current_delta_.new_pc != current_delta_.old_pc + 4);
+        if (profiler_.IsEnabled())
+        {
+            profiler_.RecordExecution(current_delta_.old_pc);
+            profiler_.RecordCycles(current_delta_.old_pc, 1);
+        }
+        if (call_graph_.IsEnabled())
+        {
+            call_graph_.Retire(current_delta_.old_pc, current_instruction_);
+            call_graph_.AddCycles(1);
+        }
+        if (bbv_.IsEnabled())
+            bbv_.Retire(current_delta_.old_pc);
+        if (branch_trace_.IsEnabled())
+            branch_trace_.Retire(current_delta_.old_pc, current_instruction_, current_delta_.new_pc);
         undo_stack_.push(current_delta_);
         current_delta_ = StepDelta();
+        if (CheckWatchpointHit())
+        {
+            emit statusChanged("VM_WATCHPOINT_HIT");
+            break;
+        }
     }
     if (program_counter_ >= program_size_)
         emit statusChanged("VM_PROGRAM_END");
 
+    WriteProfileReport();
+    WriteStats();
     qDebug() << "\n***** DEBUG RUN ENDED *****";
     qDebug() << "Instructions:" << instructions_retired_ << "Cycles:" << cycle_s_ << "\n";
 }
@@ -1306,17 +1387,29 @@ void RVSSVM::Step()
 
     recording_enabled_ = true;
 
-    Fetch();
-    Decode();
-    Execute();
-    WriteMemory();
-    WriteBack();
+    ProcessInstruction();
 
     recording_enabled_ = false;
 
     instructions_retired_++;
     cycle_s_++;
+    stats_.Sample(cycle_s_);
     current_delta_.new_pc = program_counter_;
+    instruction_mix_.Record(current_instruction_, current_delta_.new_pc != current_delta_.old_pc + 4);
+    if (profiler_.IsEnabled())
+    {
+        profiler_.RecordExecution(current_delta_.old_pc);
+        profiler_.RecordCycles(current_delta_.old_pc, 1);
+    }
+    if (call_graph_.IsEnabled())
+    {
+        call_graph_.Retire(current_delta_.old_pc, current_instruction_);
+        call_graph_.AddCycles(1);
+    }
+    if (bbv_.IsEnabled())
+        bbv_.Retire(current_delta_.old_pc);
+    if (branch_trace_.IsEnabled())
+        branch_trace_.Retire(current_delta_.old_pc, current_instruction_, current_delta_.new_pc);
 
     qDebug() << "\nStep Summary:";
     qDebug() << "  Old PC:" << QString::number(current_delta_.old_pc, 16);
@@ -1414,15 +1507,29 @@ void RVSSVM::Undo()
         for (size_t i = 0; i < change.old_bytes_vec.size(); ++i)
             memory_controller_.WriteByte(change.address + i, change.old_bytes_vec[i]);
     }
+    memory_controller_.ClearWatchHit();  // restoring memory is not a watched store
 
     program_counter_ = last.old_pc;
     instructions_retired_--;
+    instruction_mix_.Retract(memory_controller_.ReadWord_d(last.old_pc), last.new_pc != last.old_pc + 4);
     cycle_s_--;
 
     qDebug() << "PC restored to:" << QString::number(program_counter_, 16);
     qDebug() << "============\n";
 }
 
+void RVSSVM::RestoreSnapshot(const VmSnapshot &snapshot)
+{
+    VmBase::RestoreSnapshot(snapshot);
+    BindIsa();
+    // Undo history refers to the state before the snapshot was loaded
+    undo_stack_ = std::stack<StepDelta>();
+    redo_stack_ = std::stack<StepDelta>();
+    current_delta_ = StepDelta();
+    instruction_pc_ = program_counter_;
+    DumpRegisters(globals::registers_dump_file_path, *registers_);
+}
+
 void RVSSVM::Reset()
 {
     qDebug() << "\n***** RESET *****";
@@ -1430,7 +1537,10 @@ void RVSSVM::Reset()
     program_counter_ = 0;
     instruction_pc_ = 0;
     instructions_retired_ = 0;
+    instruction_mix_.Clear();
     cycle_s_ = 0;
+    stall_cycles_ = 0;
+    branch_mispredictions_ = 0;
     registers_->Reset();
     memory_controller_.Reset();
     control_unit_.Reset();
@@ -1448,9 +1558,17 @@ void RVSSVM::Reset()
     current_delta_.old_pc = 0;
     current_delta_.new_pc = 0;
     undo_stack_ = std::stack<StepDelta>();
+    profiler_.Clear();
+    call_graph_.Clear();
+    stats_.RestartTimeSeries();
+    bbv_.Restart();
+    branch_trace_.Restart();
 
     DumpRegisters(globals::registers_dump_file_path, *registers_);
 
     qDebug() << "Reset complete";
     qDebug() << "*****************\n";
 }
+
+template void RVSSVM::ProcessInstruction<ISA::RV32>();
+template void RVSSVM::ProcessInstruction<ISA::RV64>();
@@ -64,25 +64,36 @@ public:
 
     void Fetch();
     void Decode();
-    void Execute();
+    // The RV32 instantiations reject D instructions and LD/SD without asking the register file
+    template <ISA kIsa> void Execute();
     void ExecuteFloat();
     void ExecuteDouble();
     void ExecuteCsr();
     void HandleSyscall();
-    void WriteMemory();
+    template <ISA kIsa> void WriteMemory();
     void WriteMemoryFloat();
     void WriteMemoryDouble();
-    void WriteBack();
+    template <ISA kIsa> void WriteBack();
     void WriteBackFloat();
     void WriteBackDouble();
     void WriteBackCsr();
 
+    // Fetch through WriteBack for one instruction, compiled once per ISA width
+    template <ISA kIsa> void ProcessInstruction();
+    // Runs the instantiation BindIsa picked
+    void ProcessInstruction() { (this->*process_instruction_)(); }
+    // Switches the register file to `isa` and the VM to the matching instantiations
+    void SetIsa(ISA isa);
+
+    void LoadProgram(const AssembledProgram &program) override;
+
     void Run() override;
     void DebugRun() override;
     void Step() override;
     void Undo() override;
     // void Redo() override;
     void Reset() override;
+    void RestoreSnapshot(const VmSnapshot &snapshot) override;
     void RequestStop() { stop_requested_ = true; }
     bool IsStopRequested() const { return stop_requested_; }
     void ClearStop() { stop_requested_ = false; }
@@ -101,10 +112,22 @@ public:
     virtual void SetPipelineConfig(bool hazardEnabled,
                                    bool forwardingEnabled,
                                    bool branchPredictionEnabled,
-                                   bool dynamicPredictionEnabled) {return;}
+                                   bool dynamicPredictionEnabled,
+                                   bool fusionEnabled = false) {
+        (void)hazardEnabled; (void)forwardingEnabled; (void)branchPredictionEnabled;
+        (void)dynamicPredictionEnabled; (void)fusionEnabled;
+    }
 
     void DumpPipelineState() {return ;}
 
+protected:
+    // Points the per-ISA entry points at the register file's current ISA; called on
+    // construction, load, snapshot restore and SetIsa rather than once per instruction
+    virtual void BindIsa();
+
+private:
+    void (RVSSVM::*process_instruction_)() = nullptr;
+
 signals:
     void gprUpdated(int index, quint64 value);
     void csrUpdated(int index, quint64 value);
@@ -0,0 +1,432 @@
+#include "rvss_vm_dual_issue.h"
+#include "../config.h"
+#include <QDebug>
+#include <utility>
+
+namespace
+{
+bool IsMemoryOp(uint32_t opcode)
+{
+    return opcode == 0b0000011 || opcode == 0b0100011 ||  // load, store
+           opcode == 0b0000111 || opcode == 0b0100111 ||  // FP load, FP store
+           opcode == 0b0101111;                           // AMO
+}
+
+bool IsControlTransfer(uint32_t opcode)
+{
+    return opcode == 0b1100011 || opcode == 0b1101111 || opcode == 0b1100111;
+}
+
+bool IsSerializing(uint32_t opcode)
+{
+    return opcode == 0b1110011 || opcode == 0b0001111 || opcode == 0b0101111;  // SYSTEM, FENCE, AMO
+}
+
+bool WritesRd(uint32_t opcode)
+{
+    return opcode != 0b1100011 && opcode != 0b0100011 && opcode != 0b0100111 && opcode != 0b0001111;
+}
+} // namespace
+
+RVSSVMDualIssue::RVSSVMDualIssue(RegisterFile *sharedRegisters, QObject *parent)
+    : RVSSVMPipelined(sharedRegisters, parent)
+{
+    // The base latches include the decoupled frontend, which ClockStages runs here too
+    pipeline_undo_log_.AddLatches({{&lane_.if_id, sizeof(lane_.if_id)},
+                                   {&lane_.id_ex, sizeof(lane_.id_ex)},
+                                   {&lane_.ex_mem, sizeof(lane_.ex_mem)},
+                                   {&lane_.mem_wb, sizeof(lane_.mem_wb)}});
+
+    stats_.AddScalar("issue.dual_cycles", &dual_issue_cycles_, "Cycles ID issued two instructions");
+    stats_.AddScalar("issue.single_cycles", &single_issue_cycles_, "Cycles ID issued one instruction");
+    stats_.AddScalar("issue.split_memory", &split_memory_, "Pairs split by the memory-op limit");
+    stats_.AddScalar("issue.split_branch", &split_branch_, "Pairs split by the branch limit");
+    stats_.AddScalar("issue.split_serial", &split_serial_, "Pairs split by an instruction that issues alone");
+    stats_.AddScalar("issue.split_dependence", &split_dependence_,
+                     "Pairs split because the younger one reads the older one's result");
+    stats_.AddScalar("issue.split_hazard", &split_hazard_, "Pairs split by a scoreboard hazard on the younger one");
+    stats_.AddRatio("issue.dual_rate", "issue.dual_cycles", "cycles", 1.0, "Fraction of cycles issuing two instructions");
+
+    ConfigureIssue();
+}
+
+RVSSVMDualIssue::~RVSSVMDualIssue() = default;
+
+void RVSSVMDualIssue::ConfigureIssue()
+{
+    issue_width_ = vm_config::config.getIssueWidth();
+    memory_ops_per_cycle_ = vm_config::config.getMemoryOpsPerCycle();
+    branches_per_cycle_ = vm_config::config.getBranchesPerCycle();
+
+    // The paired lanes are only modelled for the five-stage pipeline; [PipelineDepth] is ignored
+    fetch_stages_ = execute_stages_ = memory_stages_ = 1;
+    pipes_ = StagePipes();
+    pending_redirect_ = PendingRedirect();
+    redirect_penalty_ = 2;
+    load_use_distance_ = 1;
+}
+
+void RVSSVMDualIssue::SetPipelineConfig(bool hazardEnabled,
+                                        bool forwardingEnabled,
+                                        bool branchPredictionEnabled,
+                                        bool dynamicPredictionEnabled,
+                                        bool fusionEnabled)
+{
+    // Fusion is only modelled in the scalar pipeline: the lanes would each need a fused entry's
+    // second destination in pairing and forwarding
+    (void)fusionEnabled;
+    RVSSVMPipelined::SetPipelineConfig(hazardEnabled, forwardingEnabled, branchPredictionEnabled,
+                                       dynamicPredictionEnabled, false);
+    ConfigureIssue();
+}
+
+double RVSSVMDualIssue::DualIssueRate() const
+{
+    return cycle_s_ ? static_cast<double>(dual_issue_cycles_)/cycle_s_ : 0.0;
+}
+
+void RVSSVMDualIssue::Reset()
+{
+    lane_ = Lane();
+    lanes_swapped_ = false;
+    lane1_held_ = false;
+    dual_issue_cycles_ = 0;
+    single_issue_cycles_ = 0;
+    split_memory_ = 0;
+    split_branch_ = 0;
+    split_serial_ = 0;
+    split_dependence_ = 0;
+    split_hazard_ = 0;
+    ConfigureIssue();
+    RVSSVMPipelined::Reset();
+}
+
+void RVSSVMDualIssue::SquashInFlight()
+{
+    lane_ = Lane();
+    lane1_held_ = false;
+    RVSSVMPipelined::SquashInFlight();
+}
+
+bool RVSSVMDualIssue::IsPipelineEmpty() const
+{
+    return RVSSVMPipelined::IsPipelineEmpty() &&
+           !(lane_.if_id.valid || lane_.id_ex.valid || lane_.ex_mem.valid || lane_.mem_wb.valid);
+}
+
+void RVSSVMDualIssue::SwapLanes()
+{
+    std::swap(if_id_, lane_.if_id);
+    std::swap(if_id_next_, lane_.if_id_next);
+    std::swap(id_ex_, lane_.id_ex);
+    std::swap(id_ex_next_, lane_.id_ex_next);
+    std::swap(ex_mem_, lane_.ex_mem);
+    std::swap(ex_mem_next_, lane_.ex_mem_next);
+    std::swap(mem_wb_, lane_.mem_wb);
+    std::swap(mem_wb_next_, lane_.mem_wb_next);
+    lanes_swapped_ = !lanes_swapped_;
+}
+
+void RVSSVMDualIssue::ClockStages()
+{
+    // Lane 0 holds the older instruction, so it writes back first and lane 1 wins a shared rd
+    stopped_at_breakpoint_ = false;
+    WB_stage();
+    if (stopped_at_breakpoint_)
+        return;
+    SwapLanes();
+    WB_stage();
+    SwapLanes();
+    if (stopped_at_breakpoint_)
+        return;
+
+    // Memory is accessed in program order; nothing younger than an alignment fault touches it
+    MEM_stage();
+    if (!ex_mem_.valid || mem_wb_next_.valid)
+    {
+        SwapLanes();
+        MEM_stage();
+        SwapLanes();
+    }
+
+    // A redirect from lane 0 means its partner was fetched down the wrong path
+    EX_stage();
+    if (!flush_pipeline_)
+    {
+        SwapLanes();
+        EX_stage();
+        SwapLanes();
+    }
+    else if (lane_.id_ex.valid && issue_width_ > 1)
+    {
+        cpi_stack_.Squash(StallCause::kControl, control_pc_);
+    }
+
+    IssueStage();
+    ClockFrontend();
+    FetchStage();
+}
+
+RVSSVMDualIssue::SplitReason RVSSVMDualIssue::PairingConflict(uint32_t older, uint32_t younger) const
+{
+    uint32_t older_opcode = older & 0x7F;
+    uint32_t younger_opcode = younger & 0x7F;
+
+    if (IsSerializing(older_opcode) || IsSerializing(younger_opcode))
+        return SplitReason::SERIAL;
+    if (static_cast<uint64_t>(IsMemoryOp(older_opcode) + IsMemoryOp(younger_opcode)) > memory_ops_per_cycle_)
+        return SplitReason::MEMORY;
+    if (static_cast<uint64_t>(IsControlTransfer(older_opcode) + IsControlTransfer(younger_opcode)) > branches_per_cycle_)
+        return SplitReason::BRANCH;
+
+    // Both are in EX in the same cycle, so the older result can't be forwarded to its partner.
+    // Registers are compared by index only; a GPR/FPR clash splits the pair conservatively
+    RegisterUsage older_usage = DecodeRegisterUsage(older);
+    uint8_t rd = (older >> 7) & 0x1F;
+    if (WritesRd(older_opcode) && (rd != 0 || older_usage.rd_is_float))
+    {
+        RegisterUsage usage = DecodeRegisterUsage(younger);
+        if ((usage.reads_rs1 && ((younger >> 15) & 0x1F) == rd) ||
+            (usage.reads_rs2 && ((younger >> 20) & 0x1F) == rd) ||
+            (usage.reads_rs3 && ((younger >> 27) & 0x1F) == rd))
+            return SplitReason::DEPENDENCE;
+    }
+    return SplitReason::NONE;
+}
+
+void RVSSVMDualIssue::IssueStage()
+{
+    ID_stage();
+
+    // Lane 1's slot is charged here unless its own ID_stage runs
+    auto lose_lane1 = [this](StallCause cause, uint64_t pc)
+    {
+        if (issue_width_ > 1)
+            cpi_stack_.Charge(cause, pc);
+    };
+
+    // Lane 1 only issues alongside lane 0; a stalled or squashed lane 0 holds both
+    if (!id_ex_next_.valid)
+    {
+        lose_lane1(id_cause_, id_cause_pc_);
+        return;
+    }
+    if (!lane_.if_id.valid)
+    {
+        ++single_issue_cycles_;
+        lose_lane1(lane_.if_id.bubble_cause, lane_.if_id.bubble_pc);
+        return;
+    }
+
+    SplitReason split = PairingConflict(if_id_.instruction, lane_.if_id.instruction);
+    if (split == SplitReason::NONE)
+    {
+        // Lane 0 has already booked its unit and destination, so the scoreboard sees the pair
+        SwapLanes();
+        ID_stage();
+        bool lane1_stalled = stall_;
+        stall_ = false;
+        SwapLanes();
+        if (lane1_stalled)
+            split = SplitReason::HAZARD;
+    }
+
+    switch (split)
+    {
+    case SplitReason::NONE:
+        ++dual_issue_cycles_;
+        return;
+    case SplitReason::MEMORY:
+        ++split_memory_;
+        lose_lane1(StallCause::kStructural, if_id_.pc);
+        break;
+    case SplitReason::BRANCH:
+        ++split_branch_;
+        lose_lane1(StallCause::kStructural, if_id_.pc);
+        break;
+    case SplitReason::SERIAL:
+        ++split_serial_;
+        lose_lane1(StallCause::kSerialize,
+                   IsSerializing(if_id_.instruction & 0x7F) ? if_id_.pc : lane_.if_id.pc);
+        break;
+    case SplitReason::DEPENDENCE:
+        // Both would be in EX together, so the result can't be forwarded
+        ++split_dependence_;
+        lose_lane1(StallCause::kRawNoForwarding, if_id_.pc);
+        break;
+    case SplitReason::HAZARD:
+        ++split_hazard_;  // lane 1's ID_stage charged the slot
+        break;
+    }
+    STAGE_LOG << "ID: lane 1 held back, reason:" << static_cast<int>(split);
+    ++single_issue_cycles_;
+    lane1_held_ = true;
+}
+
+void RVSSVMDualIssue::FetchStage()
+{
+    // Redirects, flushes and lane-0 stalls work as in the scalar pipeline; a stall holds both slots
+    if (pc_update_pending_ || flush_pipeline_ || stall_)
+    {
+        IF_stage();
+        if (stall_)
+            lane_.if_id_next = lane_.if_id;
+        return;
+    }
+
+    // A held instruction becomes the older one of the next pair; fetch one to go behind it
+    if (lane1_held_)
+        if_id_next_ = lane_.if_id;
+    else
+        IF_stage();
+
+    // A fetch group ends at a predicted-taken transfer
+    bool fetch_second = issue_width_ > 1 && if_id_next_.valid && (lane1_held_ || !if_id_next_.predicted_taken);
+    if (fetch_second)
+    {
+        SwapLanes();
+        IF_stage();
+        SwapLanes();
+    }
+    else if (if_id_next_.valid)
+    {
+        lane_.if_id_next.bubble_cause = StallCause::kControl;
+        lane_.if_id_next.bubble_pc = if_id_next_.pc;
+    }
+}
+
+uint64_t RVSSVMDualIssue::ForwardOperand(uint8_t reg, bool is_float, uint64_t value) const
+{
+    // While lane 1 runs the base latches are lane 1's; either way the pair in each stage is
+    // checked youngest first. The forwarding unit's two inputs are the two lanes of one stage
+    const EX_MEM &ex_older = lanes_swapped_ ? lane_.ex_mem : ex_mem_;
+    const EX_MEM &ex_younger = lanes_swapped_ ? ex_mem_ : lane_.ex_mem;
+    const MEM_WB &wb_older = lanes_swapped_ ? lane_.mem_wb : mem_wb_;
+    const MEM_WB &wb_younger = lanes_swapped_ ? mem_wb_ : lane_.mem_wb;
+
+    auto source = forwarding_unit_.GetRs1Source(ex_younger.valid && ex_younger.reg_write, ex_younger.rd,
+                                                ex_older.valid && ex_older.reg_write, ex_older.rd,
+                                                reg, is_float, ex_younger.is_float, ex_older.is_float);
+    if (source == ForwardingUnit::ForwardingSource::FROM_EX_MEM)
+        return ex_younger.alu_result;
+    if (source == ForwardingUnit::ForwardingSource::FROM_MEM_WB)
+        return ex_older.alu_result;
+
+    source = forwarding_unit_.GetRs1Source(wb_younger.valid && wb_younger.reg_write, wb_younger.rd,
+                                           wb_older.valid && wb_older.reg_write, wb_older.rd,
+                                           reg, is_float, wb_younger.is_float, wb_older.is_float);
+    if (source == ForwardingUnit::ForwardingSource::FROM_EX_MEM)
+        return wb_younger.mem_to_reg ? wb_younger.mem_data : wb_younger.alu_result;
+    if (source == ForwardingUnit::ForwardingSource::FROM_MEM_WB)
+        return wb_older.mem_to_reg ? wb_older.mem_data : wb_older.alu_result;
+    return value;
+}
+
+void RVSSVMDualIssue::ProfileCycle()
+{
+    // The base charges the cycle and retires lane 0; lane 1 retires right after it
+    RVSSVMPipelined::ProfileCycle();
+    if (!lane_.mem_wb.valid)
+        return;
+    if (call_graph_.IsEnabled())
+        call_graph_.Retire(lane_.mem_wb.pc, lane_.mem_wb.instruction);
+    if (branch_trace_.IsEnabled())
+        branch_trace_.Retire(lane_.mem_wb.pc, lane_.mem_wb.instruction,
+                             lane_.mem_wb.branch_taken ? lane_.mem_wb.branch_target : lane_.mem_wb.pc + 4);
+    if (profiler_.IsEnabled())
+        profiler_.RecordExecution(lane_.mem_wb.pc);
+}
+
+void RVSSVMDualIssue::TraceCycle()
+{
+    // Lane 1 is drawn in Konata's second lane; a held instruction moves to lane 0 next cycle
+    pipeline_trace_.BeginCycle(cycle_s_);
+    TraceLatches(0, traced_fetch_seq_);
+    SwapLanes();
+    TraceLatches(1, traced_fetch_seq_);
+    SwapLanes();
+    pipeline_trace_.EndCycle();
+    traced_fetch_seq_ = fetch_seq_;
+}
+
+void RVSSVMDualIssue::advance_pipeline_registers()
+{
+    lane_.mem_wb = lane_.mem_wb_next;
+    lane_.ex_mem = lane_.ex_mem_next;
+    lane_.id_ex = lane_.id_ex_next;
+    lane_.if_id = lane_.if_id_next;
+
+    lane_.mem_wb_next = MEM_WB();
+    lane_.ex_mem_next = EX_MEM();
+    lane_.id_ex_next = ID_EX();
+    lane_.if_id_next = IF_ID();
+    lane1_held_ = false;
+
+    RVSSVMPipelined::advance_pipeline_registers();
+}
+
+void RVSSVMDualIssue::CaptureStages(StageSnapshot &stages) const
+{
+    RVSSVMPipelined::CaptureStages(stages);
+
+    if (lane_.mem_wb.valid)
+        stages.Set(PipelineStage::kLaneWB, lane_.mem_wb.pc);
+    if (lane_.ex_mem.valid)
+        stages.Set(PipelineStage::kLaneMEM, lane_.ex_mem.pc);
+    if (lane_.id_ex.valid)
+        stages.Set(PipelineStage::kLaneEX, lane_.id_ex.pc);
+    if (lane_.if_id.valid)
+        stages.Set(PipelineStage::kLaneID, lane_.if_id.pc);
+}
+
+void RVSSVMDualIssue::Undo()
+{
+    uint64_t retired = instructions_retired_;
+    RVSSVMPipelined::Undo();
+    // The base retracts lane 0's instruction from the mix; lane 1 retired in the same cycle
+    if (retired - instructions_retired_ > 1 && lane_.mem_wb.valid)
+        instruction_mix_.Retract(lane_.mem_wb.instruction, lane_.mem_wb.branch_taken);
+    lane_.if_id_next = IF_ID();
+    lane_.id_ex_next = ID_EX();
+    lane_.ex_mem_next = EX_MEM();
+    lane_.mem_wb_next = MEM_WB();
+}
+
+void RVSSVMDualIssue::SaveSnapshot(VmSnapshot &snapshot)
+{
+    RVSSVMPipelined::SaveSnapshot(snapshot);
+
+    VmSnapshot::Writer lanes = snapshot.Add(VmSnapshot::Section::kIssueLanes);
+    lanes.PutSized(lane_.if_id);
+    lanes.PutSized(lane_.id_ex);
+    lanes.PutSized(lane_.ex_mem);
+    lanes.PutSized(lane_.mem_wb);
+    lanes.Put(dual_issue_cycles_);
+    lanes.Put(single_issue_cycles_);
+}
+
+void RVSSVMDualIssue::RestoreSnapshot(const VmSnapshot &snapshot)
+{
+    // A snapshot of the scalar pipeline resumes with an empty second lane
+    Lane restored;
+    uint64_t dual = 0;
+    uint64_t single = 0;
+    if (snapshot.Has(VmSnapshot::Section::kIssueLanes))
+    {
+        VmSnapshot::Reader lanes = snapshot.Read(VmSnapshot::Section::kIssueLanes);
+        lanes.GetSized(restored.if_id);
+        lanes.GetSized(restored.id_ex);
+        lanes.GetSized(restored.ex_mem);
+        lanes.GetSized(restored.mem_wb);
+        dual = lanes.Get<uint64_t>();
+        single = lanes.Get<uint64_t>();
+    }
+
+    RVSSVMPipelined::RestoreSnapshot(snapshot);
+    lane_ = restored;
+    lanes_swapped_ = false;
+    lane1_held_ = false;
+    dual_issue_cycles_ = dual;
+    single_issue_cycles_ = single;
+    PublishStages();
+}
@@ -0,0 +1,89 @@
+
+#ifndef RVSS_VM_DUAL_ISSUE_H
+#define RVSS_VM_DUAL_ISSUE_H
+
+#include "rvss_vm_pipelined.h"
+
+#include <cstdint>
+
+// In-order superscalar variant of the five-stage pipeline: IF fetches, ID decodes and issues
+// up to two instructions per cycle, and each stage holds a pair. Lane 0 always carries the
+// older instruction; lane 1 reuses the scalar stage functions by swapping its latches in.
+class RVSSVMDualIssue : public RVSSVMPipelined
+{
+    Q_OBJECT
+
+public:
+    explicit RVSSVMDualIssue(RegisterFile *sharedRegisters, QObject *parent = nullptr);
+    ~RVSSVMDualIssue() override;
+
+    bool IsPipelineEmpty() const override;
+    void Undo() override;
+    void Reset() override;
+    void SaveSnapshot(VmSnapshot &snapshot) override;
+    void RestoreSnapshot(const VmSnapshot &snapshot) override;
+    void SetPipelineConfig(bool hazardEnabled,
+                           bool forwardingEnabled,
+                           bool branchPredictionEnabled,
+                           bool dynamicPredictionEnabled,
+                           bool fusionEnabled = false) override;
+
+    // Fraction of cycles in which ID issued two instructions
+    double DualIssueRate() const;
+    // Loads issue_width and the pairing limits from vm_config
+    void ConfigureIssue();
+
+protected:
+    // Why the younger instruction of a decoded pair was held back for a cycle
+    enum class SplitReason
+    {
+        NONE,
+        MEMORY,     // more memory operations than memory_ops_per_cycle
+        BRANCH,     // more control transfers than branches_per_cycle
+        SERIAL,     // system, CSR, fence or atomic instructions issue alone
+        DEPENDENCE, // the younger one reads the older one's result
+        HAZARD      // the scoreboard held it (busy unit, multi-cycle source)
+    };
+
+    struct Lane
+    {
+        IF_ID if_id, if_id_next;
+        ID_EX id_ex, id_ex_next;
+        EX_MEM ex_mem, ex_mem_next;
+        MEM_WB mem_wb, mem_wb_next;
+    } lane_;
+
+    // Exchanges lane 1's latches with the scalar ones so the base stage functions act on lane 1
+    void SwapLanes();
+    bool lanes_swapped_ = false;
+
+    void ClockStages() override;
+    void SquashInFlight() override;
+    uint64_t ForwardOperand(uint8_t reg, bool is_float, uint64_t value) const override;
+    void ProfileCycle() override;
+    void TraceCycle() override;
+    void CaptureStages(StageSnapshot &stages) const override;
+    void advance_pipeline_registers() override;
+    size_t IssueLanes() const override { return 2; }
+    uint64_t IssueWidth() const override { return issue_width_; }
+
+    void IssueStage();
+    void FetchStage();
+    SplitReason PairingConflict(uint32_t older, uint32_t younger) const;
+
+    uint64_t issue_width_ = 2;
+    uint64_t memory_ops_per_cycle_ = 1;
+    uint64_t branches_per_cycle_ = 1;
+    // Lane 1 decoded but did not issue this cycle; it becomes the older instruction next cycle
+    bool lane1_held_ = false;
+
+    uint64_t dual_issue_cycles_ = 0;
+    uint64_t single_issue_cycles_ = 0;
+    uint64_t split_memory_ = 0;
+    uint64_t split_branch_ = 0;
+    uint64_t split_serial_ = 0;
+    uint64_t split_dependence_ = 0;
+    uint64_t split_hazard_ = 0;
+};
+
+#endif // RVSS_VM_DUAL_ISSUE_H
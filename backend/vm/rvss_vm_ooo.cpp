@@ -0,0 +1,566 @@
+#include "rvss_vm_ooo.h"
+#include "../config.h"
+#include "../globals.h"
+#include "../utils.h"
+#include <QDebug>
+#include <algorithm>
+
+namespace
+{
+bool WritesRd(uint32_t opcode)
+{
+    return opcode != 0b1100011 && opcode != 0b0100011 && opcode != 0b0100111 && opcode != 0b0001111;
+}
+
+// Occupancy histograms get 16 buckets plus one for a full structure
+StatsHistogram OccupancyHistogram(uint64_t capacity)
+{
+    return StatsHistogram(std::max<uint64_t>(1, (capacity + 15)/16), 17);
+}
+} // namespace
+
+RVSSVMOutOfOrder::RVSSVMOutOfOrder(RegisterFile *sharedRegisters, QObject *parent)
+    : RVSSVM(sharedRegisters, parent)
+{
+    stats_.AddScalar("ooo.store_forwards", &store_forwards_, "Loads that took their data from an older store");
+    stats_.AddScalar("ooo.rob_full_stalls", &rob_full_stalls_, "Cycles dispatch waited for a ROB entry");
+    stats_.AddScalar("ooo.iq_full_stalls", &iq_full_stalls_, "Cycles dispatch waited for an issue queue entry");
+    stats_.AddScalar("ooo.lsq_full_stalls", &lsq_full_stalls_, "Cycles dispatch waited for a load/store queue entry");
+    stats_.AddScalar("ooo.serialize_stalls", &serialize_stalls_,
+                     "Cycles dispatch waited around a serializing instruction");
+    stats_.AddScalar("ooo.fetch_redirect_cycles", &fetch_redirect_stalls_,
+                     "Cycles fetch waited for a mispredicted instruction to execute");
+    stats_.AddHistogram("ooo.rob_occupancy", &rob_occupancy_, "ROB entries in use per cycle");
+    stats_.AddHistogram("ooo.fetch_queue_occupancy", &fetch_queue_occupancy_, "Fetch queue entries in use per cycle");
+    stats_.AddHistogram("ooo.int_queue_occupancy", &int_queue_occupancy_, "Integer issue queue entries in use per cycle");
+    stats_.AddHistogram("ooo.fp_queue_occupancy", &fp_queue_occupancy_, "FP issue queue entries in use per cycle");
+    stats_.AddHistogram("ooo.lsq_occupancy", &lsq_occupancy_, "Load/store queue entries in use per cycle");
+    stats_.AddHistogram("ooo.issued_per_cycle", &issued_per_cycle_, "Instructions issued per cycle");
+    stats_.AddHistogram("ooo.committed_per_cycle", &committed_per_cycle_, "Instructions committed per cycle");
+
+    ConfigureWindow();
+}
+
+RVSSVMOutOfOrder::~RVSSVMOutOfOrder() = default;
+
+void RVSSVMOutOfOrder::ConfigureWindow()
+{
+    const vm_config::VmConfig &config = vm_config::config;
+    width_ = config.getOutOfOrderWidth();
+    rob_size_ = config.getRobSize();
+    fetch_queue_size_ = config.getFetchQueueSize();
+    int_queue_size_ = config.getIntQueueSize();
+    fp_queue_size_ = config.getFpQueueSize();
+    lsq_size_ = config.getLsqSize();
+
+    for (size_t unit = 0; unit < kFunctionalUnitCount; ++unit)
+    {
+        const vm_config::FunctionalUnitConfig *timing =
+            config.getFunctionalUnitConfig(FunctionalUnitName(static_cast<FunctionalUnit>(unit)));
+        functional_unit_timing_[unit] = {timing->latency, timing->interval, timing->count};
+    }
+
+    // Build first so a bad configuration leaves the current predictor in place
+    std::unique_ptr<BranchPredictor> predictor = MakeBranchPredictor(config.getBranchPredictorType(),
+                                                                     config.getBranchPredictorTableSize(),
+                                                                     config.getBranchHistoryLength());
+    IndirectTargetPredictor indirect(config.getIndirectPredictorSize(),
+                                     static_cast<unsigned>(config.getIndirectHistoryLength()));
+    branch_predictor_ = std::move(predictor);
+    indirect_predictor_ = std::move(indirect);
+    return_stack_ = ReturnAddressStack(config.getRasDepth());
+
+    rob_occupancy_ = OccupancyHistogram(rob_size_);
+    fetch_queue_occupancy_ = OccupancyHistogram(fetch_queue_size_);
+    int_queue_occupancy_ = OccupancyHistogram(int_queue_size_);
+    fp_queue_occupancy_ = OccupancyHistogram(fp_queue_size_);
+    lsq_occupancy_ = OccupancyHistogram(lsq_size_);
+    issued_per_cycle_ = StatsHistogram(1, width_ + 1);
+    committed_per_cycle_ = StatsHistogram(1, width_ + 1);
+
+    qDebug() << "Out-of-order window: width" << width_ << "ROB" << rob_size_ << "IQ" << int_queue_size_
+             << "+" << fp_queue_size_ << "LSQ" << lsq_size_;
+}
+
+void RVSSVMOutOfOrder::SetPipelineConfig(bool hazardEnabled,
+                                         bool forwardingEnabled,
+                                         bool branchPredictionEnabled,
+                                         bool dynamicPredictionEnabled,
+                                         bool fusionEnabled)
+{
+    // Renaming removes the hazards and results are always bypassed, so only prediction is configurable;
+    // fusion is only modelled in the in-order pipeline
+    (void)hazardEnabled;
+    (void)forwardingEnabled;
+    (void)fusionEnabled;
+    branch_prediction_enabled_ = branchPredictionEnabled;
+    dynamic_branch_prediction_enabled_ = dynamicPredictionEnabled;
+    ConfigureWindow();
+}
+
+void RVSSVMOutOfOrder::ClearWindow()
+{
+    fetch_queue_.clear();
+    rob_.clear();
+    std::fill(&rename_table_[0][0], &rename_table_[0][0] + 2*32, 0);
+    next_seq_ = 1;
+    int_queue_count_ = 0;
+    fp_queue_count_ = 0;
+    lsq_count_ = 0;
+    fetch_wait_seq_ = 0;
+    fetch_resume_cycle_ = 0;
+    fetch_halted_ = false;
+    scoreboard_.Clear();
+    step_cycles_ = std::stack<uint64_t>();
+}
+
+void RVSSVMOutOfOrder::Reset()
+{
+    ClearWindow();
+    store_forwards_ = 0;
+    rob_full_stalls_ = 0;
+    iq_full_stalls_ = 0;
+    lsq_full_stalls_ = 0;
+    serialize_stalls_ = 0;
+    fetch_redirect_stalls_ = 0;
+    ConfigureWindow();
+    RVSSVM::Reset();
+}
+
+bool RVSSVMOutOfOrder::IsPipelineEmpty() const
+{
+    return rob_.empty() && fetch_queue_.empty();
+}
+
+uint64_t RVSSVMOutOfOrder::ValueReadyCycle(uint64_t seq) const
+{
+    if (seq == 0 || rob_.empty() || seq < rob_.front().seq)
+        return 0;  // in the register file
+    return rob_[seq - rob_.front().seq].complete_cycle;
+}
+
+bool RVSSVMOutOfOrder::Predicted(const WindowEntry &entry)
+{
+    const uint32_t opcode = entry.instruction & 0x7F;
+    const bool taken = entry.next_pc != entry.pc + 4;
+    if (opcode != 0b1100011 && opcode != 0b1101111 && opcode != 0b1100111)
+        return true;
+    if (!branch_prediction_enabled_)
+        return !taken;  // fetch just falls through
+
+    bool correct = true;
+    switch (opcode)
+    {
+    case 0b1100011:
+    {
+        bool predict_taken;
+        if (dynamic_branch_prediction_enabled_)
+        {
+            predict_taken = branch_predictor_->Predict(entry.pc);
+            branch_predictor_->Update(entry.pc, taken);
+        }
+        else
+        {
+            predict_taken = (entry.instruction >> 31) != 0;  // backward taken, forward not taken
+        }
+        correct = predict_taken == taken;
+        break;
+    }
+    case 0b1101111:
+        // Direct target: decode supplies it in the same cycle
+        break;
+    case 0b1100111:
+    {
+        ReturnAddressStack::Action action = ReturnAddressStack::ActionFor(entry.instruction);
+        uint64_t target = 0;
+        if (action.pop)
+            correct = !return_stack_.Empty() && return_stack_.Top() == entry.next_pc;
+        else
+            correct = indirect_predictor_.Predict(entry.pc, target) && target == entry.next_pc;
+        if (!action.pop)
+            indirect_predictor_.Update(entry.pc, entry.next_pc);
+        break;
+    }
+    }
+    if (opcode != 0b1100011)
+        return_stack_.Apply(ReturnAddressStack::ActionFor(entry.instruction), entry.pc + 4);
+    if (taken)
+        indirect_predictor_.RecordPath(entry.next_pc);
+    return correct;
+}
+
+void RVSSVMOutOfOrder::FetchStage(uint64_t limit)
+{
+    if (fetch_halted_)
+        return;
+    if (fetch_wait_seq_ != 0 || cycle_s_ < fetch_resume_cycle_)
+    {
+        ++fetch_redirect_stalls_;
+        return;
+    }
+
+    for (uint64_t fetched = 0; fetched < std::min(limit, width_) && fetch_queue_.size() < fetch_queue_size_; ++fetched)
+    {
+        if (stop_requested_ || program_counter_ >= program_size_)
+            return;
+        if (!resuming_ && ShouldBreakAt(program_counter_))
+        {
+            output_status_ = "VM_BREAKPOINT_HIT";
+            emit statusChanged("VM_BREAKPOINT_HIT");
+            fetch_halted_ = true;
+            return;
+        }
+        resuming_ = false;
+
+        WindowEntry entry;
+        entry.seq = next_seq_++;
+        entry.pc = program_counter_;
+        entry.fetch_cycle = cycle_s_;
+
+        ProcessInstruction();
+
+        const uint32_t instruction = current_instruction_;
+        const uint32_t opcode = instruction & 0x7F;
+        const uint8_t funct3 = (instruction >> 12) & 0x7;
+        const RegisterUsage usage = DecodeRegisterUsage(instruction);
+        entry.instruction = instruction;
+        entry.next_pc = program_counter_;
+        entry.unit = FunctionalUnitFor(control_unit_.GetAluSignal(instruction, control_unit_.GetAluOp()));
+        entry.rd = (instruction >> 7) & 0x1F;
+        entry.rd_is_float = usage.rd_is_float;
+        entry.writes_rd = WritesRd(opcode) && (entry.rd != 0 || entry.rd_is_float);
+
+        const uint8_t sources[3] = {static_cast<uint8_t>((instruction >> 15) & 0x1F),
+                                    static_cast<uint8_t>((instruction >> 20) & 0x1F),
+                                    static_cast<uint8_t>((instruction >> 27) & 0x1F)};
+        const bool reads[3] = {usage.reads_rs1, usage.reads_rs2, usage.reads_rs3};
+        const bool is_float[3] = {usage.rs1_is_float, usage.rs2_is_float, true};
+        for (int i = 0; i < 3; ++i)
+        {
+            // src[] holds register numbers until dispatch renames them; x0 never has a producer
+            entry.src[i] = reads[i] && (sources[i] != 0 || is_float[i]) ? (uint64_t{is_float[i]} << 5 | sources[i]) + 1 : 0;
+        }
+
+        switch (opcode)
+        {
+        case 0b0000011: case 0b0000111:  // loads
+        case 0b0100011: case 0b0100111:  // stores
+            entry.queue = Queue::MEMORY;
+            entry.unit = FunctionalUnit::kIntAlu;  // address generation
+            entry.is_load = opcode == 0b0000011 || opcode == 0b0000111;
+            entry.is_store = !entry.is_load;
+            entry.address = static_cast<uint64_t>(execution_result_);
+            entry.size = static_cast<uint8_t>(1u << (funct3 & 0b11));
+            break;
+        case 0b0101111:  // AMO
+            entry.queue = Queue::MEMORY;
+            entry.unit = FunctionalUnit::kIntAlu;
+            entry.serializing = true;
+            break;
+        case 0b1110011:  // SYSTEM
+        case 0b0001111:  // FENCE
+            entry.serializing = true;
+            break;
+        default:
+            entry.queue = entry.unit >= FunctionalUnit::kFpAdd ? Queue::FP : Queue::INT;
+            break;
+        }
+
+        entry.mispredicted = !Predicted(entry);
+        fetch_queue_.push_back(entry);
+
+        if (CheckWatchpointHit())
+        {
+            emit statusChanged("VM_WATCHPOINT_HIT");
+            fetch_halted_ = true;
+            return;
+        }
+        if (entry.mispredicted)
+        {
+            ++branch_mispredictions_;
+            fetch_wait_seq_ = entry.seq;
+            return;
+        }
+        // A fetch group ends at a taken transfer
+        if (entry.next_pc != entry.pc + 4)
+            return;
+    }
+}
+
+void RVSSVMOutOfOrder::DispatchStage()
+{
+    bool stalled = false;
+    for (uint64_t dispatched = 0; dispatched < width_ && !fetch_queue_.empty(); ++dispatched)
+    {
+        WindowEntry &entry = fetch_queue_.front();
+        if (entry.fetch_cycle >= cycle_s_)
+            break;  // fetched this cycle
+
+        if ((!rob_.empty() && rob_.back().serializing) || (entry.serializing && !rob_.empty()))
+        {
+            ++serialize_stalls_;
+            stalled = true;
+            break;
+        }
+        if (rob_.size() >= rob_size_)
+        {
+            ++rob_full_stalls_;
+            stalled = true;
+            break;
+        }
+        if (entry.queue == Queue::MEMORY && lsq_count_ >= lsq_size_)
+        {
+            ++lsq_full_stalls_;
+            stalled = true;
+            break;
+        }
+        if ((entry.queue == Queue::INT && int_queue_count_ >= int_queue_size_) ||
+            (entry.queue == Queue::FP && fp_queue_count_ >= fp_queue_size_))
+        {
+            ++iq_full_stalls_;
+            stalled = true;
+            break;
+        }
+
+        // Rename: sources read the alias table, then the destination takes it over
+        for (uint64_t &src : entry.src)
+        {
+            if (src != 0)
+                src = rename_table_[(src - 1) >> 5][(src - 1) & 0x1F];
+        }
+        if (entry.writes_rd)
+            rename_table_[entry.rd_is_float][entry.rd] = entry.seq;
+
+        entry.dispatch_cycle = cycle_s_;
+        if (entry.queue == Queue::MEMORY)
+            ++lsq_count_;
+        else if (entry.queue == Queue::FP)
+            ++fp_queue_count_;
+        else
+            ++int_queue_count_;
+        rob_.push_back(entry);
+        fetch_queue_.pop_front();
+    }
+    if (stalled)
+        stall_cycles_++;
+}
+
+bool RVSSVMOutOfOrder::ScheduleLoad(const WindowEntry &load, size_t index, uint64_t &complete_cycle)
+{
+    // Conservative disambiguation: every older store address must be known
+    for (size_t i = 0; i < index; ++i)
+    {
+        if (rob_[i].is_store && rob_[i].address_cycle > cycle_s_)
+            return false;
+    }
+    for (size_t i = index; i-- > 0;)
+    {
+        const WindowEntry &store = rob_[i];
+        if (!store.is_store || store.address >= load.address + load.size || load.address >= store.address + store.size)
+            continue;
+        // The youngest overlapping store decides: forward if it covers the load, else wait for it to commit
+        if (store.address > load.address || store.address + store.size < load.address + load.size ||
+            store.complete_cycle == kNever)
+            return false;
+        complete_cycle = std::max(complete_cycle, store.complete_cycle) + 1;
+        ++store_forwards_;
+        return true;
+    }
+    complete_cycle += 1;  // data memory access
+    return true;
+}
+
+void RVSSVMOutOfOrder::CompleteStores()
+{
+    for (WindowEntry &entry : rob_)
+    {
+        if (entry.is_store && entry.issue_cycle != kNever && entry.complete_cycle == kNever)
+        {
+            uint64_t data_cycle = ValueReadyCycle(entry.src[1]);
+            if (data_cycle != kNever)
+                entry.complete_cycle = std::max(entry.address_cycle, data_cycle);
+        }
+    }
+}
+
+void RVSSVMOutOfOrder::IssueStage()
+{
+    const uint64_t now = cycle_s_;
+    for (size_t i = 0; i < rob_.size() && issued_this_cycle_ < width_; ++i)
+    {
+        WindowEntry &entry = rob_[i];
+        if (entry.issue_cycle != kNever || entry.dispatch_cycle >= now)
+            continue;
+        // Stores only need their address operand to issue; the data can arrive later
+        if (ValueReadyCycle(entry.src[0]) > now || ValueReadyCycle(entry.src[2]) > now ||
+            (!entry.is_store && ValueReadyCycle(entry.src[1]) > now))
+            continue;
+
+        const FunctionalUnitTiming &timing = functional_unit_timing_[static_cast<size_t>(entry.unit)];
+        if (scoreboard_.UnitFreeCycle(entry.unit, timing.count) > now)
+            continue;
+        uint64_t complete_cycle = now + timing.latency;
+        if (entry.is_load && !ScheduleLoad(entry, i, complete_cycle))
+            continue;
+        if (entry.queue == Queue::MEMORY && !entry.is_load && !entry.is_store)
+            complete_cycle += 1;  // AMO memory access
+
+        scoreboard_.Issue(entry.unit, timing, now, false, 0, false, 0);
+        entry.issue_cycle = now;
+        if (entry.is_store)
+            entry.address_cycle = now + timing.latency;
+        else
+            entry.complete_cycle = complete_cycle;
+        if (entry.queue == Queue::INT)
+            --int_queue_count_;
+        else if (entry.queue == Queue::FP)
+            --fp_queue_count_;
+
+        if (entry.seq == fetch_wait_seq_)
+        {
+            // Fetch restarts down the right path the cycle after the instruction resolves
+            fetch_resume_cycle_ = entry.complete_cycle + 1;
+            fetch_wait_seq_ = 0;
+        }
+        ++issued_this_cycle_;
+    }
+    CompleteStores();
+}
+
+void RVSSVMOutOfOrder::CommitStage()
+{
+    while (!rob_.empty() && committed_this_cycle_ < width_ && rob_.front().complete_cycle <= cycle_s_)
+    {
+        const WindowEntry &entry = rob_.front();
+        if (entry.writes_rd && rename_table_[entry.rd_is_float][entry.rd] == entry.seq)
+            rename_table_[entry.rd_is_float][entry.rd] = 0;
+        if (entry.queue == Queue::MEMORY)
+            --lsq_count_;
+
+        instructions_retired_++;
+        instruction_mix_.Record(entry.instruction, entry.next_pc != entry.pc + 4);
+        if (profiler_.IsEnabled())
+            profiler_.RecordExecution(entry.pc);
+        if (call_graph_.IsEnabled())
+            call_graph_.Retire(entry.pc, entry.instruction);
+        if (bbv_.IsEnabled())
+            bbv_.Retire(entry.pc);
+        if (branch_trace_.IsEnabled())
+            branch_trace_.Retire(entry.pc, entry.instruction, entry.next_pc);
+
+        rob_.pop_front();
+        ++committed_this_cycle_;
+    }
+}
+
+void RVSSVMOutOfOrder::SampleOccupancy()
+{
+    rob_occupancy_.Sample(rob_.size());
+    fetch_queue_occupancy_.Sample(fetch_queue_.size());
+    int_queue_occupancy_.Sample(int_queue_count_);
+    fp_queue_occupancy_.Sample(fp_queue_count_);
+    lsq_occupancy_.Sample(lsq_count_);
+    issued_per_cycle_.Sample(issued_this_cycle_);
+    committed_per_cycle_.Sample(committed_this_cycle_);
+}
+
+void RVSSVMOutOfOrder::Cycle(uint64_t fetch_limit)
+{
+    // The cycle belongs to the oldest instruction in flight, or the one about to be fetched
+    if (profiler_.IsEnabled())
+    {
+        profiler_.RecordCycles(!rob_.empty()           ? rob_.front().pc
+                               : !fetch_queue_.empty() ? fetch_queue_.front().pc
+                                                       : program_counter_, 1);
+    }
+
+    issued_this_cycle_ = 0;
+    committed_this_cycle_ = 0;
+    CommitStage();
+    IssueStage();
+    DispatchStage();
+    FetchStage(fetch_limit);
+    SampleOccupancy();
+
+    cycle_s_++;
+    stats_.Sample(cycle_s_);
+    if (call_graph_.IsEnabled())
+        call_graph_.AddCycles(1);
+}
+
+void RVSSVMOutOfOrder::Run()
+{
+    qDebug() << "\n***** OUT-OF-ORDER RUN STARTED *****\n";
+    ClearStop();
+    memory_controller_.ClearWatchHit();
+    resuming_ = true;
+    fetch_halted_ = false;
+    // Once fetch stops (end of program, breakpoint, watchpoint, stop request) the window drains,
+    // so the registers and memory left behind are those of the last committed instruction
+    while (!IsPipelineEmpty() || (!fetch_halted_ && !stop_requested_ && program_counter_ < program_size_))
+        Cycle(width_);
+
+    if (program_counter_ >= program_size_)
+        emit statusChanged("VM_PROGRAM_END");
+
+    if (!headless_)
+        DumpRegisters(globals::registers_dump_file_path, *registers_);
+    WriteProfileReport();
+    WriteStats();
+    qDebug() << "\n***** OUT-OF-ORDER RUN ENDED *****";
+    qDebug() << "Instructions:" << instructions_retired_ << "Cycles:" << cycle_s_
+             << "Mean ROB occupancy:" << rob_occupancy_.Mean() << "\n";
+}
+
+void RVSSVMOutOfOrder::DebugRun()
+{
+    Run();
+}
+
+void RVSSVMOutOfOrder::Step()
+{
+    if (program_counter_ >= program_size_)
+    {
+        qDebug() << "PC beyond program size";
+        return;
+    }
+    ClearStop();
+    memory_controller_.ClearWatchHit();
+    resuming_ = true;
+    fetch_halted_ = false;
+
+    current_delta_ = StepDelta();
+    current_delta_.old_pc = program_counter_;
+    const uint64_t start_cycle = cycle_s_;
+    const uint64_t seq = next_seq_;
+
+    // Record only while the one instruction executes at fetch; the window then runs until it commits
+    recording_enabled_ = true;
+    while (next_seq_ == seq && !stop_requested_ && program_counter_ < program_size_)
+        Cycle(1);
+    recording_enabled_ = false;
+    while (!IsPipelineEmpty())
+        Cycle(0);
+
+    current_delta_.new_pc = program_counter_;
+    undo_stack_.push(current_delta_);
+    step_cycles_.push(cycle_s_ - start_cycle);
+    current_delta_ = StepDelta();
+
+    DumpRegisters(globals::registers_dump_file_path, *registers_);
+}
+
+void RVSSVMOutOfOrder::Undo()
+{
+    if (undo_stack_.empty() || step_cycles_.empty())
+    {
+        qDebug() << "Undo stack empty";
+        return;
+    }
+    uint64_t cycles = step_cycles_.top();
+    step_cycles_.pop();
+    // Restores registers, memory, PC and takes back one instruction and one cycle; the
+    // predictors keep what the step taught them
+    RVSSVM::Undo();
+    cycle_s_ -= std::min(cycle_s_, cycles > 0 ? cycles - 1 : 0);
+}
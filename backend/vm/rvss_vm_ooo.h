@@ -0,0 +1,156 @@
+
+#ifndef RVSS_VM_OOO_H
+#define RVSS_VM_OOO_H
+
+#include "rvss_vm.h"
+#include "functional_units.h"
+#include "branch_predictor.h"
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <stack>
+
+// Out-of-order core in the style of a Tomasulo machine with a reorder buffer: fetch fills a
+// fetch queue, dispatch renames into the ROB and an integer, FP or load/store queue, issue
+// picks the oldest ready operations, and commit retires in program order.
+//
+// Values are produced by executing each instruction in order as it is fetched (with the
+// single-cycle VM's Alu and control unit), so the window only models timing: the machine
+// never follows a wrong path, a misprediction blocks fetch until the branch executes, and
+// the register file seen by the GUI is the committed one because Run and Step drain the
+// window before they return.
+class RVSSVMOutOfOrder : public RVSSVM
+{
+    Q_OBJECT
+
+public:
+    explicit RVSSVMOutOfOrder(RegisterFile *sharedRegisters, QObject *parent = nullptr);
+    ~RVSSVMOutOfOrder() override;
+
+    bool IsPipelineEmpty() const override;
+    void Run() override;
+    void DebugRun() override;
+    // Executes the next instruction and runs the window until it has committed
+    void Step() override;
+    void Undo() override;
+    void Reset() override;
+    void SetPipelineConfig(bool hazardEnabled,
+                           bool forwardingEnabled,
+                           bool branchPredictionEnabled,
+                           bool dynamicPredictionEnabled,
+                           bool fusionEnabled = false) override;
+
+    // Loads the window sizes, functional units and branch predictor from vm_config
+    void ConfigureWindow();
+    double MeanRobOccupancy() const { return rob_occupancy_.Mean(); }
+
+protected:
+    enum class Queue : uint8_t { INT, FP, MEMORY };
+
+    static constexpr uint64_t kNever = UINT64_MAX;
+
+    struct WindowEntry
+    {
+        uint64_t seq = 0;  // program-order number, 1 for the first instruction
+        uint64_t pc = 0;
+        uint64_t next_pc = 0;
+        uint32_t instruction = 0;
+        FunctionalUnit unit = FunctionalUnit::kIntAlu;
+        Queue queue = Queue::INT;
+
+        // Renamed sources: sequence number of the producing instruction, 0 when the value
+        // was already in the register file. For stores src[1] is the data to store.
+        uint64_t src[3] = {};
+        bool writes_rd = false;
+        bool rd_is_float = false;
+        uint8_t rd = 0;
+
+        bool is_load = false;
+        bool is_store = false;
+        bool serializing = false;   // SYSTEM, FENCE and AMO run alone in the window
+        bool mispredicted = false;  // fetch waits for this one to execute
+        uint64_t address = 0;
+        uint8_t size = 0;
+
+        uint64_t fetch_cycle = 0;
+        uint64_t dispatch_cycle = kNever;
+        uint64_t issue_cycle = kNever;
+        uint64_t address_cycle = kNever;   // stores: first cycle loads can compare against the address
+        uint64_t complete_cycle = kNever;  // first cycle the result can be used and the entry committed
+    };
+
+    std::deque<WindowEntry> fetch_queue_;
+    std::deque<WindowEntry> rob_;
+    // Register alias table: youngest in-flight producer of each GPR/FPR, 0 for the register file
+    uint64_t rename_table_[2][32] = {};
+    uint64_t next_seq_ = 1;
+    uint64_t int_queue_count_ = 0;
+    uint64_t fp_queue_count_ = 0;
+    uint64_t lsq_count_ = 0;
+
+    // A mispredicted instruction in flight holds fetch until one cycle after it executes
+    uint64_t fetch_wait_seq_ = 0;
+    uint64_t fetch_resume_cycle_ = 0;
+    // Set by a breakpoint, watchpoint or stop request: fetch no more and let the window drain
+    bool fetch_halted_ = false;
+
+    uint64_t width_ = 4;
+    uint64_t rob_size_ = 64;
+    uint64_t fetch_queue_size_ = 16;
+    uint64_t int_queue_size_ = 24;
+    uint64_t fp_queue_size_ = 16;
+    uint64_t lsq_size_ = 24;
+    FunctionalUnitTimings functional_unit_timing_{};
+    // Only the unit booking is used; readiness comes from the ROB
+    Scoreboard scoreboard_;
+
+    bool branch_prediction_enabled_ = true;
+    bool dynamic_branch_prediction_enabled_ = true;
+    std::unique_ptr<BranchPredictor> branch_predictor_;
+    ReturnAddressStack return_stack_;
+    IndirectTargetPredictor indirect_predictor_;
+
+    // Cycles each Step took, so Undo can take them back off cycle_s_
+    std::stack<uint64_t> step_cycles_;
+
+    // One clock: commit, issue, dispatch, fetch (oldest stage first, so space freed this
+    // cycle is reused next cycle); fetch takes at most `fetch_limit` instructions
+    void Cycle(uint64_t fetch_limit);
+    void CommitStage();
+    void IssueStage();
+    void DispatchStage();
+    // Executes up to `limit` instructions in order and queues them
+    void FetchStage(uint64_t limit);
+    // Consults and trains the predictors; false if fetch would have gone down the wrong path
+    bool Predicted(const WindowEntry &entry);
+    // Stores complete once both their address and their data are ready
+    void CompleteStores();
+    // First cycle the value written by `seq` can be read; kNever while it has not executed
+    uint64_t ValueReadyCycle(uint64_t seq) const;
+    // Completion time of the load at rob_[index] issuing now, or false if it has to wait for
+    // an older store; a store that covers the load forwards its data
+    bool ScheduleLoad(const WindowEntry &load, size_t index, uint64_t &complete_cycle);
+    void SampleOccupancy();
+    void ClearWindow();
+
+    bool resuming_ = false;  // don't stop again on the breakpoint we are resuming from
+
+    uint64_t store_forwards_ = 0;
+    uint64_t rob_full_stalls_ = 0;
+    uint64_t iq_full_stalls_ = 0;
+    uint64_t lsq_full_stalls_ = 0;
+    uint64_t serialize_stalls_ = 0;
+    uint64_t fetch_redirect_stalls_ = 0;
+    StatsHistogram rob_occupancy_;
+    StatsHistogram fetch_queue_occupancy_;
+    StatsHistogram int_queue_occupancy_;
+    StatsHistogram fp_queue_occupancy_;
+    StatsHistogram lsq_occupancy_;
+    StatsHistogram issued_per_cycle_;
+    StatsHistogram committed_per_cycle_;
+    uint64_t issued_this_cycle_ = 0;
+    uint64_t committed_this_cycle_ = 0;
+};
+
+#endif // RVSS_VM_OOO_H
@@ -1,6 +1,13 @@
 #include "rvss_vm_pipelined.h"
+#include "lockstep_checker.h"
 #include "../common/instructions.h"
+#include "../config.h"
 #include <QDebug>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
 
 using instruction_set::get_instr_encoding;
 using instruction_set::Instruction;
@@ -9,6 +16,91 @@ RVSSVMPipelined::RVSSVMPipelined(RegisterFile *sharedRegisters, QObject *parent)
     : RVSSVM(sharedRegisters, parent)
 {
     registers_ = sharedRegisters;
+
+    static_assert(std::is_trivially_copyable_v<IF_ID> && std::is_trivially_copyable_v<ID_EX> &&
+                      std::is_trivially_copyable_v<EX_MEM> && std::is_trivially_copyable_v<MEM_WB> &&
+                      std::is_trivially_copyable_v<Scoreboard> && std::is_trivially_copyable_v<StagePipes> &&
+                      std::is_trivially_copyable_v<PendingRedirect> &&
+                      std::is_trivially_copyable_v<DecoupledFrontend>,
+                  "Pipeline latches are diffed bytewise by the undo log");
+    pipeline_undo_log_.SetLatches({{&if_id_, sizeof(if_id_)},
+                                   {&id_ex_, sizeof(id_ex_)},
+                                   {&ex_mem_, sizeof(ex_mem_)},
+                                   {&mem_wb_, sizeof(mem_wb_)},
+                                   {&scoreboard_, sizeof(scoreboard_)},
+                                   {&pipes_, sizeof(pipes_)},
+                                   {&pending_redirect_, sizeof(pending_redirect_)},
+                                   {&frontend_, sizeof(frontend_)}});
+    pipeline_undo_log_.Configure(vm_config::config.getPipelineUndoDepth(),
+                                 vm_config::config.getPipelineUndoSnapshotInterval());
+
+    stats_.AddHistogram("stall_burst_length", &stall_bursts_, "Consecutive stalled cycles per stall");
+    stats_.AddScalar("btb.lookups", &btb_lookups_, "BTB lookups at fetch");
+    stats_.AddScalar("btb.hits", &btb_hits_, "BTB hits at fetch");
+    stats_.AddScalar("bpred.lookups", &predictor_lookups_, "Direction predictor lookups at fetch");
+    stats_.AddScalar("bpred.conditional_branches", &conditional_branches_, "Conditional branches resolved in EX");
+    stats_.AddScalar("bpred.direction_mispredictions", &direction_mispredictions_,
+                     "Conditional branches whose fetch-time direction was wrong");
+    stats_.AddScalar("ras.returns", &returns_, "Returns (jalr popping the return stack) resolved in EX");
+    stats_.AddScalar("ras.mispredictions", &return_mispredictions_, "Returns fetched from the wrong target");
+    stats_.AddScalar("indirect.jumps", &indirect_jumps_, "Other jalr resolved in EX");
+    stats_.AddScalar("indirect.mispredictions", &indirect_mispredictions_,
+                     "Indirect jumps fetched from the wrong target");
+    stats_.AddScalar("fu.raw_stalls", &scoreboard_raw_stalls_,
+                     "Cycles ID waited for a multi-cycle result");
+    stats_.AddScalar("fu.waw_stalls", &scoreboard_waw_stalls_,
+                     "Cycles ID waited so results stay in order");
+    stats_.AddScalar("fu.structural_stalls", &structural_stalls_,
+                     "Cycles ID waited for a busy functional unit");
+    for (size_t unit = 0; unit < kFunctionalUnitCount; ++unit)
+        stats_.AddScalar(std::string("fu.") + FunctionalUnitName(static_cast<FunctionalUnit>(unit)) + ".ops",
+                         &functional_unit_ops_[unit], "Operations issued to this functional unit");
+    stats_.AddScalar("fusion.pairs", &fused_pairs_[static_cast<size_t>(FusionKind::kNone)],
+                     "Instruction pairs issued as one fused entry");
+    for (size_t kind = 1; kind < kFusionKindCount; ++kind)
+        stats_.AddScalar(std::string("fusion.") + FusionKindName(static_cast<FusionKind>(kind)),
+                         &fused_pairs_[kind], "Fused pairs of this kind issued");
+    stats_.AddRatio("fusion.fused_fraction", "fusion.pairs", "instructions", 2.0,
+                    "Fraction of instructions issued as half of a fused pair");
+    stats_.AddRatio("btb.hit_rate", "btb.hits", "btb.lookups", 1.0, "BTB hit rate");
+    stats_.AddRatio("bpred.misprediction_rate", "bpred.direction_mispredictions", "bpred.conditional_branches",
+                    1.0, "Direction mispredictions per conditional branch");
+    stats_.AddRatio("bpred.mpki", "branch_mispredictions", "instructions", 1000.0,
+                    "Fetch redirects per thousand instructions");
+    stats_.AddScalar("cpi.issued_slots", cpi_stack_.IssuedCounter(), "Issue slots that issued an instruction");
+    for (size_t i = 0; i < kStallCauseCount; ++i)
+    {
+        StallCause cause = static_cast<StallCause>(i);
+        std::string name = std::string("cpi.") + StallCauseName(cause);
+        stats_.AddScalar(name + "_slots", cpi_stack_.LostCounter(cause),
+                         std::string("Issue slots lost to ") + StallCauseName(cause));
+        stats_.AddRatio(name, name + "_slots", "instructions", 1.0,
+                        std::string("Issue slots lost to ") + StallCauseName(cause) + " per instruction");
+    }
+    stats_.AddScalar("frontend.fetch_blocks", &fetch_blocks_, "Fetch targets moved into the instruction buffer");
+    stats_.AddScalar("frontend.restarts", &frontend_restarts_,
+                     "Times the fetch target queue and instruction buffer were discarded");
+    stats_.AddScalar("frontend.ftq_full_cycles", &ftq_full_cycles_,
+                     "Cycles the branch predictor waited for room in the fetch target queue");
+    stats_.AddScalar("frontend.buffer_empty_cycles", &buffer_empty_cycles_,
+                     "Times IF found the instruction buffer empty");
+    stats_.AddHistogram("frontend.ftq_occupancy", &ftq_occupancy_, "Fetch targets queued, per cycle");
+    stats_.AddHistogram("frontend.buffer_occupancy", &buffer_occupancy_, "Instructions buffered, per cycle");
+    stats_.AddRatio("frontend.instructions_per_block", "instructions", "frontend.fetch_blocks", 1.0,
+                    "Instructions retired per fetch block");
+    stats_.AddScalar("pipeline.fetch_stages", &fetch_stages_, "Configured IF stages");
+    stats_.AddScalar("pipeline.execute_stages", &execute_stages_, "Configured EX stages");
+    stats_.AddScalar("pipeline.memory_stages", &memory_stages_, "Configured MEM stages");
+    stats_.AddScalar("pipeline.redirect_penalty", &redirect_penalty_,
+                     "Instructions squashed by each misprediction at this depth");
+    stats_.AddScalar("pipeline.load_use_distance", &load_use_distance_,
+                     "Cycles a dependent of a load waits in ID with forwarding");
+
+    ConfigureBranchPredictor();
+    ConfigureFunctionalUnits();
+    ConfigurePipelineDepth();
+    ConfigureFrontend();
+    BindIsa();
 }
 
 RVSSVMPipelined::~RVSSVMPipelined() = default;
@@ -17,12 +109,8 @@ void RVSSVMPipelined::LoadProgram(const AssembledProgram &program)
 {
     // Call base class implementation
     RVSSVM::LoadProgram(program);
-
-    if (program_size_ > 0)
-    {
-        stage_to_pc_["IF"] = 0;
-        emit pipelineStageChanged(0, "IF");
-    }
+    cpi_stack_.Resize(0, program_size_);
+    PublishStages();
 }
 
 void RVSSVMPipelined::Reset()
@@ -36,35 +124,169 @@ void RVSSVMPipelined::Reset()
     ex_mem_next_ = EX_MEM();
     mem_wb_ = MEM_WB();
     mem_wb_next_ = MEM_WB();
+    pipes_ = StagePipes();
+    pending_redirect_ = PendingRedirect();
 
     pc_update_pending_ = false;
     pc_update_value_ = 0;
     stall_ = false;
     flush_pipeline_ = false;
+    stall_bursts_.Clear();
+    stall_burst_ = 0;
+    fetch_blocked_ = false;
+    stop_at_breakpoints_ = false;
+    released_breakpoint_pc_ = CpiStack::kNoPc;
+    stopped_at_breakpoint_ = false;
+    in_flight_writes_.clear();
+    fetch_seq_ = 0;
+    traced_fetch_seq_ = 0;
+    pipeline_trace_.Restart();
+    cpi_stack_.Clear();
+    control_pc_ = 0;
+    scoreboard_.Clear();
+    functional_unit_ops_.fill(0);
+    scoreboard_raw_stalls_ = 0;
+    scoreboard_waw_stalls_ = 0;
+    structural_stalls_ = 0;
+    fused_pairs_.fill(0);
+    frontend_ = DecoupledFrontend();
+    frontend_.predict_pc = program_counter_;
+    fetch_blocks_ = 0;
+    frontend_restarts_ = 0;
+    ftq_full_cycles_ = 0;
+    buffer_empty_cycles_ = 0;
+    ftq_occupancy_.Clear();
+    buffer_occupancy_.Clear();
+
+    ClearPublishedStages();
+
+    branch_predictor_->Reset();
+    branch_target_buffer_.Clear();
+    btb_lookups_ = 0;
+    btb_hits_ = 0;
+    predictor_lookups_ = 0;
+    conditional_branches_ = 0;
+    direction_mispredictions_ = 0;
+    return_stack_.Clear();
+    indirect_predictor_.Clear();
+    returns_ = 0;
+    return_mispredictions_ = 0;
+    indirect_jumps_ = 0;
+    indirect_mispredictions_ = 0;
+
+    // Clear undo history (picks up any change to the configured depth)
+    pipeline_undo_log_.Configure(vm_config::config.getPipelineUndoDepth(),
+                                 vm_config::config.getPipelineUndoSnapshotInterval());
+}
 
-    emit pipelineStageChanged(0, "IF_CLEAR");
-    emit pipelineStageChanged(0, "ID_CLEAR");
-    emit pipelineStageChanged(0, "EX_CLEAR");
-    emit pipelineStageChanged(0, "MEM_CLEAR");
-    emit pipelineStageChanged(0, "WB_CLEAR");
-
-    branch_target_buffer_.assign(BHT_SIZE, 0);
-    if (dynamic_branch_prediction_enabled_)
-    {
-        // Dynamic prediction: start conservative (NOT_TAKEN)
-        branch_history_table_.assign(BHT_SIZE, false);
-    }
-    else
-    {
-        // Static prediction: BHT not used, but initialize anyway
-        branch_history_table_.assign(BHT_SIZE, true);
-    }
+void RVSSVMPipelined::SaveSnapshot(VmSnapshot &snapshot)
+{
+    RVSSVM::SaveSnapshot(snapshot);
+
+    VmSnapshot::Writer pipeline = snapshot.Add(VmSnapshot::Section::kPipeline);
+    pipeline.Put(fetch_stages_);
+    pipeline.Put(execute_stages_);
+    pipeline.Put(memory_stages_);
+    pipeline.PutSized(if_id_);
+    pipeline.PutSized(id_ex_);
+    pipeline.PutSized(ex_mem_);
+    pipeline.PutSized(mem_wb_);
+    pipeline.PutSized(scoreboard_);
+    pipeline.PutSized(pipes_);
+    pipeline.PutSized(pending_redirect_);
+    pipeline.Put(stall_);
+    pipeline.Put(fetch_seq_);
+    pipeline.Put(flush_pipeline_);
+    pipeline.Put(pc_update_pending_);
+    pipeline.Put(pc_update_value_);
+    pipeline.PutSized(frontend_);
+
+    VmSnapshot::Writer predictor = snapshot.Add(VmSnapshot::Section::kBranchPredictor);
+    predictor.Put(btb_lookups_);
+    predictor.Put(btb_hits_);
+    predictor.Put(predictor_lookups_);
+    predictor.Put(conditional_branches_);
+    predictor.Put(direction_mispredictions_);
+    predictor.Put(returns_);
+    predictor.Put(return_mispredictions_);
+    predictor.Put(indirect_jumps_);
+    predictor.Put(indirect_mispredictions_);
+    branch_target_buffer_.Save(predictor);
+    return_stack_.Save(predictor);
+    indirect_predictor_.Save(predictor);
+    branch_predictor_->Save(predictor);
+}
 
-    // Clear undo stack
-    while (!pipeline_undo_stack_.empty())
-        pipeline_undo_stack_.pop();
+void RVSSVMPipelined::RestoreSnapshot(const VmSnapshot &snapshot)
+{
+    // Validate the pipelined sections before anything is overwritten
+    if (snapshot.Has(VmSnapshot::Section::kIssueLanes) && IssueLanes() == 1)
+        throw std::runtime_error("Snapshot was taken with the dual-issue pipeline");
+    VmSnapshot::Reader pipeline = snapshot.Read(VmSnapshot::Section::kPipeline);
+    VmSnapshot::Reader predictor = snapshot.Read(VmSnapshot::Section::kBranchPredictor);
+    uint64_t fetch_stages = pipeline.Get<uint64_t>();
+    uint64_t execute_stages = pipeline.Get<uint64_t>();
+    uint64_t memory_stages = pipeline.Get<uint64_t>();
+    if (fetch_stages != fetch_stages_ || execute_stages != execute_stages_ || memory_stages != memory_stages_)
+        throw std::runtime_error("Snapshot was taken with a different pipeline depth");
+
+    RVSSVM::RestoreSnapshot(snapshot);
+
+    pipeline.GetSized(if_id_);
+    pipeline.GetSized(id_ex_);
+    pipeline.GetSized(ex_mem_);
+    pipeline.GetSized(mem_wb_);
+    pipeline.GetSized(scoreboard_);
+    pipeline.GetSized(pipes_);
+    pipeline.GetSized(pending_redirect_);
+    stall_ = pipeline.Get<bool>();
+    fetch_seq_ = pipeline.Get<uint64_t>();
+    flush_pipeline_ = pipeline.Get<bool>();
+    pc_update_pending_ = pipeline.Get<bool>();
+    pc_update_value_ = pipeline.Get<uint64_t>();
+    pipeline.GetSized(frontend_);
+    // Queues filled under larger [Frontend] limits can't go on under these ones
+    if (frontend_.ftq.Size() > fetch_target_queue_entries_ || frontend_.buffer.Size() > instruction_buffer_entries_)
+        RestartFrontend(program_counter_, true, StallCause::kFillDrain, CpiStack::kNoPc);
+    if_id_next_ = IF_ID();
+    id_ex_next_ = ID_EX();
+    ex_mem_next_ = EX_MEM();
+    mem_wb_next_ = MEM_WB();
 
-    stage_to_pc_.clear();
+    // Predictor configuration is left alone so one snapshot can seed runs with different settings;
+    // tables saved with another predictor or geometry don't fit, so those start cold
+    btb_lookups_ = predictor.Get<uint64_t>();
+    btb_hits_ = predictor.Get<uint64_t>();
+    predictor_lookups_ = predictor.Get<uint64_t>();
+    conditional_branches_ = predictor.Get<uint64_t>();
+    direction_mispredictions_ = predictor.Get<uint64_t>();
+    returns_ = predictor.Get<uint64_t>();
+    return_mispredictions_ = predictor.Get<uint64_t>();
+    indirect_jumps_ = predictor.Get<uint64_t>();
+    indirect_mispredictions_ = predictor.Get<uint64_t>();
+    if (!branch_target_buffer_.Restore(predictor))
+    {
+        qDebug() << "Snapshot BTB geometry differs from the configured one - starting with an empty BTB";
+        branch_target_buffer_.Clear();
+    }
+    if (!return_stack_.Restore(predictor))
+        return_stack_.Clear();
+    if (!indirect_predictor_.Restore(predictor))
+        indirect_predictor_.Clear();
+    if (!branch_predictor_->Restore(predictor))
+    {
+        qDebug() << "Snapshot was taken with a different branch predictor - starting with cold tables";
+        branch_predictor_->Reset();
+    }
+
+    fetch_blocked_ = false;
+    released_breakpoint_pc_ = CpiStack::kNoPc;
+    in_flight_writes_.clear();
+    stall_burst_ = 0;
+    pipeline_undo_log_.Configure(vm_config::config.getPipelineUndoDepth(),
+                                 vm_config::config.getPipelineUndoSnapshotInterval());
+
+    PublishStages();
 }
 
 void RVSSVMPipelined::IF_stage()
@@ -76,12 +298,16 @@ void RVSSVMPipelined::IF_stage()
         pc_update_pending_ = false;
         pc_update_value_ = 0;
         if_id_next_.valid = false;
+        if_id_next_.bubble_cause = StallCause::kControl;
+        if_id_next_.bubble_pc = control_pc_;
         return;
     }
 
     if (flush_pipeline_)
     {
         if_id_next_.valid = false;
+        if_id_next_.bubble_cause = StallCause::kControl;
+        if_id_next_.bubble_pc = control_pc_;
         return;
     }
 
@@ -91,137 +317,283 @@ void RVSSVMPipelined::IF_stage()
         return;
     }
 
-    if (program_counter_ >= program_size_)
+    if (fetch_blocked_ || program_counter_ >= program_size_)
     {
         if_id_next_.valid = false;
         return;
     }
 
+    if (decoupled_frontend_)
+    {
+        DeliverBufferedInstruction();
+        return;
+    }
+
+    // Fetch first so jal/jalr can be predecoded for the return address stack. Fetches, including
+    // wrong-path ones and the frontend's run-ahead, read around the watchpoints
+    uint32_t instruction = memory_controller_.ReadWord_d(program_counter_);
+
+    // A fusible pair is fetched as one entry that goes on as its tail, with the head carried
+    // along; WB still checks a breakpoint on either half
+    if (fusion_enabled_ && program_counter_ + 4 < program_size_)
+    {
+        uint32_t tail = memory_controller_.ReadWord_d(program_counter_ + 4);
+        FusionKind kind = DetectFusion(instruction, tail);
+        if (kind != FusionKind::kNone)
+        {
+            if_id_next_.fused.kind = kind;
+            if_id_next_.fused.instruction = instruction;
+            if_id_next_.fused.rd = (instruction >> 7) & 0b11111;
+            STAGE_LOG << "IF: Fused" << FusionKindName(kind) << "at" << QString::number(program_counter_, 16);
+            instruction = tail;
+            program_counter_ += 4;
+        }
+    }
+
+    uint64_t predicted_pc = PredictNextPc(program_counter_, instruction, if_id_next_.predicted_taken,
+                                          if_id_next_.ras_checkpoint);
+
+    // Fetch instruction
+    if_id_next_.seq = ++fetch_seq_;
+    if_id_next_.pc = program_counter_;
+    if_id_next_.instruction = instruction;
+    if_id_next_.valid = true;
+    if_id_next_.predicted_pc = predicted_pc;
+
+    STAGE_LOG << "IF: Fetched from:" << QString::number(program_counter_, 16)
+             << "Next PC:" << QString::number(predicted_pc, 16);
+
+    // Update PC for next fetch
+    program_counter_ = predicted_pc;
+}
+
+uint64_t RVSSVMPipelined::PredictNextPc(uint64_t pc, uint32_t instruction, bool &predicted_taken,
+                                        ReturnAddressStack::Checkpoint &ras_checkpoint)
+{
     // Default: fetch next sequential instruction
-    uint64_t predicted_pc = program_counter_ + 4;
+    uint64_t predicted_pc = pc + 4;
+    predicted_taken = false;
 
-    // ✅ REFACTORED: Mutually exclusive branch prediction modes
+    // The BTB identifies control transfers before decode; jumps are always taken, and
+    // conditional branches take their direction from the static rule or the predictor.
+    // Returns take their target from the return stack, other jalr from the indirect predictor
     if (branch_prediction_enabled_)
     {
-        size_t index = (program_counter_ >> 2) % BHT_SIZE;
-        uint64_t target = branch_target_buffer_[index];
-        bool predict_taken = false;
-
-        qDebug() << "IF: PC:" << QString::number(program_counter_, 16)
-                 << "BTB Index:" << index
-                 << "BTB Target:" << QString::number(target, 16);
+        ReturnAddressStack::Action ras_action = ReturnAddressStack::ActionFor(instruction);
+        ++btb_lookups_;
+        const BranchTargetBuffer::Entry *entry = branch_target_buffer_.Lookup(pc);
+        if (entry)
+            ++btb_hits_;
 
-        // In IF_stage(), around line 157:
-        if (dynamic_branch_prediction_enabled_)
+        if (ras_action.pop && !return_stack_.Empty())
         {
-            qDebug() << "IF: Using DYNAMIC branch prediction";
-
-            // Check if we have a BTB entry
-            if (target != 0)
-            {
-                // Use BHT to predict
-                predict_taken = branch_history_table_[index];
-                qDebug() << "IF: BTB hit - BHT predicts"
-                         << (predict_taken ? "TAKEN" : "NOT_TAKEN");
-            }
-            else
-            {
-                // BTB miss - first encounter, predict not taken
-                predict_taken = false;
-                qDebug() << "IF: BTB miss - predicting NOT_TAKEN";
-            }
+            predicted_pc = return_stack_.Top();
+            predicted_taken = true;
+            STAGE_LOG << "IF: Return predicted from RAS:" << QString::number(predicted_pc, 16);
         }
-        else
+        else if (entry)
         {
-            // ============================================================
-            // STATIC PREDICTION: Backward taken, forward not taken
-            // ============================================================
-            qDebug() << "IF: Using STATIC branch prediction";
-
-            if (target != 0)
+            bool predict_taken = true;
+            uint64_t target = entry->target;
+            if (entry->kind == BranchTargetBuffer::Kind::kConditional)
             {
-                // We have a BTB entry - check branch direction
-                if (target < program_counter_)
-                {
-                    // Backward branch (likely a loop) - predict taken
-                    predict_taken = true;
-                    qDebug() << "IF: BACKWARD branch detected - predicting TAKEN";
-                }
-                else if (target > program_counter_)
+                if (dynamic_branch_prediction_enabled_)
                 {
-                    // Forward branch - predict not taken
-                    predict_taken = false;
-                    qDebug() << "IF: FORWARD branch detected - predicting NOT_TAKEN";
+                    ++predictor_lookups_;
+                    predict_taken = branch_predictor_->Predict(pc);
                 }
                 else
                 {
-                    // Self-loop (rare) - predict taken
-                    predict_taken = true;
-                    qDebug() << "IF: SELF-loop detected - predicting TAKEN";
+                    // Static: backward taken (loops), forward not taken
+                    predict_taken = target <= pc;
                 }
             }
-            else
+            else if (entry->kind == BranchTargetBuffer::Kind::kIndirect)
+            {
+                indirect_predictor_.Predict(pc, target);
+            }
+            STAGE_LOG << "IF: BTB hit" << BranchKindName(entry->kind)
+                     << "target:" << QString::number(target, 16)
+                     << "predict:" << (predict_taken ? "TAKEN" : "NOT_TAKEN");
+            if (predict_taken)
             {
-                // BTB miss - predict not taken (first encounter)
-                predict_taken = false;
-                qDebug() << "IF: BTB miss - predicting NOT_TAKEN (first encounter)";
+                predicted_pc = target;
+                predicted_taken = true;
             }
         }
 
-        // Apply prediction
-        if (predict_taken && target != 0)
-        {
-            predicted_pc = target;
-            qDebug() << "IF: Prediction = TAKEN, jumping to:"
-                     << QString::number(predicted_pc, 16);
-            if_id_next_.predicted_taken = predict_taken;
-        }
-        else
+        ras_checkpoint = return_stack_.Save();
+        return_stack_.Apply(ras_action, pc + 4);
+    }
+    return predicted_pc;
+}
+
+void RVSSVMPipelined::ClockFrontend()
+{
+    if (!decoupled_frontend_)
+        return;
+
+    // IF takes the redirect this cycle and EX has already repaired the return stack; any other
+    // move of the PC (fast-forward, undo past a restart, snapshot) leaves the queued path stale
+    if (pc_update_pending_)
+        RestartFrontend(pc_update_value_, false, StallCause::kControl, control_pc_);
+    else if (frontend_.NextPc() != program_counter_)
+        RestartFrontend(program_counter_, true, StallCause::kFillDrain, CpiStack::kNoPc);
+    if (fetch_blocked_)
+        return;
+
+    ftq_occupancy_.Sample(frontend_.ftq.Size());
+    buffer_occupancy_.Sample(frontend_.buffer.Size());
+
+    // Fetch: the oldest target moves into the buffer once all of it fits, and IF can hand
+    // its first instruction to decode in the same cycle
+    if (!frontend_.ftq.Empty() &&
+        frontend_.buffer.Size() + frontend_.ftq.Front().count <= instruction_buffer_entries_)
+    {
+        const FetchTarget &target = frontend_.ftq.Front();
+        for (uint32_t i = 0; i < target.count; ++i)
         {
-            if_id_next_.predicted_taken = false;
-            qDebug() << "IF: Prediction = NOT_TAKEN, sequential PC:"
-                     << QString::number(predicted_pc, 16);
+            BufferedInstruction entry;
+            entry.pc = target.start_pc + 4*i;
+            entry.instruction = memory_controller_.ReadWord_d(entry.pc);
+            bool last = i + 1 == target.count;
+            entry.predicted_pc = last ? target.next_pc : entry.pc + 4;
+            entry.predicted_taken = last && target.taken;
+            entry.ras_checkpoint = target.ras_checkpoint;
+            frontend_.buffer.Push(entry);
         }
+        frontend_.ftq.Pop();
+        ++fetch_blocks_;
     }
-    else
+
+    // Predict: one target per cycle, running ahead of fetch until the queue is full
+    if (frontend_.predict_pc >= program_size_)
+        return;
+    if (frontend_.ftq.Size() >= fetch_target_queue_entries_)
     {
-        qDebug() << "IF: Branch prediction DISABLED - always sequential";
+        ++ftq_full_cycles_;
+        return;
     }
 
-    // Fetch instruction
-    if_id_next_.pc = program_counter_;
-    if_id_next_.instruction = memory_controller_.ReadWord(program_counter_);
-    if_id_next_.valid = true;
+    FetchTarget target;
+    target.start_pc = frontend_.predict_pc;
+    target.ras_checkpoint = return_stack_.Save();
+    const uint64_t block_end = (target.start_pc | (fetch_block_bytes_ - 1)) + 1;
+    const uint64_t max_count = std::min(fetch_block_bytes_ / 4, instruction_buffer_entries_);
+    uint64_t pc = target.start_pc;
+    while (true)
+    {
+        // Predecoded like the coupled IF does, so calls and returns reach the return stack
+        uint32_t instruction = memory_controller_.ReadWord_d(pc);
+        ReturnAddressStack::Checkpoint checkpoint;
+        ReturnAddressStack::Action ras_action = ReturnAddressStack::ActionFor(instruction);
+        target.next_pc = PredictNextPc(pc, instruction, target.taken, checkpoint);
+        ++target.count;
+        bool touches_ras = branch_prediction_enabled_ && (ras_action.push || ras_action.pop);
+        if (target.taken || touches_ras || target.next_pc >= block_end || target.next_pc >= program_size_ ||
+            target.count == max_count)
+            break;
+        pc = target.next_pc;
+    }
+    frontend_.ftq.Push(target);
+    frontend_.predict_pc = target.next_pc;
+    STAGE_LOG << "BPU: Fetch target" << QString::number(target.start_pc, 16) << "x" << target.count
+             << "next:" << QString::number(target.next_pc, 16);
+}
 
-    qDebug() << "IF: Fetched from:" << QString::number(program_counter_, 16)
-             << "Next PC:" << QString::number(predicted_pc, 16);
+void RVSSVMPipelined::RestartFrontend(uint64_t pc, bool repair_ras, StallCause cause, uint64_t cause_pc)
+{
+    ReturnAddressStack::Checkpoint checkpoint;
+    if (repair_ras && branch_prediction_enabled_ && frontend_.OldestCheckpoint(checkpoint))
+        return_stack_.Restore(checkpoint);
+    frontend_.ftq.Clear();
+    frontend_.buffer.Clear();
+    frontend_.predict_pc = pc;
+    frontend_.empty_cause = cause;
+    frontend_.empty_pc = cause_pc;
+    ++frontend_restarts_;
+}
 
-    // Update PC for next fetch
-    program_counter_ = predicted_pc;
+void RVSSVMPipelined::DeliverBufferedInstruction()
+{
+    if (frontend_.buffer.Empty())
+    {
+        ++buffer_empty_cycles_;
+        if_id_next_.valid = false;
+        if_id_next_.bubble_cause = frontend_.empty_cause;
+        if_id_next_.bubble_pc = frontend_.empty_pc;
+        return;
+    }
+
+    BufferedInstruction entry = frontend_.buffer.Front();
+    frontend_.buffer.Pop();
+
+    // Only a pair that is already buffered fuses; no head is a control transfer, so one
+    // predicted taken is a BTB alias and its successor isn't the tail
+    if (fusion_enabled_ && !frontend_.buffer.Empty() && !entry.predicted_taken)
+    {
+        const BufferedInstruction &tail = frontend_.buffer.Front();
+        FusionKind kind = DetectFusion(entry.instruction, tail.instruction);
+        if (kind != FusionKind::kNone)
+        {
+            if_id_next_.fused.kind = kind;
+            if_id_next_.fused.instruction = entry.instruction;
+            if_id_next_.fused.rd = (entry.instruction >> 7) & 0b11111;
+            STAGE_LOG << "IF: Fused" << FusionKindName(kind) << "at" << QString::number(entry.pc, 16);
+            entry = tail;
+            frontend_.buffer.Pop();
+        }
+    }
+
+    if_id_next_.seq = ++fetch_seq_;
+    if_id_next_.pc = entry.pc;
+    if_id_next_.instruction = entry.instruction;
+    if_id_next_.valid = true;
+    if_id_next_.predicted_taken = entry.predicted_taken;
+    if_id_next_.predicted_pc = entry.predicted_pc;
+    if_id_next_.ras_checkpoint = entry.ras_checkpoint;
+    frontend_.empty_cause = StallCause::kFillDrain;
+    frontend_.empty_pc = CpiStack::kNoPc;
+
+    STAGE_LOG << "IF: From the instruction buffer:" << QString::number(entry.pc, 16)
+             << "Next PC:" << QString::number(entry.predicted_pc, 16);
+    program_counter_ = entry.predicted_pc;
 }
 
 void RVSSVMPipelined::ID_stage()
 {
-    qDebug() << "\n=== ID STAGE START ===";
+    STAGE_LOG << "\n=== ID STAGE START ===";
 
     if (flush_pipeline_)
     {
-        qDebug() << "ID: Pipeline flushed - inserting bubble";
+        STAGE_LOG << "ID: Pipeline flushed - inserting bubble";
+        id_ex_next_ = ID_EX();
+        LoseIssueSlot(StallCause::kControl, control_pc_);
+        return;
+    }
+
+    if (pending_redirect_.valid)
+    {
+        STAGE_LOG << "ID: Wrong path behind a mispredicted branch - inserting bubble";
         id_ex_next_ = ID_EX();
+        LoseIssueSlot(StallCause::kControl, pending_redirect_.branch_pc);
         return;
     }
 
     if (stall_)
     {
-        qDebug() << "ID: Stalled - inserting bubble";
+        // An older lane stalled this cycle; this slot is lost for the same reason
+        STAGE_LOG << "ID: Stalled - inserting bubble";
         id_ex_next_ = ID_EX();
+        LoseIssueSlot(id_cause_, id_cause_pc_);
         return;
     }
 
     if (!if_id_.valid)
     {
-        qDebug() << "ID: Invalid instruction - inserting bubble";
+        STAGE_LOG << "ID: Invalid instruction - inserting bubble";
         id_ex_next_ = ID_EX();
+        LoseIssueSlot(if_id_.bubble_cause, if_id_.bubble_pc);
         return;
     }
 
@@ -232,12 +604,14 @@ void RVSSVMPipelined::ID_stage()
     uint8_t funct3 = (instr >> 12) & 0x7;
     uint8_t funct7 = (instr >> 25) & 0b1111111;
     id_ex_next_.predicted_taken = if_id_.predicted_taken;
+    id_ex_next_.predicted_pc = if_id_.predicted_pc;
+    id_ex_next_.ras_checkpoint = if_id_.ras_checkpoint;
 
-    qDebug() << "ID: PC:" << QString::number(if_id_.pc, 16);
-    qDebug() << "ID: Instruction:" << QString::number(instr, 16);
-    qDebug() << "ID: Opcode:" << QString::number(opcode, 2).rightJustified(7, '0');
-    qDebug() << "ID: rs1:" << curr_rs1 << "rs2:" << curr_rs2;
-    qDebug() << "ID: funct3:" << QString::number(funct3, 2) << "funct7:" << QString::number(funct7, 2);
+    STAGE_LOG << "ID: PC:" << QString::number(if_id_.pc, 16);
+    STAGE_LOG << "ID: Instruction:" << QString::number(instr, 16);
+    STAGE_LOG << "ID: Opcode:" << QString::number(opcode, 2).rightJustified(7, '0');
+    STAGE_LOG << "ID: rs1:" << curr_rs1 << "rs2:" << curr_rs2;
+    STAGE_LOG << "ID: funct3:" << QString::number(funct3, 2) << "funct7:" << QString::number(funct7, 2);
 
     // Check system call
     auto ecall_encoding = get_instr_encoding(Instruction::kecall);
@@ -245,7 +619,7 @@ void RVSSVMPipelined::ID_stage()
                               funct3 == static_cast<uint8_t>(ecall_encoding.funct3));
     if (id_ex_next_.is_syscall)
     {
-        qDebug() << "ID: *** ECALL DETECTED ***";
+        STAGE_LOG << "ID: *** ECALL DETECTED ***";
     }
 
     // Detect floating-point instructions
@@ -302,13 +676,101 @@ void RVSSVMPipelined::ID_stage()
         id_ex_next_.rs2_is_float = false;
     }
 
-    qDebug() << "ID: rs1_is_float:" << id_ex_next_.rs1_is_float
+    STAGE_LOG << "ID: rs1_is_float:" << id_ex_next_.rs1_is_float
              << "rs2_is_float:" << id_ex_next_.rs2_is_float;
 
+    // Decode control signals now so the scoreboard knows the functional unit and destination
+    control_unit_.SetControlSignals(instr);
+    FunctionalUnit unit = FunctionalUnitFor(control_unit_.GetAluSignal(instr, control_unit_.GetAluOp()));
+    const FunctionalUnitTiming &timing = functional_unit_timing_[static_cast<size_t>(unit)];
+    RegisterUsage usage = DecodeRegisterUsage(instr);
+    uint8_t curr_rd = (instr >> 7) & 0b11111;
+
+    // A fused pair reads the head's sources: the tail's rs1 is the head's result, except in a
+    // load pair where both read the same base. The head's destination is a second one
+    const FusedHead &fused = if_id_.fused;
+    if (fused.kind != FusionKind::kNone && fused.kind != FusionKind::kLoadPair)
+    {
+        RegisterUsage head_usage = DecodeRegisterUsage(fused.instruction);
+        usage.reads_rs1 = head_usage.reads_rs1;
+        usage.reads_rs2 = head_usage.reads_rs2;
+        curr_rs1 = head_usage.reads_rs1 ? (fused.instruction >> 15) & 0b11111 : 0;
+        curr_rs2 = head_usage.reads_rs2 ? (fused.instruction >> 20) & 0b11111 : 0;
+    }
+    bool second_rd = fused.kind != FusionKind::kNone && fused.rd != curr_rd;
+    uint64_t ex_cycle = cycle_s_ + 1;
+    uint64_t result_cycle = forwarding_unit_.ResultReadyCycle(ex_cycle, timing.latency,
+                                                              control_unit_.GetMemRead(), forwarding_enabled_,
+                                                              execute_stages_, memory_stages_);
+
     // ✅ FIX: Hazard detection with proper stall counting
     if (hazard_detection_enabled_)
     {
         bool should_stall = false;
+        // The first hazard found is the one charged, to the instruction that caused it
+        StallCause cause = StallCause::kRawNoForwarding;
+        uint64_t cause_pc = if_id_.pc;
+
+        auto fu_hazard = hazard_unit_.DetectScoreboardHazard(
+            scoreboard_, ex_cycle, usage,
+            curr_rs1, id_ex_next_.rs1_is_float,
+            curr_rs2, id_ex_next_.rs2_is_float, (instr >> 27) & 0b11111,
+            control_unit_.GetRegWrite(), curr_rd, unit, timing.count, result_cycle);
+        switch (fu_hazard)
+        {
+        case HazardDetectionUnit::ScoreboardHazard::RAW:
+        {
+            STAGE_LOG << "ID: SCOREBOARD RAW HAZARD - waiting for a multi-cycle result";
+            ++scoreboard_raw_stalls_;
+            should_stall = true;
+            // Charge the producer of the source that is ready last
+            uint8_t reg = 0;
+            bool reg_is_float = false;
+            uint64_t latest = 0;
+            auto consider = [&](bool reads, uint8_t source, bool is_float)
+            {
+                if (reads && (source != 0 || is_float) && scoreboard_.ReadyCycle(source, is_float) > latest)
+                {
+                    latest = scoreboard_.ReadyCycle(source, is_float);
+                    reg = source;
+                    reg_is_float = is_float;
+                }
+            };
+            consider(usage.reads_rs1, curr_rs1, id_ex_next_.rs1_is_float);
+            consider(usage.reads_rs2, curr_rs2, id_ex_next_.rs2_is_float);
+            consider(usage.reads_rs3, (instr >> 27) & 0b11111, true);
+            cause_pc = scoreboard_.producer_pc[reg_is_float][reg];
+            cause = !forwarding_enabled_                              ? StallCause::kRawNoForwarding
+                  : scoreboard_.producer_is_load[reg_is_float][reg] ? StallCause::kLoadUse
+                                                                    : StallCause::kExecuteLatency;
+            break;
+        }
+        case HazardDetectionUnit::ScoreboardHazard::WAW:
+            STAGE_LOG << "ID: SCOREBOARD WAW HAZARD on rd:" << curr_rd;
+            ++scoreboard_waw_stalls_;
+            should_stall = true;
+            cause = StallCause::kExecuteLatency;
+            cause_pc = scoreboard_.producer_pc[usage.rd_is_float][curr_rd];
+            break;
+        case HazardDetectionUnit::ScoreboardHazard::STRUCTURAL:
+            STAGE_LOG << "ID: STRUCTURAL HAZARD -" << FunctionalUnitName(unit) << "busy";
+            ++structural_stalls_;
+            should_stall = true;
+            cause = StallCause::kStructural;
+            cause_pc = scoreboard_.UnitOwner(unit, timing.count);
+            break;
+        case HazardDetectionUnit::ScoreboardHazard::NONE:
+            // Both destinations of a fused pair are written in the same cycle
+            if (second_rd && scoreboard_.ReadyCycle(fused.rd, false) > result_cycle)
+            {
+                STAGE_LOG << "ID: SCOREBOARD WAW HAZARD on the fused head's rd:" << fused.rd;
+                ++scoreboard_waw_stalls_;
+                should_stall = true;
+                cause = StallCause::kExecuteLatency;
+                cause_pc = scoreboard_.producer_pc[0][fused.rd];
+            }
+            break;
+        }
 
         bool load_use = hazard_unit_.DetectLoadUseHazard(
             id_ex_.rd,           // EX-stage destination register index (the load in EX)
@@ -319,64 +781,98 @@ void RVSSVMPipelined::ID_stage()
             id_ex_next_.rs2_is_float, // rs2_is_float for the ID-stage instruction
             id_ex_.is_float      // ex_is_float: whether EX-stage instruction writes to FPR
         );
+        // A load pair in EX also loads its head's destination
+        if (id_ex_.fused.kind == FusionKind::kLoadPair)
+            load_use = load_use || hazard_unit_.DetectLoadUseHazard(id_ex_.fused.rd, true, curr_rs1, curr_rs2,
+                                                                    id_ex_next_.rs1_is_float,
+                                                                    id_ex_next_.rs2_is_float, false);
 
         if (load_use)
         {
-            qDebug() << "ID: LOAD-USE HAZARD detected! rd:" << id_ex_.rd;
+            STAGE_LOG << "ID: LOAD-USE HAZARD detected! rd:" << id_ex_.rd;
+            if (!should_stall)
+            {
+                cause = StallCause::kLoadUse;
+                cause_pc = id_ex_.pc;
+            }
             should_stall = true;
         }
 
         if (!forwarding_enabled_)
         {
-            bool ex_hazard = hazard_unit_.DetectEXHazard(id_ex_.rd, id_ex_.reg_write, curr_rs1, curr_rs2);
-            bool mem_hazard = hazard_unit_.DetectMEMHazard(ex_mem_.rd, ex_mem_.reg_write, curr_rs1, curr_rs2);
+            bool ex_hazard = hazard_unit_.DetectEXHazard(id_ex_.rd, id_ex_.reg_write, curr_rs1, curr_rs2) ||
+                             hazard_unit_.DetectEXHazard(id_ex_.fused.rd, id_ex_.fused.kind != FusionKind::kNone,
+                                                         curr_rs1, curr_rs2);
+            bool mem_hazard = hazard_unit_.DetectMEMHazard(ex_mem_.rd, ex_mem_.reg_write, curr_rs1, curr_rs2) ||
+                              hazard_unit_.DetectMEMHazard(ex_mem_.fused.rd, ex_mem_.fused.kind != FusionKind::kNone,
+                                                           curr_rs1, curr_rs2);
             if (ex_hazard)
             {
-                qDebug() << "ID: EX HAZARD detected! rd:" << id_ex_.rd;
+                STAGE_LOG << "ID: EX HAZARD detected! rd:" << id_ex_.rd;
+                if (!should_stall)
+                    cause_pc = id_ex_.pc;
                 should_stall = true;
             }
             if (mem_hazard)
             {
-                qDebug() << "ID: MEM HAZARD detected! rd:" << ex_mem_.rd;
+                STAGE_LOG << "ID: MEM HAZARD detected! rd:" << ex_mem_.rd;
+                if (!should_stall)
+                    cause_pc = ex_mem_.pc;
                 should_stall = true;
             }
         }
 
         if (should_stall)
         {
-            qDebug() << "ID: STALLING pipeline";
+            STAGE_LOG << "ID: STALLING pipeline";
             stall_ = true;
             // ✅ FIX: Only increment stall counter once per stall event
             // The counter will be incremented in Step() or Run() once per cycle
             id_ex_next_ = ID_EX();
+            LoseIssueSlot(cause, cause_pc);
             return;
         }
     }
 
+    // Issue: book the unit and mark when the destination becomes available
+    scoreboard_.Issue(unit, timing, ex_cycle, control_unit_.GetRegWrite(), curr_rd, usage.rd_is_float,
+                      result_cycle, if_id_.pc, control_unit_.GetMemRead());
+    if (second_rd)
+        scoreboard_.Book(fused.rd, false, result_cycle, if_id_.pc - 4, control_unit_.GetMemRead());
+    ++functional_unit_ops_[static_cast<size_t>(unit)];
+    cpi_stack_.Issue();
+    if (fused.kind != FusionKind::kNone)
+    {
+        ++fused_pairs_[static_cast<size_t>(FusionKind::kNone)];
+        ++fused_pairs_[static_cast<size_t>(fused.kind)];
+    }
+
     // Continue with normal decode...
     id_ex_next_.valid = true;
+    id_ex_next_.seq = if_id_.seq;
     id_ex_next_.pc = if_id_.pc;
     id_ex_next_.instruction = instr;
     id_ex_next_.rs1 = curr_rs1;
     id_ex_next_.rs2 = curr_rs2;
-    id_ex_next_.rd = (instr >> 7) & 0b11111;
+    id_ex_next_.rd = curr_rd;
     id_ex_next_.funct3 = funct3;
     id_ex_next_.funct7 = funct7;
     id_ex_next_.imm = ImmGenerator(instr);
+    id_ex_next_.fused = fused;
 
-    qDebug() << "ID: rd:" << id_ex_next_.rd << "imm:" << id_ex_next_.imm;
+    STAGE_LOG << "ID: rd:" << id_ex_next_.rd << "imm:" << id_ex_next_.imm;
 
     // Register reading logic
     if (is_float_instr || is_double_instr)
     {
-        qDebug() << "ID: Reading floating-point registers";
+        STAGE_LOG << "ID: Reading floating-point registers";
 
         // For loads (FLW/FLD), rs1 is base address from GPR
         if (opcode == 0b0000111) // FLW/FLD
         {
             id_ex_next_.reg1_value = registers_->ReadGpr(curr_rs1);
             id_ex_next_.reg2_value = 0;
-            qDebug() << "ID: FLW/FLD - Base (GPR x" << curr_rs1 << "):"
+            STAGE_LOG << "ID: FLW/FLD - Base (GPR x" << curr_rs1 << "):"
                      << QString::number(id_ex_next_.reg1_value, 16);
         }
         // For stores (FSW/FSD), rs1 is base address (GPR), rs2 is data (FPR)
@@ -384,9 +880,9 @@ void RVSSVMPipelined::ID_stage()
         {
             id_ex_next_.reg1_value = registers_->ReadGpr(curr_rs1);
             id_ex_next_.reg2_value = registers_->ReadFpr(curr_rs2);
-            qDebug() << "ID: FSW/FSD - Base (GPR x" << curr_rs1 << "):"
+            STAGE_LOG << "ID: FSW/FSD - Base (GPR x" << curr_rs1 << "):"
                      << QString::number(id_ex_next_.reg1_value, 16);
-            qDebug() << "ID: FSW/FSD - Data (FPR f" << curr_rs2 << "):"
+            STAGE_LOG << "ID: FSW/FSD - Data (FPR f" << curr_rs2 << "):"
                      << QString::number(id_ex_next_.reg2_value, 16);
         }
         // For FCVT/FMV from integer to float
@@ -395,7 +891,7 @@ void RVSSVMPipelined::ID_stage()
         {
             id_ex_next_.reg1_value = registers_->ReadGpr(curr_rs1);
             id_ex_next_.reg2_value = 0;
-            qDebug() << "ID: FCVT/FMV int->float - Source (GPR x" << curr_rs1 << "):"
+            STAGE_LOG << "ID: FCVT/FMV int->float - Source (GPR x" << curr_rs1 << "):"
                      << QString::number(id_ex_next_.reg1_value, 16);
         }
         // For FCVT/FMV from float to integer, or FCLASS
@@ -404,7 +900,7 @@ void RVSSVMPipelined::ID_stage()
         {
             id_ex_next_.reg1_value = registers_->ReadFpr(curr_rs1);
             id_ex_next_.reg2_value = 0;
-            qDebug() << "ID: FCVT/FMV float->int - Source (FPR f" << curr_rs1 << "):"
+            STAGE_LOG << "ID: FCVT/FMV float->int - Source (FPR f" << curr_rs1 << "):"
                      << QString::number(id_ex_next_.reg1_value, 16);
         }
         // Standard FP operations
@@ -412,9 +908,9 @@ void RVSSVMPipelined::ID_stage()
         {
             id_ex_next_.reg1_value = registers_->ReadFpr(curr_rs1);
             id_ex_next_.reg2_value = registers_->ReadFpr(curr_rs2);
-            qDebug() << "ID: FP operation - rs1 (FPR f" << curr_rs1 << "):"
+            STAGE_LOG << "ID: FP operation - rs1 (FPR f" << curr_rs1 << "):"
                      << QString::number(id_ex_next_.reg1_value, 16);
-            qDebug() << "ID: FP operation - rs2 (FPR f" << curr_rs2 << "):"
+            STAGE_LOG << "ID: FP operation - rs2 (FPR f" << curr_rs2 << "):"
                      << QString::number(id_ex_next_.reg2_value, 16);
         }
 
@@ -423,7 +919,7 @@ void RVSSVMPipelined::ID_stage()
         id_ex_next_.reg3_value = registers_->ReadFpr(rs3);
         if (rs3 != 0)
         {
-            qDebug() << "ID: rs3 (FPR f" << rs3 << "):"
+            STAGE_LOG << "ID: rs3 (FPR f" << rs3 << "):"
                      << QString::number(id_ex_next_.reg3_value, 16);
         }
     }
@@ -431,13 +927,12 @@ void RVSSVMPipelined::ID_stage()
     {
         id_ex_next_.reg1_value = registers_->ReadGpr(curr_rs1);
         id_ex_next_.reg2_value = registers_->ReadGpr(curr_rs2);
-        qDebug() << "ID: Integer operation - rs1 (GPR x" << curr_rs1 << "):"
+        STAGE_LOG << "ID: Integer operation - rs1 (GPR x" << curr_rs1 << "):"
                  << QString::number(id_ex_next_.reg1_value, 16);
-        qDebug() << "ID: Integer operation - rs2 (GPR x" << curr_rs2 << "):"
+        STAGE_LOG << "ID: Integer operation - rs2 (GPR x" << curr_rs2 << "):"
                  << QString::number(id_ex_next_.reg2_value, 16);
     }
 
-    control_unit_.SetControlSignals(instr);
     id_ex_next_.reg_write = control_unit_.GetRegWrite();
     id_ex_next_.mem_read = control_unit_.GetMemRead();
     id_ex_next_.mem_write = control_unit_.GetMemWrite();
@@ -445,30 +940,48 @@ void RVSSVMPipelined::ID_stage()
     id_ex_next_.alu_src = control_unit_.GetAluSrc();
     id_ex_next_.branch = control_unit_.GetBranch();
 
-    qDebug() << "ID: Control signals - RegWrite:" << id_ex_next_.reg_write
+    STAGE_LOG << "ID: Control signals - RegWrite:" << id_ex_next_.reg_write
              << "MemRead:" << id_ex_next_.mem_read
              << "MemWrite:" << id_ex_next_.mem_write
              << "MemToReg:" << id_ex_next_.mem_to_reg
              << "AluSrc:" << id_ex_next_.alu_src
              << "Branch:" << id_ex_next_.branch;
-    qDebug() << "=== ID STAGE END ===\n";
+    STAGE_LOG << "=== ID STAGE END ===\n";
 }
 
+template <ISA kIsa>
 void RVSSVMPipelined::EX_stage()
 {
-    qDebug() << "\n=== EX STAGE START ===";
+    STAGE_LOG << "\n=== EX STAGE START ===";
+
+    if (pending_redirect_.valid)
+    {
+        STAGE_LOG << "EX: Wrong path behind a mispredicted branch - bubble";
+        ex_mem_next_.valid = false;
+        // The branch reaches the last EX stage this cycle
+        if (--pending_redirect_.cycles_left == 0)
+        {
+            ApplyRedirect(pending_redirect_);
+            pending_redirect_ = PendingRedirect();
+        }
+        return;
+    }
 
     if (!id_ex_.valid)
     {
-        qDebug() << "EX: Invalid instruction - bubble";
+        STAGE_LOG << "EX: Invalid instruction - bubble";
         ex_mem_next_.valid = false;
         return;
     }
 
-    qDebug() << "EX: PC:" << QString::number(id_ex_.pc, 16)
+    STAGE_LOG << "EX: PC:" << QString::number(id_ex_.pc, 16)
              << "Instruction:" << QString::number(id_ex_.instruction, 16);
 
+    // ID may have decoded a younger instruction since this one (or none, after undo or a snapshot load)
+    control_unit_.SetControlSignals(id_ex_.instruction);
+
     ex_mem_next_.valid = true;
+    ex_mem_next_.seq = id_ex_.seq;
     ex_mem_next_.pc = id_ex_.pc;
     ex_mem_next_.instruction = id_ex_.instruction;
     ex_mem_next_.rd = id_ex_.rd;
@@ -478,20 +991,21 @@ void RVSSVMPipelined::EX_stage()
     ex_mem_next_.mem_to_reg = id_ex_.mem_to_reg;
     ex_mem_next_.is_float = id_ex_.is_float;
     ex_mem_next_.is_syscall = id_ex_.is_syscall;
+    ex_mem_next_.fused = id_ex_.fused;
 
     uint8_t opcode = id_ex_.instruction & 0x7F;
     uint8_t funct3 = id_ex_.funct3;
     uint8_t funct7 = id_ex_.funct7;
 
-    qDebug() << "EX: Opcode:" << QString::number(opcode, 2).rightJustified(7, '0');
+    STAGE_LOG << "EX: Opcode:" << QString::number(opcode, 2).rightJustified(7, '0');
 
     // ✅ Handle system calls
     if (id_ex_.is_syscall)
     {
-        qDebug() << "EX: Processing ECALL";
+        STAGE_LOG << "EX: Processing ECALL";
         ex_mem_next_.alu_result = 0;
         ex_mem_next_.reg2_value = 0;
-        qDebug() << "=== EX STAGE END ===\n";
+        STAGE_LOG << "=== EX STAGE END ===\n";
         return;
     }
 
@@ -556,7 +1070,7 @@ void RVSSVMPipelined::EX_stage()
         rd_writes_to_fpr = false;
     }
 
-    qDebug() << "EX: Register files - rs1_is_float:" << rs1_is_float
+    STAGE_LOG << "EX: Register files - rs1_is_float:" << rs1_is_float
              << "rs2_is_float:" << rs2_is_float
              << "rd_writes_to_fpr:" << rd_writes_to_fpr;
 
@@ -569,90 +1083,52 @@ void RVSSVMPipelined::EX_stage()
     uint64_t op3 = id_ex_.reg3_value;
     uint64_t store_data = id_ex_.reg2_value;
 
-    qDebug() << "EX: Initial op1:" << QString::number(op1, 16);
-    qDebug() << "EX: Initial op2:" << QString::number(op2, 16);
-    qDebug() << "EX: Initial op3:" << QString::number(op3, 16);
+    STAGE_LOG << "EX: Initial op1:" << QString::number(op1, 16);
+    STAGE_LOG << "EX: Initial op2:" << QString::number(op2, 16);
+    STAGE_LOG << "EX: Initial op3:" << QString::number(op3, 16);
 
     // ✅ CRITICAL FIX: Apply forwarding with correct register file awareness
     if (forwarding_enabled_)
     {
-        qDebug() << "EX: Applying forwarding...";
+        STAGE_LOG << "EX: Applying forwarding...";
 
-        // ✅ Forward rs1 with register file type checking
         if (!(rs1_is_float == false && id_ex_.rs1 == 0))  // Don't forward GPR x0
         {
-            auto rs1_src = forwarding_unit_.GetRs1Source(
-                ex_mem_.reg_write, ex_mem_.rd,
-                mem_wb_.reg_write, mem_wb_.rd,
-                id_ex_.rs1,
-                rs1_is_float,      // ✅ Is current instruction reading from FPR?
-                ex_mem_.is_float,  // ✅ Is EX/MEM writing to FPR?
-                mem_wb_.is_float   // ✅ Is MEM/WB writing to FPR?
-                );
-
-            if (rs1_src == ForwardingUnit::ForwardingSource::FROM_EX_MEM)
-            {
-                op1 = ex_mem_.alu_result;
-                qDebug() << "EX: FORWARDING rs1 from EX/MEM:" << QString::number(op1, 16);
-            }
-            else if (rs1_src == ForwardingUnit::ForwardingSource::FROM_MEM_WB)
-            {
-                op1 = mem_wb_.mem_to_reg ? mem_wb_.mem_data : mem_wb_.alu_result;
-                qDebug() << "EX: FORWARDING rs1 from MEM/WB:" << QString::number(op1, 16);
-            }
+            op1 = ForwardOperand(id_ex_.rs1, rs1_is_float, op1);
+            STAGE_LOG << "EX: rs1 after forwarding:" << QString::number(op1, 16);
         }
         else
         {
             op1 = 0;  // GPR x0 is always zero
-            qDebug() << "EX: rs1 is x0, forcing to 0";
+            STAGE_LOG << "EX: rs1 is x0, forcing to 0";
         }
 
-        // ✅ Forward rs2 with register file type checking
         if (!(rs2_is_float == false && id_ex_.rs2 == 0))  // Don't forward GPR x0
         {
-            auto rs2_src = forwarding_unit_.GetRs2Source(
-                ex_mem_.reg_write, ex_mem_.rd,
-                mem_wb_.reg_write, mem_wb_.rd,
-                id_ex_.rs2,
-                rs2_is_float,
-                ex_mem_.is_float,
-                mem_wb_.is_float
-                );
-
-            if (rs2_src == ForwardingUnit::ForwardingSource::FROM_EX_MEM)
-            {
-                op2 = ex_mem_.alu_result;
-                store_data = ex_mem_.alu_result;
-                qDebug() << "EX: FORWARDING rs2 from EX/MEM:" << QString::number(op2, 16);
-            }
-            else if (rs2_src == ForwardingUnit::ForwardingSource::FROM_MEM_WB)
-            {
-                uint64_t fwd = mem_wb_.mem_to_reg ? mem_wb_.mem_data : mem_wb_.alu_result;
-                op2 = fwd;
-                store_data = fwd;
-                qDebug() << "EX: FORWARDING rs2 from MEM/WB:" << QString::number(op2, 16);
-            }
+            op2 = ForwardOperand(id_ex_.rs2, rs2_is_float, op2);
+            store_data = op2;
+            STAGE_LOG << "EX: rs2 after forwarding:" << QString::number(op2, 16);
         }
         else
         {
             op2 = 0;  // GPR x0 is always zero
             store_data = 0;
-            qDebug() << "EX: rs2 is x0, forcing to 0";
+            STAGE_LOG << "EX: rs2 is x0, forcing to 0";
         }
     }
 
     // Handle floating-point instructions
     if (id_ex_.is_float)
     {
-        qDebug() << "EX: >>> FLOATING-POINT EXECUTION <<<";
+        STAGE_LOG << "EX: >>> FLOATING-POINT EXECUTION <<<";
 
         // Handle FLW/FLD (address calculation)
         if (opcode == 0b0000111)
         {
             ex_mem_next_.alu_result = op1 + static_cast<int64_t>(id_ex_.imm);
             ex_mem_next_.reg2_value = 0;
-            qDebug() << "EX: FLW/FLD address = " << QString::number(ex_mem_next_.alu_result, 16);
-            qDebug() << "=== EX STAGE END ===\n";
+            STAGE_LOG << "EX: FLW/FLD address = " << QString::number(ex_mem_next_.alu_result, 16);
+            STAGE_LOG << "=== EX STAGE END ===\n";
             return;
         }
 
@@ -661,9 +1137,9 @@ void RVSSVMPipelined::EX_stage()
         {
             ex_mem_next_.alu_result = op1 + static_cast<int64_t>(id_ex_.imm);
             ex_mem_next_.reg2_value = store_data;
-            qDebug() << "EX: FSW/FSD address = " << QString::number(ex_mem_next_.alu_result, 16);
-            qDebug() << "EX: Store data = " << QString::number(store_data, 16);
-            qDebug() << "=== EX STAGE END ===\n";
+            STAGE_LOG << "EX: FSW/FSD address = " << QString::number(ex_mem_next_.alu_result, 16);
+            STAGE_LOG << "EX: Store data = " << QString::number(store_data, 16);
+            STAGE_LOG << "=== EX STAGE END ===\n";
             return;
         }
 
@@ -672,7 +1148,7 @@ void RVSSVMPipelined::EX_stage()
         if (rm == 0b111)
         {
             rm = registers_->ReadCsr(0x002);
-            qDebug() << "EX: Using dynamic rounding mode:" << rm;
+            STAGE_LOG << "EX: Using dynamic rounding mode:" << rm;
         }
 
         if (id_ex_.alu_src)
@@ -684,7 +1160,7 @@ void RVSSVMPipelined::EX_stage()
         uint8_t fcsr_status = 0;
         bool is_double = instruction_set::isDInstruction(id_ex_.instruction);
 
-        if (is_double && registers_->GetIsa() == ISA::RV64)
+        if (is_double && kIsa == ISA::RV64)
         {
             std::tie(ex_mem_next_.alu_result, fcsr_status) =
                 alu::Alu::dfpexecute(aluOperation, op1, op2, op3, rm);
@@ -695,18 +1171,29 @@ void RVSSVMPipelined::EX_stage()
                 alu::Alu::fpexecute(aluOperation, op1, op2, op3, rm);
         }
 
-        qDebug() << "EX: FP result:" << QString::number(ex_mem_next_.alu_result, 16);
+        STAGE_LOG << "EX: FP result:" << QString::number(ex_mem_next_.alu_result, 16);
 
+        if (LogsInFlightWrites())
+            in_flight_writes_.push_back({id_ex_.seq, 0, registers_->ReadCsr(0x003), fcsr_status, 0});
         registers_->WriteCsr(0x003, fcsr_status);
         emit csrUpdated(0x003, fcsr_status);
 
         ex_mem_next_.reg2_value = store_data;
-        qDebug() << "=== EX STAGE END ===\n";
+        STAGE_LOG << "=== EX STAGE END ===\n";
         return;
     }
 
     // Regular integer execution path
-    qDebug() << "EX: Integer execution path";
+    STAGE_LOG << "EX: Integer execution path";
+
+    // A fused head executes first and hands its result to the tail as rs1
+    if (id_ex_.fused.kind != FusionKind::kNone)
+    {
+        ex_mem_next_.fused.value = ExecuteFusedHead(op1, op2);
+        if (id_ex_.fused.kind != FusionKind::kLoadPair)
+            op1 = ex_mem_next_.fused.value;
+        STAGE_LOG << "EX: Fused head result:" << QString::number(ex_mem_next_.fused.value, 16);
+    }
 
     // Handle special instruction types
     if (opcode == 0b0110111) // LUI
@@ -728,29 +1215,185 @@ void RVSSVMPipelined::EX_stage()
     bool overflow = false;
     std::tie(ex_mem_next_.alu_result, overflow) = alu_.execute(aluOperation, op1, op2);
 
-    qDebug() << "EX: ALU result:" << QString::number(ex_mem_next_.alu_result, 16);
+    STAGE_LOG << "EX: ALU result:" << QString::number(ex_mem_next_.alu_result, 16);
 
     ex_mem_next_.reg2_value = store_data;
     ex_mem_next_.branch_taken = false;
 
-    // Branch and jump handling remains the same...
-    // [Keep your existing branch/jump code here]
+    // Resolve branches and jumps; if IF fetched down the wrong path, flush the two younger
+    // instructions and redirect fetch
+    bool is_branch = opcode == 0b1100011;
+    bool is_jump = opcode == 0b1101111 || opcode == 0b1100111;
+    if (is_branch || is_jump)
+    {
+        bool taken = is_jump;
+        uint64_t target = id_ex_.pc + static_cast<int64_t>(id_ex_.imm);
+        if (opcode == 0b1100111) // JALR
+            target = (op1 + static_cast<int64_t>(id_ex_.imm)) & ~1ULL;
+
+        if (is_branch)
+        {
+            switch (funct3)
+            {
+            case 0b000: taken = op1 == op2; break; // BEQ
+            case 0b001: taken = op1 != op2; break; // BNE
+            case 0b100: taken = static_cast<int64_t>(op1) < static_cast<int64_t>(op2); break; // BLT
+            case 0b101: taken = static_cast<int64_t>(op1) >= static_cast<int64_t>(op2); break; // BGE
+            case 0b110: taken = op1 < op2; break; // BLTU
+            case 0b111: taken = op1 >= op2; break; // BGEU
+            }
+            ++conditional_branches_;
+            if (taken != id_ex_.predicted_taken)
+                ++direction_mispredictions_;
+        }
+        else
+        {
+            ex_mem_next_.alu_result = id_ex_.pc + 4; // link address
+        }
+
+        ex_mem_next_.branch_taken = taken;
+        ex_mem_next_.branch_target = target;
+        TrainBranchPredictor(id_ex_.pc, id_ex_.instruction, taken, target);
+
+        uint64_t next_pc = taken ? target : id_ex_.pc + 4;
+        bool mispredicted = next_pc != id_ex_.predicted_pc;
+        ReturnAddressStack::Action ras_action = ReturnAddressStack::ActionFor(id_ex_.instruction);
+        if (opcode == 0b1100111 && ras_action.pop)
+        {
+            ++returns_;
+            return_mispredictions_ += mispredicted;
+        }
+        else if (opcode == 0b1100111)
+        {
+            ++indirect_jumps_;
+            indirect_mispredictions_ += mispredicted;
+        }
+
+        if (mispredicted)
+        {
+            STAGE_LOG << "EX: MISPREDICTED - predicted:" << QString::number(id_ex_.predicted_pc, 16)
+                     << "actual:" << QString::number(next_pc, 16);
+            ++branch_mispredictions_;
+            PendingRedirect redirect;
+            redirect.valid = true;
+            redirect.cycles_left = execute_stages_ - 1;
+            redirect.pc = next_pc;
+            redirect.branch_pc = id_ex_.pc;
+            redirect.instruction = id_ex_.instruction;
+            redirect.ras_checkpoint = id_ex_.ras_checkpoint;
+            if (redirect.cycles_left == 0)
+                ApplyRedirect(redirect);
+            else
+                pending_redirect_ = redirect;
+        }
+        STAGE_LOG << "EX:" << (is_jump ? "Jump" : "Branch") << (taken ? "TAKEN" : "NOT_TAKEN")
+                 << "next PC:" << QString::number(next_pc, 16);
+    }
+
+    STAGE_LOG << "=== EX STAGE END ===\n";
+}
+
+void RVSSVMPipelined::ApplyRedirect(const PendingRedirect &redirect)
+{
+    control_pc_ = redirect.branch_pc;
+    pc_update_pending_ = true;
+    pc_update_value_ = redirect.pc;
+    flush_pipeline_ = true;
+    // Undo the wrong path's pushes and pops, then redo this instruction's own
+    if (branch_prediction_enabled_)
+    {
+        return_stack_.Restore(redirect.ras_checkpoint);
+        return_stack_.Apply(ReturnAddressStack::ActionFor(redirect.instruction), redirect.branch_pc + 4);
+    }
+}
+
+uint64_t RVSSVMPipelined::ExecuteFusedHead(uint64_t rs1_value, uint64_t rs2_value)
+{
+    const FusedHead &head = id_ex_.fused;
+    uint8_t opcode = head.instruction & 0x7F;
+    int64_t imm = ImmGenerator(head.instruction);
+    if (head.kind == FusionKind::kLoadPair)
+        return rs1_value + imm;
+
+    uint64_t op1 = rs1_value;
+    uint64_t op2 = rs2_value;
+    if (opcode == 0b0110111) // LUI
+    {
+        op1 = 0;
+        op2 = static_cast<uint64_t>(imm) << 12;
+    }
+    else if (opcode == 0b0010111) // AUIPC
+    {
+        op1 = id_ex_.pc - 4;
+        op2 = static_cast<uint64_t>(imm) << 12;
+    }
+    else if (opcode == 0b0010011) // slli
+    {
+        op2 = static_cast<uint64_t>(imm);
+    }
 
-    qDebug() << "=== EX STAGE END ===\n";
+    control_unit_.SetControlSignals(head.instruction);
+    alu::AluOp operation = control_unit_.GetAluSignal(head.instruction, control_unit_.GetAluOp());
+    control_unit_.SetControlSignals(id_ex_.instruction);
+    return alu_.execute(operation, op1, op2).first;
 }
 
+uint64_t RVSSVMPipelined::ForwardOperand(uint8_t reg, bool is_float, uint64_t value) const
+{
+    auto writes = [&](bool valid, bool reg_write, uint8_t rd, bool rd_is_float)
+    {
+        return valid && reg_write && rd == reg && rd_is_float == is_float && (rd != 0 || is_float);
+    };
+    // The head of a fused pair is older than its tail, so it only counts when the tail doesn't write `reg`
+    auto head_writes = [&](const FusedHead &head)
+    {
+        return head.kind != FusionKind::kNone && head.rd == reg && !is_float;
+    };
+
+    // Younger results win: the extra EX stages, EX/MEM, the extra MEM stages, then MEM/WB
+    for (size_t i = 0; i + 1 < execute_stages_; ++i)
+    {
+        const EX_MEM &latch = pipes_.execute[i];
+        if (writes(latch.valid, latch.reg_write, latch.rd, latch.is_float))
+            return latch.alu_result;
+        if (latch.valid && head_writes(latch.fused))
+            return latch.fused.value;
+    }
+    auto source = forwarding_unit_.GetRs1Source(ex_mem_.reg_write, ex_mem_.rd,
+                                                mem_wb_.reg_write, mem_wb_.rd,
+                                                reg, is_float, ex_mem_.is_float, mem_wb_.is_float);
+    if (source == ForwardingUnit::ForwardingSource::FROM_EX_MEM)
+        return ex_mem_.alu_result;
+    if (head_writes(ex_mem_.fused))
+        return ex_mem_.fused.value;
+    for (size_t i = 0; i + 1 < memory_stages_; ++i)
+    {
+        const MEM_WB &latch = pipes_.memory[i];
+        if (writes(latch.valid, latch.reg_write, latch.rd, latch.is_float))
+            return latch.mem_to_reg ? latch.mem_data : latch.alu_result;
+        if (latch.valid && head_writes(latch.fused))
+            return latch.fused.value;
+    }
+    if (source == ForwardingUnit::ForwardingSource::FROM_MEM_WB)
+        return mem_wb_.mem_to_reg ? mem_wb_.mem_data : mem_wb_.alu_result;
+    if (head_writes(mem_wb_.fused))
+        return mem_wb_.fused.value;
+    return value;
+}
+
+template <ISA kIsa>
 void RVSSVMPipelined::MEM_stage()
 {
-    qDebug() << "\n=== MEM STAGE START ===";
+    STAGE_LOG << "\n=== MEM STAGE START ===";
 
     if (!ex_mem_.valid)
     {
-        qDebug() << "MEM: Invalid instruction - bubble";
+        STAGE_LOG << "MEM: Invalid instruction - bubble";
         mem_wb_next_.valid = false;
         return;
     }
 
-    qDebug() << "MEM: PC:" << QString::number(ex_mem_.pc, 16)
+    STAGE_LOG << "MEM: PC:" << QString::number(ex_mem_.pc, 16)
              << "Instruction:" << QString::number(ex_mem_.instruction, 16);
 
     mem_wb_next_.valid = true;
@@ -758,16 +1401,21 @@ void RVSSVMPipelined::MEM_stage()
     mem_wb_next_.reg_write = ex_mem_.reg_write;
     mem_wb_next_.mem_to_reg = ex_mem_.mem_to_reg;
     mem_wb_next_.alu_result = ex_mem_.alu_result;
+    mem_wb_next_.store_data = ex_mem_.reg2_value;
+    mem_wb_next_.seq = ex_mem_.seq;
     mem_wb_next_.pc = ex_mem_.pc;
     mem_wb_next_.is_float = ex_mem_.is_float;
     mem_wb_next_.instruction = ex_mem_.instruction;
     mem_wb_next_.is_syscall = ex_mem_.is_syscall;
+    mem_wb_next_.branch_taken = ex_mem_.branch_taken;
+    mem_wb_next_.branch_target = ex_mem_.branch_target;
+    mem_wb_next_.fused = ex_mem_.fused;
 
     uint8_t opcode = ex_mem_.instruction & 0x7F;
     uint8_t funct3 = (ex_mem_.instruction >> 12) & 0b111;
 
-    qDebug() << "MEM: rd:" << mem_wb_next_.rd << "is_float:" << mem_wb_next_.is_float;
-    qDebug() << "MEM: ALU result:" << QString::number(ex_mem_.alu_result, 16);
+    STAGE_LOG << "MEM: rd:" << mem_wb_next_.rd << "is_float:" << mem_wb_next_.is_float;
+    STAGE_LOG << "MEM: ALU result:" << QString::number(ex_mem_.alu_result, 16);
 
     // ✅ FIX: Alignment checks BEFORE memory access
     if (ex_mem_.mem_read || ex_mem_.mem_write)
@@ -782,7 +1430,7 @@ void RVSSVMPipelined::MEM_stage()
             if (addr & 0x1)
             {
                 alignment_ok = false;
-                qDebug() << "MEM: 2-byte alignment violation";
+                STAGE_LOG << "MEM: 2-byte alignment violation";
             }
             break;
         case 0b010: // LW/SW/FLW/FSW - 4-byte alignment
@@ -790,14 +1438,14 @@ void RVSSVMPipelined::MEM_stage()
             if (addr & 0x3)
             {
                 alignment_ok = false;
-                qDebug() << "MEM: 4-byte alignment violation";
+                STAGE_LOG << "MEM: 4-byte alignment violation";
             }
             break;
         case 0b011: // LD/SD/FLD/FSD - 8-byte alignment
             if (addr & 0x7)
             {
                 alignment_ok = false;
-                qDebug() << "MEM: 8-byte alignment violation";
+                STAGE_LOG << "MEM: 8-byte alignment violation";
             }
             break;
         case 0b000: // LB/SB - no alignment required
@@ -808,7 +1456,7 @@ void RVSSVMPipelined::MEM_stage()
 
         if (!alignment_ok)
         {
-            qDebug() << "MEM: *** ALIGNMENT FAULT at address"
+            STAGE_LOG << "MEM: *** ALIGNMENT FAULT at address"
                      << QString::number(addr, 16) << "***";
             output_status_ = "VM_ALIGNMENT_FAULT";
             stop_requested_ = true;
@@ -820,62 +1468,40 @@ void RVSSVMPipelined::MEM_stage()
     // Handle floating-point loads
     if (ex_mem_.mem_read)
     {
-        qDebug() << "MEM: *** MEMORY READ ***";
-        qDebug() << "MEM: Address:" << QString::number(ex_mem_.alu_result, 16);
+        STAGE_LOG << "MEM: *** MEMORY READ ***";
+        STAGE_LOG << "MEM: Address:" << QString::number(ex_mem_.alu_result, 16);
 
         if (opcode == 0b0000111) // FLW/FLD
         {
-            qDebug() << "MEM: Floating-point load operation";
+            STAGE_LOG << "MEM: Floating-point load operation";
             if (funct3 == 0b010) // FLW
             {
                 uint32_t raw_value = memory_controller_.ReadWord(ex_mem_.alu_result);
                 // NaN-box for single precision
                 mem_wb_next_.mem_data = 0xFFFFFFFF00000000ULL | raw_value;
-                qDebug() << "MEM: FLW - Raw value:" << QString::number(raw_value, 16);
-                qDebug() << "MEM: FLW - NaN-boxed:" << QString::number(mem_wb_next_.mem_data, 16);
+                STAGE_LOG << "MEM: FLW - Raw value:" << QString::number(raw_value, 16);
+                STAGE_LOG << "MEM: FLW - NaN-boxed:" << QString::number(mem_wb_next_.mem_data, 16);
             }
             else if (funct3 == 0b011) // FLD
             {
-                if (registers_->GetIsa() == ISA::RV64)
+                if constexpr (kIsa == ISA::RV64)
                 {
                     mem_wb_next_.mem_data = memory_controller_.ReadDoubleWord(ex_mem_.alu_result);
-                    qDebug() << "MEM: FLD - Value:" << QString::number(mem_wb_next_.mem_data, 16);
+                    STAGE_LOG << "MEM: FLD - Value:" << QString::number(mem_wb_next_.mem_data, 16);
                 }
             }
         }
         else // Integer loads
         {
-            qDebug() << "MEM: Integer load operation - funct3:" << QString::number(funct3, 2);
-            switch (funct3)
+            STAGE_LOG << "MEM: Integer load operation - funct3:" << QString::number(funct3, 2);
+            mem_wb_next_.mem_data = LoadIntegerData(ex_mem_.alu_result, funct3);
+            STAGE_LOG << "MEM: Loaded:" << QString::number(mem_wb_next_.mem_data, 16);
+
+            // The head of a load pair reads the element below with the same width and alignment
+            if (ex_mem_.fused.kind == FusionKind::kLoadPair)
             {
-            case 0b000:
-                mem_wb_next_.mem_data = static_cast<int8_t>(memory_controller_.ReadByte(ex_mem_.alu_result));
-                qDebug() << "MEM: LB (signed byte):" << QString::number(mem_wb_next_.mem_data, 16);
-                break;
-            case 0b001:
-                mem_wb_next_.mem_data = static_cast<int16_t>(memory_controller_.ReadHalfWord(ex_mem_.alu_result));
-                qDebug() << "MEM: LH (signed halfword):" << QString::number(mem_wb_next_.mem_data, 16);
-                break;
-            case 0b010:
-                mem_wb_next_.mem_data = static_cast<int32_t>(memory_controller_.ReadWord(ex_mem_.alu_result));
-                qDebug() << "MEM: LW (signed word):" << QString::number(mem_wb_next_.mem_data, 16);
-                break;
-            case 0b011:
-                mem_wb_next_.mem_data = memory_controller_.ReadDoubleWord(ex_mem_.alu_result);
-                qDebug() << "MEM: LD (doubleword):" << QString::number(mem_wb_next_.mem_data, 16);
-                break;
-            case 0b100:
-                mem_wb_next_.mem_data = memory_controller_.ReadByte(ex_mem_.alu_result);
-                qDebug() << "MEM: LBU (unsigned byte):" << QString::number(mem_wb_next_.mem_data, 16);
-                break;
-            case 0b101:
-                mem_wb_next_.mem_data = memory_controller_.ReadHalfWord(ex_mem_.alu_result);
-                qDebug() << "MEM: LHU (unsigned halfword):" << QString::number(mem_wb_next_.mem_data, 16);
-                break;
-            case 0b110:
-                mem_wb_next_.mem_data = memory_controller_.ReadWord(ex_mem_.alu_result);
-                qDebug() << "MEM: LWU (unsigned word):" << QString::number(mem_wb_next_.mem_data, 16);
-                break;
+                mem_wb_next_.fused.value = LoadIntegerData(ex_mem_.fused.value, funct3);
+                STAGE_LOG << "MEM: Load pair head loaded:" << QString::number(mem_wb_next_.fused.value, 16);
             }
         }
     }
@@ -883,13 +1509,23 @@ void RVSSVMPipelined::MEM_stage()
     // Handle stores (floating-point and integer)
     if (ex_mem_.mem_write)
     {
-        qDebug() << "MEM: *** MEMORY WRITE ***";
-        qDebug() << "MEM: Address:" << QString::number(ex_mem_.alu_result, 16);
-        qDebug() << "MEM: Data:" << QString::number(ex_mem_.reg2_value, 16);
+        STAGE_LOG << "MEM: *** MEMORY WRITE ***";
+        STAGE_LOG << "MEM: Address:" << QString::number(ex_mem_.alu_result, 16);
+        STAGE_LOG << "MEM: Data:" << QString::number(ex_mem_.reg2_value, 16);
+
+        // SB/SH/SW/SD and FSW/FSD encode the access size the same way
+        if (LogsInFlightWrites() && (kIsa == ISA::RV64 || funct3 != 0b011))
+        {
+            uint8_t size = 1 << (funct3 & 0b11);
+            uint64_t old_value = 0;
+            for (uint8_t i = 0; i < size; ++i)
+                old_value |= static_cast<uint64_t>(memory_controller_.ReadByte_d(ex_mem_.alu_result + i)) << (8 * i);
+            in_flight_writes_.push_back({ex_mem_.seq, ex_mem_.alu_result, old_value, ex_mem_.reg2_value, size});
+        }
 
         if (opcode == 0b0100111) // FSW/FSD
         {
-            qDebug() << "MEM: Floating-point store operation";
+            STAGE_LOG << "MEM: Floating-point store operation";
 
             if (recording_enabled_)
             {
@@ -898,24 +1534,24 @@ void RVSSVMPipelined::MEM_stage()
 
                 if (funct3 == 0b010) // FSW
                 {
-                    qDebug() << "ex_mem_.reg2-value " << QString::number(ex_mem_.reg2_value,16);
-                    uint32_t old_val = memory_controller_.ReadWord(ex_mem_.alu_result);
+                    STAGE_LOG << "ex_mem_.reg2-value " << QString::number(ex_mem_.reg2_value,16);
+                    uint32_t old_val = memory_controller_.ReadWord_d(ex_mem_.alu_result);
                     for (int i = 0; i < 4; ++i)
                         mem_change.old_bytes_vec.push_back((old_val >> (i * 8)) & 0xFF);
                     uint32_t new_val = ex_mem_.reg2_value & 0xFFFFFFFF;
                     for (int i = 0; i < 4; ++i)
                         mem_change.new_bytes_vec.push_back((new_val >> (i * 8)) & 0xFF);
-                    qDebug() << "MEM: FSW - Old:" << QString::number(old_val, 16)
+                    STAGE_LOG << "MEM: FSW - Old:" << QString::number(old_val, 16)
                              << "New:" << QString::number(new_val, 16);
                 }
                 else if (funct3 == 0b011) // FSD
                 {
-                    uint64_t old_val = memory_controller_.ReadDoubleWord(ex_mem_.alu_result);
+                    uint64_t old_val = memory_controller_.ReadDoubleWord_d(ex_mem_.alu_result);
                     for (int i = 0; i < 8; ++i)
                         mem_change.old_bytes_vec.push_back((old_val >> (i * 8)) & 0xFF);
                     for (int i = 0; i < 8; ++i)
                         mem_change.new_bytes_vec.push_back((ex_mem_.reg2_value >> (i * 8)) & 0xFF);
-                    qDebug() << "MEM: FSD - Old:" << QString::number(old_val, 16)
+                    STAGE_LOG << "MEM: FSD - Old:" << QString::number(old_val, 16)
                              << "New:" << QString::number(ex_mem_.reg2_value, 16);
                 }
                 current_delta_.memory_changes.push_back(mem_change);
@@ -926,17 +1562,17 @@ void RVSSVMPipelined::MEM_stage()
             {
                 uint32_t store_val = ex_mem_.reg2_value & 0xFFFFFFFF;
                 memory_controller_.WriteWord(ex_mem_.alu_result, store_val);
-                qDebug() << "MEM: FSW written - Value:" << QString::number(store_val, 16);
+                STAGE_LOG << "MEM: FSW written - Value:" << QString::number(store_val, 16);
             }
-            else if (funct3 == 0b011 && registers_->GetIsa() == ISA::RV64) // FSD
+            else if (funct3 == 0b011 && kIsa == ISA::RV64) // FSD
             {
                 memory_controller_.WriteDoubleWord(ex_mem_.alu_result, ex_mem_.reg2_value);
-                qDebug() << "MEM: FSD written - Value:" << QString::number(ex_mem_.reg2_value, 16);
+                STAGE_LOG << "MEM: FSD written - Value:" << QString::number(ex_mem_.reg2_value, 16);
             }
         }
         else // Integer stores
         {
-            qDebug() << "MEM: Integer store operation - funct3:" << QString::number(funct3, 2);
+            STAGE_LOG << "MEM: Integer store operation - funct3:" << QString::number(funct3, 2);
 
             if (recording_enabled_)
             {
@@ -946,41 +1582,41 @@ void RVSSVMPipelined::MEM_stage()
                 switch (funct3)
                 {
                 case 0b000: // SB
-                    mem_change.old_bytes_vec.push_back(memory_controller_.ReadByte(ex_mem_.alu_result));
+                    mem_change.old_bytes_vec.push_back(memory_controller_.ReadByte_d(ex_mem_.alu_result));
                     mem_change.new_bytes_vec.push_back(ex_mem_.reg2_value & 0xFF);
-                    qDebug() << "MEM: SB recording";
+                    STAGE_LOG << "MEM: SB recording";
                     break;
                 case 0b001: // SH
                 {
-                    uint16_t old_val = memory_controller_.ReadHalfWord(ex_mem_.alu_result);
+                    uint16_t old_val = memory_controller_.ReadHalfWord_d(ex_mem_.alu_result);
                     mem_change.old_bytes_vec.push_back(old_val & 0xFF);
                     mem_change.old_bytes_vec.push_back((old_val >> 8) & 0xFF);
                     uint16_t new_val = ex_mem_.reg2_value & 0xFFFF;
                     mem_change.new_bytes_vec.push_back(new_val & 0xFF);
                     mem_change.new_bytes_vec.push_back((new_val >> 8) & 0xFF);
-                    qDebug() << "MEM: SH recording";
+                    STAGE_LOG << "MEM: SH recording";
                     break;
                 }
                 case 0b010: // SW
                 {
-                    uint32_t old_val = memory_controller_.ReadWord(ex_mem_.alu_result);
+                    uint32_t old_val = memory_controller_.ReadWord_d(ex_mem_.alu_result);
                     for (int i = 0; i < 4; ++i)
                         mem_change.old_bytes_vec.push_back((old_val >> (i * 8)) & 0xFF);
                     uint32_t new_val = ex_mem_.reg2_value & 0xFFFFFFFF;
                     for (int i = 0; i < 4; ++i)
                         mem_change.new_bytes_vec.push_back((new_val >> (i * 8)) & 0xFF);
-                    qDebug() << "MEM: SW recording";
+                    STAGE_LOG << "MEM: SW recording";
                     break;
                 }
                 case 0b011: // SD
-                    if (registers_->GetIsa() == ISA::RV64)
+                    if constexpr (kIsa == ISA::RV64)
                     {
-                        uint64_t old_val = memory_controller_.ReadDoubleWord(ex_mem_.alu_result);
+                        uint64_t old_val = memory_controller_.ReadDoubleWord_d(ex_mem_.alu_result);
                         for (int i = 0; i < 8; ++i)
                             mem_change.old_bytes_vec.push_back((old_val >> (i * 8)) & 0xFF);
                         for (int i = 0; i < 8; ++i)
                             mem_change.new_bytes_vec.push_back((ex_mem_.reg2_value >> (i * 8)) & 0xFF);
-                        qDebug() << "MEM: SD recording";
+                        STAGE_LOG << "MEM: SD recording";
                     }
                     break;
                 }
@@ -991,39 +1627,64 @@ void RVSSVMPipelined::MEM_stage()
             {
             case 0b000:
                 memory_controller_.WriteByte(ex_mem_.alu_result, ex_mem_.reg2_value & 0xFF);
-                qDebug() << "MEM: SB written";
+                STAGE_LOG << "MEM: SB written";
                 break;
             case 0b001:
                 memory_controller_.WriteHalfWord(ex_mem_.alu_result, ex_mem_.reg2_value & 0xFFFF);
-                qDebug() << "MEM: SH written";
+                STAGE_LOG << "MEM: SH written";
                 break;
             case 0b010:
                 memory_controller_.WriteWord(ex_mem_.alu_result, ex_mem_.reg2_value & 0xFFFFFFFF);
-                qDebug() << "MEM: SW written";
+                STAGE_LOG << "MEM: SW written";
                 break;
             case 0b011:
-                if (registers_->GetIsa() == ISA::RV64)
+                if constexpr (kIsa == ISA::RV64)
                 {
                     memory_controller_.WriteDoubleWord(ex_mem_.alu_result, ex_mem_.reg2_value);
-                    qDebug() << "MEM: SD written";
+                    STAGE_LOG << "MEM: SD written";
                 }
                 break;
             }
         }
     }
 
-    qDebug() << "=== MEM STAGE END ===\n";
+    STAGE_LOG << "=== MEM STAGE END ===\n";
+}
+
+uint64_t RVSSVMPipelined::LoadIntegerData(uint64_t address, uint8_t funct3)
+{
+    switch (funct3)
+    {
+    case 0b000: return static_cast<int8_t>(memory_controller_.ReadByte(address));      // LB
+    case 0b001: return static_cast<int16_t>(memory_controller_.ReadHalfWord(address)); // LH
+    case 0b010: return static_cast<int32_t>(memory_controller_.ReadWord(address));     // LW
+    case 0b011: return memory_controller_.ReadDoubleWord(address);                     // LD
+    case 0b100: return memory_controller_.ReadByte(address);                           // LBU
+    case 0b101: return memory_controller_.ReadHalfWord(address);                       // LHU
+    case 0b110: return memory_controller_.ReadWord(address);                           // LWU
+    }
+    return 0;
 }
 
 void RVSSVMPipelined::WB_stage()
 {
-    qDebug() << "\n=== MEM STAGE START ===";
+    STAGE_LOG << "\n=== MEM STAGE START ===";
 
     if (!mem_wb_.valid)
     {
         return;
     }
 
+    // A breakpoint on either half of a fused pair stops before that half retires
+    if (mem_wb_.fused.kind != FusionKind::kNone)
+    {
+        if (StopAtBreakpoint(mem_wb_.pc - 4))
+            return;
+        RetireFusedHead();
+    }
+    if (StopAtBreakpoint(mem_wb_.pc))
+        return;
+
     uint64_t write_val = mem_wb_.mem_to_reg ? mem_wb_.mem_data : mem_wb_.alu_result;
     uint8_t opcode = mem_wb_.instruction & 0x7F;
     uint8_t funct3 = (mem_wb_.instruction >> 12) & 0b111;
@@ -1101,15 +1762,78 @@ void RVSSVMPipelined::WB_stage()
     }
 
     instructions_retired_++;
+    instruction_mix_.Record(mem_wb_.instruction, mem_wb_.branch_taken);
+
+    if (!in_flight_writes_.empty())
+    {
+        uint64_t retired = mem_wb_.seq;
+        in_flight_writes_.erase(std::remove_if(in_flight_writes_.begin(), in_flight_writes_.end(),
+                                               [retired](const InFlightWrite &write) { return write.seq <= retired; }),
+                                in_flight_writes_.end());
+    }
+
+    if (lockstep_ && !lockstep_->Retire(DescribeRetirement(mem_wb_.pc, mem_wb_.instruction, *registers_,
+                                                           mem_wb_.alu_result, mem_wb_.store_data)))
+        stop_requested_ = true;
+}
+
+void RVSSVMPipelined::RetireFusedHead()
+{
+    // The head's write lands even when the tail overwrites it, so undo and the lockstep
+    // checker see the two instructions one after the other
+    const FusedHead &head = mem_wb_.fused;
+    if (recording_enabled_)
+    {
+        RegisterChange reg_change;
+        reg_change.reg_type = 0;
+        reg_change.reg_index = head.rd;
+        reg_change.old_value = registers_->ReadGpr(head.rd);
+        reg_change.new_value = head.value;
+        current_delta_.register_changes.push_back(reg_change);
+    }
+    registers_->WriteGpr(head.rd, head.value);
+    emit gprUpdated(head.rd, head.value);
+
+    instructions_retired_++;
+    instruction_mix_.Record(head.instruction, false);
+
+    if (lockstep_ && !lockstep_->Retire(DescribeRetirement(mem_wb_.pc - 4, head.instruction, *registers_, 0, 0)))
+        stop_requested_ = true;
 }
 
 // ============================================================================
 // CORRECTED advance_pipeline_registers() - Fix clear/update order
 // ============================================================================
+void RVSSVMPipelined::AdvanceStagePipes()
+{
+    auto shift = [](auto *pipe, size_t extra, auto &latch)
+    {
+        if (extra == 0)
+            return;
+        auto leaving = pipe[extra - 1];
+        for (size_t i = extra - 1; i > 0; --i)
+            pipe[i] = pipe[i - 1];
+        pipe[0] = latch;
+        latch = leaving;
+    };
+    shift(pipes_.execute, execute_stages_ - 1, ex_mem_next_);
+    shift(pipes_.memory, memory_stages_ - 1, mem_wb_next_);
+
+    // A redirect squashes everything still being fetched; a stall holds IF/ID and the fetch stages
+    if (flush_pipeline_)
+    {
+        IF_ID squashed;
+        squashed.bubble_cause = StallCause::kControl;
+        squashed.bubble_pc = control_pc_;
+        std::fill(std::begin(pipes_.fetch), std::end(pipes_.fetch), squashed);
+    }
+    else if (!stall_)
+        shift(pipes_.fetch, fetch_stages_ - 1, if_id_next_);
+}
+
 void RVSSVMPipelined::advance_pipeline_registers()
 {
-    // ✅ FIX: Clear old stage locations AFTER saving state but BEFORE updating
-    std::map<std::string, uint64_t> old_stage_to_pc = stage_to_pc_;
+    AdvanceStagePipes();
 
     // Advance pipeline registers
     mem_wb_ = mem_wb_next_;
@@ -1126,74 +1850,459 @@ void RVSSVMPipelined::advance_pipeline_registers()
     // ✅ FIX: Clear flags immediately to prevent persistent effects
     stall_ = false;
     flush_pipeline_ = false;
+}
 
-    // Now clear old stage locations
-    for (const auto &[stage, pc] : old_stage_to_pc)
-    {
-        QString q = QString::fromStdString(stage + "_CLEAR");
-        emit pipelineStageChanged(pc, q);
-    }
+void RVSSVMPipelined::ArmBreakpoints(bool armed)
+{
+    stop_at_breakpoints_ = armed;
+    if (armed && IsPipelineEmpty() && !pc_update_pending_)
+        released_breakpoint_pc_ = program_counter_;
+    if (!armed)
+        in_flight_writes_.clear();
+}
 
-    // Update stage_to_pc with new locations
-    stage_to_pc_.clear();
+bool RVSSVMPipelined::StopAtBreakpoint(uint64_t pc)
+{
+    // Every retirement ends the release, armed or not
+    bool released = pc == released_breakpoint_pc_;
+    released_breakpoint_pc_ = CpiStack::kNoPc;
+    if (!stop_at_breakpoints_ || released || !CheckBreakpoint(pc))
+        return false;
 
-    // Emit new stage locations
-    if (mem_wb_.valid)
+    // Everything older has retired, so backing out the logged writes, newest first, leaves the
+    // registers and memory exactly as a single-cycle run would have them at `pc`
+    for (auto it = in_flight_writes_.rbegin(); it != in_flight_writes_.rend(); ++it)
+        WriteInFlight(*it, it->old_value);
+    bool stop = ShouldBreakAt(pc);
+    if (!stop)
     {
-        stage_to_pc_["WB"] = mem_wb_.pc;
-        emit pipelineStageChanged(mem_wb_.pc, "WB");
+        for (const InFlightWrite &write : in_flight_writes_)
+            WriteInFlight(write, write.new_value);
+        memory_controller_.ClearWatchHit();
+        return false;
     }
 
-    if (ex_mem_.valid)
+    if (recording_enabled_)
     {
-        stage_to_pc_["MEM"] = ex_mem_.pc;
-        emit pipelineStageChanged(ex_mem_.pc, "MEM");
+        for (auto it = in_flight_writes_.rbegin(); it != in_flight_writes_.rend(); ++it)
+        {
+            if (it->size == 0)
+            {
+                current_delta_.register_changes.push_back({0x003, 1, it->new_value, it->old_value});
+                continue;
+            }
+            MemoryChange change;
+            change.address = it->address;
+            for (uint8_t i = 0; i < it->size; ++i)
+            {
+                change.old_bytes_vec.push_back((it->new_value >> (8 * i)) & 0xFF);
+                change.new_bytes_vec.push_back((it->old_value >> (8 * i)) & 0xFF);
+            }
+            current_delta_.memory_changes.push_back(change);
+        }
     }
+    memory_controller_.ClearWatchHit();
+    in_flight_writes_.clear();
 
-    if (id_ex_.valid)
+    SquashInFlight();
+    program_counter_ = pc;
+    if (decoupled_frontend_)
+        RestartFrontend(pc, false, StallCause::kControl, pc);
+    released_breakpoint_pc_ = pc;
+    stopped_at_breakpoint_ = true;
+    return true;
+}
+
+void RVSSVMPipelined::WriteInFlight(const InFlightWrite &write, uint64_t value)
+{
+    if (write.size == 0)
     {
-        stage_to_pc_["EX"] = id_ex_.pc;
-        emit pipelineStageChanged(id_ex_.pc, "EX");
-    }
-
-    if (if_id_.valid)
-    {
-        stage_to_pc_["ID"] = if_id_.pc;
-        emit pipelineStageChanged(if_id_.pc, "ID");
+        registers_->WriteCsr(0x003, value);
+        emit csrUpdated(0x003, value);
+        return;
     }
+    for (uint8_t i = 0; i < write.size; ++i)
+        memory_controller_.WriteByte(write.address + i, (value >> (8 * i)) & 0xFF);
+}
 
-    if (program_counter_ < program_size_)
-    {
-        stage_to_pc_["IF"] = program_counter_;
-        emit pipelineStageChanged(program_counter_, "IF");
-    }
+void RVSSVMPipelined::SquashInFlight()
+{
+    if_id_ = IF_ID();
+    if_id_next_ = IF_ID();
+    id_ex_ = ID_EX();
+    id_ex_next_ = ID_EX();
+    ex_mem_ = EX_MEM();
+    ex_mem_next_ = EX_MEM();
+    mem_wb_ = MEM_WB();
+    mem_wb_next_ = MEM_WB();
+    pipes_ = StagePipes();
+    pending_redirect_ = PendingRedirect();
+    scoreboard_.Clear();
+    pc_update_pending_ = false;
+    pc_update_value_ = 0;
+    stall_ = false;
+    flush_pipeline_ = false;
 }
 
 void RVSSVMPipelined::Run()
 {
+    trace_stages_ = false;
+    ClearStop();
+    memory_controller_.ClearWatchHit();
+    ArmBreakpoints(true);
+    const bool profiling = profiler_.IsEnabled() || call_graph_.IsEnabled() || branch_trace_.IsEnabled();
     while (!stop_requested_)
     {
-        bool pipeline_has_work = (if_id_.valid || id_ex_.valid || ex_mem_.valid || mem_wb_.valid);
+        bool pipeline_has_work = !IsPipelineEmpty();
         bool fetch_remaining = (program_counter_ < program_size_);
 
         if (!pipeline_has_work && !fetch_remaining)
             break;
 
-        WB_stage();
-        MEM_stage();
-        EX_stage();
-        ID_stage();
-        IF_stage();
+        if (profiling)
+            ProfileCycle();
+        uint64_t stalls_before = stall_cycles_;
+        uint64_t mispredictions_before = branch_mispredictions_;
+
+        ClockStages();
+        if (pipeline_trace_.IsEnabled())
+            TraceCycle();
+
+        bool was_stalled = stall_;
         advance_pipeline_registers();
+        CountStall(was_stalled);
 
         cycle_s_++;
+        stats_.Sample(cycle_s_);
+
+        if (call_graph_.IsEnabled())
+            call_graph_.AddCycles(1, stall_cycles_ - stalls_before,
+                                  branch_mispredictions_ - mispredictions_before);
+
+        if (BreakpointHit())
+        {
+            output_status_ = "VM_BREAKPOINT_HIT";
+            emit statusChanged("VM_BREAKPOINT_HIT");
+            break;
+        }
+
+        if (CheckWatchpointHit())
+        {
+            emit statusChanged("VM_WATCHPOINT_HIT");
+            break;
+        }
     }
-    if (branch_prediction_enabled_)
+    ArmBreakpoints(false);
+    if (branch_prediction_enabled_ && !headless_)
         DumpBranchPredictionTables(globals::branchPredectionPath);
+    WriteProfileReport();
+    if (pipeline_trace_.IsEnabled())
+        pipeline_trace_.Flush();
+    WriteStats();
+    PublishStages();
+}
+
+void RVSSVMPipelined::RunLockstep(LockstepChecker &checker)
+{
+    if (!IsPipelineEmpty())
+        throw std::runtime_error("Lockstep checking starts from an empty pipeline; reset or finish the run first");
+
+    lockstep_ = &checker;
+    checker.Start();
+    try
+    {
+        Run();
+    }
+    catch (...)
+    {
+        lockstep_ = nullptr;
+        checker.Finish(false);
+        throw;
+    }
+    lockstep_ = nullptr;
+    checker.Finish(IsPipelineEmpty() && program_counter_ >= program_size_);
+}
+
+void RVSSVMPipelined::ProfileCycle()
+{
+    // The head of a fused pair retires just ahead of its tail
+    bool fused = mem_wb_.valid && mem_wb_.fused.kind != FusionKind::kNone;
+    if (fused && call_graph_.IsEnabled())
+        call_graph_.Retire(mem_wb_.pc - 4, mem_wb_.fused.instruction);
+    if (fused && branch_trace_.IsEnabled())
+        branch_trace_.Retire(mem_wb_.pc - 4, mem_wb_.fused.instruction, mem_wb_.pc);
+    if (mem_wb_.valid && call_graph_.IsEnabled())
+        call_graph_.Retire(mem_wb_.pc, mem_wb_.instruction);
+    if (mem_wb_.valid && branch_trace_.IsEnabled())
+        branch_trace_.Retire(mem_wb_.pc, mem_wb_.instruction,
+                             mem_wb_.branch_taken ? mem_wb_.branch_target : mem_wb_.pc + 4);
+
+    if (!profiler_.IsEnabled())
+        return;
+
+    if (fused)
+        profiler_.RecordExecution(mem_wb_.pc - 4);
+    if (mem_wb_.valid)
+        profiler_.RecordExecution(mem_wb_.pc);
+
+    // Walk from the youngest stage to the oldest so the oldest instruction in flight gets the
+    // cycle; with nothing in flight it belongs to the instruction being fetched
+    uint64_t pc = program_counter_;
+    for (size_t i = 0; i + 1 < fetch_stages_; ++i)
+        pc = pipes_.fetch[i].valid ? pipes_.fetch[i].pc : pc;
+    pc = if_id_.valid ? if_id_.pc : pc;
+    pc = id_ex_.valid ? id_ex_.pc : pc;
+    for (size_t i = 0; i + 1 < execute_stages_; ++i)
+        pc = pipes_.execute[i].valid ? pipes_.execute[i].pc : pc;
+    pc = ex_mem_.valid ? ex_mem_.pc : pc;
+    for (size_t i = 0; i + 1 < memory_stages_; ++i)
+        pc = pipes_.memory[i].valid ? pipes_.memory[i].pc : pc;
+    pc = mem_wb_.valid ? mem_wb_.pc : pc;
+    profiler_.RecordCycles(pc, 1);
+}
+
+void RVSSVMPipelined::TraceCycle()
+{
+    pipeline_trace_.BeginCycle(cycle_s_);
+    TraceLatches(0, traced_fetch_seq_);
+    pipeline_trace_.EndCycle();
+    traced_fetch_seq_ = fetch_seq_;
+}
+
+void RVSSVMPipelined::TraceLatches(uint32_t lane, uint64_t fetched_after)
+{
+    static constexpr const char *kFetchStages[kMaxStageDepth] = {"IF", "IF2", "IF3", "IF4"};
+    static constexpr const char *kExecuteStages[kMaxStageDepth] = {"EX", "EX2", "EX3", "EX4"};
+    static constexpr const char *kMemoryStages[kMaxStageDepth] = {"MEM", "MEM2", "MEM3", "MEM4"};
+
+    // While ID stalls, IF/ID is held rather than refilled
+    if (if_id_next_.valid && !stall_ && if_id_next_.seq > fetched_after)
+        pipeline_trace_.Stage(if_id_next_.seq, lane, kFetchStages[0], if_id_next_.pc, if_id_next_.instruction);
+    for (size_t i = 0; i + 1 < fetch_stages_; ++i)
+    {
+        const IF_ID &latch = pipes_.fetch[i];
+        if (latch.valid)
+            pipeline_trace_.Stage(latch.seq, lane, kFetchStages[i + 1], latch.pc, latch.instruction, stall_);
+    }
+    if (if_id_.valid)
+        pipeline_trace_.Stage(if_id_.seq, lane, "ID", if_id_.pc, if_id_.instruction, stall_);
+    if (id_ex_.valid)
+        pipeline_trace_.Stage(id_ex_.seq, lane, kExecuteStages[0], id_ex_.pc, id_ex_.instruction);
+    for (size_t i = 0; i + 1 < execute_stages_; ++i)
+    {
+        const EX_MEM &latch = pipes_.execute[i];
+        if (latch.valid)
+            pipeline_trace_.Stage(latch.seq, lane, kExecuteStages[i + 1], latch.pc, latch.instruction);
+    }
+    if (ex_mem_.valid)
+        pipeline_trace_.Stage(ex_mem_.seq, lane, kMemoryStages[0], ex_mem_.pc, ex_mem_.instruction);
+    for (size_t i = 0; i + 1 < memory_stages_; ++i)
+    {
+        const MEM_WB &latch = pipes_.memory[i];
+        if (latch.valid)
+            pipeline_trace_.Stage(latch.seq, lane, kMemoryStages[i + 1], latch.pc, latch.instruction);
+    }
+    if (mem_wb_.valid)
+        pipeline_trace_.Stage(mem_wb_.seq, lane, "WB", mem_wb_.pc, mem_wb_.instruction, false, true);
+}
+
+void RVSSVMPipelined::LoseIssueSlot(StallCause cause, uint64_t pc)
+{
+    id_cause_ = cause;
+    id_cause_pc_ = pc;
+    cpi_stack_.Charge(cause, pc);
+}
+
+void RVSSVMPipelined::WriteCpiStack(std::ostream &out, size_t limit) const
+{
+    cpi_stack_.WriteReport(out, program_, instructions_retired_, IssueWidth(), limit);
+}
+
+void RVSSVMPipelined::CountStall(bool stalled)
+{
+    if (stalled)
+    {
+        stall_cycles_++;
+        stall_burst_++;
+    }
+    else if (stall_burst_ != 0)
+    {
+        stall_bursts_.Sample(stall_burst_);
+        stall_burst_ = 0;
+    }
+}
+
+void RVSSVMPipelined::ClockStages()
+{
+    stopped_at_breakpoint_ = false;
+    WB_stage();
+    if (stopped_at_breakpoint_)
+        return;
+    MEM_stage();
+    EX_stage();
+    ID_stage();
+    ClockFrontend();
+    IF_stage();
+}
+
+void RVSSVMPipelined::DetailedCycle()
+{
+    ClockStages();
+    if (pipeline_trace_.IsEnabled())
+        TraceCycle();
+
+    bool was_stalled = stall_;
+    advance_pipeline_registers();
+    CountStall(was_stalled);
+    cycle_s_++;
+}
+
+uint64_t RVSSVMPipelined::DrainCycleBound() const
+{
+    uint64_t slowest = 1;
+    for (const FunctionalUnitTiming &timing : functional_unit_timing_)
+        slowest = std::max(slowest, timing.latency + timing.interval);
+    uint64_t stages = fetch_stages_ + 1 + execute_stages_ + memory_stages_ + 1;
+    // Each instruction in flight may wait out the slowest unit before the next one issues,
+    // then walk the remaining stages; one more slot covers a pending redirect
+    return (stages * IssueLanes() + 1) * (slowest + stages);
+}
+
+void RVSSVMPipelined::DrainPipeline()
+{
+    // The functional model must not run while an older instruction can still write back
+    const uint64_t bound = DrainCycleBound();
+    fetch_blocked_ = true;
+    for (uint64_t i = 0; !IsPipelineEmpty() || pc_update_pending_; ++i)
+    {
+        if (i == bound)
+        {
+            fetch_blocked_ = false;
+            throw std::runtime_error("Pipeline did not drain within " + std::to_string(bound) + " cycles");
+        }
+        DetailedCycle();
+    }
+    fetch_blocked_ = false;
+    // The functional model goes on from here with the return stack IF left behind
+    if (decoupled_frontend_)
+        RestartFrontend(program_counter_, true, StallCause::kFillDrain, CpiStack::kNoPc);
+}
+
+void RVSSVMPipelined::TrainBranchPredictor(uint64_t pc, uint32_t instruction, bool taken, uint64_t target)
+{
+    if (!branch_prediction_enabled_)
+        return;
+    BranchTargetBuffer::Kind kind;
+    switch (instruction & 0x7F)
+    {
+    case 0b1100011: kind = BranchTargetBuffer::Kind::kConditional; break;
+    case 0b1101111: kind = BranchTargetBuffer::Kind::kJump; break;
+    case 0b1100111: kind = BranchTargetBuffer::Kind::kIndirect; break;
+    default: return;
+    }
+    if (kind == BranchTargetBuffer::Kind::kConditional && dynamic_branch_prediction_enabled_)
+        branch_predictor_->Update(pc, taken);
+    if (kind == BranchTargetBuffer::Kind::kIndirect && !ReturnAddressStack::ActionFor(instruction).pop)
+        indirect_predictor_.Update(pc, target);
+    // Only taken transfers are allocated; a branch that is never taken needs no target
+    if (taken)
+    {
+        branch_target_buffer_.Update(pc, target, kind);
+        indirect_predictor_.RecordPath(target);
+    }
+}
+
+bool RVSSVMPipelined::FastForward(uint64_t instruction_count, bool train_predictor)
+{
+    while (instructions_retired_ < instruction_count)
+    {
+        if (stop_requested_ || program_counter_ >= program_size_)
+            return false;
+        uint64_t pc = program_counter_;
+        RVSSVM::ProcessInstruction();
+        instructions_retired_++;
+        instruction_mix_.Record(current_instruction_, program_counter_ != pc + 4);
+        if (branch_trace_.IsEnabled())
+            branch_trace_.Retire(pc, current_instruction_, program_counter_);
+        if (train_predictor && branch_prediction_enabled_)
+        {
+            TrainBranchPredictor(pc, current_instruction_, program_counter_ != pc + 4, program_counter_);
+            return_stack_.Apply(ReturnAddressStack::ActionFor(current_instruction_), pc + 4);
+        }
+    }
+    return true;
+}
+
+SampledRunResult RVSSVMPipelined::RunSampled(const SamplingPlan &plan)
+{
+    qDebug() << "\n***** SAMPLED RUN STARTED *****\n";
+    trace_stages_ = false;
+    ClearStop();
+    SampledRunResult result;
+    result.weighted = !plan.points.empty();
+
+    uint64_t detailed_start_instructions = instructions_retired_;
+    uint64_t detailed_start_cycles = cycle_s_;
+    DrainPipeline();
+    result.detailed_instructions += instructions_retired_ - detailed_start_instructions;
+    result.detailed_cycles += cycle_s_ - detailed_start_cycles;
+
+    uint64_t start = 0;
+    double weight = 1.0;
+    for (size_t k = 0; plan.Window(k, start, weight); ++k)
+    {
+        uint64_t detailed_from = start >= plan.warmup ? start - plan.warmup : 0;
+        if (!FastForward(detailed_from, plan.functional_warmup))
+            break;
+
+        detailed_start_instructions = instructions_retired_;
+        detailed_start_cycles = cycle_s_;
+
+        // Warm-up: fill the pipeline before measuring
+        uint64_t measure_from = std::max(start, instructions_retired_);
+        while (instructions_retired_ < measure_from && !stop_requested_ &&
+               (program_counter_ < program_size_ || !IsPipelineEmpty()))
+            DetailedCycle();
+
+        SampleWindow window;
+        window.start = instructions_retired_;
+        window.weight = weight;
+        uint64_t cycles_before = cycle_s_;
+        while (instructions_retired_ < window.start + plan.window && !stop_requested_ &&
+               (program_counter_ < program_size_ || !IsPipelineEmpty()))
+            DetailedCycle();
+        window.instructions = instructions_retired_ - window.start;
+        window.cycles = cycle_s_ - cycles_before;
+
+        // Hand the architectural state back to the functional model
+        DrainPipeline();
+        result.detailed_instructions += instructions_retired_ - detailed_start_instructions;
+        result.detailed_cycles += cycle_s_ - detailed_start_cycles;
+
+        if (window.instructions != 0)
+            result.windows.push_back(window);
+        qDebug() << "Sample window" << k << "CPI:" << window.Cpi();
+    }
+
+    // Finish the program functionally to learn the total instruction count
+    FastForward(std::numeric_limits<uint64_t>::max(), false);
+    result.total_instructions = instructions_retired_;
+
+    if (program_counter_ >= program_size_)
+        emit statusChanged("VM_PROGRAM_END");
+    WriteStats();
+    PublishStages();
+    qDebug() << "\n***** SAMPLED RUN ENDED *****";
+    return result;
 }
 
 bool RVSSVMPipelined::IsPipelineEmpty() const
 {
+    for (size_t i = 0; i + 1 < kMaxStageDepth; ++i)
+    {
+        if (pipes_.fetch[i].valid || pipes_.execute[i].valid || pipes_.memory[i].valid)
+            return false;
+    }
     return !(if_id_.valid || id_ex_.valid || ex_mem_.valid || mem_wb_.valid);
 }
 
@@ -1204,18 +2313,20 @@ void RVSSVMPipelined::DebugRun()
 
 void RVSSVMPipelined::Undo()
 {
-    if (pipeline_undo_stack_.empty())
+    if (pipeline_undo_log_.Empty())
     {
         qDebug() << "Undo stack is empty";
         return;
     }
 
-    PipelineStepDelta last = pipeline_undo_stack_.top();
-    pipeline_undo_stack_.pop();
+    // Restores the latches in place; the record carries everything else
+    const PipelineUndoRecord &last = pipeline_undo_log_.PopCycle();
 
-    // Restore register changes
-    for (const auto &change : last.register_changes)
+    // Restore register changes, newest first: one cycle can write a register twice (a fused
+    // pair, or both lanes of a dual-issue pair)
+    for (auto it = last.register_changes.rbegin(); it != last.register_changes.rend(); ++it)
     {
+        const RegisterChange &change = *it;
         switch (change.reg_type)
         {
         case 0: // GPR
@@ -1234,38 +2345,13 @@ void RVSSVMPipelined::Undo()
     }
 
     // Restore memory changes
-    for (const auto &change : last.memory_changes)
+    for (auto it = last.memory_changes.rbegin(); it != last.memory_changes.rend(); ++it)
     {
+        const MemoryChange &change = *it;
         for (size_t i = 0; i < change.old_bytes_vec.size(); ++i)
             memory_controller_.WriteByte(change.address + i, change.old_bytes_vec[i]);
     }
-
-    if (stage_to_pc_.count("WB"))
-    {
-        emit pipelineStageChanged(stage_to_pc_["WB"], "WB_CLEAR");
-    }
-    if (stage_to_pc_.count("MEM"))
-    {
-        emit pipelineStageChanged(stage_to_pc_["MEM"], "MEM_CLEAR");
-    }
-    if (stage_to_pc_.count("EX"))
-    {
-        emit pipelineStageChanged(stage_to_pc_["EX"], "EX_CLEAR");
-    }
-    if (stage_to_pc_.count("ID"))
-    {
-        emit pipelineStageChanged(stage_to_pc_["ID"], "ID_CLEAR");
-    }
-    if (stage_to_pc_.count("IF"))
-    {
-        emit pipelineStageChanged(stage_to_pc_["IF"], "IF_CLEAR");
-    }
-
-    // Restore pipeline registers
-    if_id_ = last.old_if_id;
-    id_ex_ = last.old_id_ex;
-    ex_mem_ = last.old_ex_mem;
-    mem_wb_ = last.old_mem_wb;
+    memory_controller_.ClearWatchHit();  // restoring memory is not a watched store
 
     // Initialize next registers to empty
     if_id_next_ = IF_ID();
@@ -1279,62 +2365,93 @@ void RVSSVMPipelined::Undo()
     pc_update_pending_ = last.old_pc_update_pending;
     pc_update_value_ = last.old_pc_update_value;
 
-    // Restore statistics
+    // Restore statistics; the restored MEM/WB latch holds the instruction that retired
     cycle_s_ = last.old_cycle;
+    if (instructions_retired_ != last.old_instructions_retired && mem_wb_.valid)
+        instruction_mix_.Retract(mem_wb_.instruction, mem_wb_.branch_taken);
     instructions_retired_ = last.old_instructions_retired;
     stall_cycles_ = last.old_stall_cycles;
+    branch_mispredictions_ = last.old_branch_mispredictions;
+    cpi_stack_.Retract(last.cpi_changes);
+    if (stall_bursts_.Samples() != last.old_stall_burst_samples)
+        stall_bursts_.Retract(last.old_stall_burst);
+    stall_burst_ = last.old_stall_burst;
+
+    // The profiles are not recorded per cycle, and an undone retirement or call would leave
+    // them out of step with the program, so they start over from here
+    if (profiler_.IsEnabled())
+        profiler_.Clear();
+    if (call_graph_.IsEnabled())
+        call_graph_.Clear();
+
+    PublishStages();
+}
+
+void RVSSVMPipelined::ClearPublishedStages()
+{
+    std::lock_guard<std::mutex> lock(published_stages_mutex_);
+    published_stages_ = StageSnapshot();
+}
+
+void RVSSVMPipelined::PublishStages()
+{
+    StageSnapshot stages;
+    CaptureStages(stages);
+    stages.cycle = cycle_s_;
+    std::lock_guard<std::mutex> lock(published_stages_mutex_);
+    published_stages_ = stages;
+}
 
-    stage_to_pc_.clear();
+StageSnapshot RVSSVMPipelined::PublishedStages() const
+{
+    std::lock_guard<std::mutex> lock(published_stages_mutex_);
+    return published_stages_;
+}
 
+void RVSSVMPipelined::CaptureStages(StageSnapshot &stages) const
+{
     if (mem_wb_.valid)
+        stages.Set(PipelineStage::kWB, mem_wb_.pc);
+    for (size_t i = 0; i + 1 < memory_stages_; ++i)
     {
-        stage_to_pc_["WB"] = mem_wb_.pc;
-        emit pipelineStageChanged(mem_wb_.pc, "WB");
+        if (pipes_.memory[i].valid)
+            stages.Set(ExtraStage(PipelineStage::kMEM2, i), pipes_.memory[i].pc);
     }
-
     if (ex_mem_.valid)
+        stages.Set(PipelineStage::kMEM, ex_mem_.pc);
+    for (size_t i = 0; i + 1 < execute_stages_; ++i)
     {
-        stage_to_pc_["MEM"] = ex_mem_.pc;
-        emit pipelineStageChanged(ex_mem_.pc, "MEM");
+        if (pipes_.execute[i].valid)
+            stages.Set(ExtraStage(PipelineStage::kEX2, i), pipes_.execute[i].pc);
     }
-
     if (id_ex_.valid)
-    {
-        stage_to_pc_["EX"] = id_ex_.pc;
-        emit pipelineStageChanged(id_ex_.pc, "EX");
-    }
-
+        stages.Set(PipelineStage::kEX, id_ex_.pc);
     if (if_id_.valid)
+        stages.Set(PipelineStage::kID, if_id_.pc);
+    for (size_t i = 0; i + 1 < fetch_stages_; ++i)
     {
-        stage_to_pc_["ID"] = if_id_.pc;
-        emit pipelineStageChanged(if_id_.pc, "ID");
+        if (pipes_.fetch[i].valid)
+            stages.Set(ExtraStage(PipelineStage::kIF2, i), pipes_.fetch[i].pc);
     }
-
     if (program_counter_ < program_size_)
-    {
-        stage_to_pc_["IF"] = program_counter_;
-        emit pipelineStageChanged(program_counter_, "IF");
-    }
+        stages.Set(PipelineStage::kIF, program_counter_);
 }
 
 void RVSSVMPipelined::Step()
 {
     // Save current pipeline state for undo
-    PipelineStepDelta delta;
-    delta.old_pc = program_counter_;
-    delta.old_if_id = if_id_;
-    delta.old_id_ex = id_ex_;
-    delta.old_ex_mem = ex_mem_;
-    delta.old_mem_wb = mem_wb_;
-    delta.old_stall = stall_;
-    delta.old_pc_update_pending = pc_update_pending_;
-    delta.old_pc_update_value = pc_update_value_;
-    delta.old_cycle = cycle_s_;
-    delta.old_instructions_retired = instructions_retired_;
-    delta.old_stall_cycles = stall_cycles_;
+    uint64_t old_pc = program_counter_;
+    bool old_stall = stall_;
+    bool old_pc_update_pending = pc_update_pending_;
+    uint64_t old_pc_update_value = pc_update_value_;
+    uint64_t old_cycle = cycle_s_;
+    uint64_t old_instructions_retired = instructions_retired_;
+    uint64_t old_stall_cycles = stall_cycles_;
+    uint64_t old_stall_burst = stall_burst_;
+    uint64_t old_stall_burst_samples = stall_bursts_.Samples();
 
     // Check if pipeline is done
-    bool pipeline_has_work = (if_id_.valid || id_ex_.valid || ex_mem_.valid || mem_wb_.valid);
+    bool pipeline_has_work = !IsPipelineEmpty();
     bool fetch_remaining = (program_counter_ < program_size_);
 
     if (!pipeline_has_work && !fetch_remaining)
@@ -1342,79 +2459,59 @@ void RVSSVMPipelined::Step()
         output_status_ = "VM_PROGRAM_END";
 
         // Clear all pipeline stages
-        if (stage_to_pc_.count("IF"))
-            emit pipelineStageChanged(stage_to_pc_["IF"], "IF_CLEAR");
-        if (stage_to_pc_.count("ID"))
-            emit pipelineStageChanged(stage_to_pc_["ID"], "ID_CLEAR");
-        if (stage_to_pc_.count("EX"))
-            emit pipelineStageChanged(stage_to_pc_["EX"], "EX_CLEAR");
-        if (stage_to_pc_.count("MEM"))
-            emit pipelineStageChanged(stage_to_pc_["MEM"], "MEM_CLEAR");
-        if (stage_to_pc_.count("WB"))
-            emit pipelineStageChanged(stage_to_pc_["WB"], "WB_CLEAR");
-
-        stage_to_pc_.clear();
+        ClearPublishedStages();
         return;
     }
 
     // Enable recording for undo
+    trace_stages_ = true;
     recording_enabled_ = true;
+    pipeline_undo_log_.BeginCycle();
+    cpi_stack_.SetJournal(&cpi_changes_);
+
+    if (profiler_.IsEnabled() || call_graph_.IsEnabled() || branch_trace_.IsEnabled())
+        ProfileCycle();
+    uint64_t old_mispredictions = branch_mispredictions_;
 
     // Execute pipeline stages
-    WB_stage();
-    MEM_stage();
-    EX_stage();
-    ID_stage();
-    IF_stage();
+    ClockStages();
+    if (pipeline_trace_.IsEnabled())
+        TraceCycle();
 
     bool was_stalled = stall_;
 
     advance_pipeline_registers();
 
     // Count stall after advancing (flag is now cleared)
-    if (was_stalled)
-    {
-        stall_cycles_++;
-    }
+    CountStall(was_stalled);
     // Disable recording
     recording_enabled_ = false;
+    cpi_stack_.SetJournal(nullptr);
 
     cycle_s_++;
-
-    // Save new pipeline state
-    delta.new_pc = program_counter_;
-    delta.new_if_id = if_id_;
-    delta.new_id_ex = id_ex_;
-    delta.new_ex_mem = ex_mem_;
-    delta.new_mem_wb = mem_wb_;
-    delta.new_stall = stall_;
-    delta.register_changes = current_delta_.register_changes;
-    delta.memory_changes = current_delta_.memory_changes;
-
-    // ✅ Limit undo stack size
-    const size_t MAX_UNDO_STACK_SIZE = 10000;
-    if (pipeline_undo_stack_.size() >= MAX_UNDO_STACK_SIZE)
-    {
-        // Remove oldest entry (more efficient method)
-        std::stack<PipelineStepDelta> temp_stack;
-        temp_stack.push(pipeline_undo_stack_.top());
-        pipeline_undo_stack_.pop();
-
-        while (!pipeline_undo_stack_.empty())
-        {
-            temp_stack.push(pipeline_undo_stack_.top());
-            pipeline_undo_stack_.pop();
-        }
-
-        while (!temp_stack.empty())
-        {
-            pipeline_undo_stack_.push(temp_stack.top());
-            temp_stack.pop();
-        }
-    }
-
-    // Push to undo stack
-    pipeline_undo_stack_.push(delta);
+    stats_.Sample(cycle_s_);
+    PublishStages();
+
+    if (call_graph_.IsEnabled())
+        call_graph_.AddCycles(1, stall_cycles_ - old_stall_cycles,
+                              branch_mispredictions_ - old_mispredictions);
+
+    // Only the latch bytes that changed this cycle are kept
+    PipelineUndoRecord &record = pipeline_undo_log_.CommitCycle();
+    record.old_pc = old_pc;
+    record.old_stall = old_stall;
+    record.old_pc_update_pending = old_pc_update_pending;
+    record.old_pc_update_value = old_pc_update_value;
+    record.old_cycle = old_cycle;
+    record.old_instructions_retired = old_instructions_retired;
+    record.old_stall_cycles = old_stall_cycles;
+    record.old_branch_mispredictions = old_mispredictions;
+    record.old_stall_burst = old_stall_burst;
+    record.old_stall_burst_samples = old_stall_burst_samples;
+    record.register_changes.swap(current_delta_.register_changes);
+    record.memory_changes.swap(current_delta_.memory_changes);
+    record.cpi_changes.swap(cpi_changes_);
+    cpi_changes_.clear();
 
     // Clear current delta for next step
     current_delta_ = StepDelta();
@@ -1423,44 +2520,100 @@ void RVSSVMPipelined::Step()
         qDebug() << "DumpBranchPrediction called";
         DumpBranchPredictionTables(globals::branchPredectionPath);
     }
+    if (pipeline_trace_.IsEnabled())
+        pipeline_trace_.Flush();
 
     DumpPipelineState();
 }
 
+void RVSSVMPipelined::BindIsa()
+{
+    RVSSVM::BindIsa();
+    if (registers_->GetIsa() == ISA::RV64)
+    {
+        ex_stage_ = &RVSSVMPipelined::EX_stage<ISA::RV64>;
+        mem_stage_ = &RVSSVMPipelined::MEM_stage<ISA::RV64>;
+    }
+    else
+    {
+        ex_stage_ = &RVSSVMPipelined::EX_stage<ISA::RV32>;
+        mem_stage_ = &RVSSVMPipelined::MEM_stage<ISA::RV32>;
+    }
+}
+
 void RVSSVMPipelined::SetPipelineConfig(bool hazardEnabled,
                                         bool forwardingEnabled,
                                         bool branchPredictionEnabled,
-                                        bool dynamicPredictionEnabled)
+                                        bool dynamicPredictionEnabled,
+                                        bool fusionEnabled)
 {
     hazard_detection_enabled_ = hazardEnabled;
     forwarding_enabled_ = forwardingEnabled;
+    fusion_enabled_ = fusionEnabled;
 
     branch_prediction_enabled_ = branchPredictionEnabled;
     dynamic_branch_prediction_enabled_ = dynamicPredictionEnabled;
 
-    if (branch_prediction_enabled_)
+    // Picks up predictor type and table sizes from vm_config; tables start cold
+    ConfigureBranchPredictor();
+    ConfigureFunctionalUnits();
+    ConfigurePipelineDepth();
+    ConfigureFrontend();
+}
+
+void RVSSVMPipelined::ConfigureFunctionalUnits()
+{
+    static_assert(kMaxUnitCopies == vm_config::kMaxFunctionalUnitCount, "Scoreboard sized for the config limit");
+    for (size_t unit = 0; unit < kFunctionalUnitCount; ++unit)
     {
+        const vm_config::FunctionalUnitConfig *config =
+            vm_config::config.getFunctionalUnitConfig(FunctionalUnitName(static_cast<FunctionalUnit>(unit)));
+        functional_unit_timing_[unit] = {config->latency, config->interval, config->count};
+    }
+}
 
-        branch_target_buffer_.assign(BHT_SIZE, 0);
-        qDebug() << "buffer assigned";
-        if (branch_prediction_enabled_)
-        {
-            branch_target_buffer_.assign(BHT_SIZE, 0);
+void RVSSVMPipelined::ConfigurePipelineDepth()
+{
+    static_assert(kMaxStageDepth == vm_config::kMaxPipelineStageDepth, "Stage pipes sized for the config limit");
+    fetch_stages_ = vm_config::config.getFetchStages();
+    execute_stages_ = vm_config::config.getExecuteStages();
+    memory_stages_ = vm_config::config.getMemoryStages();
+    pipes_ = StagePipes();
+    pending_redirect_ = PendingRedirect();
+    redirect_penalty_ = fetch_stages_ + execute_stages_;
+    load_use_distance_ = execute_stages_ - 1 + memory_stages_;
+}
 
-            // ✅ FIX: Initialize BHT based on prediction mode
-            if (dynamic_branch_prediction_enabled_)
-            {
-                // For dynamic prediction, start with NOT_TAKEN (false)
-                // This is more conservative and learns over time
-                branch_history_table_.assign(BHT_SIZE, false);
-            }
-            else
-            {
-                // For static prediction, we don't use BHT
-                branch_history_table_.assign(BHT_SIZE, true);
-            }
-        }
-    }
+void RVSSVMPipelined::ConfigureFrontend()
+{
+    static_assert(kMaxFetchTargetQueue == vm_config::kMaxFetchTargets &&
+                      kMaxInstructionBuffer == vm_config::kMaxInstructionBufferEntries,
+                  "Frontend queues sized for the config limits");
+    const vm_config::VmConfig &config = vm_config::config;
+    decoupled_frontend_ = config.isDecoupledFrontend();
+    fetch_target_queue_entries_ = config.getFetchTargetQueueEntries();
+    fetch_block_bytes_ = config.getFetchBlockBytes();
+    instruction_buffer_entries_ = config.getInstructionBufferEntries();
+    frontend_ = DecoupledFrontend();
+    frontend_.predict_pc = program_counter_;
+}
+
+void RVSSVMPipelined::ConfigureBranchPredictor()
+{
+    const vm_config::VmConfig &config = vm_config::config;
+    // Build both first so a bad configuration leaves the current predictor in place
+    std::unique_ptr<BranchPredictor> predictor = MakeBranchPredictor(config.getBranchPredictorType(),
+                                                                     config.getBranchPredictorTableSize(),
+                                                                     config.getBranchHistoryLength());
+    BranchTargetBuffer btb(config.getBtbSize(), config.getBtbAssociativity());
+    IndirectTargetPredictor indirect(config.getIndirectPredictorSize(),
+                                     static_cast<unsigned>(config.getIndirectHistoryLength()));
+    branch_predictor_ = std::move(predictor);
+    branch_target_buffer_ = std::move(btb);
+    indirect_predictor_ = std::move(indirect);
+    return_stack_ = ReturnAddressStack(config.getRasDepth());
+    qDebug() << "Branch predictor:" << QString::fromStdString(branch_predictor_->Name())
+             << "BTB:" << branch_target_buffer_.Entries() << "entries," << branch_target_buffer_.Ways() << "ways";
 }
 
 void RVSSVMPipelined::DumpBranchPredictionTables(const std::filesystem::path &filepath)
@@ -1473,6 +2626,10 @@ void RVSSVMPipelined::DumpBranchPredictionTables(const std::filesystem::path &fi
         return;
     }
 
+    auto percent = [](uint64_t part, uint64_t whole) {
+        return whole == 0 ? 0.0 : part * 100.0 / whole;
+    };
+
     file << "================================================================================\n";
     file << "                    BRANCH PREDICTION TABLES DUMP\n";
     file << "================================================================================\n";
@@ -1480,194 +2637,64 @@ void RVSSVMPipelined::DumpBranchPredictionTables(const std::filesystem::path &fi
     if (!branch_prediction_enabled_)
         file << "DISABLED (No Prediction)\n";
     else if (dynamic_branch_prediction_enabled_)
-        file << "1-BIT DYNAMIC PREDICTION\n";
+        file << "DYNAMIC (" << branch_predictor_->Name() << ")\n";
     else
-        file << "STATIC PREDICTION (Always Taken)\n";
+        file << "STATIC (Backward Taken, Forward Not Taken)\n";
 
+    file << "Predictor Storage: " << branch_predictor_->StorageBits() << " bits"
+         << " (BTB: " << branch_target_buffer_.StorageBits() << " bits, RAS: " << return_stack_.StorageBits()
+         << " bits, indirect: " << indirect_predictor_.StorageBits() << " bits)\n";
     file << "Current Cycle: " << cycle_s_ << "\n";
     file << "Instructions Retired: " << instructions_retired_ << "\n";
     file << "Stall Cycles: " << stall_cycles_ << "\n";
     file << "================================================================================\n\n";
 
-    // Count valid entries
-    int btb_valid_entries = 0;
-    int bht_taken_count = 0;
-    int bht_not_taken_count = 0;
-
-    for (size_t i = 0; i < BHT_SIZE; i++)
-    {
-        if (branch_target_buffer_[i] != 0)
-            btb_valid_entries++;
-
-        if (branch_history_table_[i])
-            bht_taken_count++;
-        else
-            bht_not_taken_count++;
-    }
-
+    file << std::fixed << std::setprecision(2);
     file << "Summary:\n";
-    file << "  BTB Valid Entries: " << btb_valid_entries << " / " << BHT_SIZE << "\n";
-    file << "  BHT Taken: " << bht_taken_count << " / " << BHT_SIZE << "\n";
-    file << "  BHT Not Taken: " << bht_not_taken_count << " / " << BHT_SIZE << "\n";
+    file << "  BTB Lookups: " << btb_lookups_ << ", Hits: " << btb_hits_
+         << " (" << percent(btb_hits_, btb_lookups_) << "%)\n";
+    file << "  BTB Valid Entries: " << branch_target_buffer_.ValidEntries()
+         << " / " << branch_target_buffer_.Entries() << "\n";
+    file << "  Direction Predictor Lookups: " << predictor_lookups_ << "\n";
+    file << "  Conditional Branches Resolved: " << conditional_branches_ << "\n";
+    file << "  Direction Mispredictions: " << direction_mispredictions_
+         << " (" << percent(direction_mispredictions_, conditional_branches_) << "%)\n";
+    file << "  Returns: " << returns_ << ", Mispredicted: " << return_mispredictions_
+         << " (" << percent(return_mispredictions_, returns_) << "%)\n";
+    file << "  Indirect Jumps: " << indirect_jumps_ << ", Mispredicted: " << indirect_mispredictions_
+         << " (" << percent(indirect_mispredictions_, indirect_jumps_) << "%)\n";
+    file << "  Fetch Redirects (all control transfers): " << branch_mispredictions_ << "\n";
     file << "\n";
+
     file << "================================================================================\n";
-    file << "                    COMBINED BTB + BHT TABLE\n";
+    file << "                    BRANCH TARGET BUFFER (BTB)\n";
     file << "================================================================================\n";
-
-    file << std::left
-         << std::setw(8) << "Index"
-         << std::setw(12) << "PC (Hex)"
-         << std::setw(16) << "BTB Target"
-         << std::setw(15) << "BHT State"
-         << std::setw(20) << "Branch Type" << "\n";
-    file << "--------------------------------------------------------------------------------\n";
-
-    for (size_t i = 0; i < BHT_SIZE; i++)
-    {
-        uint64_t target = branch_target_buffer_[i];
-        bool bht_state = branch_history_table_[i];
-
-        // Skip empty entries unless you want to see all
-        if (target == 0)
-            continue;
-
-        uint64_t pc = i * 4; // Approximate PC
-
-        std::stringstream pc_ss, target_ss;
-        pc_ss << "0x" << std::hex << std::setfill('0') << std::setw(8) << pc;
-
-        std::string target_str;
-        std::string branch_type;
-
-        if (target != 0)
-        {
-            target_ss << "0x" << std::hex << std::setfill('0') << std::setw(8) << target;
-            target_str = target_ss.str();
-
-            // Determine branch direction
-            if (target < pc)
-                branch_type = "BACKWARD (Loop)";
-            else if (target > pc)
-                branch_type = "FORWARD";
-            else
-                branch_type = "SELF";
-        }
-        else
-        {
-            target_str = "---";
-            branch_type = "No Branch";
-        }
-
-        std::string bht_str = bht_state ? "TAKEN (1)" : "NOT TAKEN (0)";
-
-        file << std::left
-             << std::setw(8) << i
-             << std::setw(12) << pc_ss.str()
-             << std::setw(16) << target_str
-             << std::setw(15) << bht_str
-             << std::setw(20) << branch_type << "\n";
-    }
-
+    branch_target_buffer_.Dump(file);
     file << "================================================================================\n\n";
 
-    // Detailed BTB Table
     file << "================================================================================\n";
-    file << "                    BRANCH TARGET BUFFER (BTB) - DETAILED\n";
+    file << "                    RETURN ADDRESS STACK / INDIRECT TARGETS\n";
     file << "================================================================================\n";
-    file << std::left
-         << std::setw(8) << "Index"
-         << std::setw(12) << "PC"
-         << std::setw(16) << "Target (Hex)"
-         << std::setw(12) << "Target (Dec)"
-         << std::setw(10) << "Offset" << "\n";
-    file << "--------------------------------------------------------------------------------\n";
-
-    for (size_t i = 0; i < BHT_SIZE; i++)
-    {
-        uint64_t target = branch_target_buffer_[i];
-        if (target == 0)
-            continue;
-
-        uint64_t pc = i * 4;
-        int64_t offset = target - pc;
-
-        std::stringstream pc_ss, target_ss;
-        pc_ss << "0x" << std::hex << std::setfill('0') << std::setw(8) << pc;
-        target_ss << "0x" << std::hex << std::setfill('0') << std::setw(8) << target;
-
-        std::string offset_str = (offset > 0 ? "+" : "") + std::to_string(offset);
-
-        file << std::left
-             << std::setw(8) << i
-             << std::setw(12) << pc_ss.str()
-             << std::setw(16) << target_ss.str()
-             << std::setw(12) << target
-             << std::setw(10) << offset_str << "\n";
-    }
-
+    return_stack_.Dump(file);
+    file << "\n";
+    indirect_predictor_.Dump(file);
     file << "================================================================================\n\n";
 
-    // Detailed BHT Table
     file << "================================================================================\n";
-    file << "                    BRANCH HISTORY TABLE (BHT) - DETAILED\n";
+    file << "                    DIRECTION PREDICTOR (" << branch_predictor_->Name() << ")\n";
     file << "================================================================================\n";
-    file << std::left
-         << std::setw(8) << "Index"
-         << std::setw(12) << "PC"
-         << std::setw(15) << "Prediction"
-         << std::setw(12) << "State Bit" << "\n";
-    file << "--------------------------------------------------------------------------------\n";
-
-    for (size_t i = 0; i < BHT_SIZE; i++)
-    {
-        // Only show entries that have corresponding BTB entries
-        if (branch_target_buffer_[i] == 0)
-            continue;
-
-        uint64_t pc = i * 4;
-        bool state = branch_history_table_[i];
-
-        std::stringstream pc_ss;
-        pc_ss << "0x" << std::hex << std::setfill('0') << std::setw(8) << pc;
-
-        file << std::left
-             << std::setw(8) << i
-             << std::setw(12) << pc_ss.str()
-             << std::setw(15) << (state ? "TAKEN" : "NOT TAKEN")
-             << std::setw(12) << (state ? 1 : 0) << "\n";
-    }
-
+    if (branch_prediction_enabled_ && !dynamic_branch_prediction_enabled_)
+        file << "(Not consulted in static mode)\n";
+    branch_predictor_->DumpTables(file);
     file << "================================================================================\n\n";
 
-    // Statistics Section
     file << "================================================================================\n";
     file << "                    BRANCH PREDICTION STATISTICS\n";
     file << "================================================================================\n";
-
     if (branch_prediction_enabled_)
-    {
-        file << "Total Branches Encountered: " << btb_valid_entries << "\n";
-
-        double btb_coverage = (btb_valid_entries * 100.0) / BHT_SIZE;
-        file << "BTB Coverage: " << std::fixed << std::setprecision(2) << btb_coverage << "%\n";
-
-        if (dynamic_branch_prediction_enabled_)
-        {
-            double taken_pct = (bht_taken_count * 100.0) / BHT_SIZE;
-            double not_taken_pct = (bht_not_taken_count * 100.0) / BHT_SIZE;
-
-            file << "\n1-Bit Predictor State Distribution:\n";
-            file << "  Predicting TAKEN: " << bht_taken_count
-                 << " (" << std::fixed << std::setprecision(2) << taken_pct << "%)\n";
-            file << "  Predicting NOT TAKEN: " << bht_not_taken_count
-                 << " (" << std::fixed << std::setprecision(2) << not_taken_pct << "%)\n";
-        }
-    }
+        branch_predictor_->WriteStats(file);
     else
-    {
         file << "Branch prediction is DISABLED\n";
-    }
-
     file << "================================================================================\n";
 
     file.close();
@@ -1679,33 +2706,24 @@ void RVSSVMPipelined::PrintBranchPredictionTables()
     qDebug() << "\n╔════════════════════════════════════════════════════════════════╗";
     qDebug() << "║          BRANCH PREDICTION TABLES (RUNTIME VIEW)              ║";
     qDebug() << "╚════════════════════════════════════════════════════════════════╝";
-    qDebug() << "Prediction Mode:" << (branch_prediction_enabled_ ? (dynamic_branch_prediction_enabled_ ? "1-BIT DYNAMIC" : "STATIC") : "DISABLED");
+    qDebug() << "Prediction Mode:" << (branch_prediction_enabled_ ? (dynamic_branch_prediction_enabled_ ? QString::fromStdString(branch_predictor_->Name()) : QString("STATIC")) : QString("DISABLED"));
     qDebug() << "Cycle:" << cycle_s_ << "Instructions:" << instructions_retired_;
 
-    qDebug() << "\n--- Active BTB Entries ---";
-    qDebug() << QString("Index").leftJustified(8)
-             << QString("PC").leftJustified(12)
-             << QString("Target").leftJustified(12)
-             << QString("BHT").leftJustified(10);
-    qDebug() << "----------------------------------------------------------------";
-
+    // Limit to 20 entries for console
+    std::ostringstream btb;
+    branch_target_buffer_.Dump(btb);
+    std::istringstream lines(btb.str());
+    std::string line;
     int count = 0;
-    for (size_t i = 0; i < BHT_SIZE && count < 20; i++) // Limit to 20 entries for console
+    while (std::getline(lines, line) && count < 22)
     {
-        if (branch_target_buffer_[i] != 0)
-        {
-            uint64_t pc = i * 4;
-            qDebug() << QString::number(i).leftJustified(8)
-                     << QString("0x%1").arg(pc, 8, 16, QChar('0')).leftJustified(12)
-                     << QString("0x%1").arg(branch_target_buffer_[i], 8, 16, QChar('0')).leftJustified(12)
-                     << QString(branch_history_table_[i] ? "T" : "NT").leftJustified(10);
-            count++;
-        }
+        qDebug().noquote() << QString::fromStdString(line);
+        count++;
     }
 
-    if (count == 0)
+    if (branch_target_buffer_.ValidEntries() == 0)
         qDebug() << "  (No active branches yet)";
-    else if (count == 20)
+    else if (branch_target_buffer_.ValidEntries() > 20)
         qDebug() << "  ... (showing first 20 entries, see dump file for complete table)";
 
     qDebug() << "================================================================\n";
@@ -1753,3 +2771,8 @@ void RVSSVMPipelined::DumpPipelineState()
     qDebug() << "Fetch remaining:" << (program_counter_ < program_size_);
     qDebug() << "════════════════════════════════════════════════════════════\n";
 }
+
+template void RVSSVMPipelined::EX_stage<ISA::RV32>();
+template void RVSSVMPipelined::EX_stage<ISA::RV64>();
+template void RVSSVMPipelined::MEM_stage<ISA::RV32>();
+template void RVSSVMPipelined::MEM_stage<ISA::RV64>();
@@ -4,29 +4,64 @@
 
 #include <QObject>
 #include <QMap>
+#include <QDebug>
 #include "rvss_control_unit.h"
 #include "rvss_vm.h"
 #include "hazardUnit.h"
 #include "forwarding_unit.h"
-
+#include "pipeline_undo_log.h"
+#include "sampled_simulation.h"
+#include "branch_predictor.h"
+#include "pipeline_trace.h"
+#include "cpi_stack.h"
+#include "macro_fusion.h"
+#include "fetch_frontend.h"
+#include "stage_snapshot.h"
+
+#include <array>
 #include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class LockstepChecker;
+
+// Per-cycle stage logging; the message is formatted only while trace_stages_ is set
+#define STAGE_LOG if (!trace_stages_) {} else qDebug()
 
 class RVSSVMPipelined : public RVSSVM
 {
     Q_OBJECT
 
-private:
+protected:
     RVSSControlUnit control_unit_;
 
+    // The head of a fused pair riding in its tail's latch; the latch's pc and instruction are
+    // the tail's, and the head sits at pc - 4
+    struct FusedHead {
+        FusionKind kind = FusionKind::kNone;
+        uint32_t instruction = 0;
+        uint8_t rd = 0;
+        uint64_t value = 0;  // head's result from EX on; for a load pair, its address until MEM
+    };
+
     struct IF_ID {
         bool valid = false;
+        uint64_t seq = 0;  // fetch order; names the instruction in pipeline traces
         uint64_t pc = 0;
         uint32_t instruction = 0;
         bool predicted_taken = false;
+        uint64_t predicted_pc = 0;  // where IF fetched next; EX redirects if it was wrong
+        ReturnAddressStack::Checkpoint ras_checkpoint;  // return stack before this fetch's push/pop
+        // Why an invalid latch is empty, charged to the CPI stack when the bubble reaches ID
+        StallCause bubble_cause = StallCause::kFillDrain;
+        uint64_t bubble_pc = CpiStack::kNoPc;
+        FusedHead fused;
     } if_id_, if_id_next_;
 
     struct ID_EX {
         bool valid = false;
+        uint64_t seq = 0;
         uint64_t pc = 0;
         uint32_t instruction = 0;
         bool is_syscall;
@@ -45,11 +80,15 @@ private:
 
         // bool is_float = false;  // Add this
         bool predicted_taken = false;
+        uint64_t predicted_pc = 0;
+        ReturnAddressStack::Checkpoint ras_checkpoint;
+        FusedHead fused;
 
     } id_ex_, id_ex_next_;
 
     struct EX_MEM {
         bool valid = false;
+        uint64_t seq = 0;
         uint64_t pc = 0;
         uint32_t instruction = 0;
 
@@ -61,60 +100,220 @@ private:
          bool is_float = false;
         uint64_t branch_target = 0;
          bool is_syscall = false;
+        FusedHead fused;
     } ex_mem_, ex_mem_next_;
 
     struct MEM_WB {
         bool valid = false;
+        uint64_t seq = 0;
         uint8_t rd = 0;
         bool reg_write = false, mem_to_reg = false;
         uint64_t alu_result = 0, mem_data = 0;
+        uint64_t store_data = 0;  // value a store wrote, for lockstep checking
         uint64_t pc = 0;
         bool is_float = false;
         bool is_syscall = false;
+        bool branch_taken = false;
+        uint64_t branch_target = 0;
         uint32_t instruction = 0;
+        FusedHead fused;
     } mem_wb_, mem_wb_next_;
 
-    struct PipelineStepDelta {
-        // PC state
-        uint64_t old_pc;
-        uint64_t new_pc;
-
-        // Pipeline register snapshots
-        IF_ID old_if_id;
-        ID_EX old_id_ex;
-        EX_MEM old_ex_mem;
-        MEM_WB old_mem_wb;
-
-        IF_ID new_if_id;
-        ID_EX new_id_ex;
-        EX_MEM new_ex_mem;
-        MEM_WB new_mem_wb;
-
-        // Register/memory changes (same as before)
-        std::vector<RegisterChange> register_changes;
-        std::vector<MemoryChange> memory_changes;
-
-        // Pipeline control state
-        bool old_stall;
-        bool new_stall;
-        bool old_pc_update_pending;
-        uint64_t old_pc_update_value;
-
-        // Statistics
-        uint64_t old_cycle;
-        uint64_t old_instructions_retired;
-        uint64_t old_stall_cycles;
-    };
-
     bool pc_update_pending_ = false;
     uint64_t pc_update_value_ = 0;
+
+    // Deeper pipelines (vm_config [PipelineDepth]): fetch, execute and memory can each take up to
+    // kMaxStageDepth cycles. The stages after the first of each group are plain delay latches,
+    // youngest first, so fetch[0] holds the instruction in IF2 and execute[0] the one in EX2.
+    static constexpr size_t kMaxStageDepth = 4;
+    struct StagePipes {
+        IF_ID fetch[kMaxStageDepth - 1];
+        EX_MEM execute[kMaxStageDepth - 1];
+        MEM_WB memory[kMaxStageDepth - 1];
+    } pipes_;
+    static_assert(kMaxStageDepth - 1 <= kMaxExtraStages, "every extra stage needs a PipelineStage");
+    uint64_t fetch_stages_ = 1;
+    uint64_t execute_stages_ = 1;
+    uint64_t memory_stages_ = 1;
+
+    // With several EX stages a branch is resolved in EX1 but only redirects fetch as it leaves the
+    // last one; until then the instructions behind it are known to be wrong-path and flow as bubbles
+    struct PendingRedirect {
+        bool valid = false;
+        uint64_t cycles_left = 0;
+        uint64_t pc = 0;         // correct next PC
+        uint64_t branch_pc = 0;
+        uint32_t instruction = 0;
+        ReturnAddressStack::Checkpoint ras_checkpoint;
+    } pending_redirect_;
+
+    // Shifts the extra stages by one cycle: the latch leaving the first stage of each group goes in,
+    // the one leaving the last stage comes out (held fetch stages don't move while ID stalls)
+    void AdvanceStagePipes();
+    // Sends fetch to the correct path and repairs the return stack after a misprediction
+    void ApplyRedirect(const PendingRedirect &redirect);
+    uint64_t control_pc_ = 0;  // branch behind the last redirect, charged for the slots it costs
+    // Fetch-to-redirect bubbles of a misprediction and load-to-use distance for the configured depth
+    uint64_t redirect_penalty_ = 2;
+    uint64_t load_use_distance_ = 1;
     // bool branch_taken_this_cycle_ = false;
 
+    // Decoupled frontend (vm_config [Frontend]): the predictor runs ahead of fetch through the
+    // fetch target queue, and IF takes instructions from the instruction buffer instead of memory
+    DecoupledFrontend frontend_;
+    bool decoupled_frontend_ = false;
+    uint64_t fetch_target_queue_entries_ = 8;
+    uint64_t fetch_block_bytes_ = 32;
+    uint64_t instruction_buffer_entries_ = 16;
+    // Restarts the frontend on the correct path after a redirect, or wherever the PC was moved
+    // to (fast-forward, snapshot), then fetches one block and predicts the next one
+    void ClockFrontend();
+    // Empties both queues and predicts from `pc`; with `repair_ras` the return stack loses the
+    // pushes and pops of everything IF has not handed to decode
+    void RestartFrontend(uint64_t pc, bool repair_ras, StallCause cause, uint64_t cause_pc);
+    // Hands the oldest buffered instruction (or fused pair) to decode as IF/ID-next
+    void DeliverBufferedInstruction();
+    uint64_t fetch_blocks_ = 0;
+    uint64_t frontend_restarts_ = 0;
+    uint64_t ftq_full_cycles_ = 0;
+    uint64_t buffer_empty_cycles_ = 0;
+    StatsHistogram ftq_occupancy_{1, kMaxFetchTargetQueue + 1};
+    StatsHistogram buffer_occupancy_{1, kMaxInstructionBuffer + 1};
+
+    // Where fetch goes after `instruction` at `pc`: the return stack, BTB, direction and indirect
+    // predictors as configured. Applies the instruction's return stack push/pop and leaves the
+    // stack from before it in `ras_checkpoint`
+    uint64_t PredictNextPc(uint64_t pc, uint32_t instruction, bool &predicted_taken,
+                           ReturnAddressStack::Checkpoint &ras_checkpoint);
+
     void IF_stage();
     void ID_stage();
-    void EX_stage();
-    void MEM_stage();
+    // Run the instantiation BindIsa picked; the RV32 ones drop FLD/FSD and LD/SD without
+    // asking the register file
+    void EX_stage() { (this->*ex_stage_)(); }
+    void MEM_stage() { (this->*mem_stage_)(); }
     void WB_stage();
+    template <ISA kIsa> void EX_stage();
+    template <ISA kIsa> void MEM_stage();
+    void (RVSSVMPipelined::*ex_stage_)() = nullptr;
+    void (RVSSVMPipelined::*mem_stage_)() = nullptr;
+    void BindIsa() override;
+    // Runs the stages of one cycle, youngest-state-first (WB .. IF); latches advance separately
+    virtual void ClockStages();
+    // Result of the fused head in EX, from the forwarded values of its sources
+    uint64_t ExecuteFusedHead(uint64_t rs1_value, uint64_t rs2_value);
+    // Writes back and retires the head of the fused pair in WB, ahead of its tail
+    void RetireFusedHead();
+    // Integer load of width `funct3`, sign- or zero-extended
+    uint64_t LoadIntegerData(uint64_t address, uint8_t funct3);
+    // Value of `reg` for the instruction in EX: the youngest in-flight result for it, or
+    // `value` (read in ID) when nothing newer is in flight
+    virtual uint64_t ForwardOperand(uint8_t reg, bool is_float, uint64_t value) const;
+
+    // Credits the instruction in WB to the profilers and charges the cycle to the
+    // oldest instruction in flight
+    virtual void ProfileCycle();
+
+    // Reports the stage of every instruction in flight to pipeline_trace_; called after
+    // ClockStages, while the latches still describe the cycle just simulated
+    virtual void TraceCycle();
+    // Reports the scalar latches as `lane`; IF/ID-next only counts as IF if it was fetched this
+    // cycle, i.e. its sequence number is above `fetched_after`
+    void TraceLatches(uint32_t lane, uint64_t fetched_after);
+    uint64_t fetch_seq_ = 0;
+    uint64_t traced_fetch_seq_ = 0;  // fetch_seq_ at the end of the last traced cycle
+
+    // Charges ID's issue slot this cycle to `cause` and remembers it for the other lanes
+    void LoseIssueSlot(StallCause cause, uint64_t pc);
+    StallCause id_cause_ = StallCause::kFillDrain;
+    uint64_t id_cause_pc_ = CpiStack::kNoPc;
+    // Issue slots per cycle, the width of the CPI stack
+    virtual uint64_t IssueWidth() const { return 1; }
+
+    // Counts a stalled cycle and feeds finished stall runs into stall_bursts_
+    void CountStall(bool stalled);
+    StatsHistogram stall_bursts_{1, 16};
+    uint64_t stall_burst_ = 0;
+
+    // Compares each instruction leaving WB with a single-cycle reference while RunLockstep runs
+    LockstepChecker *lockstep_ = nullptr;
+
+    // While set, WB evaluates breakpoints as their instructions retire
+    bool stop_at_breakpoints_ = false;
+    // The breakpoint execution resumes from, which retires once without stopping, or CpiStack::kNoPc
+    uint64_t released_breakpoint_pc_ = CpiStack::kNoPc;
+    // Set by WB when the last clock stopped at a breakpoint
+    bool stopped_at_breakpoint_ = false;
+    // Called by WB before the instruction at `pc` retires. If a breakpoint there holds against the
+    // retired state, squashes that instruction and everything younger and returns true
+    bool StopAtBreakpoint(uint64_t pc);
+    // Empties every latch and stage pipe without retiring anything
+    virtual void SquashInFlight();
+
+    // A store or fcsr write by an instruction that has not retired, logged while breakpoints are
+    // armed so that a breakpoint can back it out; size 0 marks fcsr
+    struct InFlightWrite
+    {
+        uint64_t seq;
+        uint64_t address;
+        uint64_t old_value;
+        uint64_t new_value;
+        uint8_t size;
+    };
+    std::vector<InFlightWrite> in_flight_writes_;
+    bool LogsInFlightWrites() const { return stop_at_breakpoints_ && !breakpoints_.Empty(); }
+    void WriteInFlight(const InFlightWrite &write, uint64_t value);
+
+    // Set by Step() for the stage logs; Run() and RunSampled() clear it so that batch runs
+    // format no log messages
+    bool trace_stages_ = true;
+
+    // Sampled simulation: while fetch is blocked, IF inserts bubbles so the pipeline drains
+    bool fetch_blocked_ = false;
+    void DetailedCycle();
+    // Runs with fetch blocked until every fetched instruction has retired; throws if that takes
+    // longer than DrainCycleBound(), which only a wedged pipeline can
+    void DrainPipeline();
+    // Worst-case drain time for the configured stage depths, issue width and unit timings
+    uint64_t DrainCycleBound() const;
+    // Executes single-cycle until `instruction_count` instructions have retired; false if the program ended first
+    bool FastForward(uint64_t instruction_count, bool train_predictor);
+    // Trains the direction predictor and the BTB with a resolved branch or jump
+    void TrainBranchPredictor(uint64_t pc, uint32_t instruction, bool taken, uint64_t target);
+
+    // Branch prediction counters, kept for whichever predictor is configured
+    uint64_t btb_lookups_ = 0;
+    uint64_t btb_hits_ = 0;
+    uint64_t predictor_lookups_ = 0;
+    uint64_t conditional_branches_ = 0;
+    uint64_t direction_mispredictions_ = 0;
+    uint64_t returns_ = 0;
+    uint64_t return_mispredictions_ = 0;
+    uint64_t indirect_jumps_ = 0;
+    uint64_t indirect_mispredictions_ = 0;
+
+    // Multi-cycle functional units: an instruction books its unit and destination when it
+    // leaves ID, and later instructions wait in ID until their sources and unit are ready
+    FunctionalUnitTimings functional_unit_timing_{};
+    Scoreboard scoreboard_;
+    std::array<uint64_t, kFunctionalUnitCount> functional_unit_ops_{};
+    uint64_t scoreboard_raw_stalls_ = 0;
+    uint64_t scoreboard_waw_stalls_ = 0;
+    uint64_t structural_stalls_ = 0;
+
+    // Fused pairs issued, per kind (kNone counts all of them)
+    std::array<uint64_t, kFusionKindCount> fused_pairs_{};
+
+    // Instructions the pipeline can hold per stage; snapshots with more lanes can't be resumed here
+    virtual size_t IssueLanes() const { return 1; }
+
+    // Records the PC in every occupied stage from the latches
+    virtual void CaptureStages(StageSnapshot &stages) const;
+    // Hands the GUI the current stages; called once per Step and once at the end of a run, never
+    // per cycle of Run
+    void PublishStages();
+    // Hands the GUI an empty pipeline
+    void ClearPublishedStages();
 
     // void advance_pipeline_registers();
 
@@ -129,26 +328,59 @@ public:
 
     void Run() override;
     void DebugRun() override;
+    // Makes the following clocks stop at breakpoints. Arming with an empty pipeline lets the
+    // instruction at the current PC through, so resuming from a breakpoint makes progress
+    void ArmBreakpoints(bool armed);
+    // True when the last clock stopped at a breakpoint; the pipeline is then empty and the PC
+    // is the breakpoint's
+    bool BreakpointHit() const { return stopped_at_breakpoint_; }
+    // Runs the program functionally and simulates only the plan's windows cycle by cycle
+    SampledRunResult RunSampled(const SamplingPlan &plan);
+    // Runs like Run() while `checker` compares every retirement with its reference; starts from an empty pipeline
+    void RunLockstep(LockstepChecker &checker);
     void Step() override;
+    // Restores the pipeline, registers, memory and the cycle, stall, misprediction and CPI stack
+    // counters of the last Step(). The execution profile and call graph start over
     void Undo() override;
     // void Redo() override;
     void Reset() override;
-    std::stack<PipelineStepDelta> pipeline_undo_stack_;
+    void SaveSnapshot(VmSnapshot &snapshot) override;
+    void RestoreSnapshot(const VmSnapshot &snapshot) override;
+    PipelineUndoLog pipeline_undo_log_;
+    // CPI stack updates of the cycle Step() is recording
+    std::vector<CpiStack::Change> cpi_changes_;
 
     const IF_ID& getIfId() const { return if_id_; }
     const ID_EX& getIdEx() const { return id_ex_; }
     const EX_MEM& getExMem() const { return ex_mem_; }
     const MEM_WB& getMemWb() const { return mem_wb_; }
 
+    // Kanata log of stage occupancy for the Konata viewer
+    PipelineTraceWriter pipeline_trace_;
+    // Every issue slot, used or charged to the cause that wasted it
+    CpiStack cpi_stack_;
+    void WriteCpiStack(std::ostream &out, size_t limit = 5) const;
+
     bool hazard_detection_enabled_;
     bool forwarding_enabled_;
 
     bool branch_prediction_enabled_;  // enables branch prediction (static or dynamic)
     bool dynamic_branch_prediction_enabled_; // enables dynamic mode when branch_prediction_enabled_ is true
-
-    static constexpr int BHT_SIZE = 256;
-    std::vector<bool> branch_history_table_;      // 1-bit dynamic predictor bits
-    std::vector<uint64_t> branch_target_buffer_;  // branch target addresses
+    bool fusion_enabled_ = false;  // IF pairs the idioms in macro_fusion.h into one pipeline entry
+
+    // The BTB supplies targets in both modes; the direction predictor is only consulted in dynamic mode
+    std::unique_ptr<BranchPredictor> branch_predictor_;
+    BranchTargetBuffer branch_target_buffer_;
+    ReturnAddressStack return_stack_;
+    IndirectTargetPredictor indirect_predictor_;
+    // Rebuilds the predictor and BTB from vm_config (cold tables)
+    void ConfigureBranchPredictor();
+    // Loads functional unit latencies and initiation intervals from vm_config
+    void ConfigureFunctionalUnits();
+    // Loads the fetch, execute and memory stage counts from vm_config and empties the extra stages
+    void ConfigurePipelineDepth();
+    // Loads the [Frontend] settings from vm_config and empties the frontend's queues
+    void ConfigureFrontend();
 
 
     void SetForwardingEnabled(bool enabled) { forwarding_enabled_ = enabled; }
@@ -158,23 +390,26 @@ public:
 
     HazardDetectionUnit hazard_unit_;
     bool stall_ = false; // when true, IF/ID is frozen and ID/EX gets a bubble
-    bool flush_pipeline_;
+    bool flush_pipeline_ = false;
 
     void DumpPipelineState();
-    void advance_pipeline_registers();
+    virtual void advance_pipeline_registers();
     void SetPipelineConfig(bool hazardEnabled,
                            bool forwardingEnabled,
                            bool branchPredictionEnabled,
-                           bool dynamicPredictionEnabled) override;
+                           bool dynamicPredictionEnabled,
+                           bool fusionEnabled = false) override;
 
     void DumpBranchPredictionTables(const std::filesystem::path &filepath);
     void PrintBranchPredictionTables();
 
-private:
-    std::map<std::string, uint64_t> stage_to_pc_;
+    // The stages as of the last Step or run, for the GUI to poll at its refresh rate; safe to
+    // call from another thread while the VM runs
+    StageSnapshot PublishedStages() const;
 
-signals:
-    void pipelineStageChanged(uint64_t pc, QString stageName);
+protected:
+    mutable std::mutex published_stages_mutex_;
+    StageSnapshot published_stages_;
 };
 
 #endif // RVSS_VM_PIPELINED_H
@@ -0,0 +1,149 @@
+/**
+ * @file sampled_simulation.cpp
+ * @brief Contains the implementation of the sampling plan and result statistics.
+ */
+#include "sampled_simulation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <map>
+#include <stdexcept>
+
+namespace {
+// Two-sided 97.5th percentile of Student's t for 1..30 degrees of freedom
+constexpr double kStudentT975[] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+
+double StudentT975(size_t degrees_of_freedom) {
+  if (degrees_of_freedom == 0) {
+    return 0.0;
+  }
+  if (degrees_of_freedom <= std::size(kStudentT975)) {
+    return kStudentT975[degrees_of_freedom - 1];
+  }
+  return 1.960;
+}
+
+// Reads "<value> <cluster>" lines into cluster -> value
+template <typename T>
+std::map<uint64_t, T> ReadClusterFile(const std::filesystem::path &filename) {
+  std::ifstream file(filename);
+  if (!file.is_open()) {
+    throw std::runtime_error("Unable to open file: " + filename.string());
+  }
+  std::map<uint64_t, T> values;
+  T value;
+  uint64_t cluster;
+  while (file >> value >> cluster) {
+    values[cluster] = value;
+  }
+  return values;
+}
+} // namespace
+
+SamplingPlan SamplingPlan::FromSimPoints(const std::filesystem::path &simpoints, const std::filesystem::path &weights,
+                                         uint64_t interval) {
+  if (interval == 0) {
+    throw std::invalid_argument("SimPoint interval must be greater than zero");
+  }
+  auto intervals = ReadClusterFile<uint64_t>(simpoints);
+  auto cluster_weights = ReadClusterFile<double>(weights);
+
+  SamplingPlan plan;
+  plan.window = interval;
+  for (const auto &[cluster, index] : intervals) {
+    auto weight = cluster_weights.find(cluster);
+    if (weight == cluster_weights.end()) {
+      throw std::runtime_error("No weight for SimPoint cluster " + std::to_string(cluster));
+    }
+    plan.points.emplace_back(index*interval, weight->second);
+  }
+  std::sort(plan.points.begin(), plan.points.end());
+  return plan;
+}
+
+bool SamplingPlan::Window(size_t k, uint64_t &start, double &weight) const {
+  if (!points.empty()) {
+    if (k >= points.size()) {
+      return false;
+    }
+    start = points[k].first;
+    weight = points[k].second;
+    return true;
+  }
+  if ((max_windows != 0 && k >= max_windows) || (period == 0 && k > 0)) {
+    return false;
+  }
+  start = fast_forward + warmup + k*std::max(period, warmup + window);
+  weight = 1.0;
+  return true;
+}
+
+double SampledRunResult::MeanCpi() const {
+  double sum = 0.0;
+  double total_weight = 0.0;
+  for (const auto &window : windows) {
+    sum += window.weight*window.Cpi();
+    total_weight += window.weight;
+  }
+  return total_weight == 0.0 ? 0.0 : sum/total_weight;
+}
+
+double SampledRunResult::ConfidenceHalfWidth() const {
+  size_t n = windows.size();
+  if (weighted || n < 2) {
+    return 0.0;
+  }
+  double mean = MeanCpi();
+  double squares = 0.0;
+  for (const auto &window : windows) {
+    squares += (window.Cpi() - mean)*(window.Cpi() - mean);
+  }
+  double standard_error = std::sqrt(squares/static_cast<double>(n - 1))/std::sqrt(static_cast<double>(n));
+  return StudentT975(n - 1)*standard_error;
+}
+
+uint64_t SampledRunResult::ExtrapolatedCycles() const {
+  return static_cast<uint64_t>(std::llround(MeanCpi()*static_cast<double>(total_instructions)));
+}
+
+void SampledRunResult::WriteReport(std::ostream &out) const {
+  out << "Sampled run: " << windows.size() << " windows, " << total_instructions << " instructions ("
+      << detailed_instructions << " simulated in detail, " << detailed_cycles << " detailed cycles)\n\n";
+  out << std::left << std::setw(8) << "Window" << std::right << std::setw(16) << "Start"
+      << std::setw(14) << "Instructions" << std::setw(12) << "Cycles" << std::setw(10) << "CPI";
+  if (weighted) {
+    out << std::setw(10) << "Weight";
+  }
+  out << "\n";
+  for (size_t i = 0; i < windows.size(); ++i) {
+    const SampleWindow &window = windows[i];
+    out << std::left << std::setw(8) << i << std::right << std::setw(16) << window.start
+        << std::setw(14) << window.instructions << std::setw(12) << window.cycles
+        << std::setw(10) << std::fixed << std::setprecision(4) << window.Cpi();
+    if (weighted) {
+      out << std::setw(10) << window.weight;
+    }
+    out << "\n";
+  }
+
+  double mean = MeanCpi();
+  out << "\nEstimated CPI: " << std::setprecision(4) << mean;
+  if (!weighted && windows.size() >= 2) {
+    double half_width = ConfidenceHalfWidth();
+    out << " +/- " << half_width << " (95% CI " << mean - half_width << " .. " << mean + half_width;
+    if (mean != 0.0) {
+      out << ", +/-" << std::setprecision(2) << 100.0*half_width/mean << "%";
+    }
+    out << ")";
+  } else if (weighted) {
+    out << " (SimPoint weighted)";
+  }
+  out << "\nExtrapolated cycles: " << ExtrapolatedCycles() << "\n";
+  out << std::defaultfloat;
+}
@@ -0,0 +1,80 @@
+/**
+ * @file sampled_simulation.h
+ * @brief Contains the sampling plan and result types for sampled pipeline simulation.
+ */
+#ifndef SAMPLED_SIMULATION_H
+#define SAMPLED_SIMULATION_H
+
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Describes where the detailed windows of a sampled run are placed.
+ *
+ * Instructions outside the windows are executed functionally. Each window
+ * first runs `warmup` instructions in the detailed model to fill the pipeline
+ * (not measured), then measures `window` instructions.
+ *
+ * Windows are either periodic (systematic sampling: one every `period`
+ * instructions after `fast_forward`) or explicit, e.g. the SimPoint picks with
+ * their cluster weights.
+ */
+struct SamplingPlan {
+  uint64_t fast_forward = 0;
+  uint64_t warmup = 1000;
+  uint64_t window = 10000;
+  uint64_t period = 0;       // 0 means a single window
+  uint64_t max_windows = 0;  // 0 means until the program ends
+  bool functional_warmup = true;  // train the branch predictor while fast-forwarding
+
+  // Explicit (first measured instruction, weight) pairs; overrides the periodic placement
+  std::vector<std::pair<uint64_t, double>> points;
+
+  /**
+   * @brief Builds a plan from SimPoint's .simpoints/.weights output.
+   * @param interval The BBV interval the simpoints were computed for; it is also the window length.
+   */
+  static SamplingPlan FromSimPoints(const std::filesystem::path &simpoints, const std::filesystem::path &weights,
+                                    uint64_t interval);
+
+  /**
+   * @brief Returns the start of the k-th window, or false if there is none.
+   */
+  bool Window(size_t k, uint64_t &start, double &weight) const;
+};
+
+struct SampleWindow {
+  uint64_t start = 0;  // retired-instruction count at the start of the measurement
+  uint64_t instructions = 0;
+  uint64_t cycles = 0;
+  double weight = 1.0;
+
+  double Cpi() const { return instructions == 0 ? 0.0 : static_cast<double>(cycles)/static_cast<double>(instructions); }
+};
+
+/**
+ * @brief Per-window measurements of a sampled run and the CPI extrapolated from them.
+ */
+struct SampledRunResult {
+  std::vector<SampleWindow> windows;
+  uint64_t total_instructions = 0;
+  uint64_t detailed_instructions = 0;  // including warm-up and drain
+  uint64_t detailed_cycles = 0;
+  bool weighted = false;
+
+  double MeanCpi() const;
+  /**
+   * @brief Half-width of the 95% confidence interval of the mean CPI (Student's t); 0 if not computable.
+   *
+   * Only meaningful for systematic sampling; SimPoint windows are not a random sample.
+   */
+  double ConfidenceHalfWidth() const;
+  uint64_t ExtrapolatedCycles() const;
+
+  void WriteReport(std::ostream &out) const;
+};
+
+#endif // SAMPLED_SIMULATION_H
@@ -0,0 +1,82 @@
+/**
+ * @file spsc_queue.h
+ * @brief Contains a bounded lock-free single-producer single-consumer queue.
+ */
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Fixed-capacity ring buffer for exactly one producer thread and one consumer thread.
+ *
+ * Each side owns one index and only reads the other's; both keep a cached copy
+ * of the other index so the shared cache line is only touched when the queue
+ * looks full (producer) or empty (consumer). Neither side ever blocks: callers
+ * decide how to wait.
+ */
+template <typename T>
+class SpscQueue {
+  static_assert(std::is_trivially_copyable_v<T>, "Queue entries are copied between threads bytewise");
+
+ public:
+  /**
+   * @param capacity Rounded up to a power of two.
+   */
+  explicit SpscQueue(size_t capacity) {
+    size_t size = 2;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    buffer_.resize(size);
+    mask_ = size - 1;
+  }
+
+  SpscQueue(const SpscQueue &) = delete;
+  SpscQueue &operator=(const SpscQueue &) = delete;
+
+  // Producer only; false if the queue is full
+  bool TryPush(const T &value) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - cached_head_ > mask_) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if (tail - cached_head_ > mask_) {
+        return false;
+      }
+    }
+    buffer_[tail & mask_] = value;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer only; false if the queue is empty
+  bool TryPop(T &value) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == cached_tail_) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      if (head == cached_tail_) {
+        return false;
+      }
+    }
+    value = buffer_[head & mask_];
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t Capacity() const { return mask_ + 1; }
+
+ private:
+  static constexpr size_t kCacheLine = 64;
+
+  std::vector<T> buffer_;
+  size_t mask_ = 0;
+  alignas(kCacheLine) std::atomic<size_t> head_{0};  // next entry to pop, written by the consumer
+  size_t cached_tail_ = 0;                           // consumer's view of tail_
+  alignas(kCacheLine) std::atomic<size_t> tail_{0};  // next entry to push, written by the producer
+  size_t cached_head_ = 0;                           // producer's view of head_
+};
+
+#endif // SPSC_QUEUE_H
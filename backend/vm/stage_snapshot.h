@@ -0,0 +1,65 @@
+/**
+ * @file stage_snapshot.h
+ * @brief Contains the fixed-size record of which instruction each pipeline stage holds.
+ */
+#ifndef STAGE_SNAPSHOT_H
+#define STAGE_SNAPSHOT_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief The stages the editor labels. Extra stages of a deeper pipeline are numbered from 2;
+ * the dual-issue VM's second lane shows up as ID2, EX2, MEM2 and WB2.
+ */
+enum class PipelineStage : uint8_t {
+  kIF, kID, kEX, kMEM, kWB,
+  kIF2, kIF3, kIF4,
+  kEX2, kEX3, kEX4,
+  kMEM2, kMEM3, kMEM4,
+  kLaneID, kLaneEX, kLaneMEM, kLaneWB,
+  kCount
+};
+
+constexpr size_t kPipelineStageCount = static_cast<size_t>(PipelineStage::kCount);
+
+// Extra stages of each group: IF2..IF4, EX2..EX4, MEM2..MEM4
+constexpr size_t kMaxExtraStages = 3;
+
+// The index-th extra stage after `first` (kIF2, kEX2 or kMEM2)
+constexpr PipelineStage ExtraStage(PipelineStage first, size_t index) {
+  return static_cast<PipelineStage>(static_cast<size_t>(first) + index);
+}
+
+inline const char *PipelineStageName(PipelineStage stage) {
+  static constexpr const char *kNames[kPipelineStageCount] = {
+      "IF", "ID", "EX", "MEM", "WB",
+      "IF2", "IF3", "IF4",
+      "EX2", "EX3", "EX4",
+      "MEM2", "MEM3", "MEM4",
+      "ID2", "EX2", "MEM2", "WB2"};
+  return kNames[static_cast<size_t>(stage)];
+}
+
+/**
+ * @brief The PC in every occupied stage at the end of a cycle. Plain data, so the VM can hand
+ * a copy to the GUI thread without building strings or sending a signal per stage.
+ */
+struct StageSnapshot {
+  std::array<uint64_t, kPipelineStageCount> pc{};
+  uint32_t occupied = 0;  // one bit per PipelineStage
+  uint64_t cycle = 0;
+
+  bool Holds(PipelineStage stage) const { return (occupied >> static_cast<size_t>(stage)) & 1u; }
+  uint64_t Pc(PipelineStage stage) const { return pc[static_cast<size_t>(stage)]; }
+
+  void Set(PipelineStage stage, uint64_t stage_pc) {
+    pc[static_cast<size_t>(stage)] = stage_pc;
+    occupied |= 1u << static_cast<size_t>(stage);
+  }
+};
+
+static_assert(kPipelineStageCount <= 32, "StageSnapshot::occupied has one bit per stage");
+
+#endif // STAGE_SNAPSHOT_H
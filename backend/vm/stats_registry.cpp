@@ -0,0 +1,200 @@
+/**
+ * @file stats_registry.cpp
+ * @brief Contains the implementation of the statistics registry.
+ */
+#include "stats_registry.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+void StatsHistogram::Clear() {
+  std::fill(buckets_.begin(), buckets_.end(), 0);
+  samples_ = 0;
+  sum_ = 0;
+}
+
+void StatsRegistry::AddScalar(const std::string &name, const uint64_t *value, const std::string &description) {
+  if (Contains(name)) {
+    throw std::invalid_argument("Duplicate statistic: " + name);
+  }
+  scalars_.push_back({name, description, value});
+  last_values_.push_back(*value);
+}
+
+void StatsRegistry::AddHistogram(const std::string &name, const StatsHistogram *histogram,
+                                 const std::string &description) {
+  if (Contains(name)) {
+    throw std::invalid_argument("Duplicate statistic: " + name);
+  }
+  histograms_.push_back({name, description, histogram});
+}
+
+void StatsRegistry::AddRatio(const std::string &name, const std::string &numerator, const std::string &denominator,
+                             double scale, const std::string &description) {
+  if (Contains(name)) {
+    throw std::invalid_argument("Duplicate statistic: " + name);
+  }
+  ratios_.push_back({name, description, ScalarIndex(numerator), ScalarIndex(denominator), scale});
+}
+
+bool StatsRegistry::Contains(const std::string &name) const {
+  auto named = [&name](const auto &stat) { return stat.name == name; };
+  return std::any_of(scalars_.begin(), scalars_.end(), named)
+      || std::any_of(histograms_.begin(), histograms_.end(), named)
+      || std::any_of(ratios_.begin(), ratios_.end(), named);
+}
+
+size_t StatsRegistry::ScalarIndex(const std::string &name) const {
+  for (size_t i = 0; i < scalars_.size(); ++i) {
+    if (scalars_[i].name == name) {
+      return i;
+    }
+  }
+  throw std::invalid_argument("Unknown statistic: " + name);
+}
+
+double StatsRegistry::Divide(double scale, uint64_t numerator, uint64_t denominator) {
+  return denominator == 0 ? 0.0 : scale*static_cast<double>(numerator)/static_cast<double>(denominator);
+}
+
+double StatsRegistry::Value(const std::string &name) const {
+  for (const auto &ratio : ratios_) {
+    if (ratio.name == name) {
+      return Divide(ratio.scale, *scalars_[ratio.numerator].value, *scalars_[ratio.denominator].value);
+    }
+  }
+  return static_cast<double>(*scalars_[ScalarIndex(name)].value);
+}
+
+void StatsRegistry::WriteJson(std::ostream &out) const {
+  out << "{\n";
+  bool first = true;
+  auto key = [&out, &first](const std::string &name) -> std::ostream & {
+    out << (first ? "" : ",\n") << "  \"" << name << "\": ";
+    first = false;
+    return out;
+  };
+  for (const auto &scalar : scalars_) {
+    key(scalar.name) << *scalar.value;
+  }
+  for (const auto &ratio : ratios_) {
+    key(ratio.name) << Divide(ratio.scale, *scalars_[ratio.numerator].value, *scalars_[ratio.denominator].value);
+  }
+  for (const auto &histogram : histograms_) {
+    const StatsHistogram &h = *histogram.histogram;
+    key(histogram.name) << "{\"bucket_width\": " << h.BucketWidth() << ", \"samples\": " << h.Samples()
+                        << ", \"mean\": " << h.Mean() << ", \"buckets\": [";
+    for (size_t i = 0; i < h.Buckets().size(); ++i) {
+      out << (i ? ", " : "") << h.Buckets()[i];
+    }
+    out << "]}";
+  }
+  out << "\n}\n";
+}
+
+void StatsRegistry::WriteCsv(std::ostream &out) const {
+  auto quoted = [](const std::string &text) { return "\"" + text + "\""; };
+  out << "name,value,description\n";
+  for (const auto &scalar : scalars_) {
+    out << scalar.name << "," << *scalar.value << "," << quoted(scalar.description) << "\n";
+  }
+  for (const auto &ratio : ratios_) {
+    out << ratio.name << ","
+        << Divide(ratio.scale, *scalars_[ratio.numerator].value, *scalars_[ratio.denominator].value) << ","
+        << quoted(ratio.description) << "\n";
+  }
+  for (const auto &histogram : histograms_) {
+    const StatsHistogram &h = *histogram.histogram;
+    out << histogram.name << ".samples," << h.Samples() << "," << quoted(histogram.description) << "\n";
+    out << histogram.name << ".mean," << h.Mean() << ",\n";
+    for (size_t i = 0; i < h.Buckets().size(); ++i) {
+      out << histogram.name << ".bucket" << i*h.BucketWidth() << "," << h.Buckets()[i] << ",\n";
+    }
+  }
+}
+
+void StatsRegistry::Write(const std::filesystem::path &filename) const {
+  std::ofstream file(filename);
+  if (!file.is_open()) {
+    throw std::runtime_error("Unable to open file: " + filename.string());
+  }
+  if (filename.extension() == ".csv") {
+    WriteCsv(file);
+  } else {
+    WriteJson(file);
+  }
+}
+
+void StatsRegistry::StartTimeSeries(const std::filesystem::path &filename, uint64_t interval, uint64_t cycle) {
+  if (interval == 0) {
+    StopTimeSeries();
+    return;
+  }
+  std::ofstream file(filename);
+  if (!file.is_open()) {
+    throw std::runtime_error("Unable to open file: " + filename.string());
+  }
+  series_ = std::move(file);
+  series_path_ = filename;
+  interval_ = interval;
+  header_written_ = false;
+  std::transform(scalars_.begin(), scalars_.end(), last_values_.begin(),
+                 [](const Scalar &scalar) { return *scalar.value; });
+  last_sample_cycle_ = cycle;
+  next_sample_ = cycle + interval_;
+}
+
+void StatsRegistry::StopTimeSeries() {
+  if (series_.is_open()) {
+    series_.close();
+  }
+  series_path_.clear();
+  interval_ = 0;
+  next_sample_ = kNever;
+}
+
+void StatsRegistry::RestartTimeSeries() {
+  if (interval_ != 0) {
+    std::filesystem::path path = series_path_;
+    StartTimeSeries(path, interval_, 0);
+  }
+}
+
+void StatsRegistry::FlushTimeSeries(uint64_t cycle) {
+  if (interval_ != 0 && cycle > last_sample_cycle_) {
+    WriteInterval(cycle);
+    series_.flush();
+  }
+}
+
+void StatsRegistry::WriteInterval(uint64_t cycle) {
+  if (!header_written_) {
+    series_ << "cycle";
+    for (const auto &scalar : scalars_) {
+      series_ << "," << scalar.name;
+    }
+    for (const auto &ratio : ratios_) {
+      series_ << "," << ratio.name;
+    }
+    series_ << "\n";
+    header_written_ = true;
+  }
+
+  std::vector<uint64_t> deltas(scalars_.size());
+  for (size_t i = 0; i < scalars_.size(); ++i) {
+    uint64_t value = *scalars_[i].value;
+    deltas[i] = value - last_values_[i];
+    last_values_[i] = value;
+  }
+  series_ << cycle;
+  for (uint64_t delta : deltas) {
+    series_ << "," << delta;
+  }
+  for (const auto &ratio : ratios_) {
+    series_ << "," << Divide(ratio.scale, deltas[ratio.numerator], deltas[ratio.denominator]);
+  }
+  series_ << "\n";
+
+  last_sample_cycle_ = cycle;
+  next_sample_ = cycle + interval_;
+}
@@ -0,0 +1,158 @@
+/**
+ * @file stats_registry.h
+ * @brief Contains the registry of named simulation statistics.
+ */
+#ifndef STATS_REGISTRY_H
+#define STATS_REGISTRY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Fixed-width bucket histogram; the last bucket collects everything above the range.
+ */
+class StatsHistogram {
+ public:
+  explicit StatsHistogram(uint64_t bucket_width = 1, size_t buckets = 16)
+      : width_(bucket_width == 0 ? 1 : bucket_width), buckets_(buckets == 0 ? 1 : buckets, 0) {}
+
+  void Sample(uint64_t value) {
+    uint64_t bucket = value / width_;
+    ++buckets_[bucket < buckets_.size() ? bucket : buckets_.size() - 1];
+    ++samples_;
+    sum_ += value;
+  }
+  // Takes back one Sample(value)
+  void Retract(uint64_t value) {
+    uint64_t bucket = value / width_;
+    --buckets_[bucket < buckets_.size() ? bucket : buckets_.size() - 1];
+    --samples_;
+    sum_ -= value;
+  }
+
+  void Clear();
+
+  uint64_t BucketWidth() const { return width_; }
+  const std::vector<uint64_t> &Buckets() const { return buckets_; }
+  uint64_t Samples() const { return samples_; }
+  uint64_t Sum() const { return sum_; }
+  double Mean() const { return samples_ == 0 ? 0.0 : static_cast<double>(sum_)/static_cast<double>(samples_); }
+
+ private:
+  uint64_t width_;
+  std::vector<uint64_t> buckets_;
+  uint64_t samples_ = 0;
+  uint64_t sum_ = 0;
+};
+
+/**
+ * @brief Names the counters of the VM and its modules so they can be dumped together.
+ *
+ * Modules keep their counters as plain uint64_t members (or StatsHistogram
+ * members) and register a pointer to them once, so incrementing a statistic
+ * costs no more than incrementing the field. Formulas are ratios of two
+ * registered scalars (CPI, miss rate, ...), which lets the time series report
+ * them per interval rather than cumulatively.
+ *
+ * When an interval is set, Sample() appends one CSV row of per-interval deltas
+ * every N cycles, which shows program phases that end-of-run totals hide.
+ */
+class StatsRegistry {
+ public:
+  StatsRegistry() = default;
+  StatsRegistry(const StatsRegistry &) = delete;
+  StatsRegistry &operator=(const StatsRegistry &) = delete;
+
+  void AddScalar(const std::string &name, const uint64_t *value, const std::string &description = "");
+  void AddHistogram(const std::string &name, const StatsHistogram *histogram, const std::string &description = "");
+  /**
+   * @brief Registers `scale * numerator / denominator`; both operands must already be registered scalars.
+   */
+  void AddRatio(const std::string &name, const std::string &numerator, const std::string &denominator,
+                double scale = 1.0, const std::string &description = "");
+
+  bool Contains(const std::string &name) const;
+  /**
+   * @brief Current value of a scalar or formula.
+   */
+  double Value(const std::string &name) const;
+
+  /**
+   * @brief Writes all statistics as a JSON object.
+   */
+  void WriteJson(std::ostream &out) const;
+  /**
+   * @brief Writes "name,value,description" rows; histogram buckets become name.bucketN rows.
+   */
+  void WriteCsv(std::ostream &out) const;
+  void Write(const std::filesystem::path &filename) const;  // format chosen by extension (.csv or JSON)
+
+  /**
+   * @brief Starts writing a time-series CSV row every `interval` cycles from `cycle` on; 0 stops it.
+   */
+  void StartTimeSeries(const std::filesystem::path &filename, uint64_t interval, uint64_t cycle = 0);
+  void StopTimeSeries();
+  uint64_t TimeSeriesInterval() const { return interval_; }
+
+  /**
+   * @brief Called by the run loops once per cycle with the current cycle count.
+   */
+  void Sample(uint64_t cycle) {
+    if (cycle >= next_sample_) {
+      WriteInterval(cycle);
+    }
+  }
+  /**
+   * @brief Writes the trailing partial interval, if any (end of a run).
+   */
+  void FlushTimeSeries(uint64_t cycle);
+  /**
+   * @brief Restarts the time series from cycle 0 (VM reset).
+   */
+  void RestartTimeSeries();
+
+ private:
+  static constexpr uint64_t kNever = std::numeric_limits<uint64_t>::max();
+
+  struct Scalar {
+    std::string name;
+    std::string description;
+    const uint64_t *value;
+  };
+  struct Histogram {
+    std::string name;
+    std::string description;
+    const StatsHistogram *histogram;
+  };
+  struct Ratio {
+    std::string name;
+    std::string description;
+    size_t numerator;
+    size_t denominator;
+    double scale;
+  };
+
+  size_t ScalarIndex(const std::string &name) const;
+  static double Divide(double scale, uint64_t numerator, uint64_t denominator);
+  void WriteInterval(uint64_t cycle);
+
+  std::vector<Scalar> scalars_;
+  std::vector<Histogram> histograms_;
+  std::vector<Ratio> ratios_;
+
+  std::filesystem::path series_path_;
+  std::ofstream series_;
+  uint64_t interval_ = 0;
+  uint64_t next_sample_ = kNever;
+  uint64_t last_sample_cycle_ = 0;
+  bool header_written_ = false;
+  std::vector<uint64_t> last_values_;
+};
+
+#endif // STATS_REGISTRY_H
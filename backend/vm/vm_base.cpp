@@ -13,6 +13,21 @@
 // #include <thread>
 
 
+VmBase::VmBase() {
+    stats_.AddScalar("cycles", &cycle_s_, "Simulated cycles");
+    stats_.AddScalar("instructions", &instructions_retired_, "Retired instructions");
+    stats_.AddScalar("stall_cycles", &stall_cycles_, "Cycles with a stalled front end");
+    stats_.AddScalar("branch_mispredictions", &branch_mispredictions_, "Mispredicted branches");
+    for (size_t i = 0; i < InstructionMix::kClassCount; ++i) {
+        auto instruction_class = static_cast<InstructionClass>(i);
+        stats_.AddScalar(std::string("mix.") + InstructionClassName(instruction_class),
+                         instruction_mix_.Counter(instruction_class));
+    }
+    stats_.AddRatio("cpi", "cycles", "instructions", 1.0, "Cycles per instruction");
+    stats_.AddRatio("ipc", "instructions", "cycles", 1.0, "Instructions per cycle");
+    stats_.AddRatio("stall_fraction", "stall_cycles", "cycles", 1.0, "Fraction of cycles stalled");
+}
+
 void VmBase::LoadProgram(const AssembledProgram &program) {
   program_ = program;
   unsigned int counter = 0;
@@ -22,6 +37,9 @@ void VmBase::LoadProgram(const AssembledProgram &program) {
   }
   program_size_ = counter;
   AddBreakpoint(program_size_, false);  // address
+  profiler_.Resize(0, program_size_);
+  call_graph_.Load(program);
+  bbv_.Load(program);
 
   unsigned int data_counter = 0;
   uint64_t base_data_address = vm_config::config.getDataSectionStart();
@@ -71,8 +89,13 @@ void VmBase::LoadProgram(const AssembledProgram &program) {
       }
     }, data);
   }
-  std::cout << "VM_PROGRAM_LOADED" << std::endl;
+  // Loading the data section must not count as a watched store
+  memory_controller_.ClearWatchHit();
   output_status_ = "VM_PROGRAM_LOADED";
+  if (headless_) {
+    return;
+  }
+  std::cout << "VM_PROGRAM_LOADED" << std::endl;
 
   DumpState(globals::vm_state_dump_file_path);
     
@@ -166,30 +189,45 @@ int32_t VmBase::ImmGenerator(uint32_t instruction) {
     return imm;
 }
 
-void VmBase::AddBreakpoint(uint64_t val, bool is_line) {
+void VmBase::AddBreakpoint(uint64_t val, bool is_line, const std::string &condition) {
+    uint64_t bp = val;
     if (is_line) {
         // If the value is a line number, convert it to an instruction address
         if (program_.line_number_instruction_number_mapping.find(val) == program_.line_number_instruction_number_mapping.end()) {
             std::cerr << "Invalid line number: " << val << std::endl;
             return;
         }
-        uint64_t line = val;
-        uint64_t bp = program_.line_number_instruction_number_mapping[line] * 4;
-        if (CheckBreakpoint(bp)) {
-            std::cerr << "Breakpoint already exists at line: " << line << std::endl;
-            return;
-        }
-        breakpoints_.emplace_back(bp);
-    } else {
-        if (val % 4 != 0) {
-            std::cerr << "Invalid instruction address: " << val << ". Must be a multiple of 4." << std::endl;
+        bp = program_.line_number_instruction_number_mapping[val] * 4;
+    } else if (val % 4 != 0) {
+        std::cerr << "Invalid instruction address: " << val << ". Must be a multiple of 4." << std::endl;
+        return;
+    }
+
+    // Compile before touching the table so that a bad condition leaves nothing behind
+    BreakpointCondition compiled;
+    if (!condition.empty()) {
+        try {
+            compiled = BreakpointCondition::Compile(condition);
+        } catch (const std::invalid_argument &e) {
+            std::cerr << e.what() << std::endl;
             return;
         }
-        if (CheckBreakpoint(val)) {
-            std::cerr << "Breakpoint already exists at address: " << val << std::endl;
+    }
+
+    if (CheckBreakpoint(bp)) {
+        if (condition.empty()) {
+            if (is_line)
+                std::cerr << "Breakpoint already exists at line: " << val << std::endl;
+            else
+                std::cerr << "Breakpoint already exists at address: " << val << std::endl;
             return;
         }
-        breakpoints_.emplace_back(val);
+        // Re-adding with a condition replaces the old condition and restarts the hit count
+        breakpoint_conditions_.erase(bp);
+    }
+    breakpoints_.Add(bp);
+    if (!condition.empty()) {
+        breakpoint_conditions_[bp] = {std::move(compiled), 0};
     }
 
     // DumpState(globals::vm_state_dump_file_path);
@@ -208,7 +246,8 @@ void VmBase::RemoveBreakpoint(uint64_t val, bool is_line) {
             std::cerr << "No breakpoint exists at line: " << line << std::endl;
             return;
         }
-        breakpoints_.erase(std::remove(breakpoints_.begin(), breakpoints_.end(), bp), breakpoints_.end());
+        breakpoints_.Remove(bp);
+        breakpoint_conditions_.erase(bp);
     } else {
         if (val % 4 != 0) {
             std::cerr << "Invalid instruction address: " << val << ". Must be a multiple of 4." << std::endl;
@@ -218,17 +257,214 @@ void VmBase::RemoveBreakpoint(uint64_t val, bool is_line) {
             std::cerr << "No breakpoint exists at address: " << val << std::endl;
             return;
         }
-        breakpoints_.erase(std::remove(breakpoints_.begin(), breakpoints_.end(), val), breakpoints_.end());
+        breakpoints_.Remove(val);
+        breakpoint_conditions_.erase(val);
     }
     // DumpState(globals::vm_state_dump_file_path);
 
 
 }
 
-bool VmBase::CheckBreakpoint(uint64_t address) {
-    return std::find(breakpoints_.begin(), breakpoints_.end(), address) != breakpoints_.end();
+bool VmBase::EvaluateBreakpointCondition(uint64_t address) {
+    auto it = breakpoint_conditions_.find(address);
+    if (it == breakpoint_conditions_.end()) {
+        return true;
+    }
+    ConditionalBreakpoint &breakpoint = it->second;
+    ++breakpoint.hits;
+    return breakpoint.condition.Evaluate(*registers_, memory_controller_, breakpoint.hits);
+}
+
+bool VmBase::AddWatchpoint(uint64_t address, uint64_t size, uint8_t kind) {
+    try {
+        if (!memory_controller_.AddWatchpoint(address, size, kind)) {
+            std::cerr << "Watchpoint already exists at address: " << address << std::endl;
+            return false;
+        }
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool VmBase::RemoveWatchpoint(uint64_t address, uint64_t size, uint8_t kind) {
+    if (!memory_controller_.RemoveWatchpoint(address, size, kind)) {
+        std::cerr << "No watchpoint exists at address: " << address << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool VmBase::CheckWatchpointHit() {
+    WatchHit hit;
+    if (!memory_controller_.TakeWatchHit(hit)) {
+        return false;
+    }
+    std::cout << "VM_WATCHPOINT_HIT " << (hit.kind == kWatchRead ? "read" : "write")
+              << " at 0x" << std::hex << hit.address << std::dec << std::endl;
+    output_status_ = "VM_WATCHPOINT_HIT";
+    return true;
+}
+
+
+void VmBase::WriteProfileReport() {
+    if (headless_) {
+        return;
+    }
+    if (profiler_.IsEnabled()) {
+        std::ofstream file(globals::profile_report_file_path);
+        if (file.is_open()) {
+            profiler_.WriteReport(file, program_);
+        } else {
+            std::cerr << "Error opening file for profile report: " << globals::profile_report_file_path.string() << std::endl;
+        }
+    }
+    if (call_graph_.IsEnabled()) {
+        std::ofstream file(globals::call_graph_report_file_path);
+        if (file.is_open()) {
+            call_graph_.WriteReport(file);
+        } else {
+            std::cerr << "Error opening file for call graph report: " << globals::call_graph_report_file_path.string() << std::endl;
+        }
+        try {
+            call_graph_.WriteCollapsedStacks(globals::call_graph_stacks_file_path);
+        } catch (const std::exception &e) {
+            std::cerr << e.what() << std::endl;
+        }
+    }
+    if (bbv_.IsEnabled()) {
+        bbv_.Flush();
+        std::ofstream file(globals::bbv_blocks_file_path);
+        if (file.is_open()) {
+            bbv_.WriteBlockMap(file, program_);
+        } else {
+            std::cerr << "Error opening file for basic block map: " << globals::bbv_blocks_file_path.string() << std::endl;
+        }
+    }
+    if (branch_trace_.IsEnabled()) {
+        branch_trace_.Flush();
+    }
+}
+
+void VmBase::WriteStats() {
+    stats_.FlushTimeSeries(cycle_s_);
+    if (headless_) {
+        return;
+    }
+    try {
+        stats_.Write(globals::stats_file_path);
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+    }
+}
+
+namespace {
+// FNV-1a over the text segment, to refuse snapshots taken from a different program
+uint64_t ProgramFingerprint(const std::vector<uint32_t> &text) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (uint32_t word : text) {
+        for (int i = 0; i < 4; ++i) {
+            hash ^= (word >> (8*i)) & 0xFF;
+            hash *= 0x100000001b3ULL;
+        }
+    }
+    return hash;
+}
+} // namespace
+
+void VmBase::SaveState(const std::filesystem::path &filename) {
+    VmSnapshot snapshot;
+    SaveSnapshot(snapshot);
+    snapshot.Save(filename);
+}
+
+void VmBase::LoadState(const std::filesystem::path &filename) {
+    VmSnapshot snapshot = VmSnapshot::Load(filename);
+    RestoreSnapshot(snapshot);
 }
 
+void VmBase::SaveSnapshot(VmSnapshot &snapshot) {
+    VmSnapshot::Writer core = snapshot.Add(VmSnapshot::Section::kCore);
+    core.Put(ProgramFingerprint(program_.text_buffer));
+    core.Put(program_counter_);
+    core.Put(program_size_);
+    core.Put(current_instruction_);
+    core.Put(cycle_s_);
+    core.Put(instructions_retired_);
+    core.Put(stall_cycles_);
+    core.Put(branch_mispredictions_);
+
+    VmSnapshot::Writer registers = snapshot.Add(VmSnapshot::Section::kRegisters);
+    registers.Put(static_cast<uint32_t>(registers_->GetIsa()));
+    registers.Put(registers_->pc);
+    for (size_t i = 0; i < RegisterFile::NUM_GPR; ++i)
+        registers.Put(registers_->ReadGpr(i));
+    for (size_t i = 0; i < RegisterFile::NUM_FPR; ++i)
+        registers.Put(registers_->ReadFpr(i));
+    for (size_t i = 0; i < RegisterFile::NUM_CSR; ++i)
+        registers.Put(registers_->ReadCsr(i));
+
+    // Block indices first, then the block contents page-aligned so they can be mapped in place
+    VmSnapshot::Writer memory = snapshot.Add(VmSnapshot::Section::kMemory);
+    std::vector<uint64_t> blocks = memory_controller_.GetBlockIndices();
+    uint64_t block_size = memory_controller_.GetBlockSize();
+    memory.Put(block_size);
+    memory.Put(static_cast<uint64_t>(blocks.size()));
+    memory.PutBytes(blocks.data(), blocks.size()*sizeof(uint64_t));
+    memory.Align(VmSnapshot::kPageSize);
+    for (uint64_t block : blocks)
+        memory.PutBytes(memory_controller_.GetBlockData(block), block_size);
+}
+
+void VmBase::RestoreSnapshot(const VmSnapshot &snapshot) {
+    VmSnapshot::Reader core = snapshot.Read(VmSnapshot::Section::kCore);
+    uint64_t fingerprint = core.Get<uint64_t>();
+    if (!program_.text_buffer.empty() && fingerprint != ProgramFingerprint(program_.text_buffer)) {
+        throw std::runtime_error("Snapshot was taken from a different program");
+    }
+    VmSnapshot::Reader memory = snapshot.Read(VmSnapshot::Section::kMemory);
+    uint64_t block_size = memory.Get<uint64_t>();
+    if (block_size != memory_controller_.GetBlockSize()) {
+        throw std::runtime_error("Snapshot memory block size " + std::to_string(block_size)
+                                 + " does not match the configured block size");
+    }
+
+    program_counter_ = core.Get<uint64_t>();
+    program_size_ = core.Get<uint64_t>();
+    current_instruction_ = core.Get<uint32_t>();
+    cycle_s_ = core.Get<uint64_t>();
+    instructions_retired_ = core.Get<uint64_t>();
+    stall_cycles_ = core.Get<uint64_t>();
+    branch_mispredictions_ = core.Get<uint64_t>();
+
+    VmSnapshot::Reader registers = snapshot.Read(VmSnapshot::Section::kRegisters);
+    registers_->SetIsa(static_cast<ISA>(registers.Get<uint32_t>()));
+    registers_->pc = registers.Get<uint64_t>();
+    for (size_t i = 0; i < RegisterFile::NUM_GPR; ++i)
+        registers_->WriteGpr(i, registers.Get<uint64_t>());
+    for (size_t i = 0; i < RegisterFile::NUM_FPR; ++i)
+        registers_->WriteFpr(i, registers.Get<uint64_t>());
+    for (size_t i = 0; i < RegisterFile::NUM_CSR; ++i)
+        registers_->WriteCsr(i, registers.Get<uint64_t>());
+
+    uint64_t count = memory.Get<uint64_t>();
+    if (count > memory.Remaining()/sizeof(uint64_t)) {
+        throw std::runtime_error("Snapshot memory section is truncated");
+    }
+    std::vector<uint64_t> blocks(count);
+    memory.GetBytes(blocks.data(), count*sizeof(uint64_t));
+    memory.Align(VmSnapshot::kPageSize);
+    memory_controller_.Reset();
+    for (uint64_t block : blocks)
+        memory_controller_.RestoreBlock(block, memory.Take(block_size));
+    memory_controller_.ClearWatchHit();
+
+    // Profiles describe the run that produced them, not the restored one
+    instruction_mix_.Clear();
+    profiler_.Clear();
+    call_graph_.Clear();
+}
 
 void VmBase::PrintString(uint64_t address) {
     while (true) {
@@ -264,15 +500,30 @@ void VmBase::DumpState(const std::filesystem::path &filename) {
     file << "    \"disassembly_line_number\": " << program_.instruction_number_disassembly_mapping[instruction_number] << ",\n";
     file << "    \"cycle_count\": " << cycle_s_ << ",\n";
     file << "    \"instructions_retired\": " << instructions_retired_ << ",\n";
-    file << "    \"cpi\": " << cpi_ << ",\n";
-    file << "    \"ipc\": " << ipc_ << ",\n";
+    file << "    \"cpi\": " << stats_.Value("cpi") << ",\n";
+    file << "    \"ipc\": " << stats_.Value("ipc") << ",\n";
     file << "    \"stall_cycles\": " << stall_cycles_ << ",\n";
     file << "    \"branch_mispredictions\": " << branch_mispredictions_ << ",\n";
     file << "    \"breakpoints\": [";
-    for (size_t i = 1; i < breakpoints_.size(); ++i) {
-        program_.instruction_number_line_number_mapping[breakpoints_[i] / 4];
-        file << program_.instruction_number_line_number_mapping[breakpoints_[i] / 4];
-        if (i < breakpoints_.size() - 1) {
+    bool first_breakpoint = true;
+    for (uint64_t address : breakpoints_.Addresses()) {
+        if (address == program_size_) {
+            continue;  // end-of-program sentinel
+        }
+        if (!first_breakpoint) {
+            file << ", ";
+        }
+        file << program_.instruction_number_line_number_mapping[address / 4];
+        first_breakpoint = false;
+    }
+    file << "],\n";
+    file << "    \"watchpoints\": [";
+    const auto &watchpoints = memory_controller_.GetWatchpoints();
+    for (size_t i = 0; i < watchpoints.size(); ++i) {
+        file << "{\"address\": " << watchpoints[i].start
+             << ", \"size\": " << (watchpoints[i].end - watchpoints[i].start)
+             << ", \"kind\": " << static_cast<unsigned int>(watchpoints[i].kind) << "}";
+        if (i + 1 < watchpoints.size()) {
             file << ", ";
         }
     }
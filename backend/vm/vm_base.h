@@ -5,6 +5,15 @@
 #include "registers.h"
 #include "memory_controller.h"
 #include "alu.h"
+#include "breakpoints.h"
+#include "breakpoint_condition.h"
+#include "execution_profiler.h"
+#include "call_graph_profiler.h"
+#include "basic_block_profiler.h"
+#include "branch_trace.h"
+#include "instruction_mix.h"
+#include "stats_registry.h"
+#include "vm_snapshot.h"
 
 #include "../vm_asm_mw.h"
 
@@ -16,6 +25,7 @@
 #include <condition_variable>
 #include <queue>
 #include <atomic>
+#include <unordered_map>
 
 enum SyscallCode {
     SYSCALL_PRINT_INT = 1,
@@ -30,7 +40,7 @@ enum SyscallCode {
 
 class VmBase {
 public:
-    VmBase() = default;
+    VmBase();
     ~VmBase() = default;
 
     AssembledProgram program_;
@@ -39,20 +49,44 @@ public:
     std::condition_variable input_cv_;
     std::queue<std::string> input_queue_;
 
-    std::vector<uint64_t> breakpoints_;
+    BreakpointTable breakpoints_;
+
+    struct ConditionalBreakpoint {
+        BreakpointCondition condition;
+        uint64_t hits = 0;
+    };
+    // Only consulted when the breakpoint table reports a hit
+    std::unordered_map<uint64_t, ConditionalBreakpoint> breakpoint_conditions_;
 
     uint32_t current_instruction_{};
     uint64_t program_counter_{};
     
-    unsigned int cycle_s_{};
-    unsigned int instructions_retired_{};
+    uint64_t cycle_s_{};
+    uint64_t instructions_retired_{};
     float cpi_{};
     float ipc_{};
-    unsigned int stall_cycles_{};
-    unsigned int branch_mispredictions_{};
+    uint64_t stall_cycles_{};
+    uint64_t branch_mispredictions_{};
+    // Per-class and per-opcode counts of the instructions in instructions_retired_
+    InstructionMix instruction_mix_;
+
+    // Named view of the counters above and of any module counters registered later
+    StatsRegistry stats_;
+    // Writes stats_ to vm_state/stats.json and closes the current time-series interval
+    void WriteStats();
 
     std::string output_status_;
 
+    ExecutionProfiler profiler_;
+    CallGraphProfiler call_graph_;
+    BasicBlockProfiler bbv_;
+    BranchTraceWriter branch_trace_;
+    // Writes the reports of whichever profilers are enabled into the vm_state directory
+    void WriteProfileReport();
+    // Set on VMs run in bulk next to the session's one (design-space sweeps): they write no
+    // vm_state files and print no status lines for the frontend
+    bool headless_ = false;
+
     
 
 
@@ -72,9 +106,25 @@ public:
     
     int32_t ImmGenerator(uint32_t instruction);
 
-    void AddBreakpoint(uint64_t val, bool is_line = true);
+    void AddBreakpoint(uint64_t val, bool is_line = true, const std::string &condition = "");
     void RemoveBreakpoint(uint64_t val, bool is_line = true);
-    bool CheckBreakpoint(uint64_t address);
+    bool CheckBreakpoint(uint64_t address) const { return breakpoints_.Contains(address); }
+    // Called by the run loops each time execution reaches `address` with every older
+    // instruction retired; updates hit counts and evaluates the breakpoint condition, if any.
+    // A pipelined VM must not call it at fetch, where registers are stale and the path may be wrong.
+    bool ShouldBreakAt(uint64_t address) {
+        if (!breakpoints_.Contains(address))
+            return false;
+        if (breakpoint_conditions_.empty())
+            return true;
+        return EvaluateBreakpointCondition(address);
+    }
+    bool EvaluateBreakpointCondition(uint64_t address);
+
+    bool AddWatchpoint(uint64_t address, uint64_t size, uint8_t kind);
+    bool RemoveWatchpoint(uint64_t address, uint64_t size, uint8_t kind);
+    // Consumes a pending watchpoint hit, if any, and reports it through output_status_.
+    bool CheckWatchpointHit();
 
     // void fetchInstruction();
     // void decodeInstruction();
@@ -95,6 +145,13 @@ public:
 
     void DumpState(const std::filesystem::path &filename);
 
+    // Binary snapshot of everything needed to resume execution (see VmSnapshot)
+    void SaveState(const std::filesystem::path &filename);
+    void LoadState(const std::filesystem::path &filename);
+    // Subclasses add or restore their own sections; the base handles core state, registers and memory
+    virtual void SaveSnapshot(VmSnapshot &snapshot);
+    virtual void RestoreSnapshot(const VmSnapshot &snapshot);
+
     void ModifyRegister(const std::string &reg_name, uint64_t value);
     void PushInput(const std::string& input) {
         std::lock_guard<std::mutex> lock(input_mutex_);
@@ -0,0 +1,113 @@
+/**
+ * @file vm_snapshot.cpp
+ * @brief Contains the reading and writing of binary VM snapshots.
+ */
+#include "vm_snapshot.h"
+
+#include <fstream>
+
+namespace {
+constexpr char kMagic[8] = {'R', 'V', 'S', 'N', 'A', 'P', '\0', '\0'};
+constexpr uint32_t kByteOrderMarker = 0x01020304;
+
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t section_count;
+  uint32_t reserved;
+};
+
+struct SectionEntry {
+  uint32_t kind;
+  uint32_t reserved;
+  uint64_t offset;
+  uint64_t size;
+};
+
+uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+  return (value + alignment - 1)/alignment*alignment;
+}
+} // namespace
+
+VmSnapshot::Writer VmSnapshot::Add(Section section) {
+  std::vector<uint8_t> &data = sections_[static_cast<uint32_t>(section)];
+  data.clear();
+  return Writer(data);
+}
+
+VmSnapshot::Reader VmSnapshot::Read(Section section) const {
+  auto it = sections_.find(static_cast<uint32_t>(section));
+  if (it == sections_.end()) {
+    throw std::runtime_error("Snapshot has no section " + std::to_string(static_cast<uint32_t>(section)));
+  }
+  return Reader(it->second);
+}
+
+void VmSnapshot::Save(const std::filesystem::path &filename) const {
+  FileHeader header{};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.byte_order = kByteOrderMarker;
+  header.section_count = static_cast<uint32_t>(sections_.size());
+
+  std::vector<SectionEntry> entries;
+  uint64_t offset = AlignUp(sizeof(FileHeader) + sections_.size()*sizeof(SectionEntry), kPageSize);
+  for (const auto &[kind, data] : sections_) {
+    entries.push_back({kind, 0, offset, data.size()});
+    offset = AlignUp(offset + data.size(), kPageSize);
+  }
+
+  std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    throw std::runtime_error("Unable to open file: " + filename.string());
+  }
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char *>(entries.data()),
+             static_cast<std::streamsize>(entries.size()*sizeof(SectionEntry)));
+  size_t i = 0;
+  for (const auto &[kind, data] : sections_) {
+    file.seekp(static_cast<std::streamoff>(entries[i++].offset));
+    file.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+  }
+  if (!file) {
+    throw std::runtime_error("Error writing snapshot: " + filename.string());
+  }
+}
+
+VmSnapshot VmSnapshot::Load(const std::filesystem::path &filename) {
+  std::ifstream file(filename, std::ios::binary);
+  if (!file.is_open()) {
+    throw std::runtime_error("Unable to open file: " + filename.string());
+  }
+  FileHeader header{};
+  file.read(reinterpret_cast<char *>(&header), sizeof(header));
+  if (!file || std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+    throw std::runtime_error("Not a VM snapshot: " + filename.string());
+  }
+  if (header.byte_order != kByteOrderMarker) {
+    throw std::runtime_error("Snapshot was written on a machine with a different byte order");
+  }
+  if (header.version != kVersion) {
+    throw std::runtime_error("Unsupported snapshot version " + std::to_string(header.version));
+  }
+
+  std::vector<SectionEntry> entries(header.section_count);
+  file.read(reinterpret_cast<char *>(entries.data()),
+            static_cast<std::streamsize>(entries.size()*sizeof(SectionEntry)));
+  if (!file) {
+    throw std::runtime_error("Snapshot section table is truncated");
+  }
+
+  VmSnapshot snapshot;
+  for (const auto &entry : entries) {
+    std::vector<uint8_t> &data = snapshot.sections_[entry.kind];
+    data.resize(entry.size);
+    file.seekg(static_cast<std::streamoff>(entry.offset));
+    file.read(reinterpret_cast<char *>(data.data()), static_cast<std::streamsize>(entry.size));
+    if (!file) {
+      throw std::runtime_error("Snapshot section is truncated");
+    }
+  }
+  return snapshot;
+}
@@ -0,0 +1,132 @@
+/**
+ * @file vm_snapshot.h
+ * @brief Contains the versioned binary snapshot format used by save_state/load_state.
+ */
+#ifndef VM_SNAPSHOT_H
+#define VM_SNAPSHOT_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief A set of binary sections that together describe the state of a VM.
+ *
+ * File layout (all integers in host byte order, checked on load):
+ *  - header: magic "RVSNAP\0\0", version, byte-order marker, section count;
+ *  - section table: {kind, offset, size} per section;
+ *  - section payloads, each starting on a 4 KiB boundary.
+ *
+ * Sections only hold fixed-size records and raw arrays, and the memory
+ * section aligns its block data to 4 KiB as well, so the file can be mapped
+ * and the blocks used in place. Loading reads each section with a single
+ * read call.
+ */
+class VmSnapshot {
+ public:
+  static constexpr uint32_t kVersion = 10;
+  static constexpr size_t kPageSize = 4096;
+
+  enum class Section : uint32_t {
+    kCore = 1,             // PC, counters, program fingerprint
+    kRegisters = 2,        // GPRs, FPRs, CSRs
+    kMemory = 3,           // present memory blocks
+    kPipeline = 4,         // pipeline latches and control state
+    kBranchPredictor = 5,  // BTB, RAS, indirect and direction predictor tables
+    kIssueLanes = 6,       // second-lane latches of the dual-issue pipeline
+  };
+
+  /**
+   * @brief Appends raw values to a section.
+   */
+  class Writer {
+   public:
+    explicit Writer(std::vector<uint8_t> &data) : data_(data) {}
+
+    template <typename T>
+    void Put(const T &value) {
+      static_assert(std::is_trivially_copyable_v<T>, "Snapshot values are copied bytewise");
+      PutBytes(&value, sizeof(T));
+    }
+    // Prefixes the value with its size so a build with a different layout rejects it
+    template <typename T>
+    void PutSized(const T &value) {
+      Put(static_cast<uint32_t>(sizeof(T)));
+      Put(value);
+    }
+    void PutBytes(const void *bytes, size_t size) {
+      const auto *begin = static_cast<const uint8_t *>(bytes);
+      data_.insert(data_.end(), begin, begin + size);
+    }
+    void Align(size_t alignment) { data_.resize((data_.size() + alignment - 1)/alignment*alignment, 0); }
+
+   private:
+    std::vector<uint8_t> &data_;
+  };
+
+  /**
+   * @brief Reads raw values back from a section; throws on truncated data.
+   */
+  class Reader {
+   public:
+    explicit Reader(const std::vector<uint8_t> &data) : data_(data) {}
+
+    template <typename T>
+    T Get() {
+      static_assert(std::is_trivially_copyable_v<T>, "Snapshot values are copied bytewise");
+      T value;
+      GetBytes(&value, sizeof(T));
+      return value;
+    }
+    template <typename T>
+    void GetSized(T &value) {
+      if (Get<uint32_t>() != sizeof(T)) {
+        throw std::runtime_error("Snapshot record layout does not match this build");
+      }
+      value = Get<T>();
+    }
+    void GetBytes(void *bytes, size_t size) {
+      std::memcpy(bytes, Take(size), size);
+    }
+    // Returns a pointer to the next `size` bytes and skips them
+    const uint8_t *Take(size_t size) {
+      if (size > data_.size() - position_) {
+        throw std::runtime_error("Snapshot section is truncated");
+      }
+      const uint8_t *bytes = data_.data() + position_;
+      position_ += size;
+      return bytes;
+    }
+    size_t Remaining() const { return data_.size() - position_; }
+    void Align(size_t alignment) { position_ = std::min(data_.size(), (position_ + alignment - 1)/alignment*alignment); }
+
+   private:
+    const std::vector<uint8_t> &data_;
+    size_t position_ = 0;
+  };
+
+  /**
+   * @brief Starts a new (empty) section and returns a writer for it.
+   */
+  Writer Add(Section section);
+  bool Has(Section section) const { return sections_.count(static_cast<uint32_t>(section)) != 0; }
+  /**
+   * @brief Returns a reader for a section; throws if the snapshot does not have it.
+   */
+  Reader Read(Section section) const;
+
+  void Save(const std::filesystem::path &filename) const;
+  static VmSnapshot Load(const std::filesystem::path &filename);
+
+ private:
+  std::map<uint32_t, std::vector<uint8_t>> sections_;
+};
+
+#endif // VM_SNAPSHOT_H
@@ -63,6 +63,12 @@ void VMExecutionThread::run()
         RVSSVMPipelined* pipelinedVm = dynamic_cast<RVSSVMPipelined*>(vm_);
         bool isPipelined = (pipelinedVm != nullptr);
 
+        QString pauseReason;
+        vm_->memory_controller_.ClearWatchHit();
+        if (isPipelined) {
+            pipelinedVm->ArmBreakpoints(true);
+        }
+
         while (!stop_requested_ && instruction_count < max_instructions_) {
 
             // For pipelined: check if both PC is at end AND pipeline is empty
@@ -75,10 +81,30 @@ void VMExecutionThread::run()
                 break;
             }
 
+            // Stop before executing a breakpoint; the first step always runs so that
+            // resuming from a breakpoint makes progress
+            uint64_t pc = vm_->GetProgramCounter();
+            if (!isPipelined && instruction_count > 0 && !atEnd && vm_->ShouldBreakAt(pc)) {
+                pauseReason = QString("Breakpoint hit at PC: 0x%1").arg(pc, 0, 16);
+                break;
+            }
+
             // Execute one step
             vm_->Step();
             instruction_count++;
 
+            // The pipelined VM checks breakpoints as instructions retire and, on a hit,
+            // squashes back to the breakpoint's PC
+            if (isPipelined && pipelinedVm->BreakpointHit()) {
+                pauseReason = QString("Breakpoint hit at PC: 0x%1").arg(vm_->GetProgramCounter(), 0, 16);
+                break;
+            }
+
+            if (vm_->CheckWatchpointHit()) {
+                pauseReason = QString("Watchpoint hit at PC: 0x%1").arg(vm_->GetProgramCounter(), 0, 16);
+                break;
+            }
+
             // Detect infinite loops by checking if instructions are retiring
             if (instruction_count % 1000 == 0) {
                 if (vm_->instructions_retired_ == last_instruction_count) {
@@ -111,6 +137,16 @@ void VMExecutionThread::run()
             }
         }
 
+        if (isPipelined) {
+            pipelinedVm->ArmBreakpoints(false);
+        }
+
+        if (!pauseReason.isEmpty()) {
+            emit executionPaused(pauseReason);
+            running_ = false;
+            return;
+        }
+
         if (instruction_count >= max_instructions_) {
             emit executionError(
                 QString("Execution stopped: Maximum step limit (%1) reached.\n"
@@ -128,6 +164,9 @@ void VMExecutionThread::run()
         emit executionFinished(vm_->instructions_retired_, vm_->cycle_s_);
 
     } catch (const std::exception& ex) {
+        if (RVSSVMPipelined* pipelinedVm = dynamic_cast<RVSSVMPipelined*>(vm_)) {
+            pipelinedVm->ArmBreakpoints(false);
+        }
         emit executionError(QString("Execution error: %1").arg(ex.what()));
     }
 
@@ -25,6 +25,7 @@ signals:
     void stepCompleted();
     void executionFinished(uint64_t instructions, uint64_t cycles);
     void executionError(QString message);
+    void executionPaused(QString reason);
 
 protected:
     void run() override;
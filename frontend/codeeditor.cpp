@@ -181,7 +181,9 @@ void CodeEditor::paintEvent(QPaintEvent *event)
                     const QSet<QString>& stages = pipelineLabels[lineNumber];
 
                     // Build ordered stage list
-                    QStringList stageOrder = {"IF", "ID", "EX", "MEM", "WB"};
+                    // Lane-1 stages of the dual-issue VM and the extra stages of a deeper pipeline carry a number suffix
+                    QStringList stageOrder = {"IF", "IF2", "IF3", "IF4", "ID", "ID2", "EX", "EX2", "EX3", "EX4",
+                                              "MEM", "MEM2", "MEM3", "MEM4", "WB", "WB2"};
                     QStringList orderedStages;
 
                     for (const QString& stageName : stageOrder) {
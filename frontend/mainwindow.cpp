@@ -6,6 +6,8 @@
 #include "../backend/assembler/assembler.h"
 #include "../backend/vm/rvss_vm.h"
 #include "../backend/vm/rvss_vm_pipelined.h"
+#include "../backend/vm/rvss_vm_dual_issue.h"
+#include "../backend/vm/rvss_vm_ooo.h"
 #include "processorwindow.h"
 
 #include <QHBoxLayout>
@@ -29,6 +31,7 @@
 #include <QStackedWidget>
 // #include <QDebug>
 #include <QSlider>
+#include <QStringList>
 #include <qapplication.h>
 
 MainWindow::MainWindow(QWidget *parent)
@@ -203,10 +206,15 @@ MainWindow::MainWindow(QWidget *parent)
     cycleCountLabel = new QLabel("Cycles: 0");
     cycleCountLabel->setStyleSheet("color: #dcdcdc; font-size: 10pt;");
 
+    instructionMixLabel = new QLabel("Mix: -");
+    instructionMixLabel->setStyleSheet("color: #dcdcdc; font-size: 9pt;");
+    instructionMixLabel->setWordWrap(true);
+
     executionLayout->addWidget(executionTitle);
     executionLayout->addWidget(instructionCountLabel);
     executionLayout->addWidget(cpiLabel);
     executionLayout->addWidget(cycleCountLabel);
+    executionLayout->addWidget(instructionMixLabel);
     // executionLayout->addWidget(executionTimeLabel);
     rightLayout->addWidget(executionInfoPanel, 0);
 
@@ -227,6 +235,8 @@ MainWindow::MainWindow(QWidget *parent)
     assembler = new Assembler(registerPanel->getRegisterFile(), this);
     singleCycleVm = new RVSSVM(registerPanel->getRegisterFile(), this);
     pipelinedVm = new RVSSVMPipelined(registerPanel->getRegisterFile(), this);
+    dualIssueVm = new RVSSVMDualIssue(registerPanel->getRegisterFile(), this);
+    outOfOrderVm = new RVSSVMOutOfOrder(registerPanel->getRegisterFile(), this);
     vm = singleCycleVm;
     errorconsole = bottomPanel->getConsole();
     DataSegment *dataSegment = bottomPanel->getDataSegment();
@@ -248,6 +258,9 @@ MainWindow::MainWindow(QWidget *parent)
     connect(executionThread_, &VMExecutionThread::stepCompleted,
             this, &MainWindow::onPeriodicUpdate);
 
+    connect(executionThread_, &VMExecutionThread::executionPaused,
+            this, &MainWindow::onExecutionPaused);
+
     // Create update timer for GUI refresh during execution
     updateTimer_ = new QTimer(this);
     connect(updateTimer_, &QTimer::timeout, this, &MainWindow::onPeriodicUpdate);
@@ -1097,6 +1110,8 @@ void MainWindow::highlightCurrentLine()
     if (!editor || !vm)
         return;
 
+    showPipelineStages(editor);
+
     uint64_t pc = vm->GetProgramCounter();
     unsigned int instructionNum = pc / 4;
 
@@ -1228,6 +1243,23 @@ void MainWindow::updateExecutionInfo()
     else {
         cpiLabel->setText(QString("CPI : %1").arg(cpi,0,'f',2));
     }
+    if (RVSSVMDualIssue *dualVm = qobject_cast<RVSSVMDualIssue *>(vm))
+        cpiLabel->setText(cpiLabel->text() + QString(" | Dual-issue : %1%").arg(100.0 * dualVm->DualIssueRate(), 0, 'f', 1));
+
+    // Non-zero instruction classes as a share of all retired instructions
+    const InstructionMix &mix = vm->instruction_mix_;
+    uint64_t total = mix.Total();
+    QStringList parts;
+    for (size_t i = 0; i < InstructionMix::kClassCount && total > 0; ++i)
+    {
+        auto instructionClass = static_cast<InstructionClass>(i);
+        uint64_t count = mix.Count(instructionClass);
+        if (count == 0)
+            continue;
+        parts << QString("%1 %2%").arg(InstructionClassName(instructionClass))
+                                   .arg(100.0 * count / total, 0, 'f', 1);
+    }
+    instructionMixLabel->setText(parts.isEmpty() ? QString("Mix: -") : "Mix: " + parts.join(", "));
 }
 
 void MainWindow::refreshMemoryDisplay()
@@ -1287,22 +1319,22 @@ void MainWindow::showProcessorSelection()
                                         .arg(lastName, lastISA));
         ISA selected = (lastISA == "RV32") ? ISA::RV32 : ISA::RV64;
 
-        // ✅ Disconnect old pipelined signals
-        RVSSVMPipelined *oldPipeVm = qobject_cast<RVSSVMPipelined *>(vm);
-        if (oldPipeVm)
-        {
-            disconnect(oldPipeVm, &RVSSVMPipelined::pipelineStageChanged,
-                       this, &MainWindow::onPipelineStageChanged);
-        }
-
         // Switch VM
         if (lastName == "Single-cycle processor")
         {
             vm = singleCycleVm;
         }
+        else if (lastName == "Out-of-order processor")
+        {
+            vm = outOfOrderVm;
+            vm->SetPipelineConfig(true, true, true, true);
+        }
         else
         {
-            vm = pipelinedVm;
+            if (lastName == "Dual-issue in-order processor")
+                vm = dualIssueVm;
+            else
+                vm = pipelinedVm;
 
             RVSSVMPipelined *pipeVm = qobject_cast<RVSSVMPipelined *>(vm);
             if (pipeVm)
@@ -1329,14 +1361,11 @@ void MainWindow::showProcessorSelection()
                     qDebug() << "static Branch";
                     vm->SetPipelineConfig(true, true, true, false);
                 }
-                else if (lastName == "5-stage processor with dynamic 1-bit Branch prediction")
+                else if (lastName == "5-stage processor with dynamic 1-bit Branch prediction" ||
+                         lastName == "Dual-issue in-order processor")
                 {
                     vm->SetPipelineConfig(true, true, true, true);
                 }
-
-                // ✅ Connect new pipelined signals
-                connect(pipeVm, &RVSSVMPipelined::pipelineStageChanged,
-                        this, &MainWindow::onPipelineStageChanged);
             }
         }
 
@@ -1350,7 +1379,7 @@ void MainWindow::showProcessorSelection()
             vm->LoadProgram(program);
         }
 
-        vm->registers_->SetIsa(selected);
+        vm->SetIsa(selected);
         updateRegisterTable();
         updateExecutionInfo();
         refreshMemoryDisplay();
@@ -1364,46 +1393,27 @@ void MainWindow::showProcessorSelection()
     }
 }
 
-void MainWindow::onPipelineStageChanged(uint64_t pc, QString stage)
+void MainWindow::showPipelineStages(CodeEditor *editor)
 {
-    CodeEditor *editor = getCurrentEditor();
-    if (!editor)
+    RVSSVMPipelined *pipeVm = qobject_cast<RVSSVMPipelined *>(vm);
+    if (!pipeVm)
         return;
 
-    // Convert PC to line number
-    unsigned int instrIndex = static_cast<unsigned int>(pc / 4);
-    auto it = program.instruction_number_line_number_mapping.find(instrIndex);
-    if (it == program.instruction_number_line_number_mapping.end())
+    // Published after every Step and at the end of a Run; polled here, at the refresh rate
+    StageSnapshot stages = pipeVm->PublishedStages();
+    editor->clearAllPipelineLabels();
+    for (size_t i = 0; i < kPipelineStageCount; ++i)
     {
-        // qDebug() << "No mapping found for PC" << pc;
-        if (stage.endsWith("_CLEAR"))
-        {
-            QString baseStage = stage.left(stage.indexOf("_CLEAR"));
-            QMap<int, QSet<QString>> labels = editor->getPipelineLabels();
+        PipelineStage stage = static_cast<PipelineStage>(i);
+        if (!stages.Holds(stage))
+            continue;
 
-            for (auto lineIt = labels.begin(); lineIt != labels.end(); ++lineIt)
-            {
-                if (lineIt.value().contains(baseStage))
-                {
-                    editor->clearPipelineLabels(lineIt.key(), baseStage);
-                }
-            }
-            return;
-        }
-    }
-    unsigned int sourceLine = it->second; // 1-based
-
-    // Handle CLEAR or SET
-    if (stage.endsWith("_CLEAR"))
-    {
-        QString baseStage = stage.left(stage.indexOf("_CLEAR"));
-        editor->clearPipelineLabels(sourceLine, baseStage);
-        // qDebug() << "Cleared" << baseStage << "from line" << sourceLine;
-    }
-    else
-    {
-        editor->setPipelineLabel(sourceLine, stage);
-        // qDebug() << "Set" << stage << "at line" << sourceLine;
+        // Convert PC to line number
+        unsigned int instrIndex = static_cast<unsigned int>(stages.Pc(stage) / 4);
+        auto it = program.instruction_number_line_number_mapping.find(instrIndex);
+        if (it == program.instruction_number_line_number_mapping.end())
+            continue;
+        editor->setPipelineLabel(it->second, PipelineStageName(stage));
     }
 }
 
@@ -1425,14 +1435,19 @@ void MainWindow::onExecutionFinished(uint64_t instructions, uint64_t cycles)
 
     double cpi = instructions > 0 ? (double)cycles / instructions : 0.0;
     if (errorconsole) {
-        errorconsole->addMessages({
+        QVector<std::string> messages = {
             "==========================================",
             "Execution completed successfully!",
             QString("Instructions: %1").arg(instructions).toStdString(),
             QString("Cycles: %1").arg(cycles).toStdString(),
-            QString("CPI: %1").arg(cpi, 0, 'f', 2).toStdString(),
-            "=========================================="
-        });
+            QString("CPI: %1").arg(cpi, 0, 'f', 2).toStdString()
+        };
+        if (RVSSVMDualIssue *dualVm = qobject_cast<RVSSVMDualIssue *>(vm))
+            messages.append(QString("Dual-issue cycles: %1%").arg(100.0 * dualVm->DualIssueRate(), 0, 'f', 1).toStdString());
+        if (RVSSVMOutOfOrder *oooVm = qobject_cast<RVSSVMOutOfOrder *>(vm))
+            messages.append(QString("Mean ROB occupancy: %1").arg(oooVm->MeanRobOccupancy(), 0, 'f', 1).toStdString());
+        messages.append("==========================================");
+        errorconsole->addMessages(messages);
     }
 
     statusBar()->showMessage(
@@ -1482,6 +1497,25 @@ void MainWindow::onExecutionError(QString message)
     QMessageBox::critical(this, "Execution Error", message);
 }
 
+void MainWindow::onExecutionPaused(QString reason)
+{
+    updateTimer_->stop();
+
+    isPaused_ = true;
+    resumeAction->setEnabled(true);
+
+    updateRegisterTable();
+    highlightCurrentLine();
+    updateExecutionInfo();
+    refreshMemoryDisplay();
+
+    if (errorconsole) {
+        errorconsole->addMessages({ reason.toStdString() });
+    }
+
+    statusBar()->showMessage(reason + " - press Resume to continue", 5000);
+}
+
 void MainWindow::onPeriodicUpdate()
 {
     // Update GUI periodically during execution
@@ -1496,7 +1530,7 @@ void MainWindow::onPeriodicUpdate()
         RVSSVMPipelined *pipeVm = qobject_cast<RVSSVMPipelined *>(vm);
         if (pipeVm)
         {
-            // Pipeline labels are updated via signals, but we can force a repaint
+            // highlightCurrentLine pulled the latest stages; repaint them
             editor->viewport()->update();
         }
     }
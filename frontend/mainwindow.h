@@ -19,6 +19,8 @@ class ErrorConsole;
 class Assembler;
 class RVSSVM;
 class RVSSVMPipelined;
+class RVSSVMDualIssue;
+class RVSSVMOutOfOrder;
 class VMExecutionThread;
 struct ErrorMessage;
 
@@ -51,6 +53,8 @@ private:
     RVSSVM *vm;
     RVSSVM* singleCycleVm = nullptr;
     RVSSVMPipelined* pipelinedVm = nullptr;
+    RVSSVMDualIssue* dualIssueVm = nullptr;
+    RVSSVMOutOfOrder* outOfOrderVm = nullptr;
 
     QVector<FileTab> fileTabs;
 
@@ -67,6 +71,7 @@ private:
     QLabel *instructionCountLabel;
     QLabel *cpiLabel;
     QLabel *cycleCountLabel;
+    QLabel *instructionMixLabel;
     QLabel *executionTimeLabel;
 
     void updateRegisterTable();
@@ -76,6 +81,8 @@ private:
     bool promptSaveChanges(int tabIndex);
     bool saveToFile(int tabIndex, const QString &filePath);
     void highlightCurrentLine();
+    // Labels the lines of the instructions in each pipeline stage, from the VM's latest snapshot
+    void showPipelineStages(CodeEditor *editor);
     void clearLineHighlight();
     void refreshMemoryDisplay();
 
@@ -104,9 +111,9 @@ private slots:
     void onStop();
     void onUndo();
     void onReset();
-    void onPipelineStageChanged(uint64_t pc, QString stage);
     void onExecutionFinished(uint64_t instructions, uint64_t cycles);
     void onExecutionError(QString message);
+    void onExecutionPaused(QString reason);
     void onPeriodicUpdate();
 
     // void onRunSlow();
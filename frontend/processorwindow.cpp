@@ -27,6 +27,8 @@ ProcessorWindow::ProcessorWindow(QWidget *parent)
         "5-stage processor w/o forwarding unit",
         "5-stage processor with static Branch prediction",
         "5-stage processor with dynamic 1-bit Branch prediction",
+        "Dual-issue in-order processor",
+        "Out-of-order processor",
         "Single-cycle processor"
     });
 
@@ -101,6 +103,8 @@ void ProcessorWindow::onISAChanged(int index)
                               "5-stage processor w/o forwarding unit",
                               "5-stage processor with static Branch prediction",
                               "5-stage processor with dynamic 1-bit Branch prediction",
+                              "Dual-issue in-order processor",
+                              "Out-of-order processor",
                               "Single-cycle processor"
                               });
     } else {
@@ -110,6 +114,8 @@ void ProcessorWindow::onISAChanged(int index)
                               "5-stage processor w/o forwarding unit",
                               "5-stage processor with static Branch prediction",
                               "5-stage processor with dynamic 1-bit Branch prediction",
+                              "Dual-issue in-order processor",
+                              "Out-of-order processor",
                               "Single-cycle processor"
                               });
     }
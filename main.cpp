@@ -1,14 +1,53 @@
 #include "mainwindow.h"
+#include "command_handler.h"
+#include "rvss_vm_dual_issue.h"
+#include "rvss_vm_ooo.h"
 
 #include <QApplication>
+#include <QCoreApplication>
 #include <QDir>
 #include <QDebug>
 
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+
+// risc-simulator --cli [single_cycle|pipelined|dual_issue|out_of_order]
+// Reads console commands (load, run, step, profile, stats, ...) from stdin
+// instead of opening the GUI, so runs can be scripted.
+static int RunCommandLine(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    const std::string kind = argc > 2 ? argv[2] : "pipelined";
+
+    RegisterFile registers;
+    std::unique_ptr<RVSSVM> vm;
+    if (kind == "single_cycle")
+        vm = std::make_unique<RVSSVM>(&registers);
+    else if (kind == "pipelined")
+        vm = std::make_unique<RVSSVMPipelined>(&registers);
+    else if (kind == "dual_issue")
+        vm = std::make_unique<RVSSVMDualIssue>(&registers);
+    else if (kind == "out_of_order")
+        vm = std::make_unique<RVSSVMOutOfOrder>(&registers);
+    else
+    {
+        std::cerr << "Unknown VM: " << kind << " (single_cycle, pipelined, dual_issue or out_of_order)" << std::endl;
+        return 2;
+    }
+    if (kind != "single_cycle")
+        vm->SetPipelineConfig(true, true, true, true);
+    return command_handler::RunConsole(std::cin, *vm) == 0 ? 0 : 1;
+}
+
 int main(int argc, char *argv[])
 {
+    if (argc > 1 && std::strcmp(argv[1], "--cli") == 0)
+        return RunCommandLine(argc, argv);
+
     QApplication a(argc, argv);
     MainWindow w;
     w.show();
     return a.exec();
 }
-